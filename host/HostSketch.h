@@ -0,0 +1,60 @@
+#ifndef HOST_SKETCH_H
+#define HOST_SKETCH_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file declares the parts of the sketch the host programs use.
+ * The pin numbers and the EEPROM map come from the sketch's own
+ * HardwareConfig.h. The settings below are private to the sketch and
+ * repeated here; sketch.cpp checks them against it.
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+#include "si5351_VFODefinition.h"
+#include "VFOBank.h"
+#include "HardwareConfig.h"
+
+#define HOST_DISPLAY_BAND_LINES          3
+#define HOST_ENCODER_MOVEMENT_THRESHOLD  2
+#define HOST_SWEEP_MIN_DWELL_MICROS   2000
+
+/**
+ * sketch entry points
+ */
+void setup();
+void loop();
+boolean updateSelectedFrequencyValue();
+boolean statePersistencePending();
+
+/**
+ * sketch state
+ */
+extern Si5351        si5351;
+extern Si5351Group   si5351Devices;
+extern VFOBank       vfoBank;
+extern unsigned long frequency_delta;
+extern volatile long  encoder_movement;
+extern boolean       sweep_active;
+extern boolean       beacon_active;
+extern boolean       scan_active;
+
+#endif // HOST_SKETCH_H
@@ -0,0 +1,232 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for the Arduino core, used to build the sketch on a
+ * workstation. It provides the subset of the core the sketch uses,
+ * laid out like an Uno (AT328): pins 0-7 on port D, 8-13 on port B,
+ * 14-19 on port C, INT0/INT1 on pins 2/3.
+ *
+ * Time is virtual. It only moves when the sketch calls delay(),
+ * delayMicroseconds() or sleeps, or when the host code advances it
+ * (see HostHAL.h), so runs are repeatable and profilers only see
+ * sketch code.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+typedef bool     boolean;
+typedef uint8_t  byte;
+
+#define HIGH                 0x1
+#define LOW                  0x0
+
+#define INPUT                0x0
+#define OUTPUT               0x1
+#define INPUT_PULLUP         0x2
+
+#define CHANGE               1
+#define FALLING              2
+#define RISING               3
+
+#define DEC                  10
+#define HEX                  16
+#define OCT                  8
+#define BIN                  2
+
+#define NOT_A_PIN            0
+#define NOT_AN_INTERRUPT     -1
+
+#define SDA                  18
+#define SCL                  19
+#define A0                   14
+#define A1                   15
+#define A2                   16
+#define A3                   17
+#define A4                   18
+#define A5                   19
+
+#define bit(b)               (1UL << (b))
+#define bitRead(value, b)    (((value) >> (b)) & 0x01)
+
+/**
+ * processor registers used by the sketch
+ */
+extern volatile uint8_t SREG;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t WDTCSR;
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCIFR;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PINC;
+extern volatile uint8_t PIND;
+extern volatile uint8_t EECR;
+extern volatile uint8_t EEDR;
+extern volatile uint16_t EEAR;
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIFR1;
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCSRA;
+extern volatile uint16_t ADC;
+
+#define SREG_I               7
+#define WDIE                 6
+#define WDE                  3
+#define EERIE                3
+#define EEMPE                2
+#define EEPE                 1
+#define EERE                 0
+#define WGM12                3
+#define CS12                 2
+#define CS11                 1
+#define CS10                 0
+#define OCIE1A               1
+#define OCF1A                1
+#define REFS0                6
+#define ADEN                 7
+#define ADSC                 6
+#define ADIF                 4
+#define ADIE                 3
+#define ADPS2                2
+#define ADPS1                1
+#define ADPS0                0
+
+#define E2END                1023
+
+#ifndef F_CPU
+#define F_CPU                16000000UL
+#endif
+
+/**
+ * Uno pin mapping helpers, as in pins_arduino.h
+ */
+#define PB                   2
+#define PC                   3
+#define PD                   4
+
+#define digitalPinToPort(p)        (((p) < 8) ? PD : (((p) < 14) ? PB : PC))
+#define digitalPinToBitMask(p)     ((uint8_t)(1 << (((p) < 8) ? (p) : (((p) < 14) ? (p) - 8 : (p) - 14))))
+#define portInputRegister(P)       (((P) == PB) ? &PINB : (((P) == PC) ? &PINC : (((P) == PD) ? &PIND : (volatile uint8_t *)0)))
+#define digitalPinToPCICR(p)       ((((p) >= 0) && ((p) <= 21)) ? (&PCICR) : ((volatile uint8_t *)0))
+#define digitalPinToPCICRbit(p)    (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p)       (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (((p) <= 21) ? (&PCMSK1) : ((volatile uint8_t *)0))))
+#define digitalPinToPCMSKbit(p)    (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+#define digitalPinToInterrupt(p)   ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+/**
+ * core functions
+ */
+void          pinMode(uint8_t pin, uint8_t mode);
+int           digitalRead(uint8_t pin);
+void          digitalWrite(uint8_t pin, uint8_t val);
+int           analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+
+void          attachInterrupt(uint8_t interruptNum, void (*handler)(), int mode);
+void          detachInterrupt(uint8_t interruptNum);
+void          noInterrupts();
+void          interrupts();
+
+/**
+ * flash strings are plain strings on the host
+ */
+class __FlashStringHelper;
+#define F(string_literal)    (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
+
+/**
+ * This class is the output base class, as in Print.h
+ */
+class Print {
+protected:
+   size_t printNumber(unsigned long n, uint8_t base);
+
+public:
+   virtual ~Print() {}
+
+   virtual size_t write(uint8_t c) = 0;
+   virtual size_t write(const uint8_t *buffer, size_t size);
+
+   size_t write(const char *str) {
+      return (str == 0) ? 0 : write((const uint8_t *)str, strlen(str));
+   }
+
+   size_t print(const __FlashStringHelper *s);
+   size_t print(const char *s);
+   size_t print(char c);
+   size_t print(unsigned char n, int base = DEC);
+   size_t print(int n, int base = DEC);
+   size_t print(unsigned int n, int base = DEC);
+   size_t print(long n, int base = DEC);
+   size_t print(unsigned long n, int base = DEC);
+   size_t print(double n, int digits = 2);
+
+   size_t println();
+   template <typename T> size_t println(T value) {
+      size_t n = print(value);
+      return n + println();
+   }
+   template <typename T> size_t println(T value, int base) {
+      size_t n = print(value, base);
+      return n + println();
+   }
+};
+
+/**
+ * This class is the serial port. Output is captured, input is
+ * queued by the host code (see HostHAL.h).
+ */
+class HardwareSerial : public Print {
+public:
+   void   begin(unsigned long baud);
+   void   end();
+   int    available();
+   int    availableForWrite();
+   int    peek();
+   int    read();
+   void   flush();
+   virtual size_t write(uint8_t c);
+   using Print::write;
+   operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
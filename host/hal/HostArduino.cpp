@@ -0,0 +1,908 @@
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the host implementation of the Arduino core
+ * subset: virtual clock, pins, interrupt delivery, sleep, watchdog,
+ * timer 1 in CTC mode, the ADC and the serial port.
+ */
+#include <deque>
+#include <vector>
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/eeprom.h>
+#include "HostHAL.h"
+
+#define HOST_NUMBER_OF_PINS      20
+#define HOST_TIMER0_TICK_MICROS  1024
+#define HOST_EEPROM_WRITE_MICROS 3400
+#define HOST_SERIAL_BUFFER       63      // bytes a 64 byte serial ring holds
+#define HOST_SERIAL_FRAME_BITS   10      // start, 8 data, stop
+#define HOST_CYCLES_PER_MICRO    (F_CPU / 1000000UL)
+
+/**
+ * registers
+ */
+volatile uint8_t SREG   = bit(SREG_I);
+volatile uint8_t MCUSR  = 0;
+volatile uint8_t WDTCSR = 0;
+volatile uint8_t PCICR  = 0;
+volatile uint8_t PCIFR  = 0;
+volatile uint8_t PCMSK0 = 0;
+volatile uint8_t PCMSK1 = 0;
+volatile uint8_t PCMSK2 = 0;
+volatile uint8_t PINB   = 0xff;
+volatile uint8_t PINC   = 0xff;
+volatile uint8_t PIND   = 0xff;
+volatile uint8_t EECR   = 0;
+volatile uint8_t EEDR   = 0;
+volatile uint16_t EEAR  = 0;
+volatile uint8_t TCCR1A = 0;
+volatile uint8_t TCCR1B = 0;
+volatile uint8_t TIMSK1 = 0;
+volatile uint8_t TIFR1  = 0;
+volatile uint16_t TCNT1 = 0;
+volatile uint16_t OCR1A = 0;
+volatile uint8_t ADMUX  = 0;
+volatile uint8_t ADCSRA = 0;
+volatile uint16_t ADC   = 0;
+
+HardwareSerial Serial;
+
+/**
+ * pin change vectors, defined by the sketch if it uses them
+ */
+extern "C" void host_vector_PCINT0(void) __attribute__ ((weak));
+extern "C" void host_vector_PCINT1(void) __attribute__ ((weak));
+extern "C" void host_vector_PCINT2(void) __attribute__ ((weak));
+
+/**
+ * EEPROM ready vector, defined by the sketch if it uses it
+ */
+extern "C" void host_vector_EE_READY(void) __attribute__ ((weak));
+
+/**
+ * timer 1 compare vector, defined by the sketch if it uses it
+ */
+extern "C" void host_vector_TIMER1_COMPA(void) __attribute__ ((weak));
+
+/**
+ * ADC conversion complete vector, defined by the sketch if it uses it
+ */
+extern "C" void host_vector_ADC(void) __attribute__ ((weak));
+
+namespace {
+
+   uint64_t          g_now            = 0;
+   uint64_t          g_powerDownTotal = 0;
+   HostScheduler    *g_scheduler      = 0;
+   HostStats         g_stats;
+
+   uint8_t           g_pinLevel[HOST_NUMBER_OF_PINS];
+   uint8_t           g_pinMode[HOST_NUMBER_OF_PINS];
+   int               g_analog[HOST_NUMBER_OF_PINS];
+   bool              g_pinsReady      = false;
+
+   void            (*g_intHandler[2])() = { 0, 0 };
+   int               g_intMode[2]     = { 0, 0 };
+   uint8_t           g_intPending     = 0;    // bit 0,1 INT0/1
+   std::vector<void (*)()> g_raised;
+
+   uint8_t           g_sleepMode      = SLEEP_MODE_IDLE;
+   bool              g_sleepEnabled   = false;
+
+   bool              g_wdtEnabled     = false;
+   uint64_t          g_wdtLastReset   = 0;
+   uint64_t          g_wdtTimeout     = 0;
+
+   uint8_t           g_eeprom[E2END + 1];
+   bool              g_eepromReady    = false;
+   uint64_t          g_eepromDone     = UINT64_MAX;   // end of write in progress
+
+   uint16_t          g_t1Prescale     = 0;              // 0 while timer 1 is stopped
+   uint64_t          g_t1Last         = 0;              // cycle of the last compare match
+   uint64_t          g_t1Next         = 0;              // cycle of the next compare match
+
+   int             (*g_analogSource)(uint8_t) = 0;
+   uint64_t          g_adcDone        = UINT64_MAX;     // end of conversion in progress
+   uint16_t          g_adcValue       = 0;              // its result
+   bool              g_adcWarm        = false;          // first conversion done since ADEN
+
+   unsigned long     g_serialBaud     = 0;              // 0 before begin(), bytes move at once
+   std::deque<std::pair<uint64_t, char> > g_serialLine;   // bytes on the way in, arrival times
+   uint64_t          g_serialLineFree = 0;              // end of the last byte on the way in
+   std::deque<char>  g_serialIn;                        // receive buffer
+   std::deque<std::pair<uint64_t, char> > g_serialOut;    // bytes written, times fully sent
+   uint64_t          g_serialTxFree   = 0;              // end of the last byte written
+   bool              g_serialEcho     = false;
+
+   std::vector<HostTraceRecord> *g_traceLog = 0;
+
+  /**
+   * sets pins to power on state - inputs pulled up
+   */
+   void initPins() {
+      if (!g_pinsReady) {
+         for (int ii=0; ii<HOST_NUMBER_OF_PINS; ++ii) {
+            g_pinLevel[ii] = HIGH;
+            g_pinMode[ii]  = INPUT;
+            g_analog[ii]   = 0;
+         }
+         g_pinsReady = true;
+      }
+   }
+
+  /**
+   * rebuilds port input registers from pin levels
+   */
+   void updatePorts() {
+      uint8_t b = 0, c = 0, d = 0;
+      for (int ii=0; ii<HOST_NUMBER_OF_PINS; ++ii) {
+         if (g_pinLevel[ii]) {
+            if (ii < 8)       d |= bit(ii);
+            else if (ii < 14) b |= bit(ii - 8);
+            else              c |= bit(ii - 14);
+         }
+      }
+      PINB = b;
+      PINC = c;
+      PIND = d;
+   }
+
+  /**
+   * sets EEPROM to its erased state
+   */
+   void initEEPROM() {
+      if (!g_eepromReady) {
+         memset(g_eeprom, 0xff, sizeof(g_eeprom));
+         g_eepromReady = true;
+      }
+   }
+
+  /**
+   * starts a write the sketch has asked for, and ends one whose
+   * time is up
+   */
+   void pollEEPROM() {
+      if ((g_eepromDone != UINT64_MAX) && (g_now >= g_eepromDone)) {
+         g_eepromDone = UINT64_MAX;
+         EECR &= ~bit(EEPE);
+      }
+      if ((EECR & bit(EEPE)) && (g_eepromDone == UINT64_MAX)) {
+         if (EECR & bit(EEMPE)) {
+            initEEPROM();
+            g_eeprom[EEAR & E2END] = EEDR;
+            ++g_stats.eepromWrites;
+            g_eepromDone = g_now + HOST_EEPROM_WRITE_MICROS;
+         }
+         else {
+            // EEPE without EEMPE is ignored by the part
+            EECR &= ~bit(EEPE);
+         }
+         EECR &= ~bit(EEMPE);
+      }
+   }
+
+  /**
+   * gets the time one byte takes on the serial line
+   * @return us, 0 before the port is opened
+   */
+   uint64_t serialByteMicros() {
+      return (g_serialBaud != 0)
+           ? (HOST_SERIAL_FRAME_BITS * 1000000ULL + g_serialBaud / 2) / g_serialBaud
+           : 0;
+   }
+
+  /**
+   * moves bytes that have arrived into the receive buffer,
+   * dropping them when it is full as the serial interrupt does
+   */
+   void pollSerial() {
+      while (!g_serialLine.empty() && (g_serialLine.front().first <= g_now)) {
+         if (g_serialIn.size() < HOST_SERIAL_BUFFER) {
+            g_serialIn.push_back(g_serialLine.front().second);
+         }
+         else {
+            ++g_stats.serialRxDropped;
+         }
+         g_serialLine.pop_front();
+      }
+   }
+
+  /**
+   * gets the arrival time of the next byte on the way in
+   */
+   uint64_t nextSerialArrival() {
+      return g_serialLine.empty() ? UINT64_MAX : g_serialLine.front().first;
+   }
+
+  /**
+   * gets the timer 1 prescaler picked by the clock select bits
+   * @return 0 when stopped or clocked from the T1 pin
+   */
+   uint16_t timer1Prescale() {
+      static const uint16_t prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+      return prescale[TCCR1B & (bit(CS12) | bit(CS11) | bit(CS10))];
+   }
+
+  /**
+   * runs timer 1 up to now: starts and stops it as the clock select
+   * bits change, sets OCF1A at each compare match, and brings TCNT1
+   * up to date. Only CTC mode (WGM12) is modelled; matches are kept
+   * in CPU cycles, so a period that is not a whole number of us does
+   * not drift.
+   */
+   void pollTimer1() {
+      uint64_t cycle    = g_now * HOST_CYCLES_PER_MICRO;
+      uint16_t prescale = timer1Prescale();
+
+      if (prescale != g_t1Prescale) {
+         if ((g_t1Prescale != 0) && (prescale == 0)) {
+            TCNT1 = (uint16_t)((cycle - g_t1Last) / g_t1Prescale);
+         }
+         if (prescale != 0) {
+            // the sketch clears OCF1A by writing a one before starting
+            // the timer; a plain variable cannot tell that from a set
+            TIFR1   &= ~bit(OCF1A);
+            g_t1Last = cycle - (uint64_t)TCNT1 * prescale;
+            g_t1Next = g_t1Last + ((uint64_t)OCR1A + 1) * prescale;
+         }
+         g_t1Prescale = prescale;
+      }
+      if ((g_t1Prescale == 0) || !(TCCR1B & bit(WGM12))) {
+         return;
+      }
+
+      while (g_t1Next <= cycle) {
+         TIFR1   |= bit(OCF1A);
+         g_t1Last = g_t1Next;
+         g_t1Next = g_t1Last + ((uint64_t)OCR1A + 1) * g_t1Prescale;
+      }
+      TCNT1 = (uint16_t)((cycle - g_t1Last) / g_t1Prescale);
+   }
+
+  /**
+   * gets the time of the next timer 1 compare match that will raise
+   * an interrupt
+   */
+   uint64_t nextTimer1Match() {
+      if ((g_t1Prescale == 0) || !(TCCR1B & bit(WGM12)) || !(TIMSK1 & bit(OCIE1A))) {
+         return UINT64_MAX;
+      }
+      return (g_t1Next + HOST_CYCLES_PER_MICRO - 1) / HOST_CYCLES_PER_MICRO;
+   }
+
+  /**
+   * gets the value on an analog pin now
+   */
+   int analogValue(uint8_t pin) {
+      if (pin < A0) {
+         pin += A0;
+      }
+      if (pin >= HOST_NUMBER_OF_PINS) {
+         return 0;
+      }
+      int value = (g_analogSource != 0) ? g_analogSource(pin) : g_analog[pin];
+      return (value < 0) ? 0 : ((value > 1023) ? 1023 : value);
+   }
+
+  /**
+   * starts a conversion the sketch has asked for with ADSC, and ends
+   * one whose time is up: the result goes in ADC, ADSC clears and ADIF
+   * sets. The input is taken when the conversion starts. A conversion
+   * is 13 ADC clocks, 25 for the first after ADEN is set.
+   */
+   void pollADC() {
+      if (!(ADCSRA & bit(ADEN))) {
+         g_adcWarm = false;
+         g_adcDone = UINT64_MAX;
+         ADCSRA   &= ~bit(ADSC);
+         return;
+      }
+      if ((g_adcDone != UINT64_MAX) && (g_now >= g_adcDone)) {
+         g_adcDone = UINT64_MAX;
+         g_adcWarm = true;
+         ADC       = g_adcValue;
+         ADCSRA    = (ADCSRA & ~bit(ADSC)) | bit(ADIF);
+      }
+      if ((ADCSRA & bit(ADSC)) && (g_adcDone == UINT64_MAX)) {
+         uint8_t  adps     = ADCSRA & (bit(ADPS2) | bit(ADPS1) | bit(ADPS0));
+         uint64_t prescale = (adps == 0) ? 2 : (1ULL << adps);
+         uint64_t clocks   = g_adcWarm ? 13 : 25;
+         g_adcValue = (uint16_t)analogValue(ADMUX & 0x07);
+         g_adcDone  = g_now + (clocks * prescale + HOST_CYCLES_PER_MICRO - 1) / HOST_CYCLES_PER_MICRO;
+      }
+   }
+
+  /**
+   * checks for the ADC conversion complete interrupt
+   */
+   bool adcRaised() {
+      return (ADCSRA & bit(ADIF)) && (ADCSRA & bit(ADIE)) && (host_vector_ADC != 0);
+   }
+
+  /**
+   * checks for the timer 1 compare interrupt
+   */
+   bool timer1Raised() {
+      return (TIFR1 & TIMSK1 & bit(OCF1A)) && (host_vector_TIMER1_COMPA != 0);
+   }
+
+  /**
+   * checks for the level triggered EEPROM ready interrupt
+   */
+   bool eepromReadyRaised() {
+      return (EECR & bit(EERIE)) && !(EECR & bit(EEPE)) && (host_vector_EE_READY != 0);
+   }
+
+  /**
+   * runs one interrupt handler with interrupts off, as the hardware
+   * does; a handler that turns them back on can be interrupted
+   */
+   void runVector(void (*vector)()) {
+      if (vector == 0) {
+         return;
+      }
+      SREG &= ~bit(SREG_I);
+      ++g_stats.interruptCount;
+      vector();
+      SREG |= bit(SREG_I);
+   }
+
+  /**
+   * delivers pending interrupts, in vector priority order
+   */
+   void deliverPending() {
+      pollEEPROM();
+      pollSerial();
+      pollTimer1();
+      pollADC();
+      while (SREG & bit(SREG_I)) {
+         pollEEPROM();
+         if (g_intPending & 0x01) {
+            g_intPending &= ~0x01;
+            runVector(g_intHandler[0]);
+         }
+         else if (g_intPending & 0x02) {
+            g_intPending &= ~0x02;
+            runVector(g_intHandler[1]);
+         }
+         else if (PCIFR & PCICR & 0x01) {
+            PCIFR &= ~0x01;
+            runVector(host_vector_PCINT0);
+         }
+         else if (PCIFR & PCICR & 0x02) {
+            PCIFR &= ~0x02;
+            runVector(host_vector_PCINT1);
+         }
+         else if (PCIFR & PCICR & 0x04) {
+            PCIFR &= ~0x04;
+            runVector(host_vector_PCINT2);
+         }
+         else if (timer1Raised()) {
+            TIFR1 &= ~bit(OCF1A);
+            runVector(host_vector_TIMER1_COMPA);
+         }
+         else if (adcRaised()) {
+            ADCSRA &= ~bit(ADIF);
+            runVector(host_vector_ADC);
+         }
+         else if (!g_raised.empty()) {
+            void (*vector)() = g_raised.front();
+            g_raised.erase(g_raised.begin());
+            runVector(vector);
+         }
+         else if (eepromReadyRaised()) {
+            runVector(host_vector_EE_READY);
+         }
+         else {
+            break;
+         }
+      }
+   }
+
+  /**
+   * flags external and pin change interrupts for a pin change
+   */
+   void flagPinInterrupts(uint8_t pin, uint8_t oldLevel, uint8_t level) {
+      int in = digitalPinToInterrupt(pin);
+      if ((in >= 0) && (g_intHandler[in] != 0)) {
+         if (  (g_intMode[in] == CHANGE)
+            || ((g_intMode[in] == RISING)  && (level == HIGH))
+            || ((g_intMode[in] == FALLING) && (level == LOW))) {
+            g_intPending |= bit(in);
+         }
+      }
+
+      if (*digitalPinToPCMSK(pin) & bit(digitalPinToPCMSKbit(pin))) {
+         PCIFR |= bit(digitalPinToPCICRbit(pin));
+      }
+   }
+
+  /**
+   * gets time of the next timer 0 tick
+   */
+   uint64_t nextTimerTick() {
+      return ((g_now / HOST_TIMER0_TICK_MICROS) + 1) * HOST_TIMER0_TICK_MICROS;
+   }
+
+  /**
+   * checks for an interrupt that would end a sleep
+   */
+   bool interruptWaiting() {
+      return (g_intPending != 0) || ((PCIFR & PCICR) != 0) || !g_raised.empty() || eepromReadyRaised()
+          || timer1Raised() || adcRaised();
+   }
+}
+
+namespace host {
+
+   uint64_t now() {
+      return g_now;
+   }
+
+   void advanceTo(uint64_t t) {
+      initPins();
+      // runs events already due even when not moving, so a sleep
+      // waiting for one of them does not stall
+      do {
+         uint64_t next = (g_scheduler != 0) ? g_scheduler->nextEventTime() : UINT64_MAX;
+         if (g_eepromDone < next) {
+            next = g_eepromDone;
+         }
+         if (nextSerialArrival() < next) {
+            next = nextSerialArrival();
+         }
+         pollTimer1();
+         if (nextTimer1Match() < next) {
+            next = nextTimer1Match();
+         }
+         pollADC();
+         if (g_adcDone < next) {
+            next = g_adcDone;
+         }
+         if (next <= t) {
+            if (next > g_now) {
+               g_now = next;
+            }
+            if (g_scheduler != 0) {
+               g_scheduler->runEvents(g_now);
+            }
+            deliverPending();
+         }
+         else if (g_now < t) {
+            g_now = t;
+         }
+      } while (g_now < t);
+      deliverPending();
+   }
+
+   void advance(uint64_t us) {
+      advanceTo(g_now + us);
+   }
+
+   void setPin(uint8_t pin, uint8_t level) {
+      initPins();
+      if (pin >= HOST_NUMBER_OF_PINS) {
+         return;
+      }
+      level = level ? HIGH : LOW;
+      uint8_t oldLevel = g_pinLevel[pin];
+      if (oldLevel != level) {
+         g_pinLevel[pin] = level;
+         updatePorts();
+         flagPinInterrupts(pin, oldLevel, level);
+         deliverPending();
+      }
+   }
+
+   uint8_t getPin(uint8_t pin) {
+      initPins();
+      return (pin < HOST_NUMBER_OF_PINS) ? g_pinLevel[pin] : LOW;
+   }
+
+   void setAnalog(uint8_t pin, int value) {
+      initPins();
+      if (pin < A0) {
+         pin += A0;
+      }
+      if (pin < HOST_NUMBER_OF_PINS) {
+         g_analog[pin] = value;
+      }
+   }
+
+   void setAnalogSource(int (*source)(uint8_t pin)) {
+      g_analogSource = source;
+   }
+
+   void setScheduler(HostScheduler *scheduler) {
+      g_scheduler = scheduler;
+   }
+
+   void serialInput(const std::string &bytes) {
+      for (size_t ii=0; ii<bytes.size(); ++ii) {
+         uint64_t start = (g_serialLineFree > g_now) ? g_serialLineFree : g_now;
+         g_serialLineFree = start + serialByteMicros();
+         g_serialLine.push_back(std::make_pair(g_serialLineFree, bytes[ii]));
+      }
+      pollSerial();
+   }
+
+   std::string serialOutput(uint64_t *sent) {
+      std::string out;
+      while (!g_serialOut.empty() && (g_serialOut.front().first <= g_now)) {
+         if (sent != 0) {
+            *sent = g_serialOut.front().first;
+         }
+         out += g_serialOut.front().second;
+         g_serialOut.pop_front();
+      }
+      return out;
+   }
+
+   void setSerialEcho(bool flag) {
+      g_serialEcho = flag;
+   }
+
+   const HostStats &stats() {
+      uint64_t since = g_now - g_wdtLastReset;
+      if (g_wdtEnabled && (since > g_stats.wdtLongestMicros)) {
+         g_stats.wdtLongestMicros = since;
+      }
+      g_stats.wdtTimeoutMicros = g_wdtEnabled ? g_wdtTimeout : 0;
+      return g_stats;
+   }
+
+   void resetStats() {
+      memset(&g_stats, 0, sizeof(g_stats));
+      g_wdtLastReset = g_now;
+   }
+
+   void raiseInterrupt(void (*vector)()) {
+      g_raised.push_back(vector);
+      deliverPending();
+   }
+
+   uint8_t *eeprom() {
+      initEEPROM();
+      return g_eeprom;
+   }
+
+   void setTraceLog(std::vector<HostTraceRecord> *log) {
+      g_traceLog = log;
+   }
+
+   void trace(uint8_t kind, uint8_t channel, uint64_t value, uint64_t start) {
+      if (g_traceLog != 0) {
+         HostTraceRecord record = { g_now, start, kind, channel, value };
+         g_traceLog->push_back(record);
+      }
+   }
+}
+
+/**
+ * core functions
+ */
+void pinMode(uint8_t pin, uint8_t mode) {
+   initPins();
+   if (pin < HOST_NUMBER_OF_PINS) {
+      g_pinMode[pin] = mode;
+   }
+}
+
+int digitalRead(uint8_t pin) {
+   return host::getPin(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+   initPins();
+   if ((pin < HOST_NUMBER_OF_PINS) && (g_pinMode[pin] == OUTPUT)) {
+      host::setPin(pin, val);
+   }
+}
+
+int analogRead(uint8_t pin) {
+   initPins();
+   return analogValue(pin);
+}
+
+unsigned long millis() {
+   return (unsigned long)((g_now - g_powerDownTotal) / 1000);
+}
+
+unsigned long micros() {
+   return (unsigned long)(g_now - g_powerDownTotal);
+}
+
+void delay(unsigned long ms) {
+   g_stats.delayMicros += (uint64_t)ms * 1000;
+   host::advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+   g_stats.delayMicros += us;
+   host::advance(us);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*handler)(), int mode) {
+   if (interruptNum < 2) {
+      g_intHandler[interruptNum] = handler;
+      g_intMode[interruptNum]    = mode;
+   }
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+   if (interruptNum < 2) {
+      g_intHandler[interruptNum] = 0;
+   }
+}
+
+void noInterrupts() {
+   SREG &= ~bit(SREG_I);
+}
+
+void interrupts() {
+   SREG |= bit(SREG_I);
+   deliverPending();
+}
+
+void host_cli() {
+   noInterrupts();
+}
+
+void host_sei() {
+   interrupts();
+}
+
+/**
+ * sleep
+ */
+void host_set_sleep_mode(unsigned char mode) {
+   g_sleepMode = mode % HOST_SLEEP_MODES;
+}
+
+void host_sleep_enable(bool flag) {
+   g_sleepEnabled = flag;
+}
+
+void host_sleep_cpu() {
+   if (!g_sleepEnabled || interruptWaiting()) {
+      return;
+   }
+
+   uint64_t start      = g_now;
+   uint64_t wakeCount  = g_stats.interruptCount;
+   uint64_t next       = (g_scheduler != 0) ? g_scheduler->nextEventTime() : UINT64_MAX;
+
+   if (g_sleepMode == SLEEP_MODE_IDLE) {
+      // timer 0 keeps running and wakes us every tick, a byte
+      // coming in on the serial port, a timer 1 match or the end of an
+      // ADC conversion wakes us too
+      uint64_t tick = nextTimerTick();
+      if (nextSerialArrival() < next) {
+         next = nextSerialArrival();
+      }
+      pollTimer1();
+      if (nextTimer1Match() < next) {
+         next = nextTimer1Match();
+      }
+      pollADC();
+      if (g_adcDone < next) {
+         next = g_adcDone;
+      }
+      host::advanceTo((next < tick) ? next : tick);
+   }
+   else {
+      // only an interrupt from outside wakes us; the clock stops
+      while ((g_stats.interruptCount == wakeCount) && !interruptWaiting()) {
+         if (next == UINT64_MAX) {
+            // nothing will ever wake us - give the driver a second
+            host::advance(1000000);
+            break;
+         }
+         if (next <= g_now) {
+            g_scheduler->runEvents(g_now);
+            deliverPending();
+         }
+         else {
+            host::advanceTo(next);
+         }
+         next = g_scheduler->nextEventTime();
+      }
+      g_powerDownTotal += g_now - start;
+   }
+
+   g_stats.sleepMicros[g_sleepMode] += g_now - start;
+   ++g_stats.sleepCount[g_sleepMode];
+}
+
+/**
+ * watchdog
+ */
+void host_wdt_enable(unsigned char timeout) {
+   // WDTO_15MS .. WDTO_8S, as on the part
+   static const uint16_t timeoutMillis[] = {
+      15, 30, 60, 120, 250, 500, 1000, 2000, 4000, 8000
+   };
+   g_wdtTimeout   = 1000ULL * timeoutMillis[(timeout <= WDTO_8S) ? timeout : WDTO_8S];
+   g_wdtEnabled   = true;
+   g_wdtLastReset = g_now;
+}
+
+void host_wdt_disable() {
+   host::stats();
+   g_wdtEnabled = false;
+}
+
+void host_wdt_reset() {
+   host::stats();
+   g_wdtLastReset = g_now;
+   ++g_stats.wdtResets;
+}
+
+/**
+ * EEPROM
+ */
+uint8_t host_eeprom_read_byte(const uint8_t *addr) {
+   initEEPROM();
+   return g_eeprom[(uintptr_t)addr & E2END];
+}
+
+void host_eeprom_read_block(void *dst, const void *src, size_t n) {
+   for (size_t ii=0; ii<n; ++ii) {
+      ((uint8_t *)dst)[ii] = host_eeprom_read_byte((const uint8_t *)src + ii);
+   }
+}
+
+/**
+ * Print
+ */
+size_t Print::write(const uint8_t *buffer, size_t size) {
+   size_t n = 0;
+   while (size--) {
+      n += write(*buffer++);
+   }
+   return n;
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+   char buf[8 * sizeof(long) + 1];
+   char *str = &buf[sizeof(buf) - 1];
+
+   *str = '\0';
+   if (base < 2) {
+      base = 10;
+   }
+   do {
+      char c = n % base;
+      n /= base;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+   } while (n);
+
+   return write(str);
+}
+
+size_t Print::print(const __FlashStringHelper *s) {
+   return write(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(const char *s) {
+   return write(s);
+}
+
+size_t Print::print(char c) {
+   return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+   return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base) {
+   return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+   return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+   if ((base == 10) && (n < 0)) {
+      size_t t = print('-');
+      return t + printNumber(-n, 10);
+   }
+   return printNumber(n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+   return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) {
+   char buf[32];
+   snprintf(buf, sizeof(buf), "%.*f", digits, n);
+   return write(buf);
+}
+
+size_t Print::println() {
+   return write("\r\n");
+}
+
+/**
+ * HardwareSerial
+ */
+void HardwareSerial::begin(unsigned long baud) {
+   g_serialBaud = baud;
+}
+
+void HardwareSerial::end() {
+}
+
+int HardwareSerial::available() {
+   pollSerial();
+   return (int)g_serialIn.size();
+}
+
+int HardwareSerial::availableForWrite() {
+   uint64_t byte    = serialByteMicros();
+   uint64_t pending = ((byte != 0) && (g_serialTxFree > g_now)) ? (g_serialTxFree - g_now + byte - 1) / byte : 0;
+   return (pending < HOST_SERIAL_BUFFER) ? (int)(HOST_SERIAL_BUFFER - pending) : 0;
+}
+
+int HardwareSerial::peek() {
+   pollSerial();
+   return g_serialIn.empty() ? -1 : (uint8_t)g_serialIn.front();
+}
+
+int HardwareSerial::read() {
+   pollSerial();
+   if (g_serialIn.empty()) {
+      return -1;
+   }
+   uint8_t c = g_serialIn.front();
+   g_serialIn.pop_front();
+   ++g_stats.serialRxBytes;
+   return c;
+}
+
+void HardwareSerial::flush() {
+   if (g_serialTxFree > g_now) {
+      host::advanceTo(g_serialTxFree);
+   }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+   uint64_t byte = serialByteMicros();
+   if (byte != 0) {
+      // a full transmit buffer holds the writer until a byte goes out
+      if (g_serialTxFree > g_now + HOST_SERIAL_BUFFER * byte) {
+         host::advanceTo(g_serialTxFree - HOST_SERIAL_BUFFER * byte);
+      }
+      g_serialTxFree = ((g_serialTxFree > g_now) ? g_serialTxFree : g_now) + byte;
+   }
+   g_serialOut.push_back(std::make_pair((byte != 0) ? g_serialTxFree : g_now, (char)c));
+   ++g_stats.serialTxBytes;
+   if (g_serialEcho) {
+      fputc(c, stdout);
+   }
+   return 1;
+}
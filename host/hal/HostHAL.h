@@ -0,0 +1,215 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the host side controls of the stub HAL: the
+ * virtual clock, the input pins driven from outside the sketch, the
+ * serial port queues and the run statistics.
+ *
+ * A HostScheduler can be installed to get a call whenever virtual
+ * time moves, so a test driver can apply pin changes at the right
+ * time, including while the sketch is in delay() or asleep.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * number of sleep modes tracked (SLEEP_MODE_* values 0..7)
+ */
+#define HOST_SLEEP_MODES         8
+
+/**
+ * kinds of trace record written by the stub peripherals
+ */
+#define HOST_TRACE_SI5351_FREQUENCY  0    // enabled clock output changed, channel
+                                          // clock, value Hz * 100
+#define HOST_TRACE_SI5351_OUTPUTS    1    // value bit per clock enabled
+#define HOST_TRACE_DISPLAY_FRAME     2    // a complete frame was sent
+#define HOST_TRACE_DISPLAY_INIT      3    // display controller set up, value
+                                          // commands sent
+
+/**
+ * a timestamped output of the sketch
+ */
+struct HostTraceRecord {
+   uint64_t time;         // when the output was complete
+   uint64_t start;        // when the sketch started producing it
+   uint8_t  kind;
+   uint8_t  channel;
+   uint64_t value;
+};
+
+/**
+ * This class is the interface for code driving inputs in virtual time
+ */
+class HostScheduler {
+public:
+   virtual ~HostScheduler() {}
+
+  /**
+   * gets time of the next input event
+   * @return time in us, or UINT64_MAX if there is none
+   */
+   virtual uint64_t nextEventTime() = 0;
+
+  /**
+   * applies all input events due at or before the given time
+   * @param  now   current virtual time in us
+   */
+   virtual void runEvents(uint64_t now) = 0;
+};
+
+/**
+ * run statistics gathered by the HAL
+ */
+struct HostStats {
+   uint64_t sleepMicros[HOST_SLEEP_MODES];
+   uint64_t sleepCount[HOST_SLEEP_MODES];
+   uint64_t delayMicros;
+   uint64_t interruptCount;
+   uint64_t wdtLongestMicros;
+   uint64_t wdtResets;
+   uint64_t wdtTimeoutMicros;
+   uint64_t serialTxBytes;
+   uint64_t serialRxBytes;
+   uint64_t serialRxDropped;
+   uint64_t eepromWrites;
+};
+
+namespace host {
+
+  /**
+   * gets virtual time
+   * @return time since start in us
+   */
+   uint64_t now();
+
+  /**
+   * moves virtual time forward, running scheduled events and
+   * delivering interrupts on the way
+   * @param  us    time to advance in us
+   */
+   void advance(uint64_t us);
+
+  /**
+   * moves virtual time forward to an absolute time
+   * @param  t     target time in us
+   */
+   void advanceTo(uint64_t t);
+
+  /**
+   * drives an input pin from outside the sketch
+   * Fires INT0/INT1 and pin change interrupts as configured.
+   * @param  pin   pin number
+   * @param  level HIGH or LOW
+   */
+   void setPin(uint8_t pin, uint8_t level);
+
+  /**
+   * gets the level of a pin
+   * @param  pin   pin number
+   * @return HIGH or LOW
+   */
+   uint8_t getPin(uint8_t pin);
+
+  /**
+   * sets the value returned by analogRead() for a pin
+   * @param  pin   analog pin number (A0..A5 or 0..5)
+   * @param  value 0..1023
+   */
+   void setAnalog(uint8_t pin, int value);
+
+  /**
+   * takes analog values from a function instead, for a simulated
+   * sensor; it is called when a pin is read or an ADC conversion of
+   * it starts, and may look at now()
+   * @param  source  gets the value 0..1023 of an analog pin (A0..A5),
+   *                 0 to go back to setAnalog() values
+   */
+   void setAnalogSource(int (*source)(uint8_t pin));
+
+  /**
+   * installs the scheduler driving inputs, or 0 for none
+   */
+   void setScheduler(HostScheduler *scheduler);
+
+  /**
+   * queues bytes for the sketch to read from Serial
+   * Once the sketch has opened the port they arrive one after
+   * another at its baud rate, and bytes arriving to a full receive
+   * buffer are lost.
+   */
+   void serialInput(const std::string &bytes);
+
+  /**
+   * takes the bytes the sketch has finished sending on Serial
+   * @param  sent  if given, set to the time the last of them was sent
+   */
+   std::string serialOutput(uint64_t *sent = 0);
+
+  /**
+   * echoes serial output to stdout as it is written
+   */
+   void setSerialEcho(bool flag);
+
+  /**
+   * gets run statistics
+   */
+   const HostStats &stats();
+
+  /**
+   * clears run statistics
+   */
+   void resetStats();
+
+  /**
+   * raises an interrupt vector by name, for timer and peripheral
+   * simulations; runs it now if interrupts are on, else when they
+   * are turned back on
+   * @param  vector  the vector function
+   */
+   void raiseInterrupt(void (*vector)());
+
+  /**
+   * gets the EEPROM contents, E2END + 1 bytes, erased (0xff) at
+   * start; a test driver may load or save them to model power cycles
+   */
+   uint8_t *eeprom();
+
+  /**
+   * sets the log receiving trace records, or 0 to stop tracing
+   */
+   void setTraceLog(std::vector<HostTraceRecord> *log);
+
+  /**
+   * adds a record to the trace log, completed at the current time
+   * @param  kind     HOST_TRACE_* kind
+   * @param  channel  clock or display number
+   * @param  value    recorded value
+   * @param  start    time the output was started, us
+   */
+   void trace(uint8_t kind, uint8_t channel, uint64_t value, uint64_t start);
+}
+
+#endif // HOST_HAL_H
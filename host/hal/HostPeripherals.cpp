@@ -0,0 +1,300 @@
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the host implementations of the Wire bus and
+ * the two display libraries.
+ */
+#include <Arduino.h>
+#include <Wire.h>
+#include <U8glib.h>
+#include <LiquidCrystal_I2C.h>
+#include "Si5351Emulator.h"
+#include "HostHAL.h"
+
+TwoWire            Wire;
+Si5351Emulator     hostSi5351Chip;    // after Wire, it attaches itself
+U8GLIB            *hostU8glibDisplay = 0;
+LiquidCrystal_I2C *hostLcdDisplay    = 0;
+
+const u8g_fntpgm_uint8_t u8g_font_6x12[]        = { 0 };
+const u8g_fntpgm_uint8_t u8g_font_10x20[]       = { 0 };
+const u8g_fntpgm_uint8_t u8g_font_10x20_67_75[] = { 0 };
+
+/**
+ * SSD1306 set up commands, as the library sends them from its
+ * constructor: display off, clock, multiplex, offset, start line,
+ * charge pump, addressing, remap, pins, contrast, precharge, vcomh,
+ * scroll off, resume, normal, display on
+ */
+static const uint8_t hostSSD1306Init[] = {
+   0xae, 0xd5, 0x80, 0xa8, 0x3f, 0xd3, 0x00, 0x40, 0x8d, 0x14,
+   0x20, 0x02, 0xa1, 0xc8, 0xda, 0x12, 0x81, 0xcf, 0xd9, 0xf1,
+   0xdb, 0x40, 0x2e, 0xa4, 0xa6, 0xaf
+};
+
+/**
+ * TwoWire
+ */
+TwoWire::TwoWire()
+: m_length(0)
+, m_address(0)
+, m_transmitting(false)
+, m_rxLength(0)
+, m_rxIndex(0)
+, m_clock(100000)
+, m_timing(true)
+, ml_transferStart(0)
+{
+   memset(m_devices, 0, sizeof(m_devices));
+   resetCounters();
+}
+
+void TwoWire::busTime(size_t count) {
+   if (m_timing) {
+      // start, address byte, data bytes at 9 bit times each, stop
+      host::advance((((count + 1) * 9) + 2) * 1000000UL / m_clock);
+   }
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(unsigned long clock) {
+   m_clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+   m_address        = address & 0x7f;
+   m_length         = 0;
+   m_transmitting   = true;
+   ml_transferStart = host::now();
+}
+
+size_t TwoWire::write(uint8_t c) {
+   if (!m_transmitting || (m_length >= HOST_WIRE_BUFFER_LENGTH)) {
+      return 0;
+   }
+   m_buffer[m_length++] = c;
+   return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t count) {
+   size_t n = 0;
+   while (count--) {
+      n += write(*data++);
+   }
+   return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+   m_transmitting = false;
+   m_bytes[m_address] += m_length + 1;
+   ++m_transfers[m_address];
+   busTime(m_length);
+
+   if (m_devices[m_address] != 0) {
+      m_devices[m_address]->i2cWrite(m_buffer, m_length);
+   }
+   return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t count) {
+   address &= 0x7f;
+   ml_transferStart = host::now();
+   m_rxIndex  = 0;
+   m_rxLength = 0;
+   if (m_devices[address] != 0) {
+      m_rxLength = m_devices[address]->i2cRead(m_rxBuffer, count);
+   }
+   m_bytes[address] += m_rxLength + 1;
+   ++m_transfers[address];
+   busTime(m_rxLength);
+   return (uint8_t)m_rxLength;
+}
+
+int TwoWire::available() {
+   return (int)(m_rxLength - m_rxIndex);
+}
+
+int TwoWire::read() {
+   return (m_rxIndex < m_rxLength) ? m_rxBuffer[m_rxIndex++] : -1;
+}
+
+void TwoWire::attachDevice(uint8_t address, HostI2CDevice *device) {
+   m_devices[address & 0x7f] = device;
+}
+
+void TwoWire::resetCounters() {
+   memset(m_bytes, 0, sizeof(m_bytes));
+   memset(m_transfers, 0, sizeof(m_transfers));
+}
+
+/**
+ * U8GLIB
+ */
+U8GLIB::U8GLIB(uint8_t pages)
+: mc_pages(pages)
+, mc_page(0)
+, mi_x(0)
+, mi_y(0)
+, ml_frameStart(0)
+, frames(0)
+, pages(0)
+{
+   uint64_t start = host::now();
+
+   // the controller is set up here, not at the first frame, so a
+   // display built with the globals talks on the bus before setup()
+   for (size_t ii=0; ii<sizeof(hostSSD1306Init); ++ii) {
+      Wire.beginTransmission(HOST_SSD1306_ADDRESS);
+      Wire.write((uint8_t)0x80);    // control byte, one command follows
+      Wire.write(hostSSD1306Init[ii]);
+      Wire.endTransmission();
+   }
+   host::trace(HOST_TRACE_DISPLAY_INIT, 0, sizeof(hostSSD1306Init), start);
+   hostU8glibDisplay = this;
+}
+
+void U8GLIB::sendPage() {
+   size_t bytes = (HOST_SSD1306_WIDTH * HOST_SSD1306_HEIGHT / 8) / mc_pages;
+
+   ++pages;
+   Wire.beginTransmission(HOST_SSD1306_ADDRESS);
+   for (size_t ii=0; ii<bytes; ++ii) {
+      if (Wire.write((uint8_t)0) == 0) {
+         // split at the buffer size, as the library does
+         Wire.endTransmission();
+         Wire.beginTransmission(HOST_SSD1306_ADDRESS);
+         Wire.write((uint8_t)0);
+      }
+   }
+   Wire.endTransmission();
+}
+
+void U8GLIB::firstPage() {
+   ml_frameStart = host::now();
+   mc_page = 0;
+   m_text.clear();
+}
+
+uint8_t U8GLIB::nextPage() {
+   sendPage();
+   if (++mc_page < mc_pages) {
+      return 1;
+   }
+   frameText = m_text;
+   ++frames;
+   host::trace(HOST_TRACE_DISPLAY_FRAME, 0, frames, ml_frameStart);
+   return 0;
+}
+
+void U8GLIB::setFont(const u8g_fntpgm_uint8_t *font) {
+}
+
+void U8GLIB::setPrintPos(int x, int y) {
+   mi_x = x;
+   mi_y = y;
+   if ((mc_page == 0) && !m_text.empty()) {
+      m_text += '\n';
+   }
+}
+
+int U8GLIB::drawStr(int x, int y, const char *s) {
+   setPrintPos(x, y);
+   return (int)print(s);
+}
+
+size_t U8GLIB::write(uint8_t c) {
+   if (mc_page == 0) {
+      m_text += (char)c;
+   }
+   return 1;
+}
+
+/**
+ * LiquidCrystal_I2C
+ */
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_Addr, uint8_t En, uint8_t Rw, uint8_t Rs,
+                                     uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                                     uint8_t backlighPin, int pol)
+: mc_address(lcd_Addr)
+, mc_columns(HOST_LCD_COLUMNS)
+, mc_rows(HOST_LCD_ROWS)
+, mc_col(0)
+, mc_row(0)
+, clears(0)
+{
+   memset(m_screen, ' ', sizeof(m_screen));
+   hostLcdDisplay = this;
+}
+
+void LiquidCrystal_I2C::send(uint8_t value) {
+   // two nibbles, each written with enable high then low
+   Wire.beginTransmission(mc_address);
+   Wire.write((uint8_t)(value & 0xf0));
+   Wire.write((uint8_t)(value & 0xf0));
+   Wire.write((uint8_t)(value << 4));
+   Wire.write((uint8_t)(value << 4));
+   Wire.endTransmission();
+}
+
+void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t rows) {
+   mc_columns = (cols < HOST_LCD_COLUMNS) ? cols : HOST_LCD_COLUMNS;
+   mc_rows    = (rows < HOST_LCD_ROWS) ? rows : HOST_LCD_ROWS;
+   clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+   ++clears;
+   send(0x01);
+   memset(m_screen, ' ', sizeof(m_screen));
+   mc_col = mc_row = 0;
+   // clear display command takes 1.52 ms, the library waits 2 ms
+   delayMicroseconds(2000);
+}
+
+void LiquidCrystal_I2C::home() {
+   setCursor(0, 0);
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+   send(0x80 | (col + row * 0x40));
+   mc_col = col;
+   mc_row = row;
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+   send(c);
+   if ((mc_row < mc_rows) && (mc_col < mc_columns)) {
+      m_screen[mc_row][mc_col] = (char)c;
+   }
+   ++mc_col;
+   return 1;
+}
+
+std::string LiquidCrystal_I2C::screenText() const {
+   std::string text;
+   for (int ii=0; ii<mc_rows; ++ii) {
+      text.append(m_screen[ii], mc_columns);
+      text += '\n';
+   }
+   return text;
+}
@@ -0,0 +1,86 @@
+#ifndef HOST_LIQUIDCRYSTAL_I2C_H
+#define HOST_LIQUIDCRYSTAL_I2C_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for the F Malpartida LiquidCrystal_I2C library.
+ * Characters go into a 20x4 screen image. Each character costs the
+ * bus time of the PCF8574 expander writes on the host Wire bus.
+ */
+
+#include <string>
+#include <Arduino.h>
+
+#define POSITIVE                   0
+#define NEGATIVE                   1
+
+#define HOST_LCD_COLUMNS           20
+#define HOST_LCD_ROWS              4
+
+/**
+ * This class is the LCD display object
+ */
+class LiquidCrystal_I2C : public Print {
+protected:
+   uint8_t  mc_address;
+   uint8_t  mc_columns;
+   uint8_t  mc_rows;
+   uint8_t  mc_col;
+   uint8_t  mc_row;
+   char     m_screen[HOST_LCD_ROWS][HOST_LCD_COLUMNS];
+
+  /**
+   * sends one byte to the controller through the expander
+   */
+   void send(uint8_t value);
+
+public:
+   LiquidCrystal_I2C(uint8_t lcd_Addr, uint8_t En, uint8_t Rw, uint8_t Rs,
+                     uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
+                     uint8_t backlighPin, int pol);
+
+   void begin(uint8_t cols, uint8_t rows);
+   void clear();
+   void home();
+   void setCursor(uint8_t col, uint8_t row);
+   void backlight() {}
+   void noBacklight() {}
+
+   virtual size_t write(uint8_t c);
+   using Print::write;
+
+  /**
+   * host only - screen contents, rows separated by newlines
+   */
+   std::string screenText() const;
+
+  /**
+   * host only - number of clear() calls
+   */
+   unsigned long clears;
+};
+
+/**
+ * host only - last display object created, for test drivers
+ */
+extern LiquidCrystal_I2C *hostLcdDisplay;
+
+#endif // HOST_LIQUIDCRYSTAL_I2C_H
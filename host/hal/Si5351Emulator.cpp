@@ -0,0 +1,278 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the Si5351 register model.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <si5351.h>
+#include "Si5351Emulator.h"
+#include "HostHAL.h"
+
+#define PLL_RATIO_MIN           15.0
+#define PLL_RATIO_MAX           90.0
+#define VCO_MIN                 600e6
+#define VCO_MAX                 900e6
+#define VCO_CRYSTAL_TOLERANCE   200e-6     // limits move with the crystal
+#define MS_RATIO_MIN            8.0
+#define MS_RATIO_MAX            2048.0
+#define OUTPUT_MAX              200e6
+
+Si5351Emulator::Si5351Emulator(uint32_t xtalFreq, uint8_t address)
+: mc_pointer(0)
+, md_xtalFreq(xtalFreq)
+, mc_enabled(0)
+, verbose(false)
+{
+   memset(m_regs, 0, sizeof(m_regs));
+
+   // power on state - clocks powered down
+   for (int ii=0; ii<8; ++ii) {
+      m_regs[SI5351_CLK0_CTRL + ii] = SI5351_CLK_POWERDOWN;
+   }
+   for (int ii=0; ii<SI5351_EMULATED_CLOCKS; ++ii) {
+      md_output[ii] = 0;
+      md_traced[ii] = 0;
+   }
+   resetCounters();
+
+   Wire.attachDevice(address, this);
+}
+
+void Si5351Emulator::resetCounters() {
+   writeTransfers   = 0;
+   readTransfers    = 0;
+   bytesWritten     = 0;
+   bytesRead        = 0;
+   pllResets        = 0;
+   frequencyChanges = 0;
+   problems         = 0;
+   messages.clear();
+}
+
+void Si5351Emulator::flag(const char *format, ...) {
+   char    text[160];
+   va_list args;
+
+   int n = snprintf(text, sizeof(text), "%.3f ms: ", host::now() / 1000.0);
+   va_start(args, format);
+   vsnprintf(text + n, sizeof(text) - n, format, args);
+   va_end(args);
+
+   ++problems;
+   if (messages.size() < SI5351_EMULATOR_MESSAGES) {
+      messages.push_back(text);
+   }
+   if (verbose) {
+      fprintf(stderr, "si5351: %s\n", text);
+   }
+}
+
+bool Si5351Emulator::decodeRatio(uint8_t base, double &ratio, bool &fractional) {
+   const uint8_t *r = &m_regs[base];
+
+   uint32_t p3 = ((uint32_t)(r[5] >> 4) << 16) | ((uint32_t)r[0] << 8) | r[1];
+   uint32_t p1 = ((uint32_t)(r[2] & 0x03) << 16) | ((uint32_t)r[3] << 8) | r[4];
+   uint32_t p2 = ((uint32_t)(r[5] & 0x0f) << 16) | ((uint32_t)r[6] << 8) | r[7];
+
+   if (p3 == 0) {
+      return false;
+   }
+
+   // p1 = 128a + floor(128b/c) - 512, p2 = 128b - c floor(128b/c)
+   ratio      = (p1 + 512 + (double)p2 / p3) / 128.0;
+   fractional = (p2 != 0) || (((p1 + 512) % 128) != 0);
+   return true;
+}
+
+double Si5351Emulator::pllFrequency(int pll) {
+   double ratio;
+   bool   fractional;
+
+   if (!decodeRatio(pll ? SI5351_PLLB_PARAMETERS : SI5351_PLLA_PARAMETERS, ratio, fractional)) {
+      return 0;
+   }
+   return md_xtalFreq * ratio;
+}
+
+double Si5351Emulator::decodeClock(int clk) {
+   uint8_t  ctrl = m_regs[SI5351_CLK0_CTRL + clk];
+   uint8_t  base = SI5351_CLK0_PARAMETERS + SI5351_PARAMETERS_LENGTH * clk;
+   int      pll  = (ctrl & SI5351_CLK_PLL_SELECT) ? 1 : 0;
+   char     pllName = pll ? 'B' : 'A';
+   double   ratio;
+   bool     fractional;
+
+   std::string &problem = m_problem[clk];
+   std::string  found;
+   char         text[120];
+
+   if ((ctrl & SI5351_CLK_POWERDOWN) || (m_regs[SI5351_OUTPUT_ENABLE_CTRL] & bit(clk))) {
+      problem.clear();
+      return 0;
+   }
+
+   if ((ctrl & SI5351_CLK_INPUT_MASK) != SI5351_CLK_INPUT_MULTISYNTH_N) {
+      snprintf(text, sizeof(text), "CLK%d input is not multisynth %d", clk, clk);
+      found = text;
+   }
+
+   // PLL
+   double vco = 0;
+   if (found.empty()) {
+      uint8_t pllBase = pll ? SI5351_PLLB_PARAMETERS : SI5351_PLLA_PARAMETERS;
+      if (!decodeRatio(pllBase, ratio, fractional)) {
+         snprintf(text, sizeof(text), "CLK%d PLL %c denominator is zero", clk, pllName);
+         found = text;
+      }
+      else {
+         vco = md_xtalFreq * ratio;
+         if ((ratio < PLL_RATIO_MIN) || (ratio > PLL_RATIO_MAX)) {
+            snprintf(text, sizeof(text), "CLK%d PLL %c feedback divider %.6f out of range",
+                     clk, pllName, ratio);
+            found = text;
+         }
+         else if (  (vco < VCO_MIN * (1.0 - VCO_CRYSTAL_TOLERANCE))
+                 || (vco > VCO_MAX * (1.0 + VCO_CRYSTAL_TOLERANCE))) {
+            snprintf(text, sizeof(text), "CLK%d PLL %c VCO %.0f Hz out of range", clk, pllName, vco);
+            found = text;
+         }
+      }
+   }
+
+   // multisynth and output divider
+   double out = 0;
+   if (found.empty()) {
+      bool    divBy4  = (m_regs[base + 2] & SI5351_OUTPUT_CLK_DIVBY4) == SI5351_OUTPUT_CLK_DIVBY4;
+      bool    integer = (ctrl & SI5351_CLK_INTEGER_MODE) != 0;
+      int     rDiv    = 1 << ((m_regs[base + 2] & SI5351_OUTPUT_CLK_DIV_MASK) >> SI5351_OUTPUT_CLK_DIV_SHIFT);
+
+      if (divBy4) {
+         ratio      = 4;
+         fractional = false;
+      }
+      else if (!decodeRatio(base, ratio, fractional)) {
+         snprintf(text, sizeof(text), "CLK%d multisynth denominator is zero", clk);
+         found = text;
+      }
+
+      if (found.empty()) {
+         bool inRange = ((ratio >= MS_RATIO_MIN) && (ratio <= MS_RATIO_MAX))
+                     || (!fractional && ((ratio == 4) || (ratio == 6)));
+         if (!inRange) {
+            snprintf(text, sizeof(text), "CLK%d multisynth divider %.6f out of range", clk, ratio);
+            found = text;
+         }
+         else if (integer && (fractional || (fmod(ratio, 2.0) != 0))) {
+            snprintf(text, sizeof(text), "CLK%d integer mode with divider %.6f", clk, ratio);
+            found = text;
+         }
+         else {
+            out = vco / ratio / rDiv;
+            if (out > OUTPUT_MAX) {
+               snprintf(text, sizeof(text), "CLK%d output %.0f Hz out of range", clk, out);
+               found = text;
+            }
+         }
+      }
+   }
+
+   if (!found.empty() && (found != problem)) {
+      flag("%s", found.c_str());
+   }
+   problem = found;
+
+   return found.empty() ? out : 0;
+}
+
+void Si5351Emulator::setCrystal(double hz) {
+   md_xtalFreq = hz;
+   update();
+}
+
+void Si5351Emulator::update() {
+   uint8_t enabled = 0;
+
+   for (int ii=0; ii<SI5351_EMULATED_CLOCKS; ++ii) {
+      md_output[ii] = decodeClock(ii);
+      if (md_output[ii] > 0) {
+         enabled |= bit(ii);
+
+         if (md_output[ii] != md_traced[ii]) {
+            md_traced[ii] = md_output[ii];
+            ++frequencyChanges;
+            host::trace(HOST_TRACE_SI5351_FREQUENCY, ii,
+                        (uint64_t)llround(md_output[ii] * SI5351_FREQ_MULT), Wire.transferStart());
+         }
+      }
+   }
+
+   if (enabled != mc_enabled) {
+      mc_enabled = enabled;
+      host::trace(HOST_TRACE_SI5351_OUTPUTS, 0, enabled, Wire.transferStart());
+   }
+}
+
+void Si5351Emulator::i2cWrite(const uint8_t *data, size_t count) {
+   if (count == 0) {
+      return;
+   }
+
+   ++writeTransfers;
+   mc_pointer = data[0];
+   for (size_t ii=1; ii<count; ++ii) {
+      uint8_t addr = mc_pointer++;
+      if (addr == SI5351_PLL_RESET) {
+         // self clearing
+         pllResets += ((data[ii] & SI5351_PLL_RESET_A) != 0) + ((data[ii] & SI5351_PLL_RESET_B) != 0);
+         m_regs[addr] = 0;
+      }
+      else {
+         m_regs[addr] = data[ii];
+      }
+   }
+   bytesWritten += count - 1;
+
+   if (count > 1) {
+      update();
+   }
+}
+
+size_t Si5351Emulator::i2cRead(uint8_t *data, size_t count) {
+   ++readTransfers;
+   for (size_t ii=0; ii<count; ++ii) {
+      // status - initialized, PLLs locked, no loss of signal
+      data[ii] = (mc_pointer == SI5351_DEVICE_STATUS) ? 0 : m_regs[mc_pointer];
+      ++mc_pointer;
+   }
+   bytesRead += count;
+   return count;
+}
+
+double Si5351Emulator::outputFrequency(int clk) const {
+   return ((clk >= 0) && (clk < SI5351_EMULATED_CLOCKS)) ? md_output[clk] : 0;
+}
+
+bool Si5351Emulator::outputEnabled(int clk) const {
+   return !(m_regs[SI5351_OUTPUT_ENABLE_CTRL] & bit(clk));
+}
@@ -0,0 +1,162 @@
+#ifndef HOST_SI5351EMULATOR_H
+#define HOST_SI5351EMULATOR_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the definition of Si5351Emulator, a model of
+ * the Si5351 register map sitting on the host Wire bus. It does not
+ * trust the driver: after every write it decodes the PLL and
+ * multisynth parameter blocks, clock controls and output enables
+ * back into the frequency on each CLK pin, and checks the result
+ * against the datasheet limits:
+ *
+ * - PLL feedback divider 15 + 0/1048575 .. 90, VCO 600 .. 900 MHz
+ * - multisynth divider 8 + 1/1048575 .. 2048, or 4, 6, 8 in integer
+ *   mode; an odd or fractional divider with integer mode set
+ * - denominators of zero, output above 200 MHz
+ * - CLK input other than its own multisynth
+ *
+ * Checks apply to enabled, powered outputs and the PLL feeding them,
+ * since a disabled clock may legally hold anything. Each problem is
+ * counted and kept as a message with its time.
+ *
+ * Enabled output frequency changes and output enable changes go to
+ * the host trace log, so latency is measured to what the chip does.
+ *
+ * Multisynths 0-5 are modelled. 6 and 7 (integer only, Si5351A-20
+ * and C parts) are not.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Wire.h>
+
+#define SI5351_EMULATED_CLOCKS     6
+#define SI5351_REGISTERS           256
+#define SI5351_EMULATOR_MESSAGES   100
+
+/**
+ * This class is the Si5351 register model
+ */
+class Si5351Emulator : public HostI2CDevice {
+protected:
+   uint8_t            m_regs[SI5351_REGISTERS];
+   uint8_t            mc_pointer;
+   double             md_xtalFreq;
+   double             md_output[SI5351_EMULATED_CLOCKS];
+   double             md_traced[SI5351_EMULATED_CLOCKS];
+   uint8_t            mc_enabled;
+
+  /**
+   * problem found by the latest decode of each clock, so each one is
+   * reported once rather than on every write while it lasts
+   */
+   std::string        m_problem[SI5351_EMULATED_CLOCKS];
+
+  /**
+   * decodes a parameter block into a divider ratio
+   * @return false if the block can not be decoded (zero denominator)
+   */
+   bool decodeRatio(uint8_t base, double &ratio, bool &fractional);
+
+  /**
+   * records a problem
+   */
+   void flag(const char *format, ...);
+
+  /**
+   * decodes the frequency on one clock pin, flagging problems
+   * @return frequency in Hz, 0 if off or unusable
+   */
+   double decodeClock(int clk);
+
+  /**
+   * re-decodes all clocks after a write
+   */
+   void update();
+
+public:
+   Si5351Emulator(uint32_t xtalFreq = 25000000, uint8_t address = 0x60);
+
+   virtual void   i2cWrite(const uint8_t *data, size_t count);
+   virtual size_t i2cRead(uint8_t *data, size_t count);
+
+  /**
+   * sets the frequency the crystal really runs at, to model a unit
+   * off by its crystal error; clocks are decoded again
+   * @param  hz  crystal frequency in Hz
+   */
+   void setCrystal(double hz);
+
+  /**
+   * gets a register value
+   */
+   uint8_t reg(uint8_t addr) const { return m_regs[addr]; }
+
+  /**
+   * gets a PLL VCO frequency
+   * @param  pll  0 for PLL A, 1 for PLL B
+   * @return frequency in Hz, 0 if the parameters are unusable
+   */
+   double pllFrequency(int pll);
+
+  /**
+   * gets the frequency on a clock pin
+   * @return frequency in Hz, 0 if disabled, powered down or unusable
+   */
+   double outputFrequency(int clk) const;
+
+  /**
+   * checks the output enable of a clock pin
+   */
+   bool outputEnabled(int clk) const;
+
+  /**
+   * statistics, since construction or resetCounters()
+   */
+   unsigned long writeTransfers;
+   unsigned long readTransfers;
+   unsigned long bytesWritten;       // register bytes, excluding address
+   unsigned long bytesRead;
+   unsigned long pllResets;
+   unsigned long frequencyChanges;   // enabled output changed frequency
+   unsigned long problems;
+
+  /**
+   * time stamped problem messages, the first SI5351_EMULATOR_MESSAGES
+   */
+   std::vector<std::string> messages;
+
+  /**
+   * prints problems to stderr as they are found
+   */
+   bool verbose;
+
+   void resetCounters();
+};
+
+/**
+ * host only - the chip on the board, attached to Wire at 0x60
+ */
+extern Si5351Emulator hostSi5351Chip;
+
+#endif // HOST_SI5351EMULATOR_H
@@ -0,0 +1,117 @@
+#ifndef HOST_U8GLIB_H
+#define HOST_U8GLIB_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for the U8glib library, SSD1306 I2C devices only.
+ * Text drawn on the first page of each picture loop is captured as
+ * the frame text, and each page is sent over the host Wire bus at
+ * its real size, so a paint costs the same bus time as on the board.
+ */
+
+#include <string>
+#include <Arduino.h>
+
+typedef uint8_t u8g_fntpgm_uint8_t;
+
+extern const u8g_fntpgm_uint8_t u8g_font_6x12[];
+extern const u8g_fntpgm_uint8_t u8g_font_10x20[];
+extern const u8g_fntpgm_uint8_t u8g_font_10x20_67_75[];
+
+#define U8G_I2C_OPT_NONE           0
+#define U8G_I2C_OPT_DEV_0          0
+#define U8G_I2C_OPT_FAST           16
+
+#define U8G_MODE_BW                1
+#define U8G_MODE_GRAY2BIT          2
+#define U8G_MODE_R3G3B2            8
+#define U8G_MODE_HICOLOR           16
+
+#define HOST_SSD1306_ADDRESS       0x3c
+#define HOST_SSD1306_WIDTH         128
+#define HOST_SSD1306_HEIGHT        64
+
+/**
+ * This class is the U8glib display object
+ */
+class U8GLIB : public Print {
+protected:
+   uint8_t      mc_pages;
+   uint8_t      mc_page;
+   int          mi_x;
+   int          mi_y;
+   std::string  m_text;
+   uint64_t     ml_frameStart;
+
+  /**
+   * sends the current page over the bus
+   */
+   void sendPage();
+
+   U8GLIB(uint8_t pages);
+
+public:
+   void    firstPage();
+   uint8_t nextPage();
+   void    setFont(const u8g_fntpgm_uint8_t *font);
+   void    setPrintPos(int x, int y);
+   int     drawStr(int x, int y, const char *s);
+   uint8_t getMode() { return U8G_MODE_BW; }
+   void    setColorIndex(uint8_t index) {}
+   void    setHiColorByRGB(uint8_t r, uint8_t g, uint8_t b) {}
+
+   virtual size_t write(uint8_t c);
+   using Print::write;
+
+  /**
+   * host only - text of the last complete frame
+   */
+   std::string  frameText;
+
+  /**
+   * host only - number of complete frames and pages sent
+   */
+   unsigned long frames;
+   unsigned long pages;
+};
+
+/**
+ * single page buffer - 8 pages of 128 bytes per frame
+ */
+class U8GLIB_SSD1306_128X64 : public U8GLIB {
+public:
+   U8GLIB_SSD1306_128X64(uint8_t options = U8G_I2C_OPT_NONE) : U8GLIB(8) {}
+};
+
+/**
+ * double page buffer - 4 pages of 256 bytes per frame
+ */
+class U8GLIB_SSD1306_128X64_2X : public U8GLIB {
+public:
+   U8GLIB_SSD1306_128X64_2X(uint8_t options = U8G_I2C_OPT_NONE) : U8GLIB(4) {}
+};
+
+/**
+ * host only - last display object created, for test drivers
+ */
+extern U8GLIB *hostU8glibDisplay;
+
+#endif // HOST_U8GLIB_H
@@ -0,0 +1,132 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for Wire.h. Transfers are counted per device and
+ * take virtual time at the bus clock rate (9 bit times per byte,
+ * plus the address byte), so bus cost shows up in timings. A host
+ * device model can be attached at an address to receive the bytes.
+ */
+
+#include <Arduino.h>
+
+/**
+ * This class is the interface for host models of I2C devices
+ */
+class HostI2CDevice {
+public:
+   virtual ~HostI2CDevice() {}
+
+  /**
+   * receives one complete write transfer
+   * @param  data   bytes written, after the address
+   * @param  count  number of bytes
+   */
+   virtual void i2cWrite(const uint8_t *data, size_t count) = 0;
+
+  /**
+   * supplies bytes for a read transfer
+   * @param  data   receives the bytes
+   * @param  count  number of bytes wanted
+   * @return number of bytes supplied
+   */
+   virtual size_t i2cRead(uint8_t *data, size_t count) { return 0; }
+};
+
+#define HOST_WIRE_BUFFER_LENGTH    256
+#define HOST_WIRE_ADDRESSES        128
+
+/**
+ * This class is the I2C bus master
+ */
+class TwoWire : public Print {
+protected:
+   uint8_t        m_buffer[HOST_WIRE_BUFFER_LENGTH];
+   size_t         m_length;
+   uint8_t        m_address;
+   bool           m_transmitting;
+   uint8_t        m_rxBuffer[HOST_WIRE_BUFFER_LENGTH];
+   size_t         m_rxLength;
+   size_t         m_rxIndex;
+   unsigned long  m_clock;
+   bool           m_timing;
+   uint64_t       ml_transferStart;
+
+   HostI2CDevice *m_devices[HOST_WIRE_ADDRESSES];
+   unsigned long  m_bytes[HOST_WIRE_ADDRESSES];
+   unsigned long  m_transfers[HOST_WIRE_ADDRESSES];
+
+  /**
+   * accounts bus time for a transfer
+   */
+   void busTime(size_t count);
+
+public:
+   TwoWire();
+
+   void    begin();
+   void    setClock(unsigned long clock);
+   void    beginTransmission(uint8_t address);
+   uint8_t endTransmission(bool sendStop = true);
+   uint8_t requestFrom(uint8_t address, uint8_t count);
+   int     available();
+   int     read();
+
+   virtual size_t write(uint8_t c);
+   virtual size_t write(const uint8_t *data, size_t count);
+   using Print::write;
+
+  /**
+   * host only - attaches a device model at an address
+   */
+   void attachDevice(uint8_t address, HostI2CDevice *device);
+
+  /**
+   * host only - turns bus timing on or off
+   */
+   void setTiming(bool flag) { m_timing = flag; }
+
+  /**
+   * host only - bytes sent to or read from an address, including
+   * the address byte of each transfer
+   */
+   unsigned long bytes(uint8_t address) const { return m_bytes[address & 0x7f]; }
+
+  /**
+   * host only - transfers to or from an address
+   */
+   unsigned long transfers(uint8_t address) const { return m_transfers[address & 0x7f]; }
+
+  /**
+   * host only - time the current or last transfer began, us
+   */
+   uint64_t transferStart() const { return ml_transferStart; }
+
+  /**
+   * host only - clears the byte and transfer counters
+   */
+   void resetCounters();
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,41 @@
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for avr/eeprom.h, reading the EEPROM model in
+ * HostArduino.cpp. Writes go through EECR, EEAR and EEDR as on the
+ * part: setting EEPE with EEMPE set writes EEDR to EEAR, EEPE stays
+ * set for the 3.4 ms write time, and EE_READY_vect runs while EERIE
+ * is set and no write is in progress.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint8_t host_eeprom_read_byte(const uint8_t *addr);
+void    host_eeprom_read_block(void *dst, const void *src, size_t n);
+
+#define eeprom_read_byte(addr)          host_eeprom_read_byte(addr)
+#define eeprom_read_block(dst, src, n)  host_eeprom_read_block(dst, src, n)
+#define eeprom_is_ready()               (!(EECR & bit(EEPE)))
+
+#endif // HOST_AVR_EEPROM_H
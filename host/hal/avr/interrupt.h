@@ -0,0 +1,53 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for avr/interrupt.h. An ISR becomes a plain
+ * extern "C" function, which the host interrupt controller in
+ * HostArduino.cpp calls when a simulated pin or timer event fires.
+ * As on the part, a handler runs with interrupts off, and can be
+ * interrupted once it turns them back on with sei().
+ */
+
+#define HOST_ISR_STR(x)            #x
+#define HOST_ISR_XSTR(x)           HOST_ISR_STR(x)
+
+#define ISR(vector, ...)           extern "C" void vector(void) __VA_ARGS__; \
+                                   extern "C" void vector(void) __VA_ARGS__
+#define ISR_ALIASOF(target)        __attribute__ ((alias (HOST_ISR_XSTR(target))))
+
+#define PCINT0_vect                host_vector_PCINT0
+#define PCINT1_vect                host_vector_PCINT1
+#define PCINT2_vect                host_vector_PCINT2
+#define WDT_vect                   host_vector_WDT
+#define TIMER1_COMPA_vect          host_vector_TIMER1_COMPA
+#define TIMER2_COMPA_vect          host_vector_TIMER2_COMPA
+#define ADC_vect                   host_vector_ADC
+#define EE_READY_vect              host_vector_EE_READY
+
+void host_cli();
+void host_sei();
+
+#define cli()                      host_cli()
+#define sei()                      host_sei()
+
+#endif // HOST_AVR_INTERRUPT_H
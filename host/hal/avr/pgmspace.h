@@ -0,0 +1,49 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for avr/pgmspace.h. Flash and RAM are the same
+ * address space on the host, so PROGMEM data is read directly.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P                      const char *
+#define PSTR(s)                    (s)
+
+#define pgm_read_byte(addr)        (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)        (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)       (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)         (*(void * const *)(addr))
+
+#define memcpy_P(dst, src, n)      memcpy((dst), (src), (n))
+#define strcpy_P(dst, src)         strcpy((dst), (src))
+#define strlen_P(src)              strlen(src)
+#define strcmp_P(a, b)             strcmp((a), (b))
+#define strncmp_P(a, b, n)         strncmp((a), (b), (n))
+#define sprintf_P                  sprintf
+#define snprintf_P                 snprintf
+
+#endif // HOST_AVR_PGMSPACE_H
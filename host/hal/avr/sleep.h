@@ -0,0 +1,44 @@
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for avr/sleep.h. sleep_cpu() moves virtual time
+ * to the next event that would wake the processor, and accounts
+ * the time slept for the duty cycle report.
+ */
+
+#define SLEEP_MODE_IDLE            0
+#define SLEEP_MODE_ADC             1
+#define SLEEP_MODE_PWR_DOWN        2
+#define SLEEP_MODE_PWR_SAVE        3
+#define SLEEP_MODE_STANDBY         6
+
+void host_set_sleep_mode(unsigned char mode);
+void host_sleep_enable(bool flag);
+void host_sleep_cpu();
+
+#define set_sleep_mode(mode)       host_set_sleep_mode(mode)
+#define sleep_enable()             host_sleep_enable(true)
+#define sleep_disable()            host_sleep_enable(false)
+#define sleep_cpu()                host_sleep_cpu()
+
+#endif // HOST_AVR_SLEEP_H
@@ -0,0 +1,47 @@
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for avr/wdt.h. The watchdog does not reset the
+ * host; the longest time between resets is tracked instead.
+ */
+
+#define WDTO_15MS                  0
+#define WDTO_30MS                  1
+#define WDTO_60MS                  2
+#define WDTO_120MS                 3
+#define WDTO_250MS                 4
+#define WDTO_500MS                 5
+#define WDTO_1S                    6
+#define WDTO_2S                    7
+#define WDTO_4S                    8
+#define WDTO_8S                    9
+
+void host_wdt_enable(unsigned char timeout);
+void host_wdt_disable();
+void host_wdt_reset();
+
+#define wdt_enable(timeout)        host_wdt_enable(timeout)
+#define wdt_disable()              host_wdt_disable()
+#define wdt_reset()                host_wdt_reset()
+
+#endif // HOST_AVR_WDT_H
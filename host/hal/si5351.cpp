@@ -0,0 +1,243 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the host Si5351 driver. The register traffic
+ * follows the Etherkit library: parameter blocks go out as one bulk
+ * write, and single bit fields (output enable, drive, integer mode,
+ * R divider, PLL source) are read-modify-write over the bus.
+ *
+ * set_freq assigns PLLs as library 1.x does: CLK0 on PLL A, left as
+ * it is, and the other clocks on PLL B, whose parameters it writes
+ * again on every call from the reference with the library's own
+ * correction. A PLL B set up any other way does not survive it.
+ */
+#include <Arduino.h>
+#include <Wire.h>
+#include <si5351.h>
+
+Si5351::Si5351(uint8_t i2c_addr)
+: mc_i2cAddress(i2c_addr)
+, ml_xtalFreq(SI5351_XTAL_FREQ)
+, correction(0)
+, initialized(false)
+, setFreqCalls(0)
+, multisynthWrites(0)
+, outputEnableCalls(0)
+, registerWrites(0)
+{
+   for (int ii=0; ii<SI5351_NUMBER_OF_CLOCKS; ++ii) {
+      clockFrequency[ii] = 0;
+      clockEnabled[ii]   = false;
+      clockDrive[ii]     = SI5351_DRIVE_2MA;
+   }
+   pllFrequency[0] = pllFrequency[1] = 0;
+}
+
+void Si5351::ratioCalc(uint64_t num, uint64_t den, Si5351RegSet &reg) {
+   uint32_t a = (uint32_t)(num / den);
+   uint32_t b = (uint32_t)(((num % den) * SI5351_FRAC_DENOM + den / 2) / den);
+   uint32_t c = SI5351_FRAC_DENOM;
+
+   if (b >= c) {
+      ++a;
+      b = 0;
+   }
+   if (b == 0) {
+      c = 1;
+   }
+
+   uint32_t f = (128 * b) / c;
+   reg.p1 = 128 * a + f - 512;
+   reg.p2 = 128 * b - c * f;
+   reg.p3 = c;
+}
+
+void Si5351::packParameters(const Si5351RegSet &reg, uint8_t *params) {
+   params[0] = (uint8_t)(reg.p3 >> 8);
+   params[1] = (uint8_t)(reg.p3);
+   params[2] = (uint8_t)((reg.p1 >> 16) & 0x03);
+   params[3] = (uint8_t)(reg.p1 >> 8);
+   params[4] = (uint8_t)(reg.p1);
+   params[5] = (uint8_t)(((reg.p3 >> 12) & 0xf0) | ((reg.p2 >> 16) & 0x0f));
+   params[6] = (uint8_t)(reg.p2 >> 8);
+   params[7] = (uint8_t)(reg.p2);
+}
+
+uint64_t Si5351::referenceFrequency() {
+   // correction is in parts per 10 million, as in library 1.x
+   int64_t ref = (int64_t)ml_xtalFreq * SI5351_FREQ_MULT;
+   return (uint64_t)(ref + (ref * correction) / 10000000LL);
+}
+
+void Si5351::updateRegister(uint8_t addr, uint8_t mask, uint8_t value) {
+   uint8_t reg = si5351_read(addr);
+   si5351_write(addr, (reg & ~mask) | (value & mask));
+}
+
+void Si5351::init(uint8_t xtal_load_c, uint32_t ref_osc_freq) {
+   Wire.begin();
+
+   // crystal load, reserved bits as recommended
+   si5351_write(SI5351_CRYSTAL_LOAD, (xtal_load_c & 0xc0) | 0x12);
+   if (ref_osc_freq != 0) {
+      ml_xtalFreq = ref_osc_freq;
+   }
+
+   // outputs off, clocks powered, each on its own multisynth from PLL A
+   si5351_write(SI5351_OUTPUT_ENABLE_CTRL, 0xff);
+   for (int ii=0; ii<SI5351_NUMBER_OF_CLOCKS; ++ii) {
+      si5351_write(SI5351_CLK0_CTRL + ii, SI5351_CLK_INPUT_MULTISYNTH_N);
+      clockEnabled[ii] = false;
+   }
+
+   set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
+   set_pll(SI5351_PLL_FIXED, SI5351_PLLB);
+   initialized = true;
+}
+
+uint8_t Si5351::set_freq(uint64_t freq, uint64_t pll_freq, enum si5351_clock clk) {
+   ++setFreqCalls;
+   clockFrequency[clk] = freq;
+
+   if (freq < (uint64_t)SI5351_CLKOUT_MIN_FREQ * SI5351_FREQ_MULT) {
+      freq = (uint64_t)SI5351_CLKOUT_MIN_FREQ * SI5351_FREQ_MULT;
+   }
+   if (freq > (uint64_t)SI5351_MULTISYNTH_MAX_FREQ * SI5351_FREQ_MULT) {
+      freq = (uint64_t)SI5351_MULTISYNTH_MAX_FREQ * SI5351_FREQ_MULT;
+   }
+   if (pll_freq == 0) {
+      pll_freq = SI5351_PLL_FIXED;
+   }
+
+   // CLK0 runs from PLL A as it is; every other clock is put on PLL B,
+   // which is worked out again from the library's own reference, and
+   // a clock after CLK1 shares the frequency PLL B already has
+   enum si5351_pll target_pll = (clk == SI5351_CLK0) ? SI5351_PLLA : SI5351_PLLB;
+   if (target_pll == SI5351_PLLA) {
+      pll_freq = pllFrequency[SI5351_PLLA] ? pllFrequency[SI5351_PLLA] : pll_freq;
+   }
+   else {
+      if ((clk != SI5351_CLK1) && (pllFrequency[SI5351_PLLB] != 0)) {
+         pll_freq = pllFrequency[SI5351_PLLB];
+      }
+      writePllParameters(pll_freq, SI5351_PLLB);
+   }
+
+   // output divider keeps low frequencies in multisynth range
+   uint8_t r_div = 0;
+   while ((r_div < 7) && (freq < (((uint64_t)SI5351_CLKOUT_MIN_FREQ * 128 * SI5351_FREQ_MULT) >> r_div))) {
+      ++r_div;
+   }
+   freq <<= r_div;
+
+   Si5351RegSet ms_reg;
+   uint8_t      params[SI5351_PARAMETERS_LENGTH];
+   ratioCalc(pll_freq, freq, ms_reg);
+   packParameters(ms_reg, params);
+   si5351_write_bulk(SI5351_CLK0_PARAMETERS + SI5351_PARAMETERS_LENGTH * clk,
+                     SI5351_PARAMETERS_LENGTH, params);
+
+   // fractional mode, then the output divider, then the PLL source
+   updateRegister(SI5351_CLK0_CTRL + clk, SI5351_CLK_INTEGER_MODE, 0);
+   updateRegister(SI5351_CLK0_PARAMETERS + SI5351_PARAMETERS_LENGTH * clk + 2,
+                  SI5351_OUTPUT_CLK_DIV_MASK | SI5351_OUTPUT_CLK_DIVBY4,
+                  r_div << SI5351_OUTPUT_CLK_DIV_SHIFT);
+   set_ms_source(clk, target_pll);
+   return 0;
+}
+
+void Si5351::writePllParameters(uint64_t pll_freq, enum si5351_pll target_pll) {
+   Si5351RegSet pll_reg;
+   uint8_t      params[SI5351_PARAMETERS_LENGTH];
+
+   pllFrequency[target_pll] = pll_freq;
+   ratioCalc(pll_freq, referenceFrequency(), pll_reg);
+   packParameters(pll_reg, params);
+   si5351_write_bulk((target_pll == SI5351_PLLA) ? SI5351_PLLA_PARAMETERS : SI5351_PLLB_PARAMETERS,
+                     SI5351_PARAMETERS_LENGTH, params);
+}
+
+void Si5351::set_pll(uint64_t pll_freq, enum si5351_pll target_pll) {
+   writePllParameters(pll_freq, target_pll);
+   si5351_write(SI5351_PLL_RESET,
+                (target_pll == SI5351_PLLA) ? SI5351_PLL_RESET_A : SI5351_PLL_RESET_B);
+}
+
+void Si5351::set_ms_source(enum si5351_clock clk, enum si5351_pll pll) {
+   updateRegister(SI5351_CLK0_CTRL + clk, SI5351_CLK_PLL_SELECT,
+                  (pll == SI5351_PLLB) ? SI5351_CLK_PLL_SELECT : 0);
+}
+
+void Si5351::output_enable(enum si5351_clock clk, uint8_t enable) {
+   ++outputEnableCalls;
+   clockEnabled[clk] = (enable != 0);
+   updateRegister(SI5351_OUTPUT_ENABLE_CTRL, bit(clk), enable ? 0 : bit(clk));
+}
+
+void Si5351::drive_strength(enum si5351_clock clk, enum si5351_drive drive) {
+   clockDrive[clk] = drive;
+   updateRegister(SI5351_CLK0_CTRL + clk, SI5351_CLK_DRIVE_STRENGTH_MASK, drive);
+}
+
+void Si5351::set_correction(int32_t corr) {
+   correction = corr;
+
+   // PLLs already running pick up the new reference
+   for (int ii=0; ii<2; ++ii) {
+      if (pllFrequency[ii] != 0) {
+         set_pll(pllFrequency[ii], (enum si5351_pll)ii);
+      }
+   }
+}
+
+int32_t Si5351::get_correction() {
+   return correction;
+}
+
+uint8_t Si5351::si5351_write(uint8_t addr, uint8_t data) {
+   return si5351_write_bulk(addr, 1, &data);
+}
+
+uint8_t Si5351::si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data) {
+   registerWrites += bytes;
+   if (  (addr >= SI5351_CLK0_PARAMETERS) && (bytes == SI5351_PARAMETERS_LENGTH)
+      && (((addr - SI5351_CLK0_PARAMETERS) % SI5351_PARAMETERS_LENGTH) == 0)) {
+      ++multisynthWrites;
+   }
+   if (addr == SI5351_OUTPUT_ENABLE_CTRL) {
+      for (int ii=0; ii<SI5351_NUMBER_OF_CLOCKS; ++ii) {
+         clockEnabled[ii] = !(data[0] & bit(ii));
+      }
+   }
+
+   Wire.beginTransmission(mc_i2cAddress);
+   Wire.write(addr);
+   Wire.write(data, bytes);
+   return Wire.endTransmission();
+}
+
+uint8_t Si5351::si5351_read(uint8_t addr) {
+   Wire.beginTransmission(mc_i2cAddress);
+   Wire.write(addr);
+   Wire.endTransmission();
+
+   Wire.requestFrom(mc_i2cAddress, (uint8_t)1);
+   return (Wire.available() > 0) ? (uint8_t)Wire.read() : 0;
+}
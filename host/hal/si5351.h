@@ -0,0 +1,168 @@
+#ifndef HOST_SI5351_H
+#define HOST_SI5351_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * Host stand-in for the Etherkit Si5351Arduino library (the 1.x
+ * interface used by the sketch). Like the library, it works out the
+ * PLL and multisynth parameters and writes them to the chip over
+ * Wire, with the same transfers, so bus cost is realistic and the
+ * register emulator (Si5351Emulator.h) can check the result. It
+ * also picks the PLL of each clock the way 1.x does, CLK0 on PLL A
+ * and the rest on PLL B, which set_freq programs itself. Calls
+ * are also recorded per clock, so a test driver can see what the
+ * sketch asked for. The chip address is a constructor argument, as in
+ * library 2.x, so more than one chip can be driven.
+ */
+
+#include <Arduino.h>
+
+#define SI5351_BUS_BASE_ADDR            0x60
+#define SI5351_XTAL_FREQ                25000000
+#define SI5351_PLL_FIXED                90000000000ULL
+#define SI5351_FREQ_MULT                100ULL
+#define SI5351_CLKOUT_MIN_FREQ          8000
+#define SI5351_CLKOUT_MAX_FREQ          160000000
+#define SI5351_PLL_VCO_MIN              600000000
+#define SI5351_PLL_VCO_MAX              900000000
+
+#define SI5351_DEVICE_STATUS            0
+#define SI5351_OUTPUT_ENABLE_CTRL       3
+#define SI5351_CLK0_CTRL                16
+#define SI5351_PLLA_PARAMETERS          26
+#define SI5351_PLLB_PARAMETERS          34
+#define SI5351_CLK0_PARAMETERS          42
+#define SI5351_PARAMETERS_LENGTH        8
+#define SI5351_PLL_RESET                177
+#define SI5351_CRYSTAL_LOAD             183
+
+#define SI5351_CLK_POWERDOWN            (1<<7)
+#define SI5351_CLK_INTEGER_MODE         (1<<6)
+#define SI5351_CLK_PLL_SELECT           (1<<5)
+#define SI5351_CLK_INVERT               (1<<4)
+#define SI5351_CLK_INPUT_MASK           (3<<2)
+#define SI5351_CLK_INPUT_MULTISYNTH_N   (3<<2)
+#define SI5351_CLK_DRIVE_STRENGTH_MASK  (3<<0)
+
+#define SI5351_OUTPUT_CLK_DIV_MASK      (7<<4)
+#define SI5351_OUTPUT_CLK_DIV_SHIFT     4
+#define SI5351_OUTPUT_CLK_DIVBY4        (3<<2)
+
+#define SI5351_PLL_RESET_B              (1<<7)
+#define SI5351_PLL_RESET_A              (1<<5)
+
+#define SI5351_PLL_A_MIN                15
+#define SI5351_PLL_A_MAX                90
+#define SI5351_MULTISYNTH_A_MIN         6
+#define SI5351_MULTISYNTH_A_MAX         1800
+#define SI5351_MULTISYNTH_MAX_FREQ      150000000
+#define SI5351_FRAC_DENOM               1048575UL
+
+#define SI5351_CRYSTAL_LOAD_6PF         (1<<6)
+#define SI5351_CRYSTAL_LOAD_8PF         (2<<6)
+#define SI5351_CRYSTAL_LOAD_10PF        (3<<6)
+
+#define SI5351_NUMBER_OF_CLOCKS         8
+
+enum si5351_clock {SI5351_CLK0, SI5351_CLK1, SI5351_CLK2, SI5351_CLK3,
+   SI5351_CLK4, SI5351_CLK5, SI5351_CLK6, SI5351_CLK7};
+
+enum si5351_pll {SI5351_PLLA, SI5351_PLLB};
+
+enum si5351_drive {SI5351_DRIVE_2MA, SI5351_DRIVE_4MA, SI5351_DRIVE_6MA, SI5351_DRIVE_8MA};
+
+/**
+ * a PLL or multisynth parameter set
+ */
+struct Si5351RegSet {
+   uint32_t p1;
+   uint32_t p2;
+   uint32_t p3;
+};
+
+/**
+ * This class is the Si5351 driver
+ */
+class Si5351 {
+protected:
+   uint8_t  mc_i2cAddress;
+   uint32_t ml_xtalFreq;
+
+  /**
+   * works out a + b/c divider parameters for ratio num / den
+   */
+   static void ratioCalc(uint64_t num, uint64_t den, Si5351RegSet &reg);
+
+  /**
+   * packs parameters into a register block
+   */
+   static void packParameters(const Si5351RegSet &reg, uint8_t *params);
+
+  /**
+   * gets the reference frequency with correction applied, Hz * 100
+   */
+   uint64_t referenceFrequency();
+
+  /**
+   * writes the parameters of a PLL, without resetting it
+   */
+   void writePllParameters(uint64_t pll_freq, enum si5351_pll target_pll);
+
+  /**
+   * read-modify-write of one register
+   */
+   void updateRegister(uint8_t addr, uint8_t mask, uint8_t value);
+
+public:
+   Si5351(uint8_t i2c_addr = SI5351_BUS_BASE_ADDR);
+
+   void    init(uint8_t xtal_load_c, uint32_t ref_osc_freq);
+   uint8_t set_freq(uint64_t freq, uint64_t pll_freq, enum si5351_clock clk);
+   void    set_pll(uint64_t pll_freq, enum si5351_pll target_pll);
+   void    set_ms_source(enum si5351_clock clk, enum si5351_pll pll);
+   void    output_enable(enum si5351_clock clk, uint8_t enable);
+   void    drive_strength(enum si5351_clock clk, enum si5351_drive drive);
+   void    set_correction(int32_t corr);
+   int32_t get_correction();
+   uint8_t si5351_write(uint8_t addr, uint8_t data);
+   uint8_t si5351_write_bulk(uint8_t addr, uint8_t bytes, uint8_t *data);
+   uint8_t si5351_read(uint8_t addr);
+
+  /**
+   * host only - what the sketch last asked for, per clock
+   */
+   uint64_t clockFrequency[SI5351_NUMBER_OF_CLOCKS];
+   bool     clockEnabled[SI5351_NUMBER_OF_CLOCKS];
+   uint8_t  clockDrive[SI5351_NUMBER_OF_CLOCKS];
+   uint64_t pllFrequency[2];
+   int32_t  correction;
+   bool     initialized;
+
+  /**
+   * host only - call counts
+   */
+   unsigned long setFreqCalls;
+   unsigned long multisynthWrites;   // whole multisynth blocks, from set_freq or not
+   unsigned long outputEnableCalls;
+   unsigned long registerWrites;
+};
+
+#endif // HOST_SI5351_H
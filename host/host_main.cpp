@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file runs the sketch on the host: setup(), then a number of
+ * loop() passes while the encoder is spun at a steady rate, then a
+ * summary of what the sketch did. It is the target to point perf or
+ * callgrind at.
+ *
+ *    vfo_host [loop passes] [encoder edge interval us]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <si5351.h>
+#include <U8glib.h>
+#include "Si5351Emulator.h"
+#include "HostHAL.h"
+#include "HostSketch.h"
+
+#define HOST_DEFAULT_LOOPS       10000
+#define HOST_DEFAULT_EDGE_US      2500
+
+/**
+ * This class spins the encoder clockwise, one edge per interval
+ */
+class EncoderSpinner : public HostScheduler {
+protected:
+   uint64_t ml_interval;
+   uint64_t ml_next;
+   int      mi_phase;
+
+public:
+   unsigned long edges;
+
+   EncoderSpinner(uint64_t interval, uint64_t start)
+   : ml_interval(interval)
+   , ml_next(start)
+   , mi_phase(0)
+   , edges(0)
+   {}
+
+   virtual uint64_t nextEventTime() {
+      return ml_next;
+   }
+
+   virtual void runEvents(uint64_t now) {
+      // from rest with both lines high: B falls, A falls, B rises, A rises
+      static const uint8_t pin[4]   = { ENCODER_PIN_B, ENCODER_PIN_A,
+                                        ENCODER_PIN_B, ENCODER_PIN_A };
+      static const uint8_t level[4] = { LOW, LOW, HIGH, HIGH };
+
+      while (ml_next <= now) {
+         host::setPin(pin[mi_phase], level[mi_phase]);
+         mi_phase = (mi_phase + 1) & 3;
+         ml_next += ml_interval;
+         ++edges;
+      }
+   }
+};
+
+int main(int argc, char **argv) {
+   unsigned long loops    = (argc > 1) ? strtoul(argv[1], 0, 10) : HOST_DEFAULT_LOOPS;
+   unsigned long interval = (argc > 2) ? strtoul(argv[2], 0, 10) : HOST_DEFAULT_EDGE_US;
+
+   setup();
+
+   EncoderSpinner spinner(interval, host::now() + interval);
+   host::setScheduler(&spinner);
+   host::resetStats();
+   Wire.resetCounters();
+   hostSi5351Chip.resetCounters();
+
+   uint64_t      start    = host::now();
+   unsigned long loads    = si5351.multisynthWrites;
+   unsigned long frames   = hostU8glibDisplay ? hostU8glibDisplay->frames : 0;
+
+   for (unsigned long ii=0; ii<loops; ++ii) {
+      loop();
+   }
+   host::setScheduler(0);
+
+   const HostStats &stats = host::stats();
+   uint64_t elapsed = host::now() - start;
+   uint64_t asleep  = 0;
+   for (int ii=0; ii<HOST_SLEEP_MODES; ++ii) {
+      asleep += stats.sleepMicros[ii];
+   }
+
+   printf("loop passes        %lu\n",  loops);
+   printf("virtual time       %.3f s\n", elapsed / 1e6);
+   printf("encoder edges      %lu\n",  spinner.edges);
+   printf("interrupts         %llu\n", (unsigned long long)stats.interruptCount);
+   printf("frequency loads    %lu\n",  si5351.multisynthWrites - loads);
+   printf("display frames     %lu\n",  (hostU8glibDisplay ? hostU8glibDisplay->frames : 0) - frames);
+   printf("i2c bytes si5351   %lu (%.1f per load)\n", Wire.bytes(SI5351_BUS_BASE_ADDR),
+          (si5351.multisynthWrites > loads)
+          ? (double)Wire.bytes(SI5351_BUS_BASE_ADDR) / (si5351.multisynthWrites - loads) : 0.0);
+   printf("i2c bytes display  %lu\n",  Wire.bytes(HOST_SSD1306_ADDRESS));
+   printf("time asleep        %.1f %%\n", elapsed ? (100.0 * asleep / elapsed) : 0.0);
+   printf("watchdog gap       %.1f ms longest, timeout %.0f ms\n",
+          stats.wdtLongestMicros / 1e3, stats.wdtTimeoutMicros / 1e3);
+   printf("si5351 problems    %lu\n", hostSi5351Chip.problems);
+   for (size_t ii=0; ii<hostSi5351Chip.messages.size(); ++ii) {
+      printf("   %s\n", hostSi5351Chip.messages[ii].c_str());
+   }
+   for (int ii=0; ii<3; ++ii) {
+      // only the selected band's clock is asked for anything
+      double asked = (vfoBank.active()->getClock() == ii) ? vfoBank.active()->getOutputFrequency() : 0.0;
+      printf("clock %d            asked %.2f Hz, chip %.2f Hz%s\n", ii, asked,
+             hostSi5351Chip.outputFrequency(ii),
+             hostSi5351Chip.outputEnabled(ii) ? "" : " (off)");
+   }
+
+   return 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file builds the sketch for the host. The .ino is compiled as
+ * is, the way the Arduino IDE does it, against the stub HAL in hal/.
+ * The sketch settings HostSketch.h repeats are checked here.
+ */
+#include <Arduino.h>
+
+#include "si5351vfo3b.ino"
+#include "HostSketch.h"
+
+static_assert(HOST_DISPLAY_BAND_LINES == DISPLAY_BAND_LINES,
+              "HOST_DISPLAY_BAND_LINES differs from the sketch");
+static_assert(HOST_ENCODER_MOVEMENT_THRESHOLD == ENCODER_MOVEMENT_THRESHOLD,
+              "HOST_ENCODER_MOVEMENT_THRESHOLD differs from the sketch");
+#ifdef USE_FREQUENCY_SWEEP
+static_assert(HOST_SWEEP_MIN_DWELL_MICROS == SWEEP_MIN_DWELL_MICROS,
+              "HOST_SWEEP_MIN_DWELL_MICROS differs from the sketch");
+#endif
@@ -0,0 +1,310 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the antenna analyzer test program. It runs the sketch
+ * built with USE_ANTENNA_ANALYZER against a simulated SWR bridge and
+ * antenna, sends SA commands over the simulated serial port, and
+ * checks the analyzer frames that come back.
+ *
+ *    vfo_analyzer                  sweeps at several dwells, 200 points
+ *    vfo_analyzer -p 100 -d 5000 -o sweep.csv
+ *                                  one sweep, points written as CSV
+ *
+ * Each sweep covers ANALYZER_SPAN of the selected band, 7 MHz up.
+ * The antenna is a series RLC, resonant at ANTENNA_RESONANCE_HZ. The
+ * bridge detectors read the forward level and the reflection
+ * coefficient times it, and follow a change of frequency through an
+ * RC lag of DETECTOR_TAU_US, so a point read before it settles shows.
+ * The frequency is taken from the chip emulator trace.
+ *
+ * For each sweep it reports the time from the command to the end
+ * frame, points received and dropped, frames failing their CRC, and
+ * the worst SWR error against the antenna model. The CSV columns are
+ * frequency in Hz, measured and model SWR, for instance
+ *
+ *    gnuplot -p -e "set datafile separator ','; plot 'sweep.csv' using 1:2 with lines, '' using 1:3"
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+#include "FrameParser.h"
+
+#define ANTENNA_RESONANCE_HZ     7150000.0
+#define ANTENNA_RESISTANCE            42.0     // ohms at resonance
+#define ANTENNA_REACTANCE_SLOPE      600.0     // ohms per unit of f/f0 - f0/f
+#define FEED_IMPEDANCE                50.0
+#define DETECTOR_FULL_SCALE          800.0     // forward reading, ADC counts
+#define DETECTOR_TAU_US              300.0
+#define ANALYZER_START_FREQUENCY  7000000UL
+#define ANALYZER_SPAN              298500UL
+#define ANALYZER_TIMEOUT_US     10000000ULL
+
+/**
+ * the simulated bridge: the detectors follow the frequency on the
+ * selected band's clock, taken from the trace
+ */
+static std::vector<HostTraceRecord> traceLog;
+static size_t   traceSeen;
+static double   detectorFrom[2];       // readings when the frequency last changed
+static double   detectorTo[2];         // readings it is settling to
+static uint64_t detectorChange;
+
+/**
+ * gets the reflection coefficient of the antenna
+ * @param  f  frequency in Hz
+ */
+static double reflection(double f) {
+   double x   = ANTENNA_REACTANCE_SLOPE * (f / ANTENNA_RESONANCE_HZ - ANTENNA_RESONANCE_HZ / f);
+   double r   = ANTENNA_RESISTANCE;
+   double num = sqrt((r - FEED_IMPEDANCE) * (r - FEED_IMPEDANCE) + x * x);
+   double den = sqrt((r + FEED_IMPEDANCE) * (r + FEED_IMPEDANCE) + x * x);
+   return num / den;
+}
+
+/**
+ * gets the SWR the analyzer should report at a frequency, from the
+ * settled detector readings
+ */
+static double modelSWR(double f) {
+   double forward   = floor(DETECTOR_FULL_SCALE + 0.5);
+   double reflected = floor(DETECTOR_FULL_SCALE * reflection(f) + 0.5);
+   return (forward + reflected) / (forward - reflected);
+}
+
+/**
+ * gets a detector reading at a time
+ */
+static double detectorAt(int channel, uint64_t t) {
+   double lag = exp(-(double)(t - detectorChange) / DETECTOR_TAU_US);
+   return detectorTo[channel] + (detectorFrom[channel] - detectorTo[channel]) * lag;
+}
+
+/**
+ * analog source for the sketch: the detector outputs now
+ */
+static int detector(uint8_t pin) {
+   uint8_t clk = vfoBank.active()->getClock();
+   for (; traceSeen<traceLog.size(); ++traceSeen) {
+      const HostTraceRecord &record = traceLog[traceSeen];
+      if ((record.kind == HOST_TRACE_SI5351_FREQUENCY) && (record.channel == clk)) {
+         double f = record.value / 100.0;
+         for (int ii=0; ii<2; ++ii) {
+            detectorFrom[ii] = detectorAt(ii, record.time);
+         }
+         detectorTo[0]  = DETECTOR_FULL_SCALE;
+         detectorTo[1]  = DETECTOR_FULL_SCALE * reflection(f);
+         detectorChange = record.time;
+      }
+   }
+
+   int channel = (pin == ANALYZER_FORWARD_PIN) ? 0 : ((pin == ANALYZER_REFLECTED_PIN) ? 1 : -1);
+   return (channel < 0) ? 0 : (int)floor(detectorAt(channel, host::now()) + 0.5);
+}
+
+/**
+ * one analyzer frame
+ */
+struct AnalyzerFrame {
+   uint8_t  kind;
+   uint16_t first;
+   uint16_t second;
+};
+
+/**
+ * picks analyzer frames out of the serial output
+ * @param  bytes  output so far; frames and anything before them are
+ *                taken off
+ * @param  frames receives the frames
+ * @param  bad    counts frames failing their CRC
+ */
+static void takeFrames(std::string &bytes, std::vector<AnalyzerFrame> &frames, unsigned long &bad) {
+   size_t at;
+   while (((at = bytes.find((char)FRAME_SYNC)) != std::string::npos)
+       && (bytes.size() - at >= FRAME_ANALYZER_LENGTH)) {
+      const uint8_t *frame = (const uint8_t *)bytes.data() + at;
+      uint16_t sum = FrameParser::crc(frame + 1, FRAME_ANALYZER_LENGTH - 3);
+      if ((frame[6] != (uint8_t)sum) || (frame[7] != (uint8_t)(sum >> 8))) {
+         ++bad;
+         bytes.erase(0, at + 1);
+         continue;
+      }
+      AnalyzerFrame f = { frame[1],
+                          (uint16_t)(frame[2] | (frame[3] << 8)),
+                          (uint16_t)(frame[4] | (frame[5] << 8)) };
+      frames.push_back(f);
+      bytes.erase(0, at + FRAME_ANALYZER_LENGTH);
+   }
+}
+
+/**
+ * formats an SA command
+ */
+static std::string analyzerCommand(unsigned long start, unsigned long stop, unsigned long step, unsigned long dwell) {
+   char buf[48];
+   snprintf(buf, sizeof(buf), "SA%011lu%011lu%07lu%07lu;", start, stop, step, dwell);
+   return buf;
+}
+
+/**
+ * runs one analyzer sweep over the selected band and reports it
+ * @param  count  points
+ * @param  dwell  us per point
+ * @param  csv    file for the points, or 0
+ */
+static void runSweep(int count, unsigned long dwell, FILE *csv) {
+   unsigned long start = ANALYZER_START_FREQUENCY;
+   unsigned long step  = ANALYZER_SPAN / (count - 1);
+
+   host::serialInput(analyzerCommand(start, start + step * (count - 1), step, dwell));
+   uint64_t begin = host::now();
+
+   std::vector<AnalyzerFrame> frames;
+   std::string   output;
+   unsigned long bad   = 0;
+   bool          ended = false;
+   while (!ended && (host::now() - begin < ANALYZER_TIMEOUT_US)) {
+      loop();
+      output += host::serialOutput();
+      takeFrames(output, frames, bad);
+      ended = !frames.empty() && (frames.back().kind == FRAME_ANALYZER_END);
+   }
+   uint64_t took = host::now() - begin;
+
+   unsigned long points  = 0;
+   unsigned long wrong   = 0;
+   double        worst   = 0;
+   int           lastIndex = -1;
+   double        bestF   = 0;
+   double        bestSWR = 1e9;
+   for (size_t ii=0; ii<frames.size(); ++ii) {
+      if (frames[ii].kind != FRAME_ANALYZER_POINT) {
+         continue;
+      }
+      ++points;
+      if ((int)frames[ii].first <= lastIndex) {
+         ++wrong;
+      }
+      lastIndex = frames[ii].first;
+
+      double f     = start + (double)step * frames[ii].first;
+      double swr   = frames[ii].second / 100.0;
+      double model = modelSWR(f);
+      worst = std::max(worst, fabs(swr - model));
+      if (swr < bestSWR) {
+         bestSWR = swr;
+         bestF   = f;
+      }
+      if (csv != 0) {
+         fprintf(csv, "%.0f,%.2f,%.3f\n", f, swr, model);
+      }
+   }
+
+   const AnalyzerFrame *end = ended ? &frames.back() : 0;
+   printf("dwell %5lu us  %4d points  %7.1f ms  received %lu  dropped %u  bad crc %lu  "
+          "worst SWR error %.3f  lowest %.2f at %.0f Hz  %s\n",
+          dwell, count, took / 1000.0, points, end ? end->second : 0, bad,
+          worst, bestSWR, bestF,
+          (!ended || wrong || (points != (unsigned long)count) || (end->first != points) || (worst > 0.02))
+          ? "WRONG" : "ok");
+}
+
+/**
+ * checks a dwell too short for the serial port is refused
+ */
+static void refuseCase() {
+   unsigned long start = ANALYZER_START_FREQUENCY;
+   host::serialInput(analyzerCommand(start, start + 99 * 1000, 1000, 2000));
+
+   std::string reply;
+   uint64_t    begin = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - begin < ANALYZER_TIMEOUT_US)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   printf("dwell  2000 us  %s %s\n", reply.c_str(), (reply == "?;") ? "refused" : "NOT refused");
+}
+
+static void usage() {
+   fprintf(stderr, "usage: vfo_analyzer [-p points] [-d dwell us] [-o csv file]\n");
+   exit(2);
+}
+
+int main(int argc, char **argv) {
+   int           count = 200;
+   unsigned long dwell = 0;
+   const char   *path  = 0;
+   int           opt;
+
+   while ((opt = getopt(argc, argv, "p:d:o:")) != -1) {
+      switch (opt) {
+         case 'p': count = atoi(optarg);            break;
+         case 'd': dwell = strtoul(optarg, 0, 10);  break;
+         case 'o': path  = optarg;                  break;
+         default:  usage();
+      }
+   }
+   if ((optind != argc) || (count < 2) || (count > 2000)) {
+      usage();
+   }
+
+   FILE *csv = 0;
+   if (path != 0) {
+      csv = fopen(path, "w");
+      if (csv == 0) {
+         perror(path);
+         return 1;
+      }
+      fprintf(csv, "frequency_hz,swr,model_swr\n");
+   }
+
+   host::setTraceLog(&traceLog);
+   host::setAnalogSource(detector);
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   if (dwell != 0) {
+      runSweep(count, dwell, csv);
+   }
+   else {
+      static const unsigned long dwells[] = { 10000, 5000, 2500 };
+      for (size_t ii=0; ii<sizeof(dwells)/sizeof(dwells[0]); ++ii) {
+         runSweep(count, dwells[ii], csv);
+      }
+      refuseCase();
+   }
+
+   if (csv != 0) {
+      fclose(csv);
+   }
+   return 0;
+}
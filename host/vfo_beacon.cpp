@@ -0,0 +1,299 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the FSK beacon benchmark. It runs the sketch built with
+ * USE_FSK_BEACON, loads messages with the BM CAT command and sends
+ * them with BE over the simulated serial port, and times every tone
+ * change on the chip.
+ *
+ *    vfo_beacon
+ *
+ * A WSPR and an FT8 shaped message are sent, made of pseudo random
+ * tones. Each tone change is checked against the frequency of its
+ * tone, and the time it took effect on the chip is compared with the
+ * symbol schedule, counted from the first change the timer sent: the
+ * spread of those errors is the symbol edge jitter. The write time is
+ * how long a tone change holds the bus. The FT8 message is sent again
+ * with FA queries coming in throughout, to show the loop work does
+ * not move the edges; a message is stopped with BE0 to check the dial
+ * frequency comes back, and a period too short for a write refused.
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+
+#define BEACON_TIMEOUT_US     200000000ULL
+#define BEACON_QUERY_EVERY_US     20000ULL
+#define BEACON_TONES_PER_COMMAND     32
+#define BEACON_BYTE_US              261ULL     // 10 bits at 38400 baud
+
+/**
+ * one beacon mode
+ */
+struct BeaconMode {
+   const char    *name;
+   int            symbols;
+   int            tones;
+   unsigned long  frequency;    // tone 0, Hz
+   unsigned long  spacing;      // mHz
+   unsigned long  period;       // us
+};
+
+static const BeaconMode wspr = { "WSPR", 162, 4, 7040000, 1465, 682667 };
+static const BeaconMode ft8  = { "FT8",   79, 8, 7075500, 6250, 160000 };
+
+/**
+ * runs the sketch for a while
+ */
+static void runFor(uint64_t us) {
+   uint64_t until = host::now() + us;
+   while (host::now() < until) {
+      loop();
+   }
+}
+
+/**
+ * runs the sketch until an answer to a CAT command is in
+ * @return the answer, empty if none came
+ */
+static std::string answer() {
+   std::string reply;
+   uint64_t    start = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - start < 1000000ULL)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   return reply;
+}
+
+/**
+ * sends a command with no answer and gives the sketch time to take
+ * it
+ */
+static void command(const std::string &text) {
+   host::serialInput(text);
+   runFor(text.size() * BEACON_BYTE_US + 20000);
+}
+
+/**
+ * makes a message of pseudo random tones and loads it with BM
+ */
+static std::vector<int> loadMessage(const BeaconMode &mode, unsigned long seed) {
+   std::vector<int> tones;
+   for (int ii=0; ii<mode.symbols; ++ii) {
+      seed = seed * 1103515245UL + 12345UL;
+      tones.push_back((int)((seed >> 16) % mode.tones));
+   }
+
+   for (int first=0; first<mode.symbols; first+=BEACON_TONES_PER_COMMAND) {
+      char buf[48];
+      int  n = snprintf(buf, sizeof(buf), "BM%03d", first);
+      for (int ii=first; (ii<first+BEACON_TONES_PER_COMMAND) && (ii<mode.symbols); ++ii) {
+         buf[n++] = '0' + tones[ii];
+      }
+      buf[n++] = ';';
+      buf[n]   = 0;
+      command(buf);
+   }
+   std::string out = host::serialOutput();
+   if (!out.empty()) {
+      printf("%-18s message load answered %s\n", mode.name, out.c_str());
+   }
+   return tones;
+}
+
+/**
+ * formats a BE command starting a message
+ */
+static std::string beaconCommand(const BeaconMode &mode, unsigned long period) {
+   char buf[48];
+   snprintf(buf, sizeof(buf), "BE%011lu%07lu%07lu%03d;", mode.frequency, mode.spacing, period, mode.symbols);
+   return buf;
+}
+
+/**
+ * gets the chip writes of the selected band's clock from a trace
+ */
+static std::vector<HostTraceRecord> changes(const std::vector<HostTraceRecord> &log) {
+   std::vector<HostTraceRecord> out;
+   uint8_t clk = vfoBank.active()->getClock();
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      if ((log[ii].kind == HOST_TRACE_SI5351_FREQUENCY) && (log[ii].channel == clk)) {
+         out.push_back(log[ii]);
+      }
+   }
+   return out;
+}
+
+/**
+ * sends one message and reports it
+ * @param  name     case name
+ * @param  mode     beacon mode
+ * @param  queries  true to send FA queries while it runs
+ */
+static void runCase(const char *name, const BeaconMode &mode, bool queries) {
+   std::vector<int> tones = loadMessage(mode, mode.symbols);
+   std::vector<HostTraceRecord> log;
+
+   host::setTraceLog(&log);
+   host::serialInput(beaconCommand(mode, mode.period));
+
+   uint64_t      start     = host::now();
+   uint64_t      nextQuery = start + BEACON_QUERY_EVERY_US;
+   unsigned long answered  = 0;
+   bool          started   = false;
+   while ((started ? beacon_active : true) && (host::now() - start < BEACON_TIMEOUT_US)) {
+      loop();
+      started = started || beacon_active;
+      if (queries && (host::now() >= nextQuery)) {
+         host::serialInput("FA;");
+         nextQuery += BEACON_QUERY_EVERY_US;
+      }
+      std::string out = host::serialOutput();
+      answered += std::count(out.begin(), out.end(), ';');
+   }
+   host::setTraceLog(0);
+
+   // sketch's own latest interrupt, after any FA answers still to come
+   host::serialInput("BE;");
+   std::string status;
+   while (status.find("BE") == std::string::npos) {
+      std::string reply = answer();
+      if (reply.empty()) {
+         break;
+      }
+      status += reply;
+   }
+   status = status.substr(std::min(status.find("BE"), status.size()));
+   unsigned long late = (status.size() >= 14) ? strtoul(status.substr(6, 7).c_str(), 0, 10) : 0;
+
+   // symbol 0, each change of tone after it, then the dial frequency
+   std::vector<HostTraceRecord> written = changes(log);
+   std::vector<int64_t> error;
+   unsigned long wrong     = 0;
+   double        worstHz   = 0;
+   uint64_t      writeTime = 0;
+   size_t        at        = 0;
+   int64_t       first     = -1;
+   int           firstEdge = 0;
+   for (int ii=0; ii<mode.symbols; ++ii) {
+      if ((ii > 0) && (tones[ii] == tones[ii - 1])) {
+         continue;
+      }
+      if (at >= written.size()) {
+         ++wrong;
+         continue;
+      }
+      const HostTraceRecord &record = written[at++];
+      double want = mode.frequency + (tones[ii] * (double)mode.spacing) / 1000.0;
+      double off  = fabs(record.value / 100.0 - want);
+      worstHz = std::max(worstHz, off);
+      if (off > 0.1) {
+         ++wrong;
+      }
+      if (ii == 0) {
+         continue;
+      }
+
+      writeTime = std::max(writeTime, record.time - record.start);
+      if (first < 0) {
+         first     = (int64_t)record.time;
+         firstEdge = ii;
+      }
+      error.push_back((int64_t)record.time - first - (int64_t)(ii - firstEdge) * (int64_t)mode.period);
+   }
+   bool restored = (at < written.size())
+                && (written.back().value == (uint64_t)vfoBank.active()->getFrequency() * 100);
+
+   int64_t low  = error.empty() ? 0 : *std::min_element(error.begin(), error.end());
+   int64_t high = error.empty() ? 0 : *std::max_element(error.begin(), error.end());
+   printf("%-18s %3d symbols %5lu us  %4zu changes, write %4llu us  edge error %+lld..%+lld us, "
+          "jitter %lld us  tone error %.3f Hz  late %lu us  %s%s",
+          name, mode.symbols, mode.period, error.size(), (unsigned long long)writeTime,
+          (long long)low, (long long)high, (long long)(high - low), worstHz, late,
+          wrong ? "WRONG" : "ok", restored ? "" : ", dial NOT restored");
+   if (queries) {
+      printf(", %lu answers", answered);
+   }
+   printf("\n");
+}
+
+/**
+ * starts a message, stops it with BE0 and checks the dial frequency
+ * is back on the chip
+ */
+static void stopCase() {
+   std::vector<HostTraceRecord> log;
+
+   loadMessage(ft8, 1);
+   host::serialInput(beaconCommand(ft8, ft8.period));
+   runFor(2000000);
+   host::serialOutput();
+
+   host::setTraceLog(&log);
+   host::serialInput("BE0;BE;");
+   std::string status = answer();
+   host::setTraceLog(0);
+
+   std::vector<HostTraceRecord> written = changes(log);
+   bool restored = !written.empty()
+                && (written.back().value == (uint64_t)vfoBank.active()->getFrequency() * 100);
+   printf("%-18s BE0 after 2 s: %s, dial %s\n", "stop", status.c_str(), restored ? "restored" : "NOT restored");
+}
+
+/**
+ * checks a period under the shortest dwell is refused
+ */
+static void refuseCase() {
+   char name[32];
+   snprintf(name, sizeof(name), "period %d us", HOST_SWEEP_MIN_DWELL_MICROS - 100);
+   host::serialInput(beaconCommand(ft8, HOST_SWEEP_MIN_DWELL_MICROS - 100));
+   std::string reply = answer();
+   printf("%-18s %s %s\n", name, reply.c_str(), (reply == "?;") ? "refused" : "NOT refused");
+}
+
+int main(int argc, char **argv) {
+   if (argc != 1) {
+      fprintf(stderr, "usage: vfo_beacon\n");
+      return 2;
+   }
+
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   runCase("WSPR", wspr, false);
+   runCase("FT8", ft8, false);
+   runCase("FT8 + FA;", ft8, true);
+   stopCase();
+   refuseCase();
+   return 0;
+}
@@ -0,0 +1,810 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the microbenchmark suite for the tuning hot path:
+ *
+ * - updateSelectedFrequencyValue(), with and without a step waiting
+ * - VFODefinition::increaseFrequency() and decreaseFrequency()
+ * - si5351_VFODefinition::loadFrequency()
+ * - VFODisplay::formatFrequencyMHz()
+ * - showVFOs() on the SSD1306 (U8glib) and LCD2004 displays
+ * - VFOBank::select(), switching bands: 3 bands on their own clocks,
+ *   as the sketch ships, against 3 and 10 bands sharing one clock,
+ *   where every switch reloads the clock
+ * - SI5351 startup and output switching on one and two chips, the
+ *   per call library path against Si5351Group
+ * - SI5351 startup from a saved register image, Si5351Group::restore()
+ *   with the selected output on, then begin() for the rest of the chip
+ *
+ * Each benchmark is calibrated so one sample runs for the target
+ * time, warmed up, then sampled a number of times. The result is the
+ * distribution of host ns per operation over the samples: median
+ * with its 95% confidence interval (order statistics, no assumption
+ * about the shape), p10/p90, mean and standard deviation, and samples
+ * more than 3 scaled MADs from the median are counted as outliers.
+ * Compare medians between builds, and treat a change as real when
+ * the confidence intervals do not overlap.
+ *
+ * Host ns are a proxy for AVR cycles, good for regressions in the
+ * code itself. What the board also pays is bus time, so the virtual
+ * I2C time and bytes per operation at 100 kHz are reported next to
+ * them; these are exact, not sampled.
+ *
+ * The Si5351 register emulator is swapped for a plain register file
+ * while benchmarking, so its datasheet checks are not counted as
+ * driver cost.
+ *
+ *    vfo_bench [-n samples] [-t sample ms] [-w warmup samples]
+ *              [-f name filter] [-l label] [-o json file]
+ *
+ * JSON goes to stdout, or the -o file, and a table to stderr. The
+ * label (a commit id, say) is copied into the JSON.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <si5351.h>
+#include <U8glib.h>
+#include <LiquidCrystal_I2C.h>
+#include "si5351_VFODefinition.h"
+#include "SSD1306_U8GLIB_VFODisplay.h"
+#include "LCD2004_LCDLIB_VFODisplay.h"
+#include "HostHAL.h"
+#include "HostSketch.h"
+
+#define BENCH_DEFAULT_SAMPLES       31
+#define BENCH_DEFAULT_SAMPLE_MS     10
+#define BENCH_DEFAULT_WARMUP        2
+#define BENCH_OUTLIER_MADS          3.0
+#define BENCH_MAD_SCALE             1.4826    // MAD to standard deviation, normal data
+
+#ifndef HOST_BUILD_TYPE
+#define HOST_BUILD_TYPE             ""
+#endif
+
+/**
+ * defeats dead code elimination of benchmark results
+ */
+volatile unsigned long benchSink;
+
+/**
+ * This class is a bare Si5351 register file, reads give back what
+ * was written, with none of the emulator's decoding
+ */
+class BenchRegisterFile : public HostI2CDevice {
+protected:
+   uint8_t m_regs[256];
+   uint8_t mc_pointer;
+
+public:
+   BenchRegisterFile()
+   : mc_pointer(0)
+   {
+      memset(m_regs, 0, sizeof(m_regs));
+   }
+
+   virtual void i2cWrite(const uint8_t *data, size_t count) {
+      if (count > 0) {
+         mc_pointer = data[0];
+         for (size_t ii=1; ii<count; ++ii) {
+            m_regs[mc_pointer++] = data[ii];
+         }
+      }
+   }
+
+   virtual size_t i2cRead(uint8_t *data, size_t count) {
+      for (size_t ii=0; ii<count; ++ii) {
+         data[ii] = m_regs[mc_pointer++];
+      }
+      return count;
+   }
+};
+
+/**
+ * band wide enough that the step benchmarks never reach a limit
+ */
+const BandDefinition benchBand PROGMEM =
+   { 7000000UL, 1000UL, 4000000000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 };
+
+/**
+ * HF bands for the band switch benchmarks, all on one clock and on
+ * their own clocks
+ */
+#define BENCH_HF_BANDS                   10
+
+const BandDefinition benchHFBands[BENCH_HF_BANDS] PROGMEM = {
+   {  1810000UL,  1800000UL,  2000000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   {  3560000UL,  3500000UL,  4000000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   {  5332000UL,  5330500UL,  5406500UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   {  7055000UL,  7000000UL,  7300000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 10120000UL, 10100000UL, 10150000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 14060000UL, 14000000UL, 14350000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 18096000UL, 18068000UL, 18168000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 21060000UL, 21000000UL, 21450000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 24906000UL, 24890000UL, 24990000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { 28060000UL, 28000000UL, 29700000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+};
+
+const BandDefinition benchOwnClockBands[3] PROGMEM = {
+   {  3560000UL,  3500000UL,  4000000UL, SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   {  7055000UL,  7000000UL,  7300000UL, SI5351_PLL_FIXED, SI5351_CLK1, 0 },
+   { 10120000UL, 10100000UL, 10150000UL, SI5351_PLL_FIXED, SI5351_CLK2, 0 },
+};
+
+/**
+ * This class is a vfo whose frequency can be set directly, so each
+ * sample starts from the same place
+ */
+class BenchVFODefinition : public si5351_VFODefinition {
+public:
+   BenchVFODefinition(Si5351Group &devices, const BandDefinition *band)
+   : si5351_VFODefinition(devices, band)
+   {}
+
+   void reset(unsigned long f) {
+      frequency = f;
+   }
+};
+
+/**
+ * This class opens up the protected display formatting
+ */
+class BenchFormatDisplay : public VFODisplay {
+public:
+   BenchFormatDisplay()
+   : VFODisplay(&vfoBank, 0, NO_HEADING)
+   {}
+
+   const char *format(unsigned long f) {
+      ml_freq = f;
+      formatFrequencyMHz();
+      return ms_buffer;
+   }
+
+   virtual void showVFOs(unsigned long f_delta, short currentVFO) {}
+   virtual void showFreqDeltaDisplay(unsigned long f_delta) {}
+};
+
+/**
+ * This class is one benchmark
+ */
+class BenchCase {
+public:
+   const char *name;
+   const char *description;
+
+   BenchCase(const char *n, const char *d)
+   : name(n)
+   , description(d)
+   {}
+
+   virtual ~BenchCase() {}
+
+  /**
+   * sets up state before each sample, not timed
+   */
+   virtual void prepare() {}
+
+  /**
+   * runs the operation a number of times
+   */
+   virtual void run(unsigned long iterations) = 0;
+};
+
+class BenchUpdateIdle : public BenchCase {
+public:
+   BenchUpdateIdle()
+   : BenchCase("updateSelectedFrequencyValue.idle", "loop pass with no encoder movement")
+   {}
+
+   virtual void run(unsigned long iterations) {
+      unsigned long changed = 0;
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         encoder_movement = 0;
+         changed += updateSelectedFrequencyValue();
+      }
+      benchSink = changed;
+   }
+};
+
+class BenchUpdateStep : public BenchCase {
+public:
+   BenchUpdateStep()
+   : BenchCase("updateSelectedFrequencyValue.step", "one tuning step, alternately up and down, loaded into the chip")
+   {}
+
+   virtual void run(unsigned long iterations) {
+      unsigned long changed = 0;
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         encoder_movement = (ii & 1) ? -HOST_ENCODER_MOVEMENT_THRESHOLD : HOST_ENCODER_MOVEMENT_THRESHOLD;
+         changed += updateSelectedFrequencyValue();
+      }
+      benchSink = changed;
+   }
+};
+
+class BenchIncrease : public BenchCase {
+protected:
+   BenchVFODefinition *mp_vfo;
+
+public:
+   BenchIncrease(BenchVFODefinition *vfo)
+   : BenchCase("VFODefinition.increaseFrequency", "increase by 1 Hz, below the maximum")
+   , mp_vfo(vfo)
+   {}
+
+   virtual void prepare() {
+      mp_vfo->reset(7000000UL);
+   }
+
+   virtual void run(unsigned long iterations) {
+      VFODefinition *vfo = mp_vfo;
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         vfo->increaseFrequency(1);
+      }
+      benchSink = vfo->getFrequency();
+   }
+};
+
+class BenchDecrease : public BenchCase {
+protected:
+   BenchVFODefinition *mp_vfo;
+
+public:
+   BenchDecrease(BenchVFODefinition *vfo)
+   : BenchCase("VFODefinition.decreaseFrequency", "decrease by 1 Hz, above the minimum")
+   , mp_vfo(vfo)
+   {}
+
+   virtual void prepare() {
+      mp_vfo->reset(3000000000UL);
+   }
+
+   virtual void run(unsigned long iterations) {
+      VFODefinition *vfo = mp_vfo;
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         vfo->decreaseFrequency(1);
+      }
+      benchSink = vfo->getFrequency();
+   }
+};
+
+class BenchLoadFrequency : public BenchCase {
+protected:
+   BenchVFODefinition *mp_vfo;
+
+public:
+   BenchLoadFrequency(BenchVFODefinition *vfo)
+   : BenchCase("si5351_VFODefinition.loadFrequency", "multisynth load of a 7 MHz clock, frequency changing each call")
+   , mp_vfo(vfo)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         mp_vfo->reset(7000000UL + (ii & 1023) * 10);
+         mp_vfo->loadFrequency();
+      }
+   }
+};
+
+class BenchFormat : public BenchCase {
+protected:
+   BenchFormatDisplay m_display;
+
+public:
+   BenchFormat()
+   : BenchCase("VFODisplay.formatFrequencyMHz", "format one frequency as nn.nnnnn")
+   {}
+
+   virtual void run(unsigned long iterations) {
+      unsigned long sum = 0;
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         sum += m_display.format(14000000UL + (ii & 1023) * 10)[7];
+      }
+      benchSink = sum;
+   }
+};
+
+class BenchShowVFOs : public BenchCase {
+protected:
+   VFODisplay *mp_display;
+
+public:
+   BenchShowVFOs(const char *n, const char *d, VFODisplay *display)
+   : BenchCase(n, d)
+   , mp_display(display)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         mp_display->showVFOs(frequency_delta, (short)(ii % vfoBank.count()));
+      }
+   }
+};
+
+class BenchBandSwitch : public BenchCase {
+protected:
+   unsigned long m_frequency[BENCH_HF_BANDS];
+   uint8_t       m_enabled[VFOBANK_ENABLED_BYTES(BENCH_HF_BANDS)];
+   VFOBank       m_bank;
+
+public:
+   BenchBandSwitch(const char *n, const char *d, const BandDefinition *bands, uint8_t count)
+   : BenchCase(n, d)
+   , m_bank(si5351Devices, bands, count, m_frequency, m_enabled)
+   {}
+
+   /**
+    * loads every band once, so bands on their own clocks start loaded
+    */
+   virtual void prepare() {
+      m_bank.begin(0);
+      m_bank.load();
+      for (uint8_t ii=1; ii<=m_bank.count(); ++ii) {
+         m_bank.select(ii % m_bank.count());
+      }
+   }
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         m_bank.select((m_bank.selected() + 1) % m_bank.count());
+      }
+   }
+};
+
+/**
+ * the sketch's setupSI5351() before Si5351Group: a library call per
+ * setting per clock, on each chip
+ */
+class BenchStartupPerCall : public BenchCase {
+protected:
+   Si5351 * const *mpp_chips;
+   uint8_t         mc_count;
+
+public:
+   BenchStartupPerCall(const char *n, Si5351 * const *chips, uint8_t count)
+   : BenchCase(n, "init, 3 outputs off, 3 drive strengths, PLL A, per chip")
+   , mpp_chips(chips)
+   , mc_count(count)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         for (uint8_t chip=0; chip<mc_count; ++chip) {
+            Si5351 &device = *mpp_chips[chip];
+            device.init(SI5351_CRYSTAL_LOAD_8PF, 0);
+            device.output_enable(SI5351_CLK0, 0);
+            device.output_enable(SI5351_CLK1, 0);
+            device.output_enable(SI5351_CLK2, 0);
+            device.drive_strength(SI5351_CLK0, SI5351_DRIVE_2MA);
+            device.drive_strength(SI5351_CLK1, SI5351_DRIVE_2MA);
+            device.drive_strength(SI5351_CLK2, SI5351_DRIVE_2MA);
+            device.set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
+         }
+      }
+   }
+};
+
+class BenchStartupGroup : public BenchCase {
+protected:
+   Si5351Group *mp_group;
+
+public:
+   BenchStartupGroup(const char *n, Si5351Group *group)
+   : BenchCase(n, "Si5351Group.begin, all 8 clocks of each chip")
+   , mp_group(group)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         mp_group->begin(SI5351_CRYSTAL_LOAD_8PF, SI5351_DRIVE_2MA);
+      }
+   }
+};
+
+/**
+ * cold start from a register image: the output is on after restore(),
+ * begin() finishes the chip
+ */
+class BenchStartupRestore : public BenchCase {
+protected:
+   Si5351Group *mp_group;
+   uint8_t      mc_image[SI5351_IMAGE_LENGTH];
+
+public:
+   BenchStartupRestore(const char *n, Si5351Group *group)
+   : BenchCase(n, "Si5351Group.restore of one output, then begin")
+   , mp_group(group)
+   {}
+
+   virtual void prepare() {
+      mp_group->begin(SI5351_CRYSTAL_LOAD_8PF, SI5351_DRIVE_2MA);
+      mp_group->device(0).set_freq(7055000ULL * SI5351_FREQ_MULT, SI5351_PLL_FIXED, SI5351_CLK1);
+      mp_group->readImage(0, SI5351_CLK1, mc_image);
+   }
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         mp_group->restore(0, mc_image, true);
+         mp_group->begin(SI5351_CRYSTAL_LOAD_8PF, SI5351_DRIVE_2MA);
+      }
+   }
+};
+
+/**
+ * a band switch on each chip: CLK0 and CLK1 trade places
+ */
+class BenchOutputsPerCall : public BenchCase {
+protected:
+   Si5351 * const *mpp_chips;
+   uint8_t         mc_count;
+
+public:
+   BenchOutputsPerCall(const char *n, Si5351 * const *chips, uint8_t count)
+   : BenchCase(n, "one output off and one on per chip, output_enable each")
+   , mpp_chips(chips)
+   , mc_count(count)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         for (uint8_t chip=0; chip<mc_count; ++chip) {
+            mpp_chips[chip]->output_enable(SI5351_CLK0, ii & 1);
+            mpp_chips[chip]->output_enable(SI5351_CLK1, !(ii & 1));
+         }
+      }
+   }
+};
+
+class BenchOutputsGroup : public BenchCase {
+protected:
+   Si5351Group *mp_group;
+
+public:
+   BenchOutputsGroup(const char *n, Si5351Group *group)
+   : BenchCase(n, "one output off and one on per chip, staged and flushed")
+   , mp_group(group)
+   {}
+
+   virtual void run(unsigned long iterations) {
+      for (unsigned long ii=0; ii<iterations; ++ii) {
+         for (uint8_t chip=0; chip<mp_group->count(); ++chip) {
+            mp_group->outputEnable(chip, SI5351_CLK0, ii & 1);
+            mp_group->outputEnable(chip, SI5351_CLK1, !(ii & 1));
+         }
+         mp_group->flush();
+      }
+   }
+};
+
+/**
+ * results of one benchmark
+ */
+struct BenchResult {
+   const BenchCase    *bench;
+   unsigned long       iterations;    // per sample
+   std::vector<double> ns;            // per operation, one per sample, sorted
+   double              mean;
+   double              stddev;
+   double              mad;
+   double              ciLow;
+   double              ciHigh;
+   unsigned long       outliers;
+   double              busMicros;     // per operation
+   double              busBytes;      // per operation
+};
+
+static unsigned long totalBusBytes() {
+   unsigned long bytes = 0;
+   for (int ii=0; ii<HOST_WIRE_ADDRESSES; ++ii) {
+      bytes += Wire.bytes(ii);
+   }
+   return bytes;
+}
+
+/**
+ * times one sample
+ * @return ns for all iterations
+ */
+static double timeSample(BenchCase &bench, unsigned long iterations) {
+   bench.prepare();
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   bench.run(iterations);
+   std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+   return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * gets the value at a fraction of the way through sorted data
+ */
+static double percentile(const std::vector<double> &sorted, double p) {
+   double  pos = p * (sorted.size() - 1);
+   size_t  lo  = (size_t)floor(pos);
+   size_t  hi  = std::min(lo + 1, sorted.size() - 1);
+   return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+static double median(const std::vector<double> &sorted) {
+   return percentile(sorted, 0.5);
+}
+
+static BenchResult runBench(BenchCase &bench, int samples, double sampleNs, int warmup) {
+   BenchResult result;
+   result.bench = &bench;
+
+   // calibrate - grow the count until one sample reaches the target
+   unsigned long iterations = 1;
+   double        elapsed    = timeSample(bench, iterations);
+   while (elapsed < sampleNs) {
+      double scale = (elapsed > 0) ? (sampleNs / elapsed) * 1.2 : 10.0;
+      iterations   = (unsigned long)(iterations * std::min(std::max(scale, 2.0), 100.0));
+      elapsed      = timeSample(bench, iterations);
+   }
+   result.iterations = iterations;
+
+   for (int ii=0; ii<warmup; ++ii) {
+      timeSample(bench, iterations);
+   }
+
+   uint64_t      busStart   = host::now();
+   unsigned long bytesStart = totalBusBytes();
+
+   for (int ii=0; ii<samples; ++ii) {
+      result.ns.push_back(timeSample(bench, iterations) / iterations);
+   }
+
+   double operations = (double)iterations * samples;
+   result.busMicros  = (host::now() - busStart) / operations;
+   result.busBytes   = (totalBusBytes() - bytesStart) / operations;
+
+   // distribution over the samples
+   std::vector<double> &ns = result.ns;
+   std::sort(ns.begin(), ns.end());
+
+   double sum = 0;
+   for (size_t ii=0; ii<ns.size(); ++ii) {
+      sum += ns[ii];
+   }
+   result.mean = sum / ns.size();
+
+   double squares = 0;
+   for (size_t ii=0; ii<ns.size(); ++ii) {
+      squares += (ns[ii] - result.mean) * (ns[ii] - result.mean);
+   }
+   result.stddev = (ns.size() > 1) ? sqrt(squares / (ns.size() - 1)) : 0;
+
+   double mid = median(ns);
+   std::vector<double> deviation;
+   for (size_t ii=0; ii<ns.size(); ++ii) {
+      deviation.push_back(fabs(ns[ii] - mid));
+   }
+   std::sort(deviation.begin(), deviation.end());
+   result.mad = median(deviation);
+
+   result.outliers = 0;
+   for (size_t ii=0; ii<ns.size(); ++ii) {
+      if (deviation[ii] > BENCH_OUTLIER_MADS * BENCH_MAD_SCALE * result.mad) {
+         ++result.outliers;
+      }
+   }
+
+   // median confidence interval - ranks n/2 -+ 1.96 sqrt(n)/2, by the
+   // binomial distribution of samples falling below the true median
+   double n    = ns.size();
+   double half = 1.96 * sqrt(n) / 2;
+   long   lo   = (long)floor(n / 2 - half);
+   long   hi   = (long)ceil(n / 2 + half);
+   result.ciLow  = ns[std::max(lo, 0L)];
+   result.ciHigh = ns[std::min(hi, (long)n - 1)];
+
+   return result;
+}
+
+static void printJsonString(FILE *out, const char *text) {
+   fputc('"', out);
+   for (const char *p = text; *p; ++p) {
+      if ((*p == '"') || (*p == '\\')) {
+         fputc('\\', out);
+         fputc(*p, out);
+      }
+      else if ((unsigned char)*p < 0x20) {
+         fprintf(out, "\\u%04x", *p);
+      }
+      else {
+         fputc(*p, out);
+      }
+   }
+   fputc('"', out);
+}
+
+static void printJson(FILE *out, const std::vector<BenchResult> &results,
+                      const char *label, int samples, int sampleMs, int warmup) {
+   char      when[32];
+   time_t    now = time(0);
+   strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+   fprintf(out, "{\n");
+   fprintf(out, "  \"suite\": \"vfo_bench\",\n");
+   fprintf(out, "  \"label\": ");
+   printJsonString(out, label);
+   fprintf(out, ",\n");
+   fprintf(out, "  \"time\": \"%s\",\n", when);
+   fprintf(out, "  \"compiler\": ");
+   printJsonString(out, __VERSION__);
+   fprintf(out, ",\n");
+   fprintf(out, "  \"build_type\": ");
+   printJsonString(out, HOST_BUILD_TYPE);
+   fprintf(out, ",\n");
+   fprintf(out, "  \"samples\": %d,\n", samples);
+   fprintf(out, "  \"sample_ms\": %d,\n", sampleMs);
+   fprintf(out, "  \"warmup\": %d,\n", warmup);
+   fprintf(out, "  \"unit\": \"ns/op\",\n");
+   fprintf(out, "  \"benchmarks\": [");
+
+   for (size_t ii=0; ii<results.size(); ++ii) {
+      const BenchResult &r = results[ii];
+      fprintf(out, "%s\n    {\n", ii ? "," : "");
+      fprintf(out, "      \"name\": ");
+      printJsonString(out, r.bench->name);
+      fprintf(out, ",\n      \"description\": ");
+      printJsonString(out, r.bench->description);
+      fprintf(out, ",\n");
+      fprintf(out, "      \"iterations\": %lu,\n", r.iterations);
+      fprintf(out, "      \"median\": %.3f,\n", median(r.ns));
+      fprintf(out, "      \"median_ci95\": [%.3f, %.3f],\n", r.ciLow, r.ciHigh);
+      fprintf(out, "      \"min\": %.3f,\n", r.ns.front());
+      fprintf(out, "      \"p10\": %.3f,\n", percentile(r.ns, 0.1));
+      fprintf(out, "      \"p90\": %.3f,\n", percentile(r.ns, 0.9));
+      fprintf(out, "      \"max\": %.3f,\n", r.ns.back());
+      fprintf(out, "      \"mean\": %.3f,\n", r.mean);
+      fprintf(out, "      \"stddev\": %.3f,\n", r.stddev);
+      fprintf(out, "      \"mad\": %.3f,\n", r.mad);
+      fprintf(out, "      \"outliers\": %lu,\n", r.outliers);
+      fprintf(out, "      \"bus_us_per_op\": %.3f,\n", r.busMicros);
+      fprintf(out, "      \"bus_bytes_per_op\": %.3f,\n", r.busBytes);
+      fprintf(out, "      \"samples_ns\": [");
+      for (size_t jj=0; jj<r.ns.size(); ++jj) {
+         fprintf(out, "%s%.3f", jj ? ", " : "", r.ns[jj]);
+      }
+      fprintf(out, "]\n    }");
+   }
+   fprintf(out, "\n  ]\n}\n");
+}
+
+static void usage() {
+   fprintf(stderr, "usage: vfo_bench [-n samples] [-t sample ms] [-w warmup samples]\n"
+                   "                 [-f name filter] [-l label] [-o json file]\n");
+   exit(2);
+}
+
+int main(int argc, char **argv) {
+   int         samples  = BENCH_DEFAULT_SAMPLES;
+   int         sampleMs = BENCH_DEFAULT_SAMPLE_MS;
+   int         warmup   = BENCH_DEFAULT_WARMUP;
+   const char *filter   = 0;
+   const char *label    = "";
+   const char *outName  = 0;
+   int         opt;
+
+   while ((opt = getopt(argc, argv, "n:t:w:f:l:o:")) != -1) {
+      switch (opt) {
+         case 'n': samples  = atoi(optarg);  break;
+         case 't': sampleMs = atoi(optarg);  break;
+         case 'w': warmup   = atoi(optarg);  break;
+         case 'f': filter   = optarg;        break;
+         case 'l': label    = optarg;        break;
+         case 'o': outName  = optarg;        break;
+         default:  usage();
+      }
+   }
+   if ((optind != argc) || (samples < 2) || (sampleMs < 1) || (warmup < 0)) {
+      usage();
+   }
+
+   setup();
+
+   // benchmark the driver, not the emulator's checks
+   BenchRegisterFile registers;
+   BenchRegisterFile registersB;
+   Wire.attachDevice(SI5351_BUS_BASE_ADDR, &registers);
+   Wire.attachDevice(SI5351_BUS_BASE_ADDR + 1, &registersB);
+
+   // a second chip, for the multi-chip cases
+   Si5351         chipB(SI5351_BUS_BASE_ADDR + 1);
+   Si5351 * const chips[] = { &si5351, &chipB };
+   Si5351Group    oneChip(chips, 1);
+   Si5351Group    twoChips(chips, 2);
+
+   BenchVFODefinition vfo(si5351Devices, &benchBand);
+   SSD1306_U8glib_VFODisplay ssd1306(&vfoBank, HOST_DISPLAY_BAND_LINES, SHOW_HEADING);
+   LCD2004_LCDLib_VFODisplay lcd2004(&vfoBank, HOST_DISPLAY_BAND_LINES, SHOW_HEADING);
+   ssd1306.begin();
+   lcd2004.begin();
+
+   BenchUpdateIdle    updateIdle;
+   BenchUpdateStep    updateStep;
+   BenchIncrease      increase(&vfo);
+   BenchDecrease      decrease(&vfo);
+   BenchLoadFrequency loadFrequency(&vfo);
+   BenchFormat        format;
+   BenchShowVFOs      showSSD1306("SSD1306_U8glib_VFODisplay.showVFOs",
+                                  "full repaint of the vfo screen, 128x64 in pages", &ssd1306);
+   BenchShowVFOs      showLCD2004("LCD2004_LCDLib_VFODisplay.showVFOs",
+                                  "clear and rewrite of the vfo screen, 20x4", &lcd2004);
+   BenchBandSwitch    switchOwnClocks("VFOBank.select.3bands.3clocks",
+                                      "next band, each band still loaded on its own clock",
+                                      benchOwnClockBands, 3);
+   BenchBandSwitch    switch3Bands("VFOBank.select.3bands.1clock",
+                                   "next band, reloading the shared clock", benchHFBands, 3);
+   BenchBandSwitch    switch10Bands("VFOBank.select.10bands.1clock",
+                                    "next band, reloading the shared clock", benchHFBands, BENCH_HF_BANDS);
+   BenchStartupPerCall startupPerCall1("setupSI5351.percall.1chip", chips, 1);
+   BenchStartupPerCall startupPerCall2("setupSI5351.percall.2chips", chips, 2);
+   BenchStartupGroup   startupGroup1("Si5351Group.begin.1chip", &oneChip);
+   BenchStartupGroup   startupGroup2("Si5351Group.begin.2chips", &twoChips);
+   BenchStartupRestore startupRestore1("Si5351Group.restore.1chip", &oneChip);
+   BenchOutputsPerCall outputsPerCall1("output_enable.percall.1chip", chips, 1);
+   BenchOutputsPerCall outputsPerCall2("output_enable.percall.2chips", chips, 2);
+   BenchOutputsGroup   outputsGroup1("Si5351Group.flush.1chip", &oneChip);
+   BenchOutputsGroup   outputsGroup2("Si5351Group.flush.2chips", &twoChips);
+
+   BenchCase *benches[] = { &updateIdle, &updateStep, &increase, &decrease,
+                            &loadFrequency, &format, &showSSD1306, &showLCD2004,
+                            &switchOwnClocks, &switch3Bands, &switch10Bands,
+                            &startupPerCall1, &startupPerCall2, &startupGroup1, &startupGroup2,
+                            &startupRestore1,
+                            &outputsPerCall1, &outputsPerCall2, &outputsGroup1, &outputsGroup2 };
+
+   std::vector<BenchResult> results;
+   fprintf(stderr, "%-38s %12s %12s %12s %5s %10s %8s\n",
+           "benchmark", "median ns", "ci95 low", "ci95 high", "out", "bus us", "bytes");
+   for (size_t ii=0; ii<sizeof(benches)/sizeof(benches[0]); ++ii) {
+      if (filter && !strstr(benches[ii]->name, filter)) {
+         continue;
+      }
+      results.push_back(runBench(*benches[ii], samples, sampleMs * 1e6, warmup));
+
+      const BenchResult &r = results.back();
+      fprintf(stderr, "%-38s %12.1f %12.1f %12.1f %5lu %10.1f %8.1f\n", r.bench->name,
+              median(r.ns), r.ciLow, r.ciHigh, r.outliers, r.busMicros, r.busBytes);
+   }
+
+   FILE *out = stdout;
+   if (outName && !(out = fopen(outName, "w"))) {
+      perror(outName);
+      return 1;
+   }
+   printJson(out, results, label, samples, sampleMs, warmup);
+   if (out != stdout) {
+      fclose(out);
+   }
+
+   return 0;
+}
@@ -0,0 +1,258 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the crystal calibration test program. It runs the
+ * sketch against a clock chip whose crystal is off by a set error, and
+ * checks the output accuracy across the bands before and after
+ * calibrating with the CM CAT command over the simulated serial port.
+ *
+ *    vfo_calibrate [-p ppb]
+ *
+ *    -p  crystal error of the modelled chip in parts per billion,
+ *        + when it runs fast; default 18700, 0.47 kHz on 25 MHz
+ *
+ * Each band is tuned with FA to its bottom, middle and top, and the
+ * frequency on the chip compared with the dial. Then band C is tuned
+ * to its middle, the chip frequency there "measured" to 0.01 Hz and
+ * sent back with CM, as a counter or a zero beat against a standard
+ * would give it, and the same checks are run again. The bus bytes of
+ * a tune are counted both times: the correction is in the PLL, so a
+ * tune costs the same with it. Last the correction read back with CL
+ * is compared with the one saved to EEPROM, and an out of range
+ * correction checked refused.
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+#include "Si5351Emulator.h"
+#include "EEPROMLog.h"
+
+#define CALIBRATE_DEFAULT_PPB        18700L
+#define CALIBRATE_BAND                   2
+#define CALIBRATE_CHIP_ADDRESS        0x60
+#define CALIBRATE_BYTE_US              261ULL     // 10 bits at 38400 baud
+#define CALIBRATE_SAVE_WAIT_US      200000ULL
+#define CALIBRATE_LIMIT_PPB             20.0      // allowed after calibrating
+
+/**
+ * limits of the bands in the sketch's table, kept in step with the .ino
+ */
+struct CalibrateBand {
+   unsigned long  low;
+   unsigned long  high;
+};
+
+static const CalibrateBand bands[] = {
+   {  3500000,  4000000 },
+   {  7000000,  7300000 },
+   { 10100000, 10150000 },
+};
+#define CALIBRATE_BANDS  (sizeof(bands) / sizeof(bands[0]))
+
+/**
+ * runs the sketch for a while
+ */
+static void runFor(uint64_t us) {
+   uint64_t until = host::now() + us;
+   while (host::now() < until) {
+      loop();
+   }
+}
+
+/**
+ * sends a command with no answer and gives the sketch time to take
+ * it, and longer if a slow pass left some of it unread
+ */
+static void command(const std::string &text) {
+   host::serialInput(text);
+   runFor(text.size() * CALIBRATE_BYTE_US + 5000);
+   while (Serial.available() > 0) {
+      loop();
+   }
+}
+
+/**
+ * runs the sketch until an answer to a CAT command is in
+ * @return the answer, empty if none came
+ */
+static std::string answer(const std::string &text) {
+   std::string reply;
+   host::serialOutput();
+   host::serialInput(text);
+   uint64_t start = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - start < 1000000ULL)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   return reply;
+}
+
+/**
+ * formats a frequency set
+ */
+static std::string setCommand(unsigned long f) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "FA%011lu;", f);
+   return buf;
+}
+
+/**
+ * gets the frequency on the selected band's clock
+ * @return Hz, 0 if the output is off
+ */
+static double chipFrequency() {
+   return hostSi5351Chip.outputFrequency(vfoBank.active()->getClock());
+}
+
+/**
+ * tunes a frequency in a band
+ * @return register bytes the tune sent
+ */
+static uint64_t tune(unsigned long f) {
+   uint64_t bytes = Wire.bytes(CALIBRATE_CHIP_ADDRESS);
+   command(setCommand(f));
+   return Wire.bytes(CALIBRATE_CHIP_ADDRESS) - bytes;
+}
+
+/**
+ * tunes each band to its bottom, middle and top and reports the
+ * worst output error of each
+ * @param  label  pass name
+ * @param  worst  set to the worst error over the bands, ppb
+ * @return register bytes of the middle tunes over their count
+ */
+static double checkBands(const char *label, double &worst) {
+   uint64_t bytes = 0;
+   worst = 0;
+
+   for (uint8_t band=0; band<CALIBRATE_BANDS; ++band) {
+      unsigned long points[3] = { bands[band].low
+                                , (bands[band].low + bands[band].high) / 2
+                                , bands[band].high };
+      double        hz  = 0;
+      double        ppb = 0;
+      for (int ii=0; ii<3; ++ii) {
+         uint64_t sent = tune(points[ii]);
+         if (ii == 1) {
+            bytes += sent;
+         }
+         double error = chipFrequency() - points[ii];
+         if (fabs(error) > fabs(hz)) {
+            hz  = error;
+            ppb = error * 1e9 / points[ii];
+         }
+      }
+      worst = std::max(worst, fabs(ppb));
+      printf("%-12s band %c  %8lu - %8lu Hz  worst error %+9.2f Hz  %+9.1f ppb\n",
+             label, 'A' + band, bands[band].low, bands[band].high, hz, ppb);
+   }
+   return (double)bytes / CALIBRATE_BANDS;
+}
+
+/**
+ * measures the chip on band C and sends the reading with CM
+ * @return the correction the sketch answers CL with, ppb
+ */
+static long calibrate() {
+   unsigned long f = (bands[CALIBRATE_BAND].low + bands[CALIBRATE_BAND].high) / 2;
+   tune(f);
+
+   unsigned long long measured = (unsigned long long)llround(chipFrequency() * 100.0);
+   char buf[32];
+   snprintf(buf, sizeof(buf), "CM%011llu%02llu;", measured / 100, measured % 100);
+   command(buf);
+
+   std::string reply = answer("CL;");
+   printf("%-12s band %c at %lu Hz measured %llu.%02llu Hz, %s answered %s\n",
+          "calibrate", 'A' + CALIBRATE_BAND, f, measured / 100, measured % 100, buf, reply.c_str());
+   return strtol(reply.c_str() + 2, 0, 10);
+}
+
+/**
+ * reads the correction saved to EEPROM
+ * @param  ppb  set to the correction
+ * @return false if there is no saved correction
+ */
+static bool savedCorrection(long &ppb) {
+   uint8_t   record[EEPROMLOG_RECORD_LENGTH(4)];
+   EEPROMLog log(EEPROM_CALIBRATION_LOG_ADDRESS, EEPROM_CALIBRATION_LOG_BYTES, record, sizeof(record));
+   if (!log.begin()) {
+      return false;
+   }
+   const uint8_t *p = log.payload();
+   ppb = (long)(int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+   return true;
+}
+
+int main(int argc, char **argv) {
+   long crystal = CALIBRATE_DEFAULT_PPB;
+   int  opt;
+
+   while ((opt = getopt(argc, argv, "p:")) != -1) {
+      switch (opt) {
+         case 'p':
+            crystal = strtol(optarg, 0, 10);
+            break;
+         default:
+            fprintf(stderr, "usage: vfo_calibrate [-p ppb]\n");
+            return 2;
+      }
+   }
+
+   hostSi5351Chip.setCrystal(SI5351_XTAL_FREQ * (1.0 + crystal * 1e-9));
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+   printf("crystal error %+ld ppb\n", crystal);
+
+   double before;
+   double after;
+   double bytesBefore = checkBands("uncalibrated", before);
+   long   correction  = calibrate();
+   double bytesAfter  = checkBands("calibrated", after);
+   printf("%-12s %.1f register bytes before calibrating, %.1f after\n",
+          "tune", bytesBefore, bytesAfter);
+
+   runFor(CALIBRATE_SAVE_WAIT_US);
+   long saved   = 0;
+   bool isSaved = savedCorrection(saved) && (saved == correction);
+   printf("%-12s correction %+ld ppb, EEPROM %s\n", "saved", correction, isSaved ? "matches" : "does NOT match");
+
+   std::string reply = answer("CL+300000;");
+   bool refused = (reply == "?;");
+   printf("%-12s CL+300000; answered %s %s\n", "range", reply.c_str(), refused ? "refused" : "NOT refused");
+
+   bool ok = (after <= CALIBRATE_LIMIT_PPB) && (bytesAfter == bytesBefore) && isSaved && refused;
+   printf("%s\n", ok ? "ok" : "FAILED");
+   return ok ? 0 : 1;
+}
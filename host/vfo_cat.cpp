@@ -0,0 +1,580 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the CAT control test program. It runs the sketch built
+ * with USE_CAT_CONTROL, with its serial port either on a pseudo
+ * terminal or driven by a built in client.
+ *
+ *    vfo_cat                run on a pty, paced to the wall clock
+ *    vfo_cat -b 200         run the CAT benchmark, 200 commands a case
+ *
+ * On a pty the slave path is printed, and any CAT program can be
+ * pointed at it as a TS-480, for instance
+ *
+ *    rigctl -m 2028 -r /dev/pts/5 -s 38400 f
+ *
+ * The benchmark runs in virtual time, with bytes going both ways at
+ * the sketch baud rate, so like vfo_sim it is deterministic and two
+ * builds can be compared. For each kind of exchange it reports the
+ * time from the client starting to send to the last byte of the
+ * answer, and checks the answers. Sets are also streamed without
+ * waiting for answers, as some programs do while the operator drags
+ * a waterfall, counting bytes lost to receive buffer overruns.
+ *
+ * The same is done for binary frequency frames (FrameParser.h), with
+ * single frames also timed to the new frequency on the chip, and a
+ * stream of frames checked for display paints while it runs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+#include "FrameParser.h"
+
+#define CAT_POLL_US                  1000
+#define CAT_ANSWER_TIMEOUT_US     1000000
+#define CAT_PTY_WAIT_MS               100
+
+/**
+ * This class connects the sketch serial port to the master side of a
+ * pty, checked every CAT_POLL_US like a USB serial adapter.
+ *
+ * Run for a CAT program, virtual time is held to the wall clock so
+ * its timeouts work. Run for the benchmark, virtual time runs free,
+ * and the link waits for bytes the client has written to come through
+ * the pty, so the run does not depend on the kernel's timing.
+ */
+class PtyLink : public HostScheduler {
+protected:
+   int      mi_fd;
+   bool     mb_paced;
+   uint64_t ml_next;
+   uint64_t ml_wallStart;
+
+   static uint64_t wallMicros() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+   }
+
+public:
+   /**
+    * bytes passed each way, and the time the last answer byte was sent
+    */
+   uint64_t bytesIn;
+   uint64_t bytesOut;
+   uint64_t bytesExpected;
+   uint64_t lastSent;
+
+   PtyLink(int fd, bool paced)
+   : mi_fd(fd)
+   , mb_paced(paced)
+   , ml_next(host::now())
+   , ml_wallStart(wallMicros() - host::now())
+   , bytesIn(0)
+   , bytesOut(0)
+   , bytesExpected(0)
+   , lastSent(0)
+   {}
+
+   virtual uint64_t nextEventTime() {
+      return ml_next;
+   }
+
+   virtual void runEvents(uint64_t now) {
+      if (now < ml_next) {
+         return;
+      }
+      ml_next = now + CAT_POLL_US;
+
+      if (mb_paced) {
+         uint64_t wall = wallMicros();
+         if (wall < ml_wallStart + now) {
+            usleep(ml_wallStart + now - wall);
+         }
+      }
+      else if (bytesIn < bytesExpected) {
+         struct pollfd pfd = { mi_fd, POLLIN, 0 };
+         poll(&pfd, 1, CAT_PTY_WAIT_MS);
+      }
+
+      char    buf[256];
+      ssize_t n;
+      while ((n = read(mi_fd, buf, sizeof(buf))) > 0) {
+         host::serialInput(std::string(buf, n));
+         bytesIn += n;
+      }
+
+      std::string out = host::serialOutput(&lastSent);
+      if (!out.empty() && (write(mi_fd, out.data(), out.size()) > 0)) {
+         // with no program on the slave side the answer is lost, as on a cable
+         bytesOut += out.size();
+      }
+   }
+};
+
+/**
+ * opens a pty for the sketch, raw and non-blocking
+ * @return master side, or -1
+ */
+static int openPty() {
+   int fd = posix_openpt(O_RDWR | O_NOCTTY);
+   if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0)) {
+      fprintf(stderr, "vfo_cat: pty: %s\n", strerror(errno));
+      return -1;
+   }
+
+   struct termios tio;
+   tcgetattr(fd, &tio);
+   cfmakeraw(&tio);
+   tcsetattr(fd, TCSANOW, &tio);
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+   return fd;
+}
+
+/**
+ * This class collects latency samples and reports their distribution
+ */
+class LatencyStats {
+public:
+   std::vector<uint64_t> samples;
+
+   void add(uint64_t us) {
+      samples.push_back(us);
+   }
+
+   uint64_t percentile(int p) {
+      if (samples.empty()) {
+         return 0;
+      }
+      std::sort(samples.begin(), samples.end());
+      size_t rank = (samples.size() * p + 99) / 100;
+      return samples[(rank > 0) ? rank - 1 : 0];
+   }
+
+   void report(const char *name, unsigned long bad) {
+      printf("%-24s %6lu  p50 %6.2f  p99 %6.2f  max %6.2f ms, %lu bad\n", name,
+             (unsigned long)samples.size(),
+             percentile(50) / 1000.0, percentile(99) / 1000.0, percentile(100) / 1000.0, bad);
+   }
+};
+
+/**
+ * the benchmark client: the slave side of the pty, and the link
+ */
+static int      clientFd;
+static PtyLink *clientLink;
+static uint64_t clientBytesIn;
+
+/**
+ * checks for a complete answer
+ */
+typedef bool (*AnswerCheck)(const std::string &reply);
+
+static bool textAnswer(const std::string &reply) {
+   return reply.find(';') != std::string::npos;
+}
+
+static bool frameAnswer(const std::string &reply) {
+   return reply.size() >= FRAME_ANSWER_LENGTH;
+}
+
+/**
+ * sends commands or frames through the pty and runs the sketch until
+ * the answer is in
+ * @param  command   commands or frames
+ * @param  complete  checks for the whole answer
+ * @param  reply     set to the answer
+ * @param  latency   set to the time from sending to the last answer byte
+ * @return false if the answer did not come
+ */
+static bool exchange(const std::string &command, AnswerCheck complete, std::string &reply, uint64_t &latency) {
+   uint64_t start   = host::now();
+   size_t   written = 0;
+
+   reply.clear();
+   while (!complete(reply)) {
+      if (host::now() - start > CAT_ANSWER_TIMEOUT_US) {
+         return false;
+      }
+
+      // as much of the command as the pty will take
+      if (written < command.size()) {
+         ssize_t n = write(clientFd, command.data() + written, command.size() - written);
+         if (n > 0) {
+            written += n;
+            clientLink->bytesExpected += n;
+         }
+      }
+
+      loop();
+
+      // answers the link has passed on
+      if (clientBytesIn < clientLink->bytesOut) {
+         struct pollfd pfd = { clientFd, POLLIN, 0 };
+         poll(&pfd, 1, CAT_PTY_WAIT_MS);
+      }
+      char    buf[256];
+      ssize_t n;
+      while ((n = read(clientFd, buf, sizeof(buf))) > 0) {
+         reply.append(buf, n);
+         clientBytesIn += n;
+      }
+   }
+   latency = clientLink->lastSent - start;
+   return true;
+}
+
+/**
+ * formats a frequency set command
+ */
+static std::string setCommand(unsigned long f) {
+   char buf[20];
+   snprintf(buf, sizeof(buf), "FA%011lu;", f);
+   return buf;
+}
+
+/**
+ * runs one kind of exchange a number of times and reports it
+ * @param  name      case name
+ * @param  passes    number of exchanges
+ * @param  command   gets the command for a pass
+ * @param  expected  gets the answer wanted for a pass
+ * @param  complete  checks for the whole answer
+ */
+static void runCase(const char *name, int passes
+                  , std::string (*command)(int)
+                  , std::string (*expected)(int)
+                  , AnswerCheck complete) {
+   LatencyStats  latency;
+   unsigned long bad = 0;
+   std::string   reply;
+   uint64_t      us;
+
+   for (int ii=0; ii<passes; ++ii) {
+      if (!exchange(command(ii), complete, reply, us)) {
+         ++bad;
+         continue;
+      }
+      latency.add(us);
+      if (reply != expected(ii)) {
+         ++bad;
+      }
+   }
+   latency.report(name, bad);
+}
+
+/**
+ * frequencies used by the cases: two in the selected band, and one in
+ * the band after it
+ */
+static unsigned long baseFrequency;
+static unsigned long otherFrequency;
+
+static unsigned long tuneFrequency(int pass) {
+   return baseFrequency + ((pass & 1) ? 10 : 20);
+}
+
+static unsigned long switchFrequency(int pass) {
+   return (pass & 1) ? otherFrequency : baseFrequency;
+}
+
+static std::string idCommand(int)           { return "ID;"; }
+static std::string idAnswer(int)            { return "ID020;"; }
+static std::string queryCommand(int)        { return "FA;"; }
+static std::string queryAnswer(int)         { return setCommand(vfoBank.active()->getFrequency()); }
+static std::string tuneCommand(int pass)    { return setCommand(tuneFrequency(pass)) + "FA;"; }
+static std::string tuneAnswer(int pass)     { return setCommand(tuneFrequency(pass)); }
+static std::string switchCommand(int pass)  { return setCommand(switchFrequency(pass)) + "FA;"; }
+static std::string switchAnswer(int pass)   { return setCommand(switchFrequency(pass)); }
+static std::string ifCommand(int)           { return "IF;"; }
+
+static std::string ifAnswer(int) {
+   char buf[40];
+   snprintf(buf, sizeof(buf), "IF%011lu     +00000000003000000 ;", vfoBank.active()->getFrequency());
+   return buf;
+}
+
+/**
+ * builds a frequency frame
+ * @param  band      band to tune
+ * @param  f         frequency in Hz
+ * @param  sequence  sequence number
+ * @param  answer    true to ask for an answer
+ */
+static std::string frame(uint8_t band, unsigned long f, uint8_t sequence, bool answer) {
+   uint8_t buf[FRAME_LENGTH];
+   buf[0] = FRAME_SYNC;
+   buf[1] = band | (answer ? FRAME_FLAG_ANSWER : 0);
+   for (int ii=0; ii<4; ++ii) {
+      buf[2 + ii] = (uint8_t)(f >> (8 * ii));
+   }
+   buf[6] = sequence;
+   uint16_t sum = FrameParser::crc(buf + 1, FRAME_LENGTH - 3);
+   buf[7] = (uint8_t)sum;
+   buf[8] = (uint8_t)(sum >> 8);
+   return std::string((const char *)buf, FRAME_LENGTH);
+}
+
+/**
+ * builds the answer expected to a frame
+ */
+static std::string frameAnswerFor(uint8_t status, uint8_t sequence) {
+   uint8_t buf[FRAME_ANSWER_LENGTH];
+   buf[0] = FRAME_SYNC;
+   buf[1] = status;
+   buf[2] = sequence;
+   uint16_t sum = FrameParser::crc(buf + 1, 2);
+   buf[3] = (uint8_t)sum;
+   buf[4] = (uint8_t)(sum >> 8);
+   return std::string((const char *)buf, FRAME_ANSWER_LENGTH);
+}
+
+static std::string tuneFrame(int pass)      { return frame(vfoBank.selected(), tuneFrequency(pass), pass, true); }
+static std::string tuneFrameAnswer(int pass) { return frameAnswerFor(FRAME_STATUS_OK, pass); }
+static std::string badFrame(int pass)       { return frame(vfoBank.count(), baseFrequency, pass, false); }
+static std::string badFrameAnswer(int pass) { return frameAnswerFor(FRAME_STATUS_REJECTED, pass); }
+
+/**
+ * finds when a clock was first set to a frequency, to within 1 Hz,
+ * after a time
+ * @return time in us, or 0 if it was not
+ */
+static uint64_t chipTime(const std::vector<HostTraceRecord> &log, unsigned long f, uint64_t after) {
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      if (  (log[ii].kind == HOST_TRACE_SI5351_FREQUENCY)
+         && (log[ii].time >= after)
+         && (llabs((long long)log[ii].value - (long long)f * 100) < 100)) {
+         return log[ii].time;
+      }
+   }
+   return 0;
+}
+
+/**
+ * counts display frames finished in a span of time
+ */
+static unsigned long framesPainted(const std::vector<HostTraceRecord> &log, uint64_t from, uint64_t to) {
+   unsigned long count = 0;
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      if ((log[ii].kind == HOST_TRACE_DISPLAY_FRAME) && (log[ii].time >= from) && (log[ii].time <= to)) {
+         ++count;
+      }
+   }
+   return count;
+}
+
+/**
+ * runs the frame cases: single frames with answers, timed to the
+ * answer and to the new frequency on the chip, then a stream of
+ * frames with only the last answered
+ * @param  passes  frames per case
+ */
+static void frameCases(int passes) {
+   std::vector<HostTraceRecord> log;
+   host::setTraceLog(&log);
+
+   LatencyStats  toAnswer;
+   LatencyStats  toChip;
+   unsigned long bad = 0;
+   std::string   reply;
+   uint64_t      us;
+
+   for (int ii=0; ii<passes; ++ii) {
+      uint64_t start = host::now();
+      log.clear();
+      if (!exchange(tuneFrame(ii), frameAnswer, reply, us) || (reply != tuneFrameAnswer(ii))) {
+         ++bad;
+         continue;
+      }
+      toAnswer.add(us);
+      uint64_t chip = chipTime(log, tuneFrequency(ii), start);
+      if (chip != 0) {
+         toChip.add(chip - start);
+      }
+      else {
+         ++bad;
+      }
+   }
+   toAnswer.report("frame to answer", bad);
+   toChip.report("frame to chip", bad);
+
+   runCase("rejected frame", passes, badFrame, badFrameAnswer, frameAnswer);
+
+   // let the held back repaint go out before the stream
+   uint64_t settle = host::now() + 200000;
+   while (host::now() < settle) {
+      loop();
+   }
+
+   std::string stream;
+   for (int ii=0; ii<passes; ++ii) {
+      stream += frame(vfoBank.selected(), tuneFrequency(ii), ii, ii == passes - 1);
+   }
+
+   host::resetStats();
+   log.clear();
+   uint64_t start    = host::now();
+   bool     answered = exchange(stream, frameAnswer, reply, us);
+   uint64_t end      = host::now();
+   bool     ok       = answered
+                    && (reply == tuneFrameAnswer(passes - 1))
+                    && (vfoBank.active()->getFrequency() == tuneFrequency(passes - 1));
+
+   // and the repaint once the stream has stopped
+   uint64_t repaint = 0;
+   while ((repaint == 0) && (host::now() - end < CAT_ANSWER_TIMEOUT_US)) {
+      loop();
+      for (size_t ii=0; ii<log.size(); ++ii) {
+         if ((log[ii].kind == HOST_TRACE_DISPLAY_FRAME) && (log[ii].time > end)) {
+            repaint = log[ii].time - end;
+            break;
+         }
+      }
+   }
+
+   printf("streamed frames          %6d  %.1f ms, %.0f frames/s, final %s, %lu bytes dropped\n",
+          passes, us / 1000.0, answered ? passes * 1e6 / us : 0.0, ok ? "ok" : "WRONG",
+          (unsigned long)host::stats().serialRxDropped);
+   printf("display during stream    %6lu  frames, repainted %.1f ms after\n",
+          framesPainted(log, start, end), repaint / 1000.0);
+   host::setTraceLog(0);
+}
+
+/**
+ * runs the benchmark
+ * @param  passes  exchanges per case
+ * @return exit status
+ */
+static int benchmark(int passes) {
+   int fd = openPty();
+   if (fd < 0) {
+      return 1;
+   }
+   clientFd = open(ptsname(fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+   if (clientFd < 0) {
+      fprintf(stderr, "vfo_cat: %s: %s\n", ptsname(fd), strerror(errno));
+      return 1;
+   }
+
+   PtyLink link(fd, false);
+   clientLink = &link;
+   host::setScheduler(&link);
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   baseFrequency  = vfoBank.active()->getFrequency();
+   otherFrequency = vfoBank.frequency((vfoBank.selected() + 1) % vfoBank.count());
+
+   runCase("ID round trip",     passes, idCommand,     idAnswer,    textAnswer);
+   runCase("FA query",          passes, queryCommand,  queryAnswer, textAnswer);
+   runCase("IF query",          passes, ifCommand,     ifAnswer,    textAnswer);
+   runCase("FA set + readback", passes, tuneCommand,   tuneAnswer,  textAnswer);
+   runCase("band switch",       passes, switchCommand, switchAnswer, textAnswer);
+
+   // sets sent back to back, then one query to see where it ended up
+   std::string stream;
+   for (int ii=0; ii<passes; ++ii) {
+      stream += setCommand(tuneFrequency(ii));
+   }
+   stream += "FA;";
+
+   host::resetStats();
+   std::string reply;
+   uint64_t    us;
+   bool        answered = exchange(stream, textAnswer, reply, us);
+   std::string wanted   = setCommand(tuneFrequency(passes - 1));
+
+   if (answered) {
+      printf("streamed sets            %6d  %.1f ms, %.0f sets/s, final %s, %lu bytes dropped\n",
+             passes, us / 1000.0, passes * 1e6 / us,
+             (reply == wanted) ? "ok" : "WRONG",
+             (unsigned long)host::stats().serialRxDropped);
+   }
+   else {
+      printf("streamed sets            %6d  no answer, %lu bytes dropped\n",
+             passes, (unsigned long)host::stats().serialRxDropped);
+   }
+
+   frameCases(passes);
+   return 0;
+}
+
+/**
+ * runs the sketch on a pty until killed
+ * @return exit status
+ */
+static int bridge() {
+   int fd = openPty();
+   if (fd < 0) {
+      return 1;
+   }
+   printf("%s\n", ptsname(fd));
+   fflush(stdout);
+
+   PtyLink link(fd, true);
+   host::setScheduler(&link);
+   for (;;) {
+      loop();
+   }
+}
+
+static void usage() {
+   fprintf(stderr, "usage: vfo_cat [-b commands per case]\n");
+   exit(2);
+}
+
+int main(int argc, char **argv) {
+   int passes = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "b:")) != -1) {
+      switch (opt) {
+         case 'b': passes = atoi(optarg);     break;
+         default:  usage();
+      }
+   }
+   if ((optind != argc) || (passes < 0)) {
+      usage();
+   }
+
+   setup();
+
+   if (passes == 0) {
+      return bridge();
+   }
+   return benchmark(passes);
+}
@@ -0,0 +1,330 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the RIT/XIT test program. It drives the offset with
+ * CAT commands over the simulated serial port and checks the clock
+ * chip and the display follow.
+ *
+ *    vfo_rit
+ *
+ * On each band, tuned there with FA, RIT is turned on and the offset
+ * stepped across -9999 to +9999 Hz with RD and RU. Each step the
+ * frequency on the chip is checked against the dial frequency plus
+ * the offset, and the register bytes and bus time of the change are
+ * counted; the same steps are then made as FA sets of the dial, which
+ * load the whole multisynth block, for comparison. The bus time is worked out the
+ * way the Wire model charges it, 9 bits a byte at 100 kHz.
+ *
+ * After the sweeps it checks XIT and the TX and RX commands move the
+ * offset on and off the output, a band switch with the offset on
+ * loads it into the new band, the IF answer carries the offset and
+ * flags, and the display heading shows the offset.
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <U8glib.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+#include "Si5351Emulator.h"
+
+#define RIT_STEP_HZ                   37
+#define RIT_MAX_HZ                  9999
+#define RIT_CHIP_ADDRESS            0x60
+#define RIT_BUS_CLOCK             100000UL
+#define RIT_BYTE_US                  261ULL     // 10 bits at 38400 baud
+#define RIT_REPAINT_WAIT_US       400000ULL
+
+/**
+ * runs the sketch for a while
+ */
+static void runFor(uint64_t us) {
+   uint64_t until = host::now() + us;
+   while (host::now() < until) {
+      loop();
+   }
+}
+
+/**
+ * sends a command with no answer and gives the sketch time to take
+ * it, and longer if a slow pass left some of it unread
+ */
+static void command(const std::string &text) {
+   host::serialInput(text);
+   runFor(text.size() * RIT_BYTE_US + 5000);
+   while (Serial.available() > 0) {
+      loop();
+   }
+}
+
+/**
+ * runs the sketch until an answer to a CAT command is in
+ * @return the answer, empty if none came
+ */
+static std::string answer(const std::string &text) {
+   std::string reply;
+   host::serialOutput();
+   host::serialInput(text);
+   uint64_t start = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - start < 1000000ULL)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   return reply;
+}
+
+/**
+ * formats a frequency set
+ */
+static std::string setCommand(unsigned long f) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "FA%011lu;", f);
+   return buf;
+}
+
+/**
+ * formats an RU or RD command
+ */
+static std::string offsetCommand(long hz) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "%s%05ld;", (hz < 0) ? "RD" : "RU", labs(hz));
+   return buf;
+}
+
+/**
+ * gets the frequency on the selected band's clock
+ * @return Hz, 0 if the output is off
+ */
+static double chipFrequency() {
+   return hostSi5351Chip.outputFrequency(vfoBank.active()->getClock());
+}
+
+/**
+ * gets the frequency the selected band's clock would give for a
+ * frequency with the divider worked out from scratch, as a dial set
+ * does, and the size of one count of the divider fraction there
+ * @param  f      frequency in Hz
+ * @param  count  set to Hz per count
+ * @return Hz
+ */
+static double idealFrequency(double f, double &count) {
+   unsigned long long pll = vfoBank.active()->getPllFrequency();
+   if (pll == 0) {
+      pll = SI5351_PLL_FIXED;
+   }
+   unsigned long a, b;
+   uint8_t       r;
+   Si5351Group::divider(pll, (unsigned long long)llround(f * SI5351_FREQ_MULT), a, b, r);
+
+   double vco  = pll / (double)SI5351_FREQ_MULT / (1 << r);
+   double at   = vco / (a + b / (double)SI5351_FRAC_DENOM);
+   double next = vco / (a + (b + 1) / (double)SI5351_FRAC_DENOM);
+   count = at - next;
+   return at;
+}
+
+/**
+ * bus cost of a run of changes
+ */
+struct BusCost {
+   unsigned long changes;
+   unsigned long registers;     // register bytes written
+   unsigned long bytes;         // bytes on the bus, addresses included
+   unsigned long transfers;
+
+   double registersPer() const { return changes ? (double)registers / changes : 0; }
+   double microsPer() const    { return changes ? (bytes * 9.0 + transfers * 2.0) * 1e6 / RIT_BUS_CLOCK / changes : 0; }
+};
+
+/**
+ * sends a command and adds its chip writes to a cost
+ */
+static void costed(const std::string &text, BusCost &cost) {
+   unsigned long registers = hostSi5351Chip.bytesWritten;
+   unsigned long bytes     = Wire.bytes(RIT_CHIP_ADDRESS);
+   unsigned long transfers = Wire.transfers(RIT_CHIP_ADDRESS);
+   command(text);
+   ++cost.changes;
+   cost.registers += hostSi5351Chip.bytesWritten - registers;
+   cost.bytes     += Wire.bytes(RIT_CHIP_ADDRESS) - bytes;
+   cost.transfers += Wire.transfers(RIT_CHIP_ADDRESS) - transfers;
+}
+
+/**
+ * sweeps the offset across its range on one band and reports it
+ * @param  band  band to tune
+ * @return false if any step was wrong
+ */
+static bool sweepBand(uint8_t band) {
+   unsigned long dial = vfoBank.frequency(band);
+
+   // first offset after a load sends the whole block
+   command(setCommand(dial));
+   command("RC;RT0;" + setCommand(dial + 1) + setCommand(dial) + offsetCommand(-RIT_MAX_HZ));
+   BusCost first = { 0, 0, 0, 0 };
+   costed("RT1;", first);
+
+   BusCost       offset = { 0, 0, 0, 0 };
+   unsigned long wrong  = 0;
+   double        worst  = 0;
+   double        worstCounts = 0;
+   long          at     = -RIT_MAX_HZ;
+   while (at + RIT_STEP_HZ <= RIT_MAX_HZ) {
+      costed(offsetCommand(RIT_STEP_HZ), offset);
+      at += RIT_STEP_HZ;
+
+      double count;
+      double ideal = idealFrequency(dial + (double)at, count);
+      double off   = fabs(chipFrequency() - (dial + (double)at));
+      worst       = std::max(worst, off);
+      worstCounts = std::max(worstCounts, fabs(chipFrequency() - ideal) / count);
+      if ((fabs(chipFrequency() - ideal) > 1.01 * count) || (vfoBank.active()->getOffset() != at)) {
+         ++wrong;
+      }
+   }
+   costed(offsetCommand(RIT_MAX_HZ - at + 1), offset);
+   if (vfoBank.active()->getOffset() != RIT_MAX_HZ) {
+      ++wrong;
+   }
+
+   // the same steps as dial sets, each a whole block
+   command("RC;RT0;");
+   BusCost full = { 0, 0, 0, 0 };
+   for (long hz=-RIT_MAX_HZ; hz<=RIT_MAX_HZ; hz+=RIT_STEP_HZ) {
+      if (vfoBank.covers(band, dial + hz)) {
+         costed(setCommand(dial + hz), full);
+      }
+   }
+   command(setCommand(dial));
+
+   printf("band %d %8lu Hz  %4lu offsets, worst %.3f Hz %.2f counts  first %4.1f bytes  offset %4.1f bytes %6.0f us  "
+          "dial set %4.1f bytes %6.0f us  %s\n",
+          band, dial, offset.changes, worst, worstCounts, first.registersPer(),
+          offset.registersPer(), offset.microsPer(), full.registersPer(), full.microsPer(),
+          wrong ? "WRONG" : "ok");
+   return wrong == 0;
+}
+
+/**
+ * checks a command leaves the chip at the expected frequency
+ */
+static bool checkStep(const char *name, const std::string &text, double want) {
+   command(text);
+   double f  = chipFrequency();
+   bool   ok = fabs(f - want) <= 0.1;
+   printf("%-28s chip %11.2f Hz, want %11.2f  %s\n", name, f, want, ok ? "ok" : "WRONG");
+   return ok;
+}
+
+/**
+ * checks XIT, TX and RX, and a band switch with the offset on
+ */
+static bool flagCases() {
+   bool ok = true;
+   unsigned long dial = vfoBank.active()->getFrequency();
+
+   ok &= checkStep("RIT on, +1234",             "RC;RT1;XT0;RU01234;",  dial + 1234.0);
+   ok &= checkStep("TX, RIT only",              "TX;",                  dial);
+   ok &= checkStep("XIT on while transmitting", "XT1;",                 dial + 1234.0);
+   ok &= checkStep("RX, RIT off",               "RT0;RX;",              dial);
+   ok &= checkStep("TX, XIT on",                "TX;",                  dial + 1234.0);
+   ok &= checkStep("RX, RIT on",                "RX;RT1;",              dial + 1234.0);
+
+   // the other band's output still holds its frequency with no offset
+   uint8_t       band  = (vfoBank.selected() + 1) % vfoBank.count();
+   unsigned long other = vfoBank.frequency(band);
+   ok &= checkStep("band switch, offset on",    setCommand(other),      other + 1234.0);
+   ok &= checkStep("band switch back",          setCommand(dial),       dial + 1234.0);
+   return ok;
+}
+
+/**
+ * checks the IF answer and the display heading carry the offset
+ */
+static bool reportCases() {
+   bool ok = true;
+
+   command("RC;RT1;XT0;RX;RD00500;");
+   std::string reply = answer("IF;");
+   bool fields = (reply.size() == 38)
+              && (reply.substr(18, 5) == "-0500")
+              && (reply[23] == '1') && (reply[24] == '0') && (reply[28] == '0');
+   printf("%-28s %s  %s\n", "IF, RIT -500", reply.c_str(), fields ? "ok" : "WRONG");
+   ok &= fields;
+
+   command("XT1;TX;");
+   reply  = answer("IF;");
+   fields = (reply.size() == 38) && (reply[23] == '1') && (reply[24] == '1') && (reply[28] == '1');
+   printf("%-28s %s  %s\n", "IF, RIT XIT TX", reply.c_str(), fields ? "ok" : "WRONG");
+   ok &= fields;
+
+   std::string flag = answer("RT;") + answer("XT;");
+   printf("%-28s %s  %s\n", "RT; XT;", flag.c_str(), (flag == "RT1;XT1;") ? "ok" : "WRONG");
+   ok &= (flag == "RT1;XT1;");
+
+   command("XT0;RX;");
+   runFor(RIT_REPAINT_WAIT_US);
+   std::string heading = hostU8glibDisplay->frameText.substr(0, hostU8glibDisplay->frameText.find('\n'));
+   bool shown = heading.compare(0, 13, "RIT -0500 Hz ") == 0;
+   printf("%-28s \"%s\"  %s\n", "display heading", heading.c_str(), shown ? "ok" : "WRONG");
+   ok &= shown;
+
+   command("RC;RT0;");
+   runFor(RIT_REPAINT_WAIT_US);
+   heading = hostU8glibDisplay->frameText.substr(0, hostU8glibDisplay->frameText.find('\n'));
+   shown   = heading.compare(0, 13, "SI5351 N2HTT ") == 0;
+   printf("%-28s \"%s\"  %s\n", "display heading, RIT off", heading.c_str(), shown ? "ok" : "WRONG");
+   ok &= shown;
+
+   std::string refused = answer("RU123;");
+   printf("%-28s %s  %s\n", "RU short amount", refused.c_str(), (refused == "?;") ? "refused" : "NOT refused");
+   return ok && (refused == "?;");
+}
+
+int main(int argc, char **argv) {
+   if (argc != 1) {
+      fprintf(stderr, "usage: vfo_rit\n");
+      return 2;
+   }
+
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   bool ok = true;
+   uint8_t start = vfoBank.selected();
+   for (uint8_t ii=0; ii<vfoBank.count(); ++ii) {
+      ok &= sweepBand((start + 1 + ii) % vfoBank.count());
+   }
+   ok &= flagCases();
+   ok &= reportCases();
+   return ok ? 0 : 1;
+}
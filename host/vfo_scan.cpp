@@ -0,0 +1,442 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the memory channel scan benchmark. It runs the sketch
+ * built with USE_MEMORY_SCAN, stores channels and scans them with CAT
+ * commands over the simulated serial port, and times each hop on the
+ * chip.
+ *
+ *    vfo_scan
+ *
+ * Eight channels are stored with MW over the three bands, one of them
+ * marked skip, and read back with MR. The channels are first scanned
+ * with those on bands A and C marked skip too, so every hop is within
+ * one output, then all of them, and each plan at a dwell from 100 ms
+ * down to the shortest the timer takes. Each hop is checked to be the
+ * next channel, at its frequency, and the time its output came on is
+ * compared with the timer schedule, counted from the first hop. The
+ * rate is hops a second over the scan, and the bytes and bus time of a
+ * hop, worked out the way the Wire model charges it, 9 bits a byte at
+ * 100 kHz, are set against FA sets between the same channels, which
+ * load the whole multisynth block.
+ *
+ * Then a scan is paused with a press of the band button, which should
+ * leave the channel it was on tuned on its band, resumed with SC1 and
+ * stopped with SC0, which should load the dial frequency back. Last
+ * the channels saved to EEPROM are checked against MR, and a short
+ * dwell and an MW while scanning checked refused.
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+#include "Si5351Emulator.h"
+#include "EEPROMLog.h"
+
+#define SCAN_CHIP_ADDRESS            0x60
+#define SCAN_BUS_CLOCK             100000UL
+#define SCAN_BYTE_US                  261ULL     // 10 bits at 38400 baud
+#define SCAN_RUN_US               2000000ULL
+#define SCAN_SAVE_WAIT_US          200000ULL
+#define SCAN_PRESS_US              100000ULL
+#define SCAN_TOLERANCE_HZ              1.0
+
+/**
+ * the channel plan: frequency, band and skip flag, and the clock of
+ * the band, kept in step with the band table in the .ino
+ */
+struct ScanChannel {
+   unsigned long  frequency;
+   uint8_t        band;
+   bool           skip;
+   uint8_t        clock;
+};
+
+static const ScanChannel channels[] = {
+   {  7020000, 1, false, 1 },
+   {  7030000, 1, false, 1 },
+   {  7074000, 1, true,  1 },
+   {  7150000, 1, false, 1 },
+   { 10110000, 2, false, 2 },
+   { 10136000, 2, false, 2 },
+   {  3573000, 0, false, 0 },
+   {  3985000, 0, false, 0 },
+};
+#define SCAN_CHANNELS  (sizeof(channels) / sizeof(channels[0]))
+
+/**
+ * runs the sketch for a while
+ */
+static void runFor(uint64_t us) {
+   uint64_t until = host::now() + us;
+   while (host::now() < until) {
+      loop();
+   }
+}
+
+/**
+ * sends a command with no answer and gives the sketch time to take
+ * it, and longer if a slow pass left some of it unread
+ */
+static void command(const std::string &text) {
+   host::serialInput(text);
+   runFor(text.size() * SCAN_BYTE_US + 5000);
+   while (Serial.available() > 0) {
+      loop();
+   }
+}
+
+/**
+ * runs the sketch until an answer to a CAT command is in
+ * @return the answer, empty if none came
+ */
+static std::string answer(const std::string &text) {
+   std::string reply;
+   host::serialOutput();
+   host::serialInput(text);
+   uint64_t start = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - start < 1000000ULL)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   return reply;
+}
+
+/**
+ * formats a command with a number
+ */
+static std::string numbered(const char *name, unsigned long value, int digits) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "%s%0*lu;", name, digits, value);
+   return buf;
+}
+
+/**
+ * formats a channel store
+ */
+static std::string storeCommand(uint8_t channel, unsigned long f, bool skip) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "MW%02u%011lu%c;", channel, f, skip ? '1' : '0');
+   return buf;
+}
+
+/**
+ * formats the MR answer a channel should get
+ */
+static std::string channelAnswer(uint8_t channel, bool skip) {
+   char buf[24];
+   snprintf(buf, sizeof(buf), "MR%02u%011lu%03u%c;",
+            channel, channels[channel].frequency, channels[channel].band, skip ? '1' : '0');
+   return buf;
+}
+
+/**
+ * finds the next channel a scan stops on, as the sketch should
+ */
+static uint8_t nextChannel(uint8_t from, const bool *skip) {
+   for (uint8_t ii=1; ii<=SCAN_CHANNELS; ++ii) {
+      uint8_t channel = (from + ii) % SCAN_CHANNELS;
+      if (!skip[channel]) {
+         return channel;
+      }
+   }
+   return from;
+}
+
+/**
+ * finds the channel a frequency record is
+ * @return channel, SCAN_CHANNELS if none
+ */
+static uint8_t channelOf(const HostTraceRecord &record) {
+   for (uint8_t ii=0; ii<SCAN_CHANNELS; ++ii) {
+      if (  (record.channel == channels[ii].clock)
+         && (fabs(record.value / 100.0 - channels[ii].frequency) <= SCAN_TOLERANCE_HZ)) {
+         return ii;
+      }
+   }
+   return SCAN_CHANNELS;
+}
+
+/**
+ * bus cost of a run of hops
+ */
+struct BusCost {
+   unsigned long hops;
+   unsigned long bytes;         // bytes on the bus, addresses included
+   unsigned long transfers;
+
+   double bytesPer() const  { return hops ? (double)bytes / hops : 0; }
+   double microsPer() const { return hops ? (bytes * 9.0 + transfers * 2.0) * 1e6 / SCAN_BUS_CLOCK / hops : 0; }
+};
+
+/**
+ * stores the channels, with skip set on those given, and reads them
+ * back
+ * @return false if a store was refused or read back wrong
+ */
+static bool storeChannels(const bool *skip, bool report) {
+   unsigned long wrong = 0;
+   for (uint8_t ii=0; ii<SCAN_CHANNELS; ++ii) {
+      std::string reply = answer(storeCommand(ii, channels[ii].frequency, skip[ii]) + numbered("MR", ii, 2));
+      if (reply != channelAnswer(ii, skip[ii])) {
+         printf("%-10s channel %u answered %s, want %s\n", "WRONG", ii, reply.c_str(), channelAnswer(ii, skip[ii]).c_str());
+         ++wrong;
+      }
+   }
+   if (report) {
+      printf("%-10s %u channels stored and read back  %s\n", "store", (unsigned)SCAN_CHANNELS, wrong ? "WRONG" : "ok");
+   }
+   return wrong == 0;
+}
+
+/**
+ * tunes the channels on one band in turn with FA, for the cost of a
+ * hop made as a dial set
+ */
+static BusCost dialSetCost(const bool *skip) {
+   BusCost cost = { 0, 0, 0 };
+   command(numbered("FA", channels[0].frequency, 11));
+   for (int lap=0; lap<4; ++lap) {
+      for (uint8_t ii=0; ii<SCAN_CHANNELS; ++ii) {
+         if (skip[ii]) {
+            continue;
+         }
+         unsigned long bytes     = Wire.bytes(SCAN_CHIP_ADDRESS);
+         unsigned long transfers = Wire.transfers(SCAN_CHIP_ADDRESS);
+         command(numbered("FA", channels[ii].frequency, 11));
+         ++cost.hops;
+         cost.bytes     += Wire.bytes(SCAN_CHIP_ADDRESS) - bytes;
+         cost.transfers += Wire.transfers(SCAN_CHIP_ADDRESS) - transfers;
+      }
+   }
+   return cost;
+}
+
+/**
+ * scans at one dwell and reports the hops
+ * @return false if a hop was to the wrong channel or the scan stopped
+ */
+static bool runCase(const char *name, unsigned long dwell, const bool *skip) {
+   std::vector<HostTraceRecord> log;
+   host::setTraceLog(&log);
+
+   BusCost       cost      = { 0, 0, 0 };
+   unsigned long bytes     = Wire.bytes(SCAN_CHIP_ADDRESS);
+   unsigned long transfers = Wire.transfers(SCAN_CHIP_ADDRESS);
+   command(numbered("SC", dwell, 7));
+   runFor(SCAN_RUN_US);
+   cost.bytes     = Wire.bytes(SCAN_CHIP_ADDRESS) - bytes;
+   cost.transfers = Wire.transfers(SCAN_CHIP_ADDRESS) - transfers;
+
+   std::string status = answer("SC;");
+   cost.hops = strtoul(status.substr(5, 5).c_str(), 0, 10);
+   bool running = (status.size() > 2) && (status[2] == '1');
+   size_t      scanned = log.size();
+   command("SC0;");
+   host::setTraceLog(0);
+
+   // the output coming on at each channel, up to the stop
+   std::vector<HostTraceRecord> hops;
+   for (size_t ii=0; ii<scanned; ++ii) {
+      if (log[ii].kind == HOST_TRACE_SI5351_FREQUENCY) {
+         hops.push_back(log[ii]);
+      }
+   }
+
+   unsigned long wrong = 0;
+   double        early = 0;
+   double        late  = 0;
+   uint8_t       at    = hops.empty() ? SCAN_CHANNELS : channelOf(hops[0]);
+   if (at == SCAN_CHANNELS) {
+      ++wrong;
+   }
+   for (size_t ii=1; (ii<hops.size()) && (at != SCAN_CHANNELS); ++ii) {
+      uint8_t want = nextChannel(at, skip);
+      at = channelOf(hops[ii]);
+      if (at != want) {
+         ++wrong;
+         at = want;
+      }
+      double off = (double)(int64_t)(hops[ii].time - hops[0].time) - (double)ii * dwell;
+      early = std::min(early, off);
+      late  = std::max(late, off);
+   }
+   // the first channel leaves no record if the output is on its
+   // frequency already, as it is after an FA set to it
+   bool missing = (hops.size() + 1 < cost.hops);
+   double rate = (hops.size() > 1)
+               ? (hops.size() - 1) * 1e6 / (double)(hops.back().time - hops[0].time) : 0;
+
+   printf("%-10s dwell %7lu us  %5lu hops  %7.1f hops/s  schedule %+7.0f/%+5.0f us  %4.1f bytes %6.0f us a hop  %s\n",
+          name, dwell, cost.hops, rate, early, late, cost.bytesPer(), cost.microsPer(),
+          (wrong || !running || missing) ? "WRONG" : "ok");
+   return (wrong == 0) && running && !missing;
+}
+
+/**
+ * presses the band button
+ */
+static void pressBand() {
+   host::setPin(VFO_SELECTOR_PIN, LOW);
+   runFor(SCAN_PRESS_US);
+   host::setPin(VFO_SELECTOR_PIN, HIGH);
+   runFor(SCAN_PRESS_US);
+}
+
+/**
+ * checks only one output is on, at a frequency
+ */
+static bool checkOutputs(uint8_t clock, unsigned long f) {
+   bool ok = fabs(hostSi5351Chip.outputFrequency(clock) - f) <= SCAN_TOLERANCE_HZ;
+   for (uint8_t clk=0; clk<3; ++clk) {
+      if ((clk != clock) && (hostSi5351Chip.outputFrequency(clk) != 0)) {
+         ok = false;
+      }
+   }
+   return ok;
+}
+
+/**
+ * pauses a scan with a press, resumes it and stops it
+ * @return false if any step left the VFO wrong
+ */
+static bool pauseCase() {
+   bool          ok   = true;
+   uint8_t       band = vfoBank.selected();
+   unsigned long dial = vfoBank.frequency(band);
+
+   command(numbered("SC", 100000, 7));
+   runFor(350000);
+   pressBand();
+
+   std::string   status  = answer("SC;");
+   unsigned long channel = strtoul(status.substr(3, 2).c_str(), 0, 10);
+   bool paused = (status.size() > 2) && (status[2] == '2') && (channel < SCAN_CHANNELS);
+   if (paused) {
+      const ScanChannel &on = channels[channel];
+      paused = (vfoBank.selected() == on.band) && (vfoBank.frequency(on.band) == on.frequency)
+            && checkOutputs(on.clock, on.frequency);
+   }
+   printf("%-10s press paused on channel %lu, answered %s  %s\n", "pause", channel, status.c_str(), paused ? "ok" : "WRONG");
+   ok &= paused;
+
+   // the paused channel is the dial now, so stop loads it back
+   band = vfoBank.selected();
+   dial = vfoBank.frequency(band);
+
+   command("SC1;");
+   runFor(350000);
+   status = answer("SC;");
+   bool resumed = (status.size() > 2) && (status[2] == '1');
+   printf("%-10s SC1 answered %s  %s\n", "resume", status.c_str(), resumed ? "ok" : "WRONG");
+   ok &= resumed;
+
+   command("SC0;");
+   status = answer("SC;");
+   bool stopped = (status.size() > 2) && (status[2] == '0') && (vfoBank.selected() == band)
+               && checkOutputs(vfoBank.active()->getClock(), dial);
+   printf("%-10s SC0 answered %s, dial %lu Hz back on band %u  %s\n", "stop", status.c_str(), dial, band, stopped ? "ok" : "WRONG");
+   ok &= stopped;
+   return ok;
+}
+
+/**
+ * checks the channels saved to EEPROM against MR
+ */
+static bool savedCase(const bool *skip) {
+   runFor(SCAN_SAVE_WAIT_US);
+
+   uint8_t   record[EEPROMLOG_RECORD_LENGTH(6 * SCAN_CHANNELS)];
+   EEPROMLog log(EEPROM_CHANNEL_LOG_ADDRESS, EEPROM_CHANNEL_LOG_BYTES, record, sizeof(record));
+   bool ok = log.begin();
+   for (uint8_t ii=0; ok && (ii<SCAN_CHANNELS); ++ii) {
+      const uint8_t *p = log.payload() + 6 * ii;
+      unsigned long  f = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+      ok = (f == channels[ii].frequency) && (p[4] == channels[ii].band) && (((p[5] & 0x02) != 0) == skip[ii])
+        && (answer(numbered("MR", ii, 2)) == channelAnswer(ii, skip[ii]));
+   }
+   printf("%-10s channels in EEPROM %s\n", "saved", ok ? "match" : "do NOT match");
+   return ok;
+}
+
+/**
+ * checks a short dwell, and a store while scanning, are refused
+ */
+static bool refuseCase() {
+   std::string shortDwell = answer(numbered("SC", HOST_SWEEP_MIN_DWELL_MICROS - 100, 7));
+   command(numbered("SC", 10000, 7));
+   std::string store = answer(storeCommand(0, channels[0].frequency, false));
+   command("SC0;");
+
+   bool ok = (shortDwell == "?;") && (store == "?;");
+   printf("%-10s SC%07d; answered %s, MW while scanning %s  %s\n", "refuse",
+          HOST_SWEEP_MIN_DWELL_MICROS - 100, shortDwell.c_str(), store.c_str(), ok ? "ok" : "WRONG");
+   return ok;
+}
+
+int main() {
+   static const unsigned long dwells[] = { 100000, 10000, 5000, 2000 };
+
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   bool ok = true;
+   bool skip[SCAN_CHANNELS];
+   bool oneBand[SCAN_CHANNELS];
+   for (uint8_t ii=0; ii<SCAN_CHANNELS; ++ii) {
+      skip[ii]    = channels[ii].skip;
+      oneBand[ii] = channels[ii].skip || (channels[ii].band != 1);
+   }
+
+   // band B only: every hop within one output
+   ok &= storeChannels(oneBand, false);
+   BusCost full = dialSetCost(oneBand);
+   for (size_t ii=0; ii<sizeof(dwells)/sizeof(dwells[0]); ++ii) {
+      ok &= runCase("band B", dwells[ii], oneBand);
+   }
+
+   // all the bands: three of the six hops a lap change output
+   ok &= storeChannels(skip, true);
+   for (size_t ii=0; ii<sizeof(dwells)/sizeof(dwells[0]); ++ii) {
+      ok &= runCase("all bands", dwells[ii], skip);
+   }
+   printf("%-10s FA sets between band B channels  %4.1f bytes %6.0f us a hop\n",
+          "dial set", full.bytesPer(), full.microsPer());
+
+   ok &= pauseCase();
+   ok &= savedCase(skip);
+   ok &= refuseCase();
+
+   printf("%s\n", ok ? "ok" : "FAILED");
+   return ok ? 0 : 1;
+}
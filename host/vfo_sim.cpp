@@ -0,0 +1,647 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the input trace simulator. It runs the sketch in
+ * virtual time, plays encoder turns and button presses from a trace
+ * file onto the input pins, bounce included, and logs every Si5351
+ * frequency write and display frame with its time. From the log it
+ * reports:
+ *
+ * - tuning latency, from the encoder edge the sketch acted on to the
+ *   new frequency on the chip, and on to the next display frame
+ * - button latency, from release to the next display frame
+ * - tuning steps filtered, taken in by the sketch without a frequency
+ *   change of their own: the encoder movement threshold merges bounce
+ *   and part detents this way - and steps never answered by the end
+ * - Si5351 bus traffic per frequency change, and any register
+ *   settings the chip would not accept (see Si5351Emulator.h)
+ * - whether each enabled clock ends on its vfo frequency
+ * - how the loop spent its time asleep
+ * - EEPROM bytes written saving the operating state
+ * - time from start up to RF on, and to the first display frame
+ * - when the display controller was set up, flagged EARLY if that was
+ *   before setup() or before RF - the U8glib constructor sets it up
+ *   over the bus, so a display built with the globals shows here
+ *
+ * Latencies are in virtual time, which moves with bus transfers,
+ * delay() and sleep but not with the sketch's own computation, so
+ * they leave its CPU time out.
+ *
+ * Runs are deterministic, so two builds can be compared on one trace.
+ *
+ *    vfo_sim [-e eeprom file] [-l log file] [-s detents per step] trace file
+ *
+ * With -e the EEPROM is loaded from the file before setup, if it is
+ * there, and saved to it at the end, so runs one after another model
+ * power cycles. The run is then stretched past the end of the trace
+ * until the state has been saved, as if the operator left the VFO
+ * alone before turning it off.
+ *
+ * Trace file lines are settings or timed input. Times are in ms,
+ * absolute, or relative to the previous timed line with a leading +.
+ *
+ *    edge 2               ms between encoder edges (default 2)
+ *    bounce 3 40          3 extra toggles, 40 us apart, on every edge
+ *    0      turn 10       10 detents clockwise, negative for ccw
+ *    +500   press select 100
+ *    +1000  press delta 1500
+ *    +1000  end           run until here (default last input + 1000)
+ *
+ * The buttons are select (vfo select) and delta (frequency delta).
+ * A detent is one full quadrature cycle, four edges.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <si5351.h>
+#include <U8glib.h>
+#include "Si5351Emulator.h"
+#include "HostHAL.h"
+#include "HostSketch.h"
+
+#define SIM_DEFAULT_EDGE_US          2000
+#define SIM_DEFAULT_SETTLE_US     1000000
+#define SIM_DEFAULT_DETENTS_PER_STEP    2
+
+/**
+ * kinds of input marks - points in the trace the sketch must answer
+ */
+#define SIM_MARK_STEP                   0
+#define SIM_MARK_PRESS                  1
+
+/**
+ * one pin change
+ */
+struct SimEdge {
+   uint64_t time;
+   uint8_t  pin;
+   uint8_t  level;
+};
+
+/**
+ * one input to be answered - a completed tuning step or a button
+ * release - at the time its last edge settled. The sketch may act on
+ * a detent before it settles, so steps also keep the time their last
+ * detent began.
+ */
+struct SimMark {
+   uint64_t time;
+   uint64_t begin;
+   uint8_t  kind;
+   int8_t   arg;       // step direction, or button pin
+};
+
+static bool byTime(const SimEdge &a, const SimEdge &b) {
+   return a.time < b.time;
+}
+
+/**
+ * This class holds a parsed trace and plays it onto the pins
+ */
+class TracePlayer : public HostScheduler {
+protected:
+   std::vector<SimEdge> m_edges;
+   size_t               ml_next;
+   uint64_t             ml_edgeSpacing;
+   int                  mi_bounceToggles;
+   uint64_t             ml_bounceSpacing;
+   int                  mi_detentsPerStep;
+   int                  mi_detentsPending;
+
+  /**
+   * adds one edge, with bounce before it settles
+   * @return time the edge settles
+   */
+   uint64_t addEdge(uint64_t time, uint8_t pin, uint8_t level) {
+      for (int ii=0; ii<mi_bounceToggles; ++ii) {
+         SimEdge on  = { time, pin, level };
+         SimEdge off = { time + ml_bounceSpacing, pin, (uint8_t)!level };
+         m_edges.push_back(on);
+         m_edges.push_back(off);
+         time += 2 * ml_bounceSpacing;
+      }
+      SimEdge edge = { time, pin, level };
+      m_edges.push_back(edge);
+      return time;
+   }
+
+  /**
+   * adds detents of encoder rotation
+   */
+   void addTurn(uint64_t time, int detents) {
+      // clockwise from rest with both lines high:
+      // B falls, A falls, B rises, A rises
+      static const uint8_t cwPin[4]  = { ENCODER_PIN_B, ENCODER_PIN_A,
+                                         ENCODER_PIN_B, ENCODER_PIN_A };
+      static const uint8_t ccwPin[4] = { ENCODER_PIN_A, ENCODER_PIN_B,
+                                         ENCODER_PIN_A, ENCODER_PIN_B };
+      static const uint8_t level[4]  = { LOW, LOW, HIGH, HIGH };
+
+      int8_t         dir = (detents < 0) ? -1 : 1;
+      const uint8_t *pin = (detents < 0) ? ccwPin : cwPin;
+
+      for (int ii=0; ii<abs(detents); ++ii) {
+         uint64_t begin   = time;
+         uint64_t settled = time;
+         for (int jj=0; jj<4; ++jj) {
+            settled = addEdge(time, pin[jj], level[jj]);
+            time += ml_edgeSpacing;
+         }
+
+         if (++mi_detentsPending >= mi_detentsPerStep) {
+            SimMark mark = { settled, begin, SIM_MARK_STEP, dir };
+            marks.push_back(mark);
+            mi_detentsPending = 0;
+         }
+      }
+   }
+
+  /**
+   * adds a button press
+   */
+   void addPress(uint64_t time, uint8_t pin, uint64_t hold) {
+      addEdge(time, pin, LOW);
+      SimMark mark = { addEdge(time + hold, pin, HIGH), time, SIM_MARK_PRESS, (int8_t)pin };
+      marks.push_back(mark);
+   }
+
+public:
+   std::vector<SimMark> marks;
+   uint64_t             endTime;
+   uint64_t             lastInput;
+
+   TracePlayer(int detentsPerStep)
+   : ml_next(0)
+   , ml_edgeSpacing(SIM_DEFAULT_EDGE_US)
+   , mi_bounceToggles(0)
+   , ml_bounceSpacing(0)
+   , mi_detentsPerStep(detentsPerStep)
+   , mi_detentsPending(0)
+   , endTime(0)
+   , lastInput(0)
+   {}
+
+  /**
+   * reads a trace file
+   * @return false, with a message printed, if the file is bad
+   */
+   bool load(const char *fileName) {
+      FILE *fp = fopen(fileName, "r");
+      if (fp == 0) {
+         fprintf(stderr, "vfo_sim: %s: %s\n", fileName, strerror(errno));
+         return false;
+      }
+
+      char     line[256];
+      int      lineNumber = 0;
+      uint64_t time       = 0;
+      bool     ok         = true;
+
+      while (ok && fgets(line, sizeof(line), fp)) {
+         ++lineNumber;
+         char *hash = strchr(line, '#');
+         if (hash) {
+            *hash = 0;
+         }
+
+         char   word[4][32];
+         int    words = sscanf(line, "%31s %31s %31s %31s", word[0], word[1], word[2], word[3]);
+         if (words <= 0) {
+            continue;
+         }
+
+         if (!strcmp(word[0], "edge") && (words == 2)) {
+            ml_edgeSpacing = (uint64_t)(atof(word[1]) * 1000);
+         }
+         else if (!strcmp(word[0], "bounce") && (words == 3)) {
+            mi_bounceToggles = atoi(word[1]);
+            ml_bounceSpacing = strtoull(word[2], 0, 10);
+         }
+         else if ((isdigit(word[0][0]) || (word[0][0] == '+')) && (words >= 2)) {
+            uint64_t t = (uint64_t)(atof(word[0] + (word[0][0] == '+')) * 1000);
+            time = (word[0][0] == '+') ? time + t : t;
+
+            if (!strcmp(word[1], "turn") && (words == 3)) {
+               addTurn(time, atoi(word[2]));
+            }
+            else if (!strcmp(word[1], "press") && (words == 4)) {
+               uint8_t pin = !strcmp(word[2], "select") ? VFO_SELECTOR_PIN
+                           : !strcmp(word[2], "delta")  ? FRQ_DELTA_SELECTOR_PIN
+                           : 0;
+               if (pin == 0) {
+                  ok = false;
+               }
+               else {
+                  addPress(time, pin, (uint64_t)(atof(word[3]) * 1000));
+               }
+            }
+            else if (!strcmp(word[1], "end") && (words == 2)) {
+               endTime = time;
+            }
+            else {
+               ok = false;
+            }
+         }
+         else {
+            ok = false;
+         }
+
+         if (!ok) {
+            fprintf(stderr, "vfo_sim: %s:%d: bad line\n", fileName, lineNumber);
+         }
+      }
+      fclose(fp);
+
+      std::stable_sort(m_edges.begin(), m_edges.end(), byTime);
+      lastInput = m_edges.empty() ? 0 : m_edges.back().time;
+      if (endTime == 0) {
+         endTime = lastInput + SIM_DEFAULT_SETTLE_US;
+      }
+      return ok;
+   }
+
+  /**
+   * moves the whole trace later, to start once the sketch is up
+   */
+   void offset(uint64_t t) {
+      for (size_t ii=0; ii<m_edges.size(); ++ii) {
+         m_edges[ii].time += t;
+      }
+      for (size_t ii=0; ii<marks.size(); ++ii) {
+         marks[ii].time  += t;
+         marks[ii].begin += t;
+      }
+      endTime   += t;
+      lastInput += t;
+   }
+
+  /**
+   * finds the last encoder edge at or before a time
+   * @return time of the edge, 0 if none
+   */
+   uint64_t lastEncoderEdge(uint64_t t) const {
+      for (size_t ii=m_edges.size(); ii>0; --ii) {
+         const SimEdge &edge = m_edges[ii - 1];
+         if (  (edge.time <= t)
+            && ((edge.pin == ENCODER_PIN_A) || (edge.pin == ENCODER_PIN_B))) {
+            return edge.time;
+         }
+      }
+      return 0;
+   }
+
+   virtual uint64_t nextEventTime() {
+      return (ml_next < m_edges.size()) ? m_edges[ml_next].time : UINT64_MAX;
+   }
+
+   virtual void runEvents(uint64_t now) {
+      while ((ml_next < m_edges.size()) && (m_edges[ml_next].time <= now)) {
+         const SimEdge &edge = m_edges[ml_next++];
+         host::setPin(edge.pin, edge.level);
+      }
+   }
+};
+
+/**
+ * This class collects latency samples and reports their distribution
+ */
+class LatencyStats {
+public:
+   std::vector<uint64_t> samples;
+
+   void add(uint64_t us) {
+      samples.push_back(us);
+   }
+
+   uint64_t percentile(int p) {
+      if (samples.empty()) {
+         return 0;
+      }
+      std::sort(samples.begin(), samples.end());
+      size_t rank = (samples.size() * p + 99) / 100;
+      return samples[(rank > 0) ? rank - 1 : 0];
+   }
+
+   void report(const char *name) {
+      printf("%-24s %6lu  p50 %8.2f  p99 %8.2f  max %8.2f ms\n", name,
+             (unsigned long)samples.size(),
+             percentile(50) / 1000.0, percentile(99) / 1000.0, percentile(100) / 1000.0);
+   }
+};
+
+/**
+ * finds the first display frame started at or after a time
+ * @return index of the frame in the log, or log size if none
+ */
+static size_t nextFrame(const std::vector<HostTraceRecord> &log, uint64_t t) {
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      if ((log[ii].kind == HOST_TRACE_DISPLAY_FRAME) && (log[ii].start >= t)) {
+         return ii;
+      }
+   }
+   return log.size();
+}
+
+/**
+ * gets latency, zero if the answer came before the input
+ */
+static uint64_t since(uint64_t input, uint64_t answer) {
+   return (answer > input) ? answer - input : 0;
+}
+
+static void usage() {
+   fprintf(stderr, "usage: vfo_sim [-e eeprom file] [-l log file] [-s detents per step] trace file\n");
+   exit(2);
+}
+
+int main(int argc, char **argv) {
+   const char *logName        = 0;
+   const char *eepromName     = 0;
+   int         detentsPerStep = SIM_DEFAULT_DETENTS_PER_STEP;
+   int         opt;
+
+   while ((opt = getopt(argc, argv, "e:l:s:")) != -1) {
+      switch (opt) {
+         case 'e': eepromName = optarg;               break;
+         case 'l': logName = optarg;                  break;
+         case 's': detentsPerStep = atoi(optarg);     break;
+         default:  usage();
+      }
+   }
+   if ((optind != argc - 1) || (detentsPerStep < 1)) {
+      usage();
+   }
+
+   TracePlayer player(detentsPerStep);
+   if (!player.load(argv[optind])) {
+      return 1;
+   }
+
+   std::vector<HostTraceRecord> log;
+   std::vector<unsigned long>   logDelta;
+
+   if (eepromName != 0) {
+      // a missing file is a new chip, erased
+      FILE *fp = fopen(eepromName, "rb");
+      if (fp != 0) {
+         if (fread(host::eeprom(), 1, E2END + 1, fp) != E2END + 1) {
+            fprintf(stderr, "vfo_sim: %s: short file\n", eepromName);
+            return 1;
+         }
+         fclose(fp);
+      }
+   }
+
+   // start up, traced for the boot times
+   std::vector<HostTraceRecord> bootLog;
+   bool     earlyDisplay = (hostU8glibDisplay != 0);
+   uint64_t boot = host::now();
+   host::setTraceLog(&bootLog);
+   setup();
+
+   // the display comes up in the first loop passes, the trace after it
+   uint64_t bootDisplay = UINT64_MAX;
+   while (bootDisplay == UINT64_MAX) {
+      loop();
+      for (size_t ii=0; ii<bootLog.size(); ++ii) {
+         if (bootLog[ii].kind == HOST_TRACE_DISPLAY_FRAME) {
+            bootDisplay = bootLog[ii].time - boot;
+            break;
+         }
+      }
+   }
+   host::setTraceLog(0);
+
+   // frequencies on the outputs setup turned on, before the trace
+   // starts
+   uint64_t lastFrequency[SI5351_NUMBER_OF_CLOCKS];
+   for (int ii=0; ii<SI5351_NUMBER_OF_CLOCKS; ++ii) {
+      lastFrequency[ii] = (ii < SI5351_EMULATED_CLOCKS) && hostSi5351Chip.outputEnabled(ii)
+                        ? (uint64_t)llround(hostSi5351Chip.outputFrequency(ii) * SI5351_FREQ_MULT)
+                        : 0;
+   }
+
+   uint64_t start = host::now();
+   player.offset(start);
+   host::setScheduler(&player);
+   host::setTraceLog(&log);
+   host::resetStats();
+   Wire.resetCounters();
+   hostSi5351Chip.resetCounters();
+
+   unsigned long passes = 0;
+   while (host::now() < player.endTime) {
+      loop();
+      ++passes;
+
+      // the frequency delta in force for what this pass wrote
+      logDelta.resize(log.size(), frequency_delta);
+   }
+
+   if (eepromName != 0) {
+      // leave the VFO alone until the state is saved
+      while (statePersistencePending()) {
+         loop();
+         ++passes;
+         logDelta.resize(log.size(), frequency_delta);
+      }
+   }
+   host::setTraceLog(0);
+   host::setScheduler(0);
+
+   // tuning - match frequency changes to the steps waiting for them
+   LatencyStats chipLatency;
+   LatencyStats frameLatency;
+   LatencyStats pressLatency;
+   size_t       nextMark  = 0;
+   unsigned long steps    = 0;
+   unsigned long served   = 0;
+   unsigned long filtered = 0;
+   unsigned long changes  = 0;
+   std::vector<SimMark> waiting;
+
+   for (size_t ii=0; ii<player.marks.size(); ++ii) {
+      steps += (player.marks[ii].kind == SIM_MARK_STEP);
+   }
+
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      const HostTraceRecord &rec = log[ii];
+      if (rec.kind != HOST_TRACE_SI5351_FREQUENCY) {
+         continue;
+      }
+
+      // a change of n deltas answers the n oldest steps waiting;
+      // any others were read by the sketch and filtered out
+      uint64_t previous = lastFrequency[rec.channel];
+      uint64_t diff     = (rec.value > previous) ? rec.value - previous : previous - rec.value;
+      uint64_t delta    = (uint64_t)logDelta[ii] * SI5351_FREQ_MULT;
+      size_t   n        = (size_t)((delta > 0) ? (diff + delta / 2) / delta : 1);
+
+      lastFrequency[rec.channel] = rec.value;
+      if (n == 0) {
+         continue;
+      }
+      ++changes;
+
+      // steps under way before the sketch started this write
+      while ((nextMark < player.marks.size()) && (player.marks[nextMark].begin <= rec.start)) {
+         if (player.marks[nextMark].kind == SIM_MARK_STEP) {
+            waiting.push_back(player.marks[nextMark]);
+         }
+         ++nextMark;
+      }
+
+      if (n > waiting.size()) {
+         n = waiting.size();
+      }
+
+      // the edge that set the write going, rather than the step's
+      // settling, which the sketch need not wait for
+      size_t   frame = nextFrame(log, rec.time);
+      uint64_t edge  = player.lastEncoderEdge(rec.start);
+      for (size_t jj=0; jj<n; ++jj) {
+         chipLatency.add(since(edge, rec.time));
+         if (frame < log.size()) {
+            frameLatency.add(since(edge, log[frame].time));
+         }
+      }
+      served   += n;
+      filtered += waiting.size() - n;
+      waiting.clear();
+   }
+
+   // buttons - release to the next frame
+   unsigned long presses    = 0;
+   unsigned long unanswered = 0;
+   for (size_t ii=0; ii<player.marks.size(); ++ii) {
+      if (player.marks[ii].kind == SIM_MARK_PRESS) {
+         ++presses;
+         size_t frame = nextFrame(log, player.marks[ii].time);
+         if (frame < log.size()) {
+            pressLatency.add(log[frame].time - player.marks[ii].time);
+         }
+         else {
+            ++unanswered;
+         }
+      }
+   }
+
+   // first output on since start up, and the display controller set
+   // up - a display built with the globals did that before setup()
+   uint64_t bootRF   = UINT64_MAX;
+   uint64_t bootInit = UINT64_MAX;
+   for (size_t ii=0; ii<bootLog.size(); ++ii) {
+      if (  (bootLog[ii].kind == HOST_TRACE_SI5351_OUTPUTS) && (bootLog[ii].value != 0)
+         && (bootRF == UINT64_MAX)) {
+         bootRF = bootLog[ii].time - boot;
+      }
+      if ((bootLog[ii].kind == HOST_TRACE_DISPLAY_INIT) && (bootInit == UINT64_MAX)) {
+         bootInit = bootLog[ii].start - boot;
+      }
+   }
+
+   const HostStats &stats = host::stats();
+   uint64_t elapsed = host::now() - start;
+   uint64_t asleep  = 0;
+   for (int ii=0; ii<HOST_SLEEP_MODES; ++ii) {
+      asleep += stats.sleepMicros[ii];
+   }
+
+   printf("trace                    %s\n", argv[optind]);
+   printf("virtual time             %.3f s, %lu loop passes\n", elapsed / 1e6, passes);
+   printf("tuning steps             %lu in, %lu answered, %lu filtered, %lu never answered\n",
+          steps, served, filtered, steps - served - filtered);
+   printf("frequency changes        %lu\n", changes);
+   printf("button presses           %lu in, %lu never answered\n", presses, unanswered);
+   chipLatency.report("edge to chip");
+   frameLatency.report("edge to display");
+   pressLatency.report("button to display");
+   printf("asleep                   %.1f %% (idle %.1f %%, power down %.1f %%), %lu sleeps\n",
+          elapsed ? 100.0 * asleep / elapsed : 0.0,
+          elapsed ? 100.0 * stats.sleepMicros[SLEEP_MODE_IDLE] / elapsed : 0.0,
+          elapsed ? 100.0 * stats.sleepMicros[SLEEP_MODE_PWR_DOWN] / elapsed : 0.0,
+          (unsigned long)(stats.sleepCount[SLEEP_MODE_IDLE] + stats.sleepCount[SLEEP_MODE_PWR_DOWN]));
+   printf("si5351 bus               %lu bytes, %lu transfers, %.1f bytes per change\n",
+          Wire.bytes(SI5351_BUS_BASE_ADDR), Wire.transfers(SI5351_BUS_BASE_ADDR),
+          changes ? (double)Wire.bytes(SI5351_BUS_BASE_ADDR) / changes : 0.0);
+   printf("si5351 problems          %lu\n", hostSi5351Chip.problems);
+   for (size_t ii=0; ii<hostSi5351Chip.messages.size(); ++ii) {
+      printf("   %s\n", hostSi5351Chip.messages[ii].c_str());
+   }
+   for (int ii=0; ii<SI5351_EMULATED_CLOCKS; ++ii) {
+      if (hostSi5351Chip.outputEnabled(ii)) {
+         // only the selected band should be running
+         double chip  = hostSi5351Chip.outputFrequency(ii);
+         double wants = (vfoBank.active()->getClock() == ii) ? vfoBank.frequency(vfoBank.selected()) : 0.0;
+         printf("clock %d                  %.2f Hz, vfo %.0f Hz%s\n", ii, chip, wants,
+                (fabs(chip - wants) < 1.0) ? "" : "  MISMATCH");
+      }
+   }
+   printf("busy in delay()          %.1f %%\n", elapsed ? 100.0 * stats.delayMicros / elapsed : 0.0);
+   printf("interrupts               %lu\n", (unsigned long)stats.interruptCount);
+   printf("watchdog gap             %.1f ms longest, timeout %.0f ms\n",
+          stats.wdtLongestMicros / 1e3, stats.wdtTimeoutMicros / 1e3);
+   printf("eeprom writes            %lu bytes\n", (unsigned long)stats.eepromWrites);
+   printf("boot to RF               %.2f ms, to display %.2f ms\n",
+          (bootRF != UINT64_MAX) ? bootRF / 1000.0 : -1.0, bootDisplay / 1000.0);
+   if (earlyDisplay) {
+      printf("display set up           before setup()  EARLY\n");
+   }
+   else if (bootInit != UINT64_MAX) {
+      printf("display set up           %.2f ms%s\n", bootInit / 1000.0,
+             ((bootRF != UINT64_MAX) && (bootInit < bootRF)) ? ", before RF  EARLY" : "");
+   }
+
+   if (eepromName != 0) {
+      FILE *fp = fopen(eepromName, "wb");
+      if ((fp == 0) || (fwrite(host::eeprom(), 1, E2END + 1, fp) != E2END + 1)) {
+         fprintf(stderr, "vfo_sim: %s: %s\n", eepromName, strerror(errno));
+         return 1;
+      }
+      fclose(fp);
+   }
+
+   if (logName != 0) {
+      FILE *fp = fopen(logName, "w");
+      if (fp == 0) {
+         fprintf(stderr, "vfo_sim: %s: %s\n", logName, strerror(errno));
+         return 1;
+      }
+      static const char *kindName[] = { "frequency", "outputs", "frame" };
+      for (size_t ii=0; ii<log.size(); ++ii) {
+         fprintf(fp, "%.3f %.3f %s %u %llu\n",
+                 (log[ii].start - start) / 1000.0, (log[ii].time - start) / 1000.0,
+                 kindName[log[ii].kind], log[ii].channel, (unsigned long long)log[ii].value);
+      }
+      fclose(fp);
+   }
+
+   return 0;
+}
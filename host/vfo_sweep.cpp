@@ -0,0 +1,279 @@
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file is the frequency sweep benchmark. It runs the sketch built
+ * with USE_FREQUENCY_SWEEP, starts sweeps with the SW CAT command over
+ * the simulated serial port, and times each point on the chip.
+ *
+ *    vfo_sweep              500 points a case
+ *    vfo_sweep -p 2000      2000 points a case
+ *
+ * Each case sweeps the selected band at one dwell. Every point is
+ * checked against the frequency it should be, and the start of its
+ * write is compared with where the timer schedule puts it, counted
+ * from the first point the timer sent, so a late point and any drift
+ * after it both show. The rate is points a second over the sweep, and
+ * the underruns and latest interrupt are as the sketch reports them
+ * in its SW answer. A case is also run with FA queries coming in
+ * throughout, to show the loop work does not move the points, and a
+ * repeating sweep is stopped with SW0 to check the dial frequency
+ * comes back.
+ *
+ * Like vfo_sim it runs in virtual time and is deterministic.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "HostHAL.h"
+#include "HostSketch.h"
+
+#define SWEEP_START_FREQUENCY     7000000UL
+#define SWEEP_STEP                    100UL
+#define SWEEP_TIMEOUT_US         10000000ULL
+#define SWEEP_QUERY_EVERY_US         5000ULL
+
+/**
+ * This class collects step errors and reports their distribution
+ */
+class ErrorStats {
+public:
+   std::vector<int64_t> samples;
+
+   void add(int64_t us) {
+      samples.push_back(us);
+   }
+
+   int64_t percentile(int p) {
+      if (samples.empty()) {
+         return 0;
+      }
+      std::vector<int64_t> sorted;
+      for (size_t ii=0; ii<samples.size(); ++ii) {
+         sorted.push_back(llabs(samples[ii]));
+      }
+      std::sort(sorted.begin(), sorted.end());
+      size_t rank = (sorted.size() * p + 99) / 100;
+      return sorted[(rank > 0) ? rank - 1 : 0];
+   }
+};
+
+/**
+ * runs the sketch until an answer to a CAT command is in
+ * @return the answer, empty if none came
+ */
+static std::string answer() {
+   std::string reply;
+   uint64_t    start = host::now();
+   while ((reply.find(';') == std::string::npos) && (host::now() - start < SWEEP_TIMEOUT_US)) {
+      loop();
+      reply += host::serialOutput();
+   }
+   return reply;
+}
+
+/**
+ * formats an SW command starting a sweep
+ */
+static std::string sweepCommand(unsigned long start, unsigned long stop, unsigned long step,
+                                unsigned long dwell, bool repeat) {
+   char buf[48];
+   snprintf(buf, sizeof(buf), "SW%011lu%011lu%07lu%07lu%d;", start, stop, step, dwell, repeat ? 1 : 0);
+   return buf;
+}
+
+/**
+ * gets the chip writes of the selected band's clock from a trace
+ */
+static std::vector<HostTraceRecord> points(const std::vector<HostTraceRecord> &log) {
+   std::vector<HostTraceRecord> out;
+   uint8_t clk = vfoBank.active()->getClock();
+   for (size_t ii=0; ii<log.size(); ++ii) {
+      if ((log[ii].kind == HOST_TRACE_SI5351_FREQUENCY) && (log[ii].channel == clk)) {
+         out.push_back(log[ii]);
+      }
+   }
+   return out;
+}
+
+/**
+ * runs one sweep and reports it
+ * @param  name     case name
+ * @param  count    points in the sweep
+ * @param  dwell    us per point
+ * @param  queries  true to send FA queries while it runs
+ */
+static void runCase(const char *name, int count, unsigned long dwell, bool queries) {
+   std::vector<HostTraceRecord> log;
+   unsigned long stop = SWEEP_START_FREQUENCY + (count - 1) * SWEEP_STEP;
+
+   host::setTraceLog(&log);
+   host::serialInput(sweepCommand(SWEEP_START_FREQUENCY, stop, SWEEP_STEP, dwell, false));
+
+   // the command takes a few ms to come in, then the sweep runs
+   uint64_t      start     = host::now();
+   uint64_t      nextQuery = start + SWEEP_QUERY_EVERY_US;
+   unsigned long answered  = 0;
+   bool          started   = false;
+   while ((started ? sweep_active : true) && (host::now() - start < SWEEP_TIMEOUT_US)) {
+      loop();
+      started = started || sweep_active;
+      if (queries && (host::now() >= nextQuery)) {
+         host::serialInput("FA;");
+         nextQuery += SWEEP_QUERY_EVERY_US;
+      }
+      std::string out = host::serialOutput();
+      answered += std::count(out.begin(), out.end(), ';');
+   }
+   host::setTraceLog(0);
+
+   // sketch's own count of underruns and latest interrupt, after any
+   // FA answers still to come
+   host::serialInput("SW;");
+   std::string status;
+   while (status.find("SW") == std::string::npos) {
+      std::string reply = answer();
+      if (reply.empty()) {
+         break;
+      }
+      status += reply;
+   }
+   status = status.substr(std::min(status.find("SW"), status.size()));
+   unsigned long underruns = 0, late = 0;
+   if (status.size() >= 21) {
+      underruns = strtoul(status.substr(8, 5).c_str(), 0, 10);
+      late      = strtoul(status.substr(13, 7).c_str(), 0, 10);
+   }
+
+   // the sweep points, then the dial frequency back
+   std::vector<HostTraceRecord> written = points(log);
+   unsigned long wrong = 0;
+   ErrorStats    error;
+
+   if ((int)written.size() < count) {
+      wrong = count - written.size();
+   }
+   for (int ii=0; (ii<count) && (ii<(int)written.size()); ++ii) {
+      long long want = (long long)(SWEEP_START_FREQUENCY + ii * SWEEP_STEP) * 100;
+      if (llabs((long long)written[ii].value - want) >= 100) {
+         ++wrong;
+      }
+      if (ii >= 1) {
+         int64_t ideal = written[1].start + (int64_t)(ii - 1) * dwell;
+         error.add((int64_t)written[ii].start - ideal);
+      }
+   }
+   bool restored = !written.empty()
+                && (written.back().value == (uint64_t)vfoBank.active()->getFrequency() * 100);
+
+   double span = (written.size() >= (size_t)count && count > 2)
+               ? (double)(written[count - 1].start - written[1].start) : 0.0;
+
+   printf("%-18s %5d  %7.1f pts/s  step error p50 %5lld  p99 %5lld  max %5lld us"
+          "  underruns %lu  late %lu us  %s%s",
+          name, count, (span > 0) ? (count - 2) * 1e6 / span : 0.0,
+          (long long)error.percentile(50), (long long)error.percentile(99), (long long)error.percentile(100),
+          underruns, late, wrong ? "WRONG" : "ok", restored ? "" : ", dial NOT restored");
+   if (queries) {
+      printf(", %lu answers", answered);
+   }
+   printf("\n");
+}
+
+/**
+ * starts a repeating sweep, stops it with SW0 and checks the dial
+ * frequency is back on the chip
+ */
+static void stopCase() {
+   std::vector<HostTraceRecord> log;
+
+   host::serialInput(sweepCommand(SWEEP_START_FREQUENCY, SWEEP_START_FREQUENCY + 99 * SWEEP_STEP,
+                                  SWEEP_STEP, 2000, true));
+   uint64_t until = host::now() + 500000;
+   while (host::now() < until) {
+      loop();
+   }
+   host::serialOutput();
+
+   host::setTraceLog(&log);
+   host::serialInput("SW0;SW;");
+   std::string status = answer();
+   host::setTraceLog(0);
+
+   std::vector<HostTraceRecord> written = points(log);
+   bool restored = !written.empty()
+                && (written.back().value == (uint64_t)vfoBank.active()->getFrequency() * 100);
+   printf("%-18s repeat, SW0 after 500 ms: %s, dial %s\n",
+          "stop", status.c_str(), restored ? "restored" : "NOT restored");
+}
+
+/**
+ * checks a dwell under the shortest is refused
+ */
+static void refuseCase() {
+   char name[32];
+   snprintf(name, sizeof(name), "dwell %d us", HOST_SWEEP_MIN_DWELL_MICROS - 100);
+   host::serialInput(sweepCommand(SWEEP_START_FREQUENCY, SWEEP_START_FREQUENCY + 99 * SWEEP_STEP,
+                                  SWEEP_STEP, HOST_SWEEP_MIN_DWELL_MICROS - 100, false));
+   std::string reply = answer();
+   printf("%-18s %s %s\n", name, reply.c_str(), (reply == "?;") ? "refused" : "NOT refused");
+}
+
+static void usage() {
+   fprintf(stderr, "usage: vfo_sweep [-p points per case]\n");
+   exit(2);
+}
+
+int main(int argc, char **argv) {
+   int count = 500;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "p:")) != -1) {
+      switch (opt) {
+         case 'p': count = atoi(optarg);      break;
+         default:  usage();
+      }
+   }
+   if ((optind != argc) || (count < 3) || (count > 3000)) {
+      usage();
+   }
+
+   setup();
+
+   // the display comes up in the first loop passes
+   for (int ii=0; ii<10; ++ii) {
+      loop();
+   }
+
+   static const unsigned long dwells[] = { 10000, 5000, 3000, 2500, 2000 };
+   for (size_t ii=0; ii<sizeof(dwells)/sizeof(dwells[0]); ++ii) {
+      char name[32];
+      snprintf(name, sizeof(name), "dwell %lu us", dwells[ii]);
+      runCase(name, count, dwells[ii], false);
+   }
+   runCase("2000 us + FA;", count, HOST_SWEEP_MIN_DWELL_MICROS, true);
+   refuseCase();
+   stopCase();
+   return 0;
+}
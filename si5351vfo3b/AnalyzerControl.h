@@ -0,0 +1,212 @@
+#ifndef ANALYZERCONTROL_H
+#define ANALYZERCONTROL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions turning a frequency sweep into an
+ * antenna analyzer, built in when USE_ANTENNA_ANALYZER is defined. An
+ * SWR bridge on the selected band's output feeds its forward and
+ * reflected detectors to ANALYZER_FORWARD_PIN and
+ * ANALYZER_REFLECTED_PIN. The SA CAT command, run here for
+ * CATControl.h, runs the sweep:
+ *
+ *    SAsssssssssssppppppppppphhhhhhhddddddd;
+ *                 start and stop in Hz (11 digits), step in Hz (7),
+ *                 dwell in us (7)
+ *
+ * and the points come back as analyzer frames (see FrameParser.h),
+ * one per point, then an end frame. A bad command is answered ?;
+ *
+ * Each Timer1 tick of the sweep first starts the ADC on the point the
+ * output is leaving, which has had a whole dwell to settle, and then
+ * writes the next point; the two conversions run under the I2C write
+ * (DetectorSampler.h). The timer runs one tick past the last point to
+ * sample it. The loop reduces each pair to SWR and sends it, only when
+ * the serial transmit buffer has room for the whole frame, so it
+ * never waits. An 8 byte frame takes 2.08 ms at 38400 baud, which
+ * sets ANALYZER_MIN_DWELL_MICROS: 200 points take half a second.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "DetectorSampler.h"
+#include "FrameParser.h"
+#include "CATParser.h"
+
+/**
+ * shortest dwell - one frame on the serial port, with some to spare
+ */
+#define ANALYZER_MIN_DWELL_MICROS      2500
+
+/**
+ * SA command length, its fields as the SW command's
+ */
+#define CAT_ANALYZER_LENGTH              36
+
+/**
+ * the detectors, on the ADC
+ */
+DetectorSampler detectorSampler(ANALYZER_FORWARD_PIN - A0, ANALYZER_REFLECTED_PIN - A0);
+
+/**
+ * true from the start of an analyzer sweep until its end frame is sent
+ */
+boolean           analyzer_active = false;
+uint16_t          analyzer_points;
+uint16_t          analyzer_sent;
+
+/**
+ * next point to sample, moved on by the timer interrupt
+ */
+volatile uint16_t analyzer_next;
+
+/**
+ * ADC conversion complete
+ */
+ISR(ADC_vect) {
+   detectorSampler.converted(ADC);
+}
+
+/**
+ * starts the readings of the point the output is leaving, called from
+ * the Timer1 interrupt before the next point is written
+ * @return true while there are points left to sample
+ */
+boolean analyzerTick() {
+   if (!sweep_analyzed) {
+      return false;
+   }
+
+   // a tick the ring ran dry left the output where it was
+   uint16_t written = frequencySweep.written();
+   if ((written > analyzer_next) && (written <= analyzer_points)) {
+      detectorSampler.start(written - 1);
+      analyzer_next = written;
+   }
+   return analyzer_next < analyzer_points;
+}
+
+/**
+ * sends an analyzer frame
+ * @param  kind   FRAME_ANALYZER_*
+ * @param  first  first value
+ * @param  second second value
+ */
+void sendAnalyzerFrame(uint8_t kind, uint16_t first, uint16_t second) {
+   uint8_t frame[FRAME_ANALYZER_LENGTH];
+   frame[0] = FRAME_SYNC;
+   frame[1] = kind;
+   frame[2] = (uint8_t)first;
+   frame[3] = (uint8_t)(first >> 8);
+   frame[4] = (uint8_t)second;
+   frame[5] = (uint8_t)(second >> 8);
+   uint16_t sum = FrameParser::crc(frame + 1, FRAME_ANALYZER_LENGTH - 3);
+   frame[6] = (uint8_t)sum;
+   frame[7] = (uint8_t)(sum >> 8);
+   Serial.write(frame, FRAME_ANALYZER_LENGTH);
+}
+
+/**
+ * starts an analyzer sweep of the selected band
+ * @param  start  first frequency in Hz
+ * @param  stop   last frequency in Hz
+ * @param  step   Hz between points
+ * @param  dwell  us on each point
+ * @return false if the sweep is refused
+ */
+boolean startAnalyzer(unsigned long start
+                    , unsigned long stop
+                    , unsigned long step
+                    , unsigned long dwell) {
+   if ((dwell < ANALYZER_MIN_DWELL_MICROS) || !startSweep(start, stop, step, dwell, false)) {
+      return false;
+   }
+
+   // the first tick is a dwell away
+   detectorSampler.begin();
+   analyzer_points = (uint16_t)((stop - start) / step + 1);
+   analyzer_next   = 0;
+   analyzer_sent   = 0;
+   analyzer_active = true;
+   sweep_analyzed  = true;
+   return true;
+}
+
+/**
+ * sends the points sampled so far, and the end frame once the sweep
+ * is over, as far as the serial transmit buffer has room
+ * call once per loop pass
+ */
+void checkAnalyzer() {
+   if (!analyzer_active) {
+      return;
+   }
+
+   DetectorSample sample;
+   while ((Serial.availableForWrite() >= FRAME_ANALYZER_LENGTH) && detectorSampler.take(sample)) {
+      sendAnalyzerFrame(FRAME_ANALYZER_POINT, sample.index, DetectorSampler::swr(sample.forward, sample.reflected));
+      ++analyzer_sent;
+   }
+
+   // over, stopped, or replaced by a plain sweep
+   if (  (!sweep_active || !sweep_analyzed)
+      && !detectorSampler.busy() && !detectorSampler.ready()
+      && (Serial.availableForWrite() >= FRAME_ANALYZER_LENGTH)) {
+      sendAnalyzerFrame(FRAME_ANALYZER_END, analyzer_sent, detectorSampler.dropped());
+      detectorSampler.end();
+      sweep_analyzed  = false;
+      analyzer_active = false;
+   }
+}
+
+/**
+ * runs an SA command, starting an analyzer sweep
+ * @param  parser  holding the command
+ * @return false if the parameters are bad or the sweep is refused
+ */
+boolean runAnalyzerCommand(const CATParser &parser) {
+   unsigned long start, stop, step, dwell;
+
+   return (parser.parameterLength() == CAT_ANALYZER_LENGTH)
+       && parser.number(CAT_SWEEP_START, CAT_FREQUENCY_DIGITS,   start)
+       && parser.number(CAT_SWEEP_STOP,  CAT_FREQUENCY_DIGITS,   stop)
+       && parser.number(CAT_SWEEP_STEP,  CAT_SWEEP_STEP_DIGITS,  step)
+       && parser.number(CAT_SWEEP_DWELL, CAT_SWEEP_DWELL_DIGITS, dwell)
+       && startAnalyzer(start, stop, step, dwell);
+}
+
+/**
+ * runs the command in a parser if it is the analyzer's, SA
+ * @param  parser  holding a whole command
+ * @return false if it is not an analyzer command
+ */
+boolean runAnalyzerCATCommand(const CATParser &parser) {
+   if (!parser.is("SA")) {
+      return false;
+   }
+   if (!runAnalyzerCommand(parser)) {
+      Serial.print(F("?;"));
+   }
+   return true;
+}
+
+#endif // ANALYZERCONTROL_H
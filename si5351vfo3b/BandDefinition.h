@@ -0,0 +1,124 @@
+#ifndef BANDDEFINITION_H
+#define BANDDEFINITION_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the band definition record, and BandReader, which
+ * reads its fields.
+ *
+ * Band tables are declared PROGMEM by the sketch, so they take no SRAM
+ * however many bands there are. A record in flash cannot be read
+ * through a normal pointer on the AVR, so BandReader wraps the flash
+ * address and fetches each field with the pgm_read functions when it
+ * is asked for - nothing is copied into SRAM beyond the field itself.
+ *
+ *    const BandDefinition bands[] PROGMEM = { ... };
+ *    BandReader band(&bands[ii]);
+ *    unsigned long f = band.defaultFrequency();
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+
+/**
+ * one band, held in flash
+ */
+struct BandDefinition {
+   uint32_t   defaultFrequency;    // Hz
+   uint32_t   minFrequency;        // Hz
+   uint32_t   maxFrequency;        // Hz
+   uint64_t   pllFrequency;        // Hz * SI5351_FREQ_MULT
+   uint8_t    clock;               // si5351_clock
+   uint8_t    device;              // chip, index in Si5351Group
+};
+
+/**
+ * This class reads the fields of a band definition in flash
+ */
+class BandReader {
+protected:
+   /**
+    * flash address of the band record
+    */
+   const BandDefinition *mp_band;
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  band  band record in PROGMEM
+    */
+   BandReader(const BandDefinition *band)
+   : mp_band(band)
+   {}
+
+   /**
+    * gets band starting frequency
+    * @return frequency in Hz
+    */
+   unsigned long defaultFrequency() const {
+      return pgm_read_dword(&mp_band->defaultFrequency);
+   }
+
+   /**
+    * gets band lower limit
+    * @return frequency in Hz
+    */
+   unsigned long minFrequency() const {
+      return pgm_read_dword(&mp_band->minFrequency);
+   }
+
+   /**
+    * gets band upper limit
+    * @return frequency in Hz
+    */
+   unsigned long maxFrequency() const {
+      return pgm_read_dword(&mp_band->maxFrequency);
+   }
+
+   /**
+    * gets the PLL frequency the band runs from
+    * @return frequency in Hz * SI5351_FREQ_MULT
+    */
+   unsigned long long pllFrequency() const {
+      uint64_t pll;
+      memcpy_P(&pll, &mp_band->pllFrequency, sizeof(pll));
+      return pll;
+   }
+
+   /**
+    * gets the clock output of the band
+    * @return clock
+    */
+   si5351_clock clock() const {
+      return (si5351_clock)pgm_read_byte(&mp_band->clock);
+   }
+
+   /**
+    * gets the chip the band's clock is on
+    * @return index of chip in group
+    */
+   uint8_t device() const {
+      return pgm_read_byte(&mp_band->device);
+   }
+};
+
+#endif // BANDDEFINITION_H
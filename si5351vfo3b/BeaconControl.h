@@ -0,0 +1,268 @@
+#ifndef BEACONCONTROL_H
+#define BEACONCONTROL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions sending beacon messages in a WSPR or
+ * FT8 style multiple tone FSK mode on the selected band, built in
+ * when USE_FSK_BEACON is defined. The message is loaded and sent with
+ * CAT commands, run here for CATControl.h: BM puts tone numbers into
+ * the message, BE sends the first so many symbols of it from a tone 0
+ * frequency, at a tone spacing and symbol period:
+ *
+ *    BMiiitttt...;  tones of symbols iii (3 digits) onwards, one digit
+ *                 0 to 7 each, up to 32 a command
+ *    BEfffffffffffsssssssppppppphhh;
+ *                 tone 0 in Hz (11 digits), tone spacing in mHz (7),
+ *                 symbol period in us (7), symbols to send (3)
+ *    BE0;         stop
+ *    BE;          BErhhhlllllll;  r 1 while sending, symbols started
+ *                 (3 digits), latest the timer interrupt ran in us (7)
+ *
+ * The message cannot be changed while it is being sent. For WSPR that is
+ * 162 symbols, 1.465 Hz spacing (1465) and 683 ms (682667 us); for
+ * FT8, 79 symbols, 6.25 Hz (6250) and 160 ms (160000 us). The
+ * encoding is left to the computer, and so is starting on the even
+ * minute or the 15 second boundary the modes expect.
+ *
+ * The symbols are timed by the sweep's Timer1 compare interrupt (see
+ * SweepControl.h), with the fraction of a tick carried, so the only
+ * drift is the period rounded to a whole us: 54 us over a WSPR
+ * message. Each tick sends the registers that change between tones,
+ * precomputed (FSKBeacon.h), so a symbol edge lands at the same
+ * short time after its tick every time, whatever the loop is doing.
+ *
+ * As with a sweep, a beacon being sent owns the clock chip bus; the
+ * loop waits it out. It ends after its last symbol, on BE0, a
+ * frequency set or any posted event, and the dial frequency is loaded
+ * back into the clock.
+ */
+
+#include <Arduino.h>
+
+#include "FSKBeacon.h"
+#include "CATParser.h"
+
+/**
+ * BM and BE command fields, offsets in the parameters and widths
+ */
+#define CAT_BEACON_INDEX_DIGITS           3
+#define CAT_BEACON_MAX_TONES             32
+#define CAT_BEACON_FREQUENCY              0
+#define CAT_BEACON_SPACING               11
+#define CAT_BEACON_PERIOD                18
+#define CAT_BEACON_COUNT                 25
+#define CAT_BEACON_LENGTH                28
+#define CAT_BEACON_SPACING_DIGITS         7
+#define CAT_BEACON_PERIOD_DIGITS          7
+
+/**
+ * the message, keyed by the Timer1 compare interrupt
+ */
+FSKBeacon fskBeacon(si5351Devices);
+
+/**
+ * true from the start of a message until the dial frequency is back
+ */
+boolean beacon_active = false;
+
+/**
+ * starts the next symbol, called from the Timer1 interrupt
+ * @return true while there are symbols left
+ */
+boolean beaconTick() {
+   return fskBeacon.step();
+}
+
+/**
+ * ends a message, if one is being sent, and loads the dial frequency
+ * back into the clock
+ */
+void stopBeacon() {
+   if (!beacon_active) {
+      return;
+   }
+   stopSweepTimer();
+   fskBeacon.stop();
+   beacon_active = false;
+
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   vfoBank.active()->loadFrequency();
+}
+
+/**
+ * starts sending the message on the selected band
+ * @param  f        frequency of tone 0 in Hz
+ * @param  spacing  tone spacing in thousandths of a Hz
+ * @param  period   symbol period in us
+ * @param  count    symbols to send
+ * @return false if the band does not cover the tones, the divider
+ *         cannot reach them, or the period or count is out of range
+ */
+boolean startBeacon(unsigned long f
+                  , unsigned long spacing
+                  , unsigned long period
+                  , uint16_t count) {
+   uint8_t band = vfoBank.selected();
+
+   if (  (count == 0) || (count > BEACON_MAX_SYMBOLS)
+      || (period < SWEEP_MIN_DWELL_MICROS) || (period > SWEEP_MAX_DWELL_MICROS)) {
+      return false;
+   }
+   si5351_VFODefinition *vfo = vfoBank.active();
+   unsigned long top = f + ((fskBeacon.toneCount(count) - 1) * spacing + 999) / 1000;
+   if (  !vfoBank.covers(band, f) || !vfoBank.covers(band, top)
+      || !Si5351Group::reaches(vfo->getPllFrequency(), f)
+      || !Si5351Group::reaches(vfo->getPllFrequency(), top)) {
+      return false;
+   }
+
+   stopBeacon();
+   if (sweep_active) {
+      stopSweep();
+   }
+#ifdef USE_MEMORY_SCAN
+   stopScan();
+#endif
+
+   fskBeacon.begin(vfo->getDevice()
+                 , vfo->getClock()
+                 , vfo->getPllFrequency()
+                 , f
+                 , spacing
+                 , count);
+
+   // first symbol now, the rest one per period
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   fskBeacon.step();
+   startSweepTimer(period);
+   beacon_active = true;
+   return true;
+}
+
+/**
+ * ends the message when it is done or an event has been posted
+ * call once per loop pass
+ * @return true while the message is being sent and owns the bus
+ */
+boolean checkBeacon() {
+   if (!beacon_active) {
+      return false;
+   }
+   if (sweep_timer_running && vfoEvents.isEmpty()) {
+      return true;
+   }
+
+   stopBeacon();
+   return false;
+}
+
+/**
+ * runs a BM command, putting tones into the beacon message
+ * @param  parser  holding the command
+ * @return false if the parameters are bad, or the beacon is running
+ */
+boolean runBeaconMessageCommand(const CATParser &parser) {
+   unsigned long index, tone;
+   uint8_t       tones = parser.parameterLength() - CAT_BEACON_INDEX_DIGITS;
+
+   if (  beacon_active
+      || (parser.parameterLength() <= CAT_BEACON_INDEX_DIGITS) || (tones > CAT_BEACON_MAX_TONES)
+      || !parser.number(0, CAT_BEACON_INDEX_DIGITS, index)) {
+      return false;
+   }
+
+   // check them all before taking any
+   for (uint8_t ii=0; ii<tones; ++ii) {
+      if (  !parser.number(CAT_BEACON_INDEX_DIGITS + ii, 1, tone)
+         || (tone >= BEACON_MAX_TONES) || (index + ii >= BEACON_MAX_SYMBOLS)) {
+         return false;
+      }
+   }
+   for (uint8_t ii=0; ii<tones; ++ii) {
+      parser.number(CAT_BEACON_INDEX_DIGITS + ii, 1, tone);
+      fskBeacon.setSymbol(index + ii, tone);
+   }
+   return true;
+}
+
+/**
+ * runs a BE command with parameters: stops, or starts the beacon
+ * @param  parser  holding the command
+ * @return false if the parameters are bad or the beacon is refused
+ */
+boolean runBeaconCommand(const CATParser &parser) {
+   unsigned long f, spacing, period, count;
+
+   if (parser.parameterLength() == 1) {
+      if (!parser.number(count) || (count != 0)) {
+         return false;
+      }
+      stopBeacon();
+      return true;
+   }
+
+   return (parser.parameterLength() == CAT_BEACON_LENGTH)
+       && parser.number(CAT_BEACON_FREQUENCY, CAT_FREQUENCY_DIGITS,      f)
+       && parser.number(CAT_BEACON_SPACING,   CAT_BEACON_SPACING_DIGITS, spacing)
+       && parser.number(CAT_BEACON_PERIOD,    CAT_BEACON_PERIOD_DIGITS,  period)
+       && parser.number(CAT_BEACON_COUNT,     CAT_BEACON_INDEX_DIGITS,   count)
+       && startBeacon(f, spacing, period, (uint16_t)count);
+}
+
+/**
+ * sends the beacon status answer
+ */
+void sendBeaconStatus() {
+   Serial.print(F("BE"));
+   Serial.write((beacon_active && sweep_timer_running) ? '1' : '0');
+   sendCATDigits(fskBeacon.sent(),  CAT_BEACON_INDEX_DIGITS);
+   sendCATDigits(sweepLateMicros(), CAT_BEACON_PERIOD_DIGITS);
+   Serial.write(';');
+}
+
+/**
+ * runs the command in a parser if it is the beacon's, BM or BE, and
+ * answers it
+ * @param  parser  holding a whole command
+ * @return false if it is not a beacon command
+ */
+boolean runBeaconCATCommand(const CATParser &parser) {
+   if (parser.is("BM")) {
+      if (!runBeaconMessageCommand(parser)) {
+         Serial.print(F("?;"));
+      }
+   }
+   else if (parser.is("BE")) {
+      if (parser.parameterLength() == 0) {
+         sendBeaconStatus();
+      }
+      else if (!runBeaconCommand(parser)) {
+         Serial.print(F("?;"));
+      }
+   }
+   else {
+      return false;
+   }
+   return true;
+}
+
+#endif // BEACONCONTROL_H
@@ -0,0 +1,588 @@
+#ifndef CATCONTROL_H
+#define CATCONTROL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions implementing CAT control over the
+ * serial port, built in when USE_CAT_CONTROL is defined. The VFO
+ * answers a subset of the Kenwood TS-480 command set, enough for
+ * logging and digital mode programs (hamlib model 2028, flrig) to
+ * read and set the frequency:
+ *
+ *    ID;          ID020;                 radio is a TS-480
+ *    FA; FB;      FA00007055000;         frequency in Hz, 11 digits
+ *    FAnnnnnnnnnnn;                      set frequency
+ *    IF;          IF00007055000...;      status, 38 characters
+ *    MD; AI; PS; FR; FT;                 fixed answers, sets ignored
+ *
+ * The VFO has one running frequency, so FA and FB both read and set
+ * it. A frequency outside the selected band switches to the band that
+ * covers it; one no band covers is refused with ?; as is anything not
+ * understood.
+ *
+ * Bytes are taken off the serial receive buffer a few per loop pass
+ * and fed to a CATParser, so no pass waits for a command to finish
+ * arriving. A new frequency is loaded into the clock at once and the
+ * state saved once things go quiet, as for a turn of the encoder. The
+ * display is not repainted until no frequency has been set for
+ * CAT_REPAINT_IDLE_MILS: a full paint of the OLED takes longer than
+ * the 63 byte serial receive buffer lasts at 38400 baud (16 ms), so a
+ * paint after every set would lose bytes from a program streaming
+ * sets without waiting for answers. With idle sleep a byte arriving
+ * ends the wait between loop passes, as an encoder step does, so
+ * answers go out within a pass or two.
+ *
+ * With USE_FREQUENCY_STREAM defined, binary frequency frames (see
+ * FrameParser.h) are taken on the same port, for sweeps and hopping
+ * tests driven from a computer. A frame names its band and goes
+ * straight to the clock, with the repaint held back in the same way.
+ * Frames can be sent back to back: at 38400 baud, 9 bytes a frame,
+ * that is about 420 frames a second. The core's interrupt driven
+ * receive buffer is the frame ring; it holds 7 frames, enough to
+ * ride out a loop pass.
+ *
+ * The optional features parse and answer their own commands, and
+ * each command is offered to them first:
+ *
+ *    SW           USE_FREQUENCY_SWEEP,   timed sweeps of the selected
+ *                                        band (see SweepControl.h)
+ *    SA           USE_ANTENNA_ANALYZER,  sweeps with SWR readings
+ *                                        (see AnalyzerControl.h)
+ *    BM BE        USE_FSK_BEACON,        FSK beacon messages (see
+ *                                        BeaconControl.h)
+ *    MW MR MC SC  USE_MEMORY_SCAN,       memory channels and scans
+ *                                        (see ScanControl.h)
+ *
+ * A frequency set, command or frame, ends a running sweep, beacon or
+ * scan.
+ *
+ * RIT and XIT share one offset, as on the TS-480 (see VFODefinition.h):
+ *
+ *    RT; XT;      RT0;                   RIT, XIT off or on
+ *    RT0; RT1; XT0; XT1;                 turn RIT, XIT off or on
+ *    RC;                                 clear the offset
+ *    RU; RD;                             offset up, down 10 Hz
+ *    RUnnnnn; RDnnnnn;                   offset up, down n Hz, held
+ *                                        to +-9999
+ *    TX; RX;                             transmit, receive: the
+ *                                        offset follows XIT or RIT
+ *
+ * The offset goes to the clock without working out its dividers
+ * again, a write of a few bytes, and the IF answer carries it with
+ * the RIT, XIT and transmit flags. The display heading shows it while
+ * RIT or XIT is on. A change of offset ends a sweep or beacon.
+ *
+ * The crystal correction of the unit (see Si5351Group.h) is read and
+ * set with two commands of this VFO's own, saved in EEPROM at once:
+ *
+ *    CL;          CL+001234;             correction in parts per
+ *                                        billion, + when the crystal
+ *                                        runs fast
+ *    CL+nnnnnn; CL-nnnnnn;               set it, to +-200000
+ *    CMfffffffffffhh;                    calibrate: the frequency
+ *                                        measured on the selected
+ *                                        output, Hz (11 digits) and
+ *                                        hundredths (2)
+ *
+ * For CM, tune the output to a frequency a counter or a zero beat
+ * with a standard can measure, say 10 MHz against WWV, and send what
+ * was measured. The correction is worked out from the error of that
+ * against the frequency asked for, with the correction already in
+ * use taken into account, so CM can be repeated to close in.
+ */
+
+#include <Arduino.h>
+#include "CATParser.h"
+#ifdef USE_FREQUENCY_STREAM
+#include "FrameParser.h"
+#endif
+
+/**
+ * serial port speed - the TS-480 menu allows 4800 to 57600
+ */
+#define CAT_BAUD_RATE                 38400
+
+/**
+ * most bytes taken off the receive buffer per loop pass
+ */
+#define CAT_BYTES_PER_PASS               16
+
+/**
+ * fixed answers
+ */
+#define CAT_RADIO_ID                  "020"      // TS-480
+#define CAT_MODE                        "3"      // CW
+
+/**
+ * CL and CM command fields
+ */
+#define CAT_CORRECTION_DIGITS             6
+#define CAT_MEASURED_FRACTION            11
+#define CAT_MEASURED_LENGTH              13
+
+/**
+ * RU and RD: step without an amount, width of the amount
+ */
+#define CAT_OFFSET_STEP                  10
+#define CAT_OFFSET_DIGITS                 5
+
+/**
+ * time without a frequency set before the display is repainted
+ */
+#define CAT_REPAINT_IDLE_MILS           100
+
+/**
+ * the command being received
+ */
+CATParser catParser;
+
+#ifdef USE_FREQUENCY_STREAM
+/**
+ * the frame being received
+ */
+FrameParser frameParser;
+#endif
+
+/**
+ * repaint held back while frequencies are being set
+ */
+boolean       cat_repaint = false;
+unsigned long cat_set_time;
+
+/**
+ * ends a running sweep, beacon or scan, which own the clock, before
+ * the VFO is changed
+ */
+void stopCATTimed() {
+#ifdef USE_FREQUENCY_SWEEP
+   if (sweep_active) {
+      stopSweep();
+   }
+#endif
+#ifdef USE_FSK_BEACON
+   stopBeacon();
+#endif
+#ifdef USE_MEMORY_SCAN
+   stopScan();
+#endif
+}
+
+/**
+ * tunes a band, selecting it first if it is not the selected band,
+ * and holds back the repaint until sets stop coming
+ * @param  band  band to tune
+ * @param  f     frequency in Hz, within the band limits
+ */
+void setBandFrequency(uint8_t band, unsigned long f) {
+   boolean changed = false;
+
+   stopCATTimed();
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   if (band != vfoBank.selected()) {
+      vfoBank.select(band, f);
+      changed = true;
+   }
+   else if (vfoBank.active()->getFrequency() != f) {
+      vfoBank.active()->setFrequency(f);
+      vfoBank.active()->loadFrequency();
+      changed = true;
+   }
+
+   if (changed) {
+      noteStateChange();
+      cat_repaint = true;
+   }
+   cat_set_time = millis();
+}
+
+/**
+ * sets the VFO frequency from a CAT command, switching band if
+ * the selected one does not cover it
+ * @param  f  frequency in Hz
+ * @return false if no band covers the frequency
+ */
+boolean setCATFrequency(unsigned long f) {
+   uint8_t band = vfoBank.bandFor(f);
+   if (band == VFOBANK_NO_BAND) {
+      return false;
+   }
+
+   setBandFrequency(band, f);
+   return true;
+}
+
+/**
+ * sets the RIT/XIT offset and flags, loads them into the clock and
+ * holds back the repaint as for a frequency set
+ * @param  hz     offset in Hz, held to VFO_OFFSET_MAX
+ * @param  flags  VFO_OFFSET_* flags
+ */
+void setCATOffset(long hz, uint8_t flags) {
+   si5351_VFODefinition *vfo = vfoBank.active();
+
+   if (hz > VFO_OFFSET_MAX) {
+      hz = VFO_OFFSET_MAX;
+   }
+   else if (hz < -VFO_OFFSET_MAX) {
+      hz = -VFO_OFFSET_MAX;
+   }
+
+   stopCATTimed();
+   if ((hz != vfo->getOffset()) || (flags != vfo->getOffsetFlags())) {
+      vfo->setOffset(hz);
+      vfo->setOffsetFlags(flags);
+      stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+      vfoBank.loadOffset();
+      cat_repaint = true;
+   }
+   cat_set_time = millis();
+}
+
+/**
+ * runs a RIT/XIT command: RT, XT, RC, RU, RD, TX or RX
+ * @return false if the parameters are bad
+ */
+boolean runOffsetCommand() {
+   si5351_VFODefinition *vfo = vfoBank.active();
+   long          hz    = vfo->getOffset();
+   uint8_t       flags = vfo->getOffsetFlags();
+   unsigned long value = CAT_OFFSET_STEP;
+
+   if (catParser.is("RT") || catParser.is("XT")) {
+      uint8_t flag = catParser.is("RT") ? VFO_OFFSET_RIT : VFO_OFFSET_XIT;
+      if (!catParser.number(value) || (value > 1)) {
+         return false;
+      }
+      flags = value ? (flags | flag) : (flags & ~flag);
+   }
+   else if (catParser.is("RC")) {
+      hz = 0;
+   }
+   else if (catParser.is("RU") || catParser.is("RD")) {
+      if (  (catParser.parameterLength() != 0)
+         && (  (catParser.parameterLength() != CAT_OFFSET_DIGITS)
+            || !catParser.number(value))) {
+         return false;
+      }
+      if (value > 2 * VFO_OFFSET_MAX) {
+         value = 2 * VFO_OFFSET_MAX;
+      }
+      hz += catParser.is("RU") ? (long)value : -(long)value;
+   }
+   else if (catParser.is("TX")) {
+      flags |= VFO_OFFSET_TRANSMIT;
+   }
+   else {
+      flags &= ~VFO_OFFSET_TRANSMIT;
+   }
+
+   setCATOffset(hz, flags);
+   return true;
+}
+
+/**
+ * sends the RT or XT answer
+ */
+void sendOffsetFlag() {
+   uint8_t flag = catParser.is("RT") ? VFO_OFFSET_RIT : VFO_OFFSET_XIT;
+   Serial.print(catParser.is("RT") ? F("RT") : F("XT"));
+   Serial.write((vfoBank.active()->getOffsetFlags() & flag) ? '1' : '0');
+   Serial.write(';');
+}
+
+/**
+ * sets the crystal correction, ending a sweep or beacon first as PLL
+ * A is written again
+ * @param  ppb  correction in parts per billion
+ * @return false if it is out of range
+ */
+boolean setCATCalibration(long ppb) {
+   if ((ppb < -SI5351_GROUP_MAX_CORRECTION) || (ppb > SI5351_GROUP_MAX_CORRECTION)) {
+      return false;
+   }
+   stopCATTimed();
+   return setCalibration(ppb);
+}
+
+/**
+ * runs a CL command with parameters, setting the crystal correction
+ * @return false if the parameters are bad or out of range
+ */
+boolean runCorrectionCommand() {
+   unsigned long ppb;
+   char          sign = catParser.parameter(0);
+
+   return (catParser.parameterLength() == 1 + CAT_CORRECTION_DIGITS)
+       && ((sign == '+') || (sign == '-'))
+       && catParser.number(1, CAT_CORRECTION_DIGITS, ppb)
+       && setCATCalibration((sign == '-') ? -(long)ppb : (long)ppb);
+}
+
+/**
+ * runs a CM command: works out the crystal correction from the
+ * frequency measured on the selected output, and sets it
+ * @return false if the parameters are bad, or the correction comes
+ *         out of range
+ */
+boolean runMeasuredCommand() {
+   unsigned long hz, hundredths;
+
+   if (  (catParser.parameterLength() != CAT_MEASURED_LENGTH)
+      || !catParser.number(0,                     CAT_FREQUENCY_DIGITS, hz)
+      || !catParser.number(CAT_MEASURED_FRACTION, 2,                    hundredths)) {
+      return false;
+   }
+
+   // out / asked = (1 + true error) / (1 + correction in use)
+   long long asked    = (long long)vfoBank.active()->getOutputFrequency() * SI5351_FREQ_MULT;
+   long long measured = (long long)hz * SI5351_FREQ_MULT + hundredths;
+   long long inUse    = si5351Devices.getCorrection();
+   long long error    = measured - asked;
+   if ((error < -asked / 1000) || (error > asked / 1000)) {
+      return false;
+   }
+   long long scaled = error * (1000000000LL + inUse);
+   scaled += (scaled < 0) ? -asked / 2 : asked / 2;
+   return setCATCalibration((long)(inUse + scaled / asked));
+}
+
+/**
+ * sends the CL answer
+ */
+void sendCorrection() {
+   long ppb = si5351Devices.getCorrection();
+   Serial.print(F("CL"));
+   Serial.write((ppb < 0) ? '-' : '+');
+   sendCATDigits((ppb < 0) ? -ppb : ppb, CAT_CORRECTION_DIGITS);
+   Serial.write(';');
+}
+
+/**
+ * hands the command in the parser to the optional features built in
+ * @return true if one of them took it, and answered it
+ */
+boolean runFeatureCATCommand() {
+#ifdef USE_FREQUENCY_SWEEP
+   if (runSweepCATCommand(catParser)) {
+      return true;
+   }
+#endif
+#ifdef USE_ANTENNA_ANALYZER
+   if (runAnalyzerCATCommand(catParser)) {
+      return true;
+   }
+#endif
+#ifdef USE_FSK_BEACON
+   if (runBeaconCATCommand(catParser)) {
+      return true;
+   }
+#endif
+#ifdef USE_MEMORY_SCAN
+   if (runScanCATCommand(catParser)) {
+      return true;
+   }
+#endif
+   return false;
+}
+
+/**
+ * runs the command in the parser and sends its answer
+ */
+void runCATCommand() {
+   boolean       query = (catParser.parameterLength() == 0);
+   unsigned long value;
+
+   if (runFeatureCATCommand()) {
+      return;
+   }
+
+   if (catParser.is("FA") || catParser.is("FB")) {
+      if (query) {
+         Serial.print(catParser.is("FA") ? F("FA") : F("FB"));
+         sendCATDigits(vfoBank.active()->getFrequency(), CAT_FREQUENCY_DIGITS);
+         Serial.write(';');
+      }
+      else if (!catParser.number(value) || !setCATFrequency(value)) {
+         Serial.print(F("?;"));
+      }
+   }
+   else if (catParser.is("IF") && query) {
+      // frequency, step, RIT/XIT offset and flags, memory channel,
+      // receive or transmit, mode, VFO A, no scan, split or tone
+      si5351_VFODefinition *vfo = vfoBank.active();
+      long    offset = vfo->getOffset();
+      uint8_t flags  = vfo->getOffsetFlags();
+      Serial.print(F("IF"));
+      sendCATDigits(vfo->getFrequency(), CAT_FREQUENCY_DIGITS);
+      Serial.print(F("     "));
+      Serial.write((offset < 0) ? '-' : '+');
+      sendCATDigits((offset < 0) ? -offset : offset, CAT_OFFSET_DIGITS - 1);
+      Serial.write((flags & VFO_OFFSET_RIT) ? '1' : '0');
+      Serial.write((flags & VFO_OFFSET_XIT) ? '1' : '0');
+      Serial.print(F("000"));
+      Serial.write((flags & VFO_OFFSET_TRANSMIT) ? '1' : '0');
+      Serial.print(F(CAT_MODE "000000 ;"));
+   }
+   else if (catParser.is("CL")) {
+      if (query) {
+         sendCorrection();
+      }
+      else if (!runCorrectionCommand()) {
+         Serial.print(F("?;"));
+      }
+   }
+   else if (catParser.is("CM")) {
+      if (!runMeasuredCommand()) {
+         Serial.print(F("?;"));
+      }
+   }
+   else if ((catParser.is("RT") || catParser.is("XT")) && query) {
+      sendOffsetFlag();
+   }
+   else if (  catParser.is("RT") || catParser.is("XT") || catParser.is("RC")
+           || catParser.is("RU") || catParser.is("RD")
+           || catParser.is("TX") || catParser.is("RX")) {
+      if (!runOffsetCommand()) {
+         Serial.print(F("?;"));
+      }
+   }
+   else if (catParser.is("ID") && query) {
+      Serial.print(F("ID" CAT_RADIO_ID ";"));
+   }
+   else if (catParser.is("MD")) {
+      if (query) {
+         Serial.print(F("MD" CAT_MODE ";"));
+      }
+   }
+   else if (catParser.is("AI")) {
+      if (query) {
+         Serial.print(F("AI0;"));
+      }
+   }
+   else if (catParser.is("PS")) {
+      if (query) {
+         Serial.print(F("PS1;"));
+      }
+   }
+   else if (catParser.is("FR") || catParser.is("FT")) {
+      if (query) {
+         Serial.print(catParser.is("FR") ? F("FR0;") : F("FT0;"));
+      }
+   }
+   else {
+      Serial.print(F("?;"));
+   }
+}
+
+#ifdef USE_FREQUENCY_STREAM
+/**
+ * sends the answer to a frame
+ * @param  status    FRAME_STATUS_*
+ * @param  sequence  sequence number of the frame
+ */
+void sendFrameAnswer(uint8_t status, uint8_t sequence) {
+   uint8_t answer[FRAME_ANSWER_LENGTH];
+   answer[0] = FRAME_SYNC;
+   answer[1] = status;
+   answer[2] = sequence;
+   uint16_t sum = FrameParser::crc(answer + 1, 2);
+   answer[3] = (uint8_t)sum;
+   answer[4] = (uint8_t)(sum >> 8);
+   Serial.write(answer, FRAME_ANSWER_LENGTH);
+}
+
+/**
+ * runs the frame in the parser - tunes its band - and answers it if
+ * asked, or if it could not be run
+ */
+void runFrame() {
+   uint8_t       band   = frameParser.channel();
+   unsigned long f      = frameParser.frequency();
+   uint8_t       status = FRAME_STATUS_REJECTED;
+
+   if ((band < vfoBank.count()) && vfoBank.covers(band, f)) {
+      setBandFrequency(band, f);
+      status = FRAME_STATUS_OK;
+   }
+
+   if (frameParser.wantsAnswer() || (status != FRAME_STATUS_OK)) {
+      sendFrameAnswer(status, frameParser.sequence());
+   }
+}
+#endif
+
+/**
+ * reads and runs CAT commands and frames from the serial port
+ * call once per loop pass
+ */
+void checkCATCommands() {
+   for (uint8_t ii=0; (ii<CAT_BYTES_PER_PASS) && (Serial.available() > 0); ++ii) {
+      uint8_t c = Serial.read();
+
+#ifdef USE_FREQUENCY_STREAM
+      if (frameParser.takes(c)) {
+         if (frameParser.feed(c) == FRAME_PARSE_FRAME) {
+            runFrame();
+         }
+         continue;
+      }
+#endif
+
+      switch (catParser.feed(c)) {
+         case CAT_PARSE_COMMAND:
+            runCATCommand();
+            catParser.next();
+            break;
+
+         case CAT_PARSE_ERROR:
+            Serial.print(F("?;"));
+            break;
+      }
+   }
+
+   // sets have stopped - show where they left the VFO
+   if (cat_repaint && ((millis() - cat_set_time) >= CAT_REPAINT_IDLE_MILS)) {
+      cat_repaint = false;
+      vfoEvents.postOnce(EVENT_FREQUENCY_CHANGED);
+   }
+}
+
+/**
+ * checks for bytes waiting in the serial receive buffer
+ */
+inline boolean catInputWaiting() {
+   return Serial.available() > 0;
+}
+
+/**
+ * checks for CAT input not yet handled, whole or part command or
+ * frame, or a repaint held back
+ */
+inline boolean catHasPendingWork() {
+   return catInputWaiting()
+       || catParser.partial()
+#ifdef USE_FREQUENCY_STREAM
+       || frameParser.partial()
+#endif
+       || cat_repaint;
+}
+
+#endif // CATCONTROL_H
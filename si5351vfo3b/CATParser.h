@@ -0,0 +1,208 @@
+#ifndef CATPARSER_H
+#define CATPARSER_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class CATParser, which splits a stream of bytes
+ * into Kenwood style CAT commands: two letters, parameters, and a
+ * semicolon, as in FA00007055000; or ID;
+ *
+ * Bytes are fed in one at a time as they come off the serial port,
+ * so a command may arrive over any number of loop passes. Nothing is
+ * allocated: the command is collected in a fixed buffer, and one too
+ * long for it is thrown away up to its semicolon and reported as bad.
+ * Carriage returns and line feeds between commands are skipped, so
+ * the VFO can be driven by hand from a terminal.
+ *
+ * sendCATDigits() writes the fixed width numbers the answers are made
+ * of. CATControl.h runs the commands common to every build, and each
+ * optional feature runs its own (see SweepControl.h, ScanControl.h).
+ */
+
+#include <Arduino.h>
+
+/**
+ * longest command kept, letters and parameters - CM plus 13 digits,
+ * or SW plus its 37 with sweeps built in
+ */
+#ifdef USE_FREQUENCY_SWEEP
+#define CAT_COMMAND_LENGTH               39
+#else
+#define CAT_COMMAND_LENGTH               15
+#endif
+
+/**
+ * width of a frequency in Hz, in commands and answers
+ */
+#define CAT_FREQUENCY_DIGITS             11
+
+/**
+ * result of feeding a byte
+ */
+#define CAT_PARSE_MORE                   0    // command not finished
+#define CAT_PARSE_COMMAND                1    // a command is ready
+#define CAT_PARSE_ERROR                  2    // a bad command was dropped
+
+/**
+ * This class collects CAT commands from a byte stream
+ */
+class CATParser {
+protected:
+   /**
+    * command so far, without the semicolon
+    */
+   char     mc_buffer[CAT_COMMAND_LENGTH];
+   uint8_t  mc_length;
+
+   /**
+    * set when the command has outgrown the buffer
+    */
+   boolean  mb_overflow;
+
+public:
+   /**
+    * Constructor
+    */
+   CATParser()
+   : mc_length(0)
+   , mb_overflow(false)
+   {}
+
+   /**
+    * takes the next byte of the stream
+    * @param  c  byte read from the port
+    * @return CAT_PARSE_COMMAND when a command is ready to be read,
+    *         CAT_PARSE_ERROR when a bad one was dropped,
+    *         otherwise CAT_PARSE_MORE
+    */
+   uint8_t feed(char c) {
+      if (c == ';') {
+         boolean bad = mb_overflow || (mc_length < 2);
+         mb_overflow = false;
+         if (bad) {
+            mc_length = 0;
+            return CAT_PARSE_ERROR;
+         }
+         return CAT_PARSE_COMMAND;
+      }
+
+      if ((c == '\r') || (c == '\n')) {
+         return CAT_PARSE_MORE;
+      }
+
+      if (mc_length >= CAT_COMMAND_LENGTH) {
+         mb_overflow = true;
+      }
+      else {
+         // command letters are case blind, from a terminal
+         if ((mc_length < 2) && (c >= 'a') && (c <= 'z')) {
+            c -= 'a' - 'A';
+         }
+         mc_buffer[mc_length++] = c;
+      }
+      return CAT_PARSE_MORE;
+   }
+
+   /**
+    * clears the finished command, call once it has been handled
+    */
+   void next() {
+      mc_length = 0;
+   }
+
+   /**
+    * checks for part of a command waiting for more bytes
+    */
+   boolean partial() const {
+      return (mc_length != 0) || mb_overflow;
+   }
+
+   /**
+    * checks the command letters
+    * @param  name  two letter command
+    */
+   boolean is(const char *name) const {
+      return (mc_buffer[0] == name[0]) && (mc_buffer[1] == name[1]);
+   }
+
+   /**
+    * gets the number of parameter characters
+    */
+   uint8_t parameterLength() const {
+      return mc_length - 2;
+   }
+
+   /**
+    * gets one parameter character
+    * @param  index  offset in the parameters, below parameterLength()
+    */
+   char parameter(uint8_t index) const {
+      return mc_buffer[2 + index];
+   }
+
+   /**
+    * reads the parameters as a decimal number
+    * @param  value  set to the number
+    * @return false if there are none, they are not all digits,
+    *         or the number does not fit
+    */
+   boolean number(unsigned long &value) const {
+      return number(0, parameterLength(), value);
+   }
+
+   /**
+    * reads a fixed width field of the parameters as a decimal number
+    * @param  first   offset of the field in the parameters
+    * @param  digits  width of the field
+    * @param  value   set to the number
+    * @return false if the field is empty or runs past the parameters,
+    *         is not all digits, or the number does not fit
+    */
+   boolean number(uint8_t first, uint8_t digits, unsigned long &value) const {
+      if ((mc_length <= 2) || (digits == 0) || (first + digits > parameterLength())) {
+         return false;
+      }
+      value = 0;
+      for (uint8_t ii=2+first; ii<2+first+digits; ++ii) {
+         if ((mc_buffer[ii] < '0') || (mc_buffer[ii] > '9') || (value > 429496728UL)) {
+            return false;
+         }
+         value = value * 10 + (mc_buffer[ii] - '0');
+      }
+      return true;
+   }
+};
+
+/**
+ * sends a number as fixed width decimal, zero filled
+ * @param  value   number to send
+ * @param  digits  width, up to CAT_FREQUENCY_DIGITS
+ */
+void sendCATDigits(unsigned long value, uint8_t digits) {
+   char buf[CAT_FREQUENCY_DIGITS];
+   for (int8_t ii=digits-1; ii>=0; --ii) {
+      buf[ii] = '0' + (value % 10);
+      value /= 10;
+   }
+   Serial.write((const uint8_t *)buf, digits);
+}
+
+#endif // CATPARSER_H
@@ -0,0 +1,370 @@
+#ifndef CYCLEBENCHMARK_H
+#define CYCLEBENCHMARK_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the on-target cycle benchmarks, built in when
+ * USE_CYCLE_BENCHMARK is defined in the sketch. At the end of setup()
+ * each hot path kernel is run a number of times on the board itself,
+ * timed in CPU cycles with Timer1, and a table is printed on Serial:
+ *
+ * - digitalRead() against FastPin<N>::read() on an encoder pin
+ * - a debounced button read, SimpleDigitalInputPin through
+ *   digitalRead() against the PolicyDigitalInputPin<FastPin<N>> the
+ *   sketch uses
+ * - encoder decode, the interrupt handler for one pin
+ * - frequency step, increaseFrequency / decreaseFrequency
+ * - divider solve and load, loadFrequency(): Si5351Group::multisynth()
+ *   and the one write of the block, so this includes the register
+ *   write at the Wire clock
+ * - a whole tuning step, updateSelectedFrequencyValue()
+ * - band switch, VFOBank::select() to the next band
+ * - frequency formatting, VFODisplay::formatFrequencyMHz()
+ * - one display frame, showVFOs()
+ *
+ * Above the table it prints the time from start up to RF on, taken
+ * by setupSI5351(). This counts from the sketch starting, after the
+ * bootloader.
+ *
+ * Timer1 runs at the CPU clock, with its overflow interrupt extending
+ * the count to 32 bits. The cost of reading the counter is measured
+ * first and taken off every result. Interrupts stay on, since Wire
+ * needs them, so the millis() tick and the TWI interrupt land in some
+ * repetitions: the minimum is the clean cost of the code, the mean
+ * what it costs in practice. Serial is flushed before each kernel so
+ * its transmit interrupt is quiet while timing.
+ *
+ * The debounce delay in the external interrupt encoder handlers is
+ * part of the handler, and shows up as about 16000 cycles. Build with
+ * USE_PIN_CHANGE_ENCODER to time the pin change decoder instead.
+ *
+ * Every band is marked disabled while the kernels run, so the band
+ * switch and the loads change dividers behind outputs that stay off,
+ * and no band comes up on its output. The band switch therefore times
+ * the stop, the load and the flushes, but not an output enable write
+ * of its own. The benchmarks then put back the enabled flags and the
+ * selected band, which turns the operating output on again, and stop
+ * Timer1 before the sketch carries on.
+ *
+ * The display frame is timed on the display as the sketch runs it,
+ * so setup() brings the display up first, by running the display
+ * start event it posted.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#ifndef __AVR__
+#error "CycleBenchmark.h times AVR cycles and only builds for the board"
+#endif
+
+#define CYCLE_BENCHMARK_REPETITIONS       64
+#define CYCLE_BENCHMARK_FRAME_REPETITIONS 8
+
+/**
+ * Timer1 overflows since the benchmarks started
+ */
+volatile uint16_t cycle_benchmark_overflows;
+
+/**
+ * service Timer1 overflow, extending the count
+ */
+ISR(TIMER1_OVF_vect) {
+   ++cycle_benchmark_overflows;
+}
+
+/**
+ * reads the 32 bit cycle count
+ * An overflow pending but not yet serviced is counted here, if the
+ * counter wrapped before it was read.
+ */
+unsigned long readCycleCount() {
+   uint8_t  sreg = SREG;
+   cli();
+   uint16_t count     = TCNT1;
+   uint16_t overflows = cycle_benchmark_overflows;
+   if ((TIFR1 & _BV(TOV1)) && (count < 0x8000)) {
+      ++overflows;
+   }
+   SREG = sreg;
+   return ((unsigned long)overflows << 16) | count;
+}
+
+/**
+ * This class opens up the protected frequency formatting
+ * It shows no band lines, but the base class still sizes its window
+ * from the bank.
+ */
+class CycleBenchmarkFormat : public VFODisplay {
+public:
+   CycleBenchmarkFormat()
+   : VFODisplay(&vfoBank, 0, NO_HEADING)
+   {}
+
+   void format(unsigned long f) {
+      ml_freq = f;
+      formatFrequencyMHz();
+   }
+
+   virtual void showVFOs(unsigned long f_delta, short currentVFO) {}
+   virtual void showFreqDeltaDisplay(unsigned long f_delta) {}
+};
+
+CycleBenchmarkFormat cycleBenchmarkFormat;
+
+/**
+ * the band button again, read through digitalRead()
+ */
+SimpleDigitalInputPin cycleBenchmarkButton( VFO_SELECTOR_PIN
+                                          , INPUT_PULLUP
+                                          , BUTTON_DEBOUNCE_WAIT_MILS
+                                          , DIGITAL_PIN_INIT_STATE_HIGH
+                                          , DIGITAL_PIN_INVERTING);
+
+/**
+ * kernels, each given its repetition number
+ */
+void cycleKernelEmpty(uint16_t rep) {
+}
+
+void cycleKernelDigitalRead(uint16_t rep) {
+   digitalRead(ENCODER_PIN_A);
+}
+
+void cycleKernelFastPinRead(uint16_t rep) {
+   FastPin<ENCODER_PIN_A>::read();
+}
+
+void cycleKernelButtonRead(uint16_t rep) {
+   cycleBenchmarkButton.determinePinState();
+}
+
+void cycleKernelButtonFastPin(uint16_t rep) {
+   VFOSelectPin.determinePinState();
+}
+
+void cycleKernelEncoderDecode(uint16_t rep) {
+#ifdef USE_PIN_CHANGE_ENCODER
+   PinChangeEncoder::serviceGroup(digitalPinToPCICRbit(ENCODER_PIN_A));
+#else
+   encoderPinA_ISR();
+#endif
+}
+
+void cycleKernelFrequencyStep(uint16_t rep) {
+   if (rep & 1) {
+      vfoBank.active()->decreaseFrequency(frequency_delta);
+   }
+   else {
+      vfoBank.active()->increaseFrequency(frequency_delta);
+   }
+}
+
+void cycleKernelLoadFrequency(uint16_t rep) {
+   vfoBank.active()->loadFrequency();
+}
+
+void cycleKernelTuningStep(uint16_t rep) {
+   encoder_movement = (rep & 1) ? -(ENCODER_MOVEMENT_THRESHOLD) : ENCODER_MOVEMENT_THRESHOLD;
+   updateSelectedFrequencyValue();
+}
+
+void cycleKernelBandSwitch(uint16_t rep) {
+   vfoBank.select((vfoBank.selected() + 1) % vfoBank.count());
+}
+
+void cycleKernelFormat(uint16_t rep) {
+   cycleBenchmarkFormat.format(vfoBank.active()->getFrequency());
+}
+
+void cycleKernelDisplayFrame(uint16_t rep) {
+   pDisplay->showVFOs(frequency_delta, vfoBank.selected());
+}
+
+/**
+ * a benchmark, name in flash
+ */
+struct CycleBenchmark {
+   const char *name;
+   void      (*kernel)(uint16_t rep);
+   uint16_t    repetitions;
+};
+
+const char cycle_name_digital_read[]   PROGMEM = "digitalRead";
+const char cycle_name_fastpin_read[]   PROGMEM = "FastPin::read";
+const char cycle_name_button_read[]    PROGMEM = "button digitalRead";
+const char cycle_name_button_fastpin[] PROGMEM = "button FastPin";
+const char cycle_name_encoder_decode[] PROGMEM = "encoder decode";
+const char cycle_name_frequency_step[] PROGMEM = "frequency step";
+const char cycle_name_load_frequency[] PROGMEM = "loadFrequency";
+const char cycle_name_tuning_step[]    PROGMEM = "tuning step";
+const char cycle_name_band_switch[]    PROGMEM = "band switch";
+const char cycle_name_format[]         PROGMEM = "formatFrequencyMHz";
+const char cycle_name_display_frame[]  PROGMEM = "showVFOs";
+
+CycleBenchmark cycleBenchmarks[] = {
+   { cycle_name_digital_read,   cycleKernelDigitalRead,   CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_fastpin_read,   cycleKernelFastPinRead,   CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_button_read,    cycleKernelButtonRead,    CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_button_fastpin, cycleKernelButtonFastPin, CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_encoder_decode, cycleKernelEncoderDecode, CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_frequency_step, cycleKernelFrequencyStep, CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_load_frequency, cycleKernelLoadFrequency, CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_tuning_step,    cycleKernelTuningStep,    CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_band_switch,    cycleKernelBandSwitch,    CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_format,         cycleKernelFormat,        CYCLE_BENCHMARK_REPETITIONS },
+   { cycle_name_display_frame,  cycleKernelDisplayFrame,  CYCLE_BENCHMARK_FRAME_REPETITIONS },
+};
+
+/**
+ * prints a number right aligned in a field
+ */
+void printCycleField(unsigned long value, uint8_t width) {
+   unsigned long limit = 10;
+   uint8_t       digits = 1;
+   while ((value >= limit) && (digits < 10)) {
+      ++digits;
+      limit *= 10;
+   }
+   while (width-- > digits) {
+      Serial.write(' ');
+   }
+   Serial.print(value);
+}
+
+/**
+ * times a kernel
+ * @param  overhead  cycles taken off each repetition
+ * @param  minimum   receives the fewest cycles of any repetition
+ * @param  maximum   receives the most
+ * @return total cycles over all repetitions
+ */
+unsigned long timeCycleKernel(void (*kernel)(uint16_t)
+                            , uint16_t repetitions
+                            , unsigned long overhead
+                            , unsigned long &minimum
+                            , unsigned long &maximum) {
+   unsigned long total = 0;
+   minimum = 0xffffffffUL;
+   maximum = 0;
+
+   for (uint16_t rep=0; rep<repetitions; ++rep) {
+      feedStallWatchdog();
+
+      unsigned long start  = readCycleCount();
+      kernel(rep);
+      unsigned long cycles = readCycleCount() - start;
+
+      cycles = (cycles > overhead) ? cycles - overhead : 0;
+      total += cycles;
+      if (cycles < minimum) minimum = cycles;
+      if (cycles > maximum) maximum = cycles;
+   }
+   return total;
+}
+
+/**
+ * runs all benchmarks and prints the table
+ * call from setup(), after the display is up
+ */
+void runCycleBenchmarks() {
+   unsigned long minimum;
+   unsigned long maximum;
+   uint8_t       band = vfoBank.selected();
+   uint8_t       enabled[VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS)];
+
+   // every band off, so the kernels put no RF on any output
+   for (uint8_t ii=0; ii<vfoBank.count(); ++ii) {
+      if (vfoBank.isEnabled(ii)) {
+         enabled[ii >> 3] |= bit(ii & 7);
+      }
+      else {
+         enabled[ii >> 3] &= ~bit(ii & 7);
+      }
+      vfoBank.setEnabled(ii, false);
+   }
+   vfoBank.active()->stop();
+
+   // Timer1 free running at the CPU clock
+   uint8_t sreg = SREG;
+   cli();
+   TCCR1A = 0;
+   TCCR1B = 0;
+   TCNT1  = 0;
+   TIFR1  = _BV(TOV1);
+   cycle_benchmark_overflows = 0;
+   TIMSK1 = _BV(TOIE1);
+   TCCR1B = _BV(CS10);
+   SREG = sreg;
+
+   // the least it costs to read the counter around nothing
+   timeCycleKernel(cycleKernelEmpty, CYCLE_BENCHMARK_REPETITIONS, 0, minimum, maximum);
+   unsigned long overhead = minimum;
+
+   Serial.println();
+   Serial.print(F("cycle benchmarks, "));
+   Serial.print(F_CPU / 1000000UL);
+   Serial.print(F(" MHz, overhead "));
+   Serial.print(overhead);
+   Serial.println(F(" cycles removed"));
+   Serial.print(F("boot to RF "));
+   Serial.print(boot_rf_micros);
+   Serial.println(F(" us"));
+   Serial.println(F("kernel                reps    min cyc   mean cyc    max cyc     min us"));
+
+   for (uint8_t ii=0; ii<sizeof(cycleBenchmarks)/sizeof(cycleBenchmarks[0]); ++ii) {
+      CycleBenchmark &bench = cycleBenchmarks[ii];
+
+      Serial.flush();
+      unsigned long total = timeCycleKernel(bench.kernel, bench.repetitions, overhead, minimum, maximum);
+
+      const __FlashStringHelper *name = (const __FlashStringHelper *)bench.name;
+      Serial.print(name);
+      for (uint8_t pad = strlen_P(bench.name); pad < 18; ++pad) {
+         Serial.write(' ');
+      }
+      printCycleField(bench.repetitions,         8);
+      printCycleField(minimum,                  11);
+      printCycleField(total / bench.repetitions, 11);
+      printCycleField(maximum,                  11);
+      printCycleField(minimum / (F_CPU / 1000000UL), 11);
+      Serial.println();
+   }
+   Serial.flush();
+
+   // put back what the kernels changed; selecting the band again turns
+   // its output back on if it was enabled
+   for (uint8_t ii=0; ii<vfoBank.count(); ++ii) {
+      vfoBank.setEnabled(ii, (enabled[ii >> 3] & bit(ii & 7)) != 0);
+   }
+   vfoBank.select(band);
+   vfoBank.active()->loadFrequency();
+   encoder_movement = 0;
+   pDisplay->showVFOs(frequency_delta, vfoBank.selected());
+
+   // leave Timer1 as we found it
+   cli();
+   TIMSK1 = 0;
+   TCCR1B = 0;
+   SREG = sreg;
+}
+
+#endif // CYCLEBENCHMARK_H
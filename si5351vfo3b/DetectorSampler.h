@@ -0,0 +1,239 @@
+#ifndef DETECTORSAMPLER_H
+#define DETECTORSAMPLER_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class DetectorSampler, which reads the forward
+ * and reflected outputs of an SWR bridge detector with the ADC, one
+ * pair of conversions per sweep point, without the loop waiting.
+ *
+ * start() selects the forward channel and starts a conversion; the
+ * conversion complete interrupt calls converted(), which keeps the
+ * forward reading and starts the reflected one, then puts the pair in
+ * a ring of DETECTOR_RING_SAMPLES for the loop to take(). At the
+ * 125 kHz ADC clock (16 MHz / 128) the pair takes 208 us, well inside
+ * the I2C write of the next point that runs alongside it. A pair
+ * finding the ring full is dropped and counted.
+ *
+ * swr() reduces a pair to the standing wave ratio in hundredths,
+ * (F + R) / (F - R), which is all the analyzer sends.
+ */
+
+#include <Arduino.h>
+
+/**
+ * sample pairs waiting for the loop
+ */
+#define DETECTOR_RING_SAMPLES            8
+
+/**
+ * largest SWR reported, in hundredths - also for a reflected
+ * reading at or above the forward one
+ */
+#define DETECTOR_SWR_MAX              9999
+
+/**
+ * conversion in progress
+ */
+#define DETECTOR_IDLE                    0
+#define DETECTOR_FORWARD                 1
+#define DETECTOR_REFLECTED               2
+
+/**
+ * one point's readings
+ */
+struct DetectorSample {
+   uint16_t index;
+   uint16_t forward;
+   uint16_t reflected;
+};
+
+/**
+ * This class runs detector conversions and holds their results
+ */
+class DetectorSampler {
+protected:
+   /**
+    * ADC channels of the two detector outputs
+    */
+   uint8_t                mc_forward;
+   uint8_t                mc_reflected;
+
+   /**
+    * ring filled by the ADC interrupt at mc_head, emptied by the loop
+    * at mc_tail
+    */
+   DetectorSample         m_ring[DETECTOR_RING_SAMPLES];
+   volatile uint8_t       mc_head;
+   volatile uint8_t       mc_tail;
+
+   /**
+    * pair being converted
+    */
+   volatile uint8_t       mc_state;
+   volatile uint16_t      mi_index;
+   volatile uint16_t      mi_forwardValue;
+
+   volatile uint16_t      mi_dropped;
+
+   /**
+    * starts a conversion of one channel, AVcc reference
+    */
+   void convert(uint8_t channel) {
+      ADMUX   = bit(REFS0) | channel;
+      ADCSRA |= bit(ADSC);
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  forward    ADC channel of the forward detector (0 for A0)
+    * @param  reflected  ADC channel of the reflected detector
+    */
+   DetectorSampler(uint8_t forward, uint8_t reflected)
+   : mc_forward(forward)
+   , mc_reflected(reflected)
+   , mc_head(0)
+   , mc_tail(0)
+   , mc_state(DETECTOR_IDLE)
+   , mi_dropped(0)
+   {}
+
+   /**
+    * empties the ring and turns the ADC on, interrupt driven at
+    * 125 kHz
+    */
+   void begin() {
+      mc_head    = 0;
+      mc_tail    = 0;
+      mc_state   = DETECTOR_IDLE;
+      mi_dropped = 0;
+      ADMUX      = bit(REFS0) | mc_forward;
+      ADCSRA     = bit(ADEN) | bit(ADIE) | bit(ADPS2) | bit(ADPS1) | bit(ADPS0);
+   }
+
+   /**
+    * turns the ADC off
+    */
+   void end() {
+      ADCSRA = 0;
+      mc_state = DETECTOR_IDLE;
+   }
+
+   /**
+    * starts the readings of a point, call with interrupts on or off
+    * @param  index  point number, passed through to the sample
+    * @return false if the last pair is still being converted; the
+    *         point is dropped
+    */
+   boolean start(uint16_t index) {
+      if (mc_state != DETECTOR_IDLE) {
+         ++mi_dropped;
+         return false;
+      }
+      mi_index = index;
+      mc_state = DETECTOR_FORWARD;
+      convert(mc_forward);
+      return true;
+   }
+
+   /**
+    * takes a finished conversion, call from the ADC interrupt
+    * @param  value  ADC result
+    */
+   void converted(uint16_t value) {
+      if (mc_state == DETECTOR_FORWARD) {
+         mi_forwardValue = value;
+         mc_state        = DETECTOR_REFLECTED;
+         convert(mc_reflected);
+      }
+      else if (mc_state == DETECTOR_REFLECTED) {
+         mc_state = DETECTOR_IDLE;
+
+         uint8_t next = (mc_head + 1) % DETECTOR_RING_SAMPLES;
+         if (next == mc_tail) {
+            ++mi_dropped;
+            return;
+         }
+         m_ring[mc_head].index     = mi_index;
+         m_ring[mc_head].forward   = mi_forwardValue;
+         m_ring[mc_head].reflected = value;
+         mc_head = next;
+      }
+   }
+
+   /**
+    * takes the oldest sample off the ring, call from the loop
+    * @param  sample  receives the sample
+    * @return false if the ring is empty
+    */
+   boolean take(DetectorSample &sample) {
+      if (mc_tail == mc_head) {
+         return false;
+      }
+      sample  = m_ring[mc_tail];
+      mc_tail = (mc_tail + 1) % DETECTOR_RING_SAMPLES;
+      return true;
+   }
+
+   /**
+    * checks for samples waiting in the ring
+    */
+   boolean ready() const {
+      return mc_tail != mc_head;
+   }
+
+   /**
+    * checks for a pair being converted
+    */
+   boolean busy() const {
+      return mc_state != DETECTOR_IDLE;
+   }
+
+   /**
+    * gets the number of points dropped
+    */
+   uint16_t dropped() const {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      uint16_t n = mi_dropped;
+      SREG = oldSREG;
+      return n;
+   }
+
+   /**
+    * works out the SWR of a pair of readings
+    * @param  forward    forward detector reading
+    * @param  reflected  reflected detector reading
+    * @return SWR in hundredths, at most DETECTOR_SWR_MAX
+    */
+   static uint16_t swr(uint16_t forward, uint16_t reflected) {
+      if (reflected >= forward) {
+         return DETECTOR_SWR_MAX;
+      }
+      unsigned long ratio = ((unsigned long)(forward + reflected) * 100 + (forward - reflected) / 2)
+                          / (forward - reflected);
+      return (ratio > DETECTOR_SWR_MAX) ? DETECTOR_SWR_MAX : (uint16_t)ratio;
+   }
+};
+
+#endif // DETECTORSAMPLER_H
@@ -32,33 +32,12 @@
 #include <Arduino.h> 
 
 /**
- * initialize vfo list values
+ * initialize band values
  */
 void setupVFOs()   {     
-   vfoList[0] = new si5351_VFODefinition(si5351
-                                   , FREQ_VFO_A_DEFAULT
-                                   , FREQ_VFO_A_MIN
-                                   , FREQ_VFO_A_MAX
-                                   , SI5351_PLL_FIXED
-                                   , SI5351_CLK0 );
-   
-   vfoList[1] = new si5351_VFODefinition(si5351
-                                   , FREQ_VFO_B_DEFAULT
-                                   , FREQ_VFO_B_MIN
-                                   , FREQ_VFO_B_MAX
-                                   , SI5351_PLL_FIXED
-                                   , SI5351_CLK1 );
-   
-   vfoList[2] = new si5351_VFODefinition(si5351
-                                   , FREQ_VFO_C_DEFAULT
-                                   , FREQ_VFO_C_MIN
-                                   , FREQ_VFO_C_MAX
-                                   , SI5351_PLL_FIXED
-                                   , SI5351_CLK2 );
+   vfoBank.begin(STARTING_BAND);
 
    frequency_delta          = FREQ_DELTA_DEFAULT;
-   currVFO                  = STARTING_VFO;
-   pCurrentVFO              = vfoList[currVFO]; 
    freq_delta_display_time  = 0;
 }
 
@@ -72,8 +51,25 @@ void setupInputPins()   {
 
 /**
  * setup for rotary encoder (change frequencies)
+ * With USE_PIN_CHANGE_ENCODER, pins that cannot take pin change
+ * interrupts fall back to the external interrupts, if they are on
+ * them; either failure is reported on Serial.
  */
 void setupEncoder()   {                
+#ifdef USE_PIN_CHANGE_ENCODER
+   // encoder pins on pin change interrupts
+   if (tuningEncoder.initialize()) {
+      return;
+   }
+   Serial.println(F("encoder: no pin change interrupts on its pins"));
+#endif
+
+   if (  (digitalPinToInterrupt(ENCODER_PIN_A) == NOT_AN_INTERRUPT)
+      || (digitalPinToInterrupt(ENCODER_PIN_B) == NOT_AN_INTERRUPT)) {
+      Serial.println(F("encoder: no external interrupts on its pins, not running"));
+      return;
+   }
+
    // set up encoder pins for interrupts
    pinMode(ENCODER_PIN_A, INPUT); 
    pinMode(ENCODER_PIN_B, INPUT); 
@@ -81,62 +77,61 @@ void setupEncoder()   {
    digitalWrite(ENCODER_PIN_B, HIGH);  // turn on pullup resistor
 
    // encoder pin on interrupt 0 (pin 2)
-   attachInterrupt(0, encoderPinA_ISR, CHANGE);
+   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_A), encoderPinA_ISR, CHANGE);
 
    // encoder pin on interrupt 1 (pin 3)
-   attachInterrupt(1, encoderPinB_ISR, CHANGE);
+   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_B), encoderPinB_ISR, CHANGE);
 }
 
 /**
  * setup for OLED display
+ * The first frame is painted by the caller.
  */
 void setupDisplay()   {   
-#ifdef USE_U8GLIB_LIBRARY
-   #ifdef USE_SSD1306_128X64_DISPLAY
-      pDisplay = new SSD1306_U8glib_VFODisplay(vfoList
-                                             , NUMBER_OF_VFOS
-                                             , DISPLAY_HEADER_LINE);
-   #endif
-#endif
-
-#ifdef USE_LIQUIDCRYSTAL_LIBRARY
-   #ifdef USE_LCD_20X4_DISPLAY
-      pDisplay = new LCD2004_LCDLib_VFODisplay(vfoList
-                                             , NUMBER_OF_VFOS
-                                             , DISPLAY_HEADER_LINE);
-   #endif
-#endif   
-   
-   
-   pDisplay->showVFOs(frequency_delta, currVFO);
+   pDisplay->begin();
 }
 
 /**
- * setup for Si5351 clock board
+ * time from start up to the selected output coming on, in us
  */
-void setupSI5351()   {                
-   si5351.init(SI5351_CRYSTAL_LOAD_8PF, 0);
+unsigned long boot_rf_micros;
 
-   // initially all oscillators are off
-   si5351.output_enable(SI5351_CLK0, 0);
-   si5351.output_enable(SI5351_CLK1, 0);
-   si5351.output_enable(SI5351_CLK2, 0);
-
-   // set output to minimum value
-   si5351.drive_strength(SI5351_CLK0, SI5351_DRIVE_2MA);
-   si5351.drive_strength(SI5351_CLK1, SI5351_DRIVE_2MA);
-   si5351.drive_strength(SI5351_CLK2, SI5351_DRIVE_2MA);
+/**
+ * setup for Si5351 clock boards
+ */
+void setupSI5351()   {                
+   // selected band first - if its registers were saved with the
+   // operating state they go straight back, output on
+   boolean restored = restoreOutputImage();
+   if (restored) {
+      boot_rf_micros = micros();
+   }
 
-   // set  a fixed PLL frequency
-   si5351.set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
+   // all chips: outputs off, output at minimum value,
+   // fixed PLL frequency - a restored output keeps running
+   si5351Devices.begin(SI5351_CRYSTAL_LOAD_8PF, SI5351_DRIVE_2MA);
 
-   // set clocks to initial frequencies
-   for (int ii=0; ii<NUMBER_OF_VFOS; ++ii) {
-      vfoList[ii]->loadFrequency();
+   // set clock of selected band to its frequency, other
+   // bands are loaded as they are selected
+   if (!restored) {
+      vfoBank.load();
+   }
+   vfoBank.active()->stageStart();
+
+#ifdef USE_SECOND_SI5351
+   // fixed carriers
+   for (uint8_t ii=0; ii<NUMBER_OF_CARRIERS; ++ii) {
+      si5351_VFODefinition carrier(si5351Devices, &carrierTable[ii]);
+      carrier.loadFrequency();
+      carrier.stageStart();
    }
+#endif
 
-   // enable output on selected vfoList
-   vfoList[currVFO]->start();
+   // enable outputs, one write per chip
+   si5351Devices.flush();
+   if (!restored) {
+      boot_rf_micros = micros();
+   }
 }
 
 #endif // DEVICEINITIALIZATIONS_H
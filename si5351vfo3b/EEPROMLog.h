@@ -0,0 +1,237 @@
+#ifndef EEPROMLOG_H
+#define EEPROMLOG_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class EEPROMLog, which keeps a fixed length
+ * record in an area of EEPROM, spreading the writes over the area.
+ *
+ * The area is divided into slots, one record each. Every record is
+ * written to the slot after the previous one, wrapping around, so
+ * each slot sees one write in however many slots there are. A record
+ * is
+ *
+ *    sequence (2 bytes), payload, CRC-16 (2 bytes)
+ *
+ * with the CRC over the payload length, sequence and payload. At
+ * start up the valid record with the newest sequence number is the
+ * current one. A record torn by a power failure fails its CRC, and
+ * the one before it is used instead.
+ *
+ * Each EEPROM byte write takes 3.4 ms, so nothing here waits for one.
+ * write() copies the record into SRAM and turns on the EEPROM ready
+ * interrupt; the interrupt writes one byte each time the EEPROM is
+ * ready, until the record is done. Bytes that already hold the right
+ * value are skipped, so they are neither worn nor waited for. The
+ * sketch must call service() from ISR(EE_READY_vect).
+ */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+/**
+ * record length for a payload length
+ */
+#define EEPROMLOG_RECORD_LENGTH(payload)  ((payload) + 4)
+
+/**
+ * This class is a wear leveled record log in EEPROM
+ */
+class EEPROMLog {
+protected:
+   /**
+    * EEPROM area
+    */
+   uint16_t          mi_base;
+   uint8_t           mc_slots;
+   uint8_t           mc_length;
+
+   /**
+    * the current record, as last written or being written
+    */
+   uint8_t          *mp_record;
+   uint8_t           mc_slot;
+
+   /**
+    * next byte of the record for the interrupt to write,
+    * mc_length when there is nothing to write
+    */
+   volatile uint8_t  mc_next;
+
+   /**
+    * CCITT CRC-16 of a record
+    */
+   uint16_t crc(const uint8_t *record) const {
+      uint16_t sum = 0xffff ^ mc_length;
+      for (uint8_t ii=0; ii<mc_length-2; ++ii) {
+         sum ^= (uint16_t)record[ii] << 8;
+         for (uint8_t jj=0; jj<8; ++jj) {
+            sum = (sum & 0x8000) ? ((sum << 1) ^ 0x1021) : (sum << 1);
+         }
+      }
+      return sum;
+   }
+
+   /**
+    * gets the sequence number of the record in SRAM
+    */
+   uint16_t sequence() const {
+      return mp_record[0] | (mp_record[1] << 8);
+   }
+
+   /**
+    * gets the EEPROM address of a slot
+    */
+   uint8_t *slotAddress(uint8_t slot) const {
+      return (uint8_t *)(uintptr_t)(mi_base + (uint16_t)slot * mc_length);
+   }
+
+   /**
+    * reads a slot into SRAM and checks it
+    * @return true if the record in it is valid
+    */
+   boolean readSlot(uint8_t slot) {
+      eeprom_read_block(mp_record, slotAddress(slot), mc_length);
+      uint16_t sum = crc(mp_record);
+      return (mp_record[mc_length-2] == (uint8_t)sum)
+          && (mp_record[mc_length-1] == (uint8_t)(sum >> 8));
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  base    first EEPROM address of the area
+    * @param  bytes   size of the area
+    * @param  record  SRAM buffer of EEPROMLOG_RECORD_LENGTH(payload) bytes
+    * @param  length  size of the buffer
+    */
+   EEPROMLog(uint16_t base, uint16_t bytes, uint8_t *record, uint8_t length)
+   : mi_base(base)
+   , mc_slots(bytes / length)
+   , mc_length(length)
+   , mp_record(record)
+   , mc_slot(0)
+   , mc_next(length)
+   {}
+
+   /**
+    * finds the current record
+    * @return true if there is one, its payload is then in payload()
+    */
+   boolean begin() {
+      boolean  found = false;
+      uint8_t  newest = 0;
+      uint16_t newestSequence = 0;
+
+      for (uint8_t ii=0; ii<mc_slots; ++ii) {
+         if (readSlot(ii) && (!found || ((int16_t)(sequence() - newestSequence) > 0))) {
+            found = true;
+            newest = ii;
+            newestSequence = sequence();
+         }
+      }
+
+      if (found) {
+         readSlot(newest);
+         mc_slot = newest;
+      }
+      else {
+         memset(mp_record, 0, mc_length);
+         mc_slot = mc_slots - 1;
+      }
+      mc_next = mc_length;
+      return found;
+   }
+
+   /**
+    * gets the payload of the current record
+    */
+   const uint8_t *payload() const {
+      return mp_record + 2;
+   }
+
+   /**
+    * gets the payload length
+    */
+   uint8_t payloadLength() const {
+      return mc_length - 4;
+   }
+
+   /**
+    * checks for a record still being written
+    */
+   boolean busy() const {
+      return mc_next < mc_length;
+   }
+
+   /**
+    * starts writing a new record, unless it is the same as the
+    * current one; returns at once, the interrupt does the writing
+    * @param  data  payload, payloadLength() bytes
+    * @return false if the previous record is still being written
+    */
+   boolean write(const uint8_t *data) {
+      if (busy()) {
+         return false;
+      }
+      if (memcmp(data, payload(), payloadLength()) == 0) {
+         return true;
+      }
+
+      uint16_t next = sequence() + 1;
+      mp_record[0] = (uint8_t)next;
+      mp_record[1] = (uint8_t)(next >> 8);
+      memcpy(mp_record + 2, data, payloadLength());
+      uint16_t sum = crc(mp_record);
+      mp_record[mc_length-2] = (uint8_t)sum;
+      mp_record[mc_length-1] = (uint8_t)(sum >> 8);
+
+      mc_slot = (mc_slot + 1) % mc_slots;
+      mc_next = 0;
+      EECR |= bit(EERIE);
+      return true;
+   }
+
+   /**
+    * writes the next changed byte of the record
+    * called from ISR(EE_READY_vect), when the EEPROM is ready
+    */
+   void service() {
+      uint8_t *address = slotAddress(mc_slot) + mc_next;
+      while ((mc_next < mc_length) && (eeprom_read_byte(address) == mp_record[mc_next])) {
+         ++mc_next;
+         ++address;
+      }
+
+      if (mc_next >= mc_length) {
+         EECR &= ~bit(EERIE);
+         return;
+      }
+
+      EEAR = (uint16_t)(uintptr_t)address;
+      EEDR = mp_record[mc_next++];
+      EECR |= bit(EEMPE);
+      EECR |= bit(EEPE);
+   }
+};
+
+#endif // EEPROMLOG_H
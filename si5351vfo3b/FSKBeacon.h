@@ -0,0 +1,245 @@
+#ifndef FSKBEACON_H
+#define FSKBEACON_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class FSKBeacon, which sends a message of
+ * multiple frequency shift keyed symbols on one clock output, as the
+ * WSPR and FT8 style weak signal modes do, one symbol per tick of a
+ * timer interrupt.
+ *
+ * The message is held as tone numbers, two to a byte. begin() works
+ * out the multisynth register block of every tone the message uses
+ * with Si5351Group::multisynthFine(), to a hundredth of a Hz, before
+ * the first symbol goes out. Tones are only a few Hz apart, so the
+ * blocks share their leading registers - the output divider and the
+ * high bits of the divider - and only the registers from the first
+ * one that differs are sent on a tone change: typically 3 or 4 bytes,
+ * a write of under 0.6 ms at 100 kHz. step(), called from the timer
+ * interrupt, does that one write and nothing else, and no write at
+ * all when a symbol repeats the tone before it.
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+
+#include "Si5351Group.h"
+
+/**
+ * message limits - a WSPR message, tones enough for FT8
+ */
+#define BEACON_MAX_SYMBOLS             162
+#define BEACON_MAX_TONES                 8
+
+/**
+ * no tone sent yet
+ */
+#define BEACON_NO_TONE                0xff
+
+/**
+ * This class holds a beacon message and the register blocks of its
+ * tones
+ */
+class FSKBeacon {
+protected:
+   /**
+    * chips running the outputs
+    */
+   Si5351Group           &m_devices;
+
+   /**
+    * output keyed
+    */
+   uint8_t                mc_device;
+   si5351_clock           m_clock;
+
+   /**
+    * the message, two tones a byte, low nibble first
+    */
+   uint8_t                mc_symbols[(BEACON_MAX_SYMBOLS + 1) / 2];
+   uint16_t               mi_count;
+
+   /**
+    * register blocks of the tones, and the first register that
+    * differs between any of them
+    */
+   uint8_t                mc_tones[BEACON_MAX_TONES][SI5351_PARAMETERS_LENGTH];
+   uint8_t                mc_toneCount;
+   uint8_t                mc_first;
+
+   /**
+    * interrupt side: next symbol to send, and the tone on the output
+    */
+   volatile uint16_t      mi_next;
+   volatile uint8_t       mc_tone;
+   volatile boolean       mb_running;
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  devices  SI5351 chips running the outputs
+    */
+   FSKBeacon(Si5351Group &devices)
+   : m_devices(devices)
+   , mi_count(0)
+   , mc_toneCount(0)
+   , mc_first(0)
+   , mi_next(0)
+   , mc_tone(BEACON_NO_TONE)
+   , mb_running(false)
+   {
+      memset(mc_symbols, 0, sizeof(mc_symbols));
+   }
+
+   /**
+    * puts one symbol of the message, call while the beacon is stopped
+    * @param  index  symbol number
+    * @param  tone   tone number, 0 the lowest
+    * @return false if either is out of range
+    */
+   boolean setSymbol(uint16_t index, uint8_t tone) {
+      if ((index >= BEACON_MAX_SYMBOLS) || (tone >= BEACON_MAX_TONES)) {
+         return false;
+      }
+      uint8_t shift = (index & 1) ? 4 : 0;
+      mc_symbols[index / 2] = (mc_symbols[index / 2] & ~(0x0f << shift)) | (tone << shift);
+      return true;
+   }
+
+   /**
+    * gets one symbol of the message
+    * @param  index  symbol number, below BEACON_MAX_SYMBOLS
+    */
+   uint8_t symbol(uint16_t index) const {
+      return (mc_symbols[index / 2] >> ((index & 1) ? 4 : 0)) & 0x0f;
+   }
+
+   /**
+    * gets the number of tones the start of the message uses
+    * @param  count  symbols to look at
+    */
+   uint8_t toneCount(uint16_t count) const {
+      uint8_t top = 0;
+      for (uint16_t ii=0; ii<count; ++ii) {
+         if (symbol(ii) > top) {
+            top = symbol(ii);
+         }
+      }
+      return top + 1;
+   }
+
+   /**
+    * sets up the beacon and works out the tone register blocks; the
+    * first step() sends symbol 0. Call with the timer stopped.
+    * @param  device   index of chip in group
+    * @param  clk      clock output on the chip, in fractional mode
+    * @param  pll      PLL frequency the output runs from, Hz * SI5351_FREQ_MULT
+    * @param  f        frequency of tone 0 in Hz
+    * @param  spacing  tone spacing in thousandths of a Hz
+    * @param  count    symbols to send, 1 to BEACON_MAX_SYMBOLS
+    */
+   void begin(uint8_t device
+            , si5351_clock clk
+            , unsigned long long pll
+            , unsigned long f
+            , unsigned long spacing
+            , uint16_t count) {
+      mc_device    = device;
+      m_clock      = clk;
+      mi_count     = count;
+      mc_toneCount = toneCount(count);
+
+      unsigned long long base = (unsigned long long)f * SI5351_FREQ_MULT;
+      mc_first = SI5351_PARAMETERS_LENGTH;
+      for (uint8_t tone=0; tone<mc_toneCount; ++tone) {
+         Si5351Group::multisynthFine(pll, base + ((unsigned long long)tone * spacing + 5) / 10, mc_tones[tone]);
+         for (uint8_t ii=0; ii<mc_first; ++ii) {
+            if (mc_tones[tone][ii] != mc_tones[0][ii]) {
+               mc_first = ii;
+            }
+         }
+      }
+
+      mi_next    = 0;
+      mc_tone    = BEACON_NO_TONE;
+      mb_running = true;
+   }
+
+   /**
+    * ends the message; the output is left on the last tone sent
+    */
+   void stop() {
+      mb_running = false;
+   }
+
+   /**
+    * starts the next symbol, call from the timer interrupt. The first
+    * call sends the whole block of its tone, later ones only the
+    * registers that differ between tones.
+    * @return false once the last symbol has had its time
+    */
+   boolean step() {
+      if (!mb_running) {
+         return false;
+      }
+      if (mi_next >= mi_count) {
+         mb_running = false;
+         return false;
+      }
+
+      uint8_t tone = symbol(mi_next);
+      if (tone != mc_tone) {
+         m_devices.writeMultisynth(mc_device, m_clock, mc_tones[tone]
+                                 , (mc_tone == BEACON_NO_TONE) ? 0 : mc_first);
+         mc_tone = tone;
+      }
+      ++mi_next;
+      return true;
+   }
+
+   /**
+    * checks whether the message is still being sent
+    */
+   boolean running() const {
+      return mb_running;
+   }
+
+   /**
+    * gets the number of symbols started
+    */
+   uint16_t sent() const {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      uint16_t n = mi_next;
+      SREG = oldSREG;
+      return n;
+   }
+
+   /**
+    * gets the number of registers sent on a tone change
+    */
+   uint8_t changeLength() const {
+      return SI5351_PARAMETERS_LENGTH - mc_first;
+   }
+};
+
+#endif // FSKBEACON_H
@@ -0,0 +1,187 @@
+#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class FrameParser, which picks fixed size binary
+ * frequency frames out of a stream of bytes. A frame is 9 bytes, all
+ * values low byte first:
+ *
+ *    0xA5         sync
+ *    channel      band number, bit 7 set to ask for an answer
+ *    frequency    Hz, 4 bytes
+ *    sequence     counts up by one each frame, wrapping
+ *    CRC-16       CCITT, 2 bytes, over channel, frequency and sequence
+ *
+ * The sync byte never appears in a text CAT command, so frames and
+ * commands can share the serial port. A frame failing its CRC is
+ * dropped and the parser looks for the next sync byte; the sender
+ * sees the gap in the sequence numbers of the answers.
+ *
+ * The answer to a frame is 5 bytes: 0xA5, status, the sequence number
+ * of the frame, and the CRC-16 of the status and sequence.
+ *
+ * The antenna analyzer sends 8 byte frames the same way: 0xA5, a kind
+ * above any status, two 16 bit values, and the CRC-16 of kind and
+ * values. A point frame holds the point number and its SWR in
+ * hundredths; the end frame holds the points sent and dropped.
+ *
+ * Like CATParser, bytes are fed in one at a time and nothing is
+ * allocated.
+ */
+
+#include <Arduino.h>
+
+/**
+ * frame layout
+ */
+#define FRAME_SYNC                    0xa5
+#define FRAME_LENGTH                     9
+#define FRAME_ANSWER_LENGTH              5
+#define FRAME_CHANNEL_MASK            0x7f
+#define FRAME_FLAG_ANSWER             0x80
+
+/**
+ * answer status
+ */
+#define FRAME_STATUS_OK                  0
+#define FRAME_STATUS_REJECTED            1    // no such band, or out of its range
+
+/**
+ * analyzer frames
+ */
+#define FRAME_ANALYZER_LENGTH            8
+#define FRAME_ANALYZER_POINT          0x10    // point number, SWR * 100
+#define FRAME_ANALYZER_END            0x11    // points sent, points dropped
+
+/**
+ * result of feeding a byte
+ */
+#define FRAME_PARSE_MORE                 0    // frame not finished
+#define FRAME_PARSE_FRAME                1    // a frame is ready
+#define FRAME_PARSE_ERROR                2    // a frame failed its CRC
+
+/**
+ * This class collects frequency frames from a byte stream
+ */
+class FrameParser {
+protected:
+   /**
+    * frame so far, sync byte included
+    */
+   uint8_t  mc_buffer[FRAME_LENGTH];
+   uint8_t  mc_length;
+
+public:
+   /**
+    * CCITT CRC-16 of a run of bytes, for frames and answers
+    * @param  data    bytes to check
+    * @param  length  number of bytes
+    */
+   static uint16_t crc(const uint8_t *data, uint8_t length) {
+      uint16_t sum = 0xffff;
+      for (uint8_t ii=0; ii<length; ++ii) {
+         sum ^= (uint16_t)data[ii] << 8;
+         for (uint8_t jj=0; jj<8; ++jj) {
+            sum = (sum & 0x8000) ? ((sum << 1) ^ 0x1021) : (sum << 1);
+         }
+      }
+      return sum;
+   }
+
+   /**
+    * Constructor
+    */
+   FrameParser()
+   : mc_length(0)
+   {}
+
+   /**
+    * checks whether a byte is taken by the parser: any byte while a
+    * frame is being collected, otherwise only the sync byte
+    * @param  c  byte read from the port
+    */
+   boolean takes(uint8_t c) const {
+      return (mc_length != 0) || (c == FRAME_SYNC);
+   }
+
+   /**
+    * takes the next byte of a frame
+    * @param  c  byte read from the port
+    * @return FRAME_PARSE_FRAME when a frame is ready to be read,
+    *         FRAME_PARSE_ERROR when a bad one was dropped,
+    *         otherwise FRAME_PARSE_MORE
+    */
+   uint8_t feed(uint8_t c) {
+      mc_buffer[mc_length++] = c;
+      if (mc_length < FRAME_LENGTH) {
+         return FRAME_PARSE_MORE;
+      }
+
+      mc_length = 0;
+      uint16_t sum = crc(mc_buffer + 1, FRAME_LENGTH - 3);
+      if (  (mc_buffer[FRAME_LENGTH-2] != (uint8_t)sum)
+         || (mc_buffer[FRAME_LENGTH-1] != (uint8_t)(sum >> 8))) {
+         return FRAME_PARSE_ERROR;
+      }
+      return FRAME_PARSE_FRAME;
+   }
+
+   /**
+    * checks for part of a frame waiting for more bytes
+    */
+   boolean partial() const {
+      return mc_length != 0;
+   }
+
+   /**
+    * gets the band the frame is for
+    */
+   uint8_t channel() const {
+      return mc_buffer[1] & FRAME_CHANNEL_MASK;
+   }
+
+   /**
+    * checks whether the sender wants an answer
+    */
+   boolean wantsAnswer() const {
+      return (mc_buffer[1] & FRAME_FLAG_ANSWER) != 0;
+   }
+
+   /**
+    * gets the frequency in Hz
+    */
+   unsigned long frequency() const {
+      return (unsigned long)mc_buffer[2]
+           | ((unsigned long)mc_buffer[3] << 8)
+           | ((unsigned long)mc_buffer[4] << 16)
+           | ((unsigned long)mc_buffer[5] << 24);
+   }
+
+   /**
+    * gets the sequence number
+    */
+   uint8_t sequence() const {
+      return mc_buffer[6];
+   }
+};
+
+#endif // FRAMEPARSER_H
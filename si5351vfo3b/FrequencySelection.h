@@ -30,9 +30,15 @@
  * ppr; the default value of 2 essentially halves the ppr of your encoder. 
  * The minimum value for this parameter is 1 -- a value of 1 turns off
  * the software debounce feature.
+ *
+ * With USE_PIN_CHANGE_ENCODER defined, the encoder is decoded by the
+ * PinChangeEncoder driver instead of the two external interrupt
+ * handlers below. The driver needs no debounce delay, and leaves
+ * INT0/INT1 free for other uses.
  */
  
 #include <Arduino.h> 
+#include "FastPin.h"
 
 /**
  * encoder constants
@@ -44,6 +50,30 @@
  * variables tracking encoder movement
  */
 volatile long encoder_movement;
+
+/**
+ * posts an encoder step event once the encoder has moved far
+ * enough to change frequency
+ * called from the encoder interrupt handlers
+ */
+void encoderMoved() {
+   if (  (encoder_movement >= ENCODER_MOVEMENT_THRESHOLD)
+      || (encoder_movement <= -(ENCODER_MOVEMENT_THRESHOLD))) {
+      vfoEvents.postOnce(EVENT_ENCODER_STEP);
+   }
+}
+
+#ifdef USE_PIN_CHANGE_ENCODER
+/**
+ * tuning encoder, counting steps into encoder_movement
+ */
+PinChangeEncoder tuningEncoder(ENCODER_PIN_A, ENCODER_PIN_B, encoder_movement, encoderMoved);
+#endif // USE_PIN_CHANGE_ENCODER
+
+/**
+ * encoder decode on the two external interrupts, also the fall back
+ * when the pin change encoder cannot be set up on its pins
+ */
 boolean A_set = false;
 boolean B_set = false;
 
@@ -52,12 +82,13 @@ boolean B_set = false;
  */
 void encoderPinA_ISR() {
    delay(ENCODER_DEBOUNCE_WAIT_MILS);
-   if( digitalRead(ENCODER_PIN_A) != A_set ) {  
+   if( FastPin<ENCODER_PIN_A>::read() != A_set ) {  
       A_set = !A_set;
 
       // decrement counter if A leads B
       if ( A_set && !B_set ) {
          --encoder_movement;
+         encoderMoved();
       }
    }
 }
@@ -67,12 +98,13 @@ void encoderPinA_ISR() {
  */
 void encoderPinB_ISR(){
    delay(ENCODER_DEBOUNCE_WAIT_MILS);
-   if( digitalRead(ENCODER_PIN_B) != B_set ) {
+   if( FastPin<ENCODER_PIN_B>::read() != B_set ) {
       B_set = !B_set;
 
       // increment counter - if B leads A
       if( B_set && !A_set ) {
          ++encoder_movement;
+         encoderMoved();
       }    
    }
 }
@@ -90,7 +122,7 @@ boolean updateSelectedFrequencyValue() {
 
       if (encoder_movement >= ENCODER_MOVEMENT_THRESHOLD) {
          // adjust frequency positive
-         vfoList[currVFO]->increaseFrequency(frequency_delta);
+         vfoBank.active()->increaseFrequency(frequency_delta);
 
          // reset movement and tell caller to redisplay the frequencies
          encoder_movement = 0;
@@ -98,7 +130,7 @@ boolean updateSelectedFrequencyValue() {
       }  
       else if (encoder_movement <= -(ENCODER_MOVEMENT_THRESHOLD)) {
          // adjust frequency negative
-         vfoList[currVFO]->decreaseFrequency(frequency_delta);
+         vfoBank.active()->decreaseFrequency(frequency_delta);
 
          // reset movement and tell caller to redisplay the frequencies
          encoder_movement = 0;
@@ -111,7 +143,7 @@ boolean updateSelectedFrequencyValue() {
       // outside of critical section
       // install new frequency in clock if needed
       if (rtn) {
-         vfoList[currVFO]->loadFrequency();
+         vfoBank.active()->loadFrequency();
       }
    }
 
@@ -0,0 +1,249 @@
+#ifndef FREQUENCYSWEEP_H
+#define FREQUENCYSWEEP_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class FrequencySweep, which steps one clock
+ * output through evenly spaced frequencies, one point per tick of a
+ * timer interrupt.
+ *
+ * The multisynth divider is PLL / f, so equal frequency steps are not
+ * equal divider steps and every point needs a 64 bit division, too
+ * slow to do in the interrupt. The work is split: refill(), called
+ * from the loop, works out the register blocks of the next points
+ * with Si5351Group::multisynth() into a ring of SWEEP_RING_POINTS
+ * slots; step(), called from the timer interrupt, sends the oldest
+ * one with a single write and nothing else. The point the output
+ * changes on is then set by the timer, not by how long the loop
+ * pass before it took.
+ *
+ * If the loop falls so far behind that the ring runs dry, the
+ * interrupt leaves the output where it is for another tick and counts
+ * an underrun, so the sweep slows down rather than skipping points.
+ *
+ * The ring counters are shared with the interrupt: mc_ready is
+ * counted up by the loop with interrupts off, and down only by the
+ * interrupt.
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+
+#include "Si5351Group.h"
+
+/**
+ * register blocks worked out ahead of the timer
+ */
+#define SWEEP_RING_POINTS                8
+
+/**
+ * This class holds a sweep and its ring of register blocks
+ */
+class FrequencySweep {
+protected:
+   /**
+    * chips running the outputs
+    */
+   Si5351Group           &m_devices;
+
+   /**
+    * output swept, and the PLL it runs from
+    */
+   uint8_t                mc_device;
+   si5351_clock           m_clock;
+   unsigned long long     ml_pll;
+
+   /**
+    * points start, start + step, ... mi_points of them
+    */
+   unsigned long          ml_start;
+   unsigned long          ml_step;
+   uint16_t               mi_points;
+   boolean                mb_repeat;
+
+   /**
+    * loop side of the ring: next slot to fill, next point to work out,
+    * and points worked out so far
+    */
+   uint8_t                mc_ring[SWEEP_RING_POINTS][SI5351_PARAMETERS_LENGTH];
+   uint8_t                mc_fill;
+   uint16_t               mi_next;
+   uint16_t               mi_computed;
+
+   /**
+    * interrupt side: next slot to send, and slots filled but not sent
+    */
+   volatile uint8_t       mc_take;
+   volatile uint8_t       mc_ready;
+
+   volatile boolean       mb_running;
+   volatile uint16_t      mi_written;
+   volatile uint16_t      mi_underruns;
+
+   /**
+    * checks for points still to be worked out
+    */
+   boolean morePoints() const {
+      return mb_repeat || (mi_computed < mi_points);
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  devices  SI5351 chips running the outputs
+    */
+   FrequencySweep(Si5351Group &devices)
+   : m_devices(devices)
+   , mc_ready(0)
+   , mb_running(false)
+   , mi_written(0)
+   , mi_underruns(0)
+   {}
+
+   /**
+    * sets up a sweep and fills the ring; the first step() sends the
+    * start point. Call with the timer stopped.
+    * @param  device  index of chip in group
+    * @param  clk     clock output on the chip, in fractional mode
+    * @param  pll     PLL frequency the output runs from, Hz * SI5351_FREQ_MULT
+    * @param  start   first frequency in Hz
+    * @param  step    Hz between points
+    * @param  points  number of points, at least 1
+    * @param  repeat  true to go back to the start after the last point
+    */
+   void begin(uint8_t device
+            , si5351_clock clk
+            , unsigned long long pll
+            , unsigned long start
+            , unsigned long step
+            , uint16_t points
+            , boolean repeat) {
+      mc_device    = device;
+      m_clock      = clk;
+      ml_pll       = pll;
+      ml_start     = start;
+      ml_step      = step;
+      mi_points    = points;
+      mb_repeat    = repeat;
+
+      mc_fill      = 0;
+      mi_next      = 0;
+      mi_computed  = 0;
+      mc_take      = 0;
+      mc_ready     = 0;
+      mi_written   = 0;
+      mi_underruns = 0;
+      mb_running   = true;
+      refill();
+   }
+
+   /**
+    * ends the sweep; the output is left on the last point sent
+    */
+   void stop() {
+      mb_running = false;
+   }
+
+   /**
+    * works out register blocks until the ring is full, call from the
+    * loop while the sweep runs
+    */
+   void refill() {
+      while (mb_running && (mc_ready < SWEEP_RING_POINTS) && morePoints()) {
+         Si5351Group::multisynth(ml_pll, ml_start + ml_step * mi_next, mc_ring[mc_fill]);
+         mc_fill = (mc_fill + 1) % SWEEP_RING_POINTS;
+         if (++mi_next >= mi_points) {
+            mi_next = 0;
+         }
+         ++mi_computed;
+
+         uint8_t oldSREG = SREG;
+         noInterrupts();
+         ++mc_ready;
+         SREG = oldSREG;
+      }
+   }
+
+   /**
+    * sends the next point to the output, call from the timer interrupt
+    * @return false once the sweep is over
+    */
+   boolean step() {
+      if (!mb_running) {
+         return false;
+      }
+      if (mc_ready == 0) {
+         // loop behind, hold this point another tick
+         ++mi_underruns;
+         return true;
+      }
+
+      m_devices.writeMultisynth(mc_device, m_clock, mc_ring[mc_take]);
+      mc_take = (mc_take + 1) % SWEEP_RING_POINTS;
+      --mc_ready;
+      ++mi_written;
+
+      if (!mb_repeat && (mi_written >= mi_points)) {
+         mb_running = false;
+      }
+      return mb_running;
+   }
+
+   /**
+    * checks whether the sweep is still running
+    */
+   boolean running() const {
+      return mb_running;
+   }
+
+   /**
+    * checks for a ring half empty with points still to work out, to
+    * wake the loop early
+    */
+   boolean needsRefill() const {
+      return mb_running && (mc_ready <= SWEEP_RING_POINTS / 2) && morePoints();
+   }
+
+   /**
+    * gets the number of points sent, wrapping on a repeated sweep
+    */
+   uint16_t written() const {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      uint16_t n = mi_written;
+      SREG = oldSREG;
+      return n;
+   }
+
+   /**
+    * gets the number of ticks the ring was found empty
+    */
+   uint16_t underruns() const {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      uint16_t n = mi_underruns;
+      SREG = oldSREG;
+      return n;
+   }
+};
+
+#endif // FREQUENCYSWEEP_H
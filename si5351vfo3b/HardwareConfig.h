@@ -0,0 +1,60 @@
+#ifndef HARDWARECONFIG_H
+#define HARDWARECONFIG_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the pin assignments and the EEPROM map of the
+ * sketch. They are kept out of the .ino so the host build (host/)
+ * drives the same pins and reads the same EEPROM areas as the sketch,
+ * from this one copy. Change them here to suit your wiring.
+ */
+
+#include <Arduino.h>
+
+/**
+ * hardware pin definitions
+ */
+#define ENCODER_PIN_A                     2
+#define ENCODER_PIN_B                     3
+#define VFO_SELECTOR_PIN                  4
+#define FRQ_DELTA_SELECTOR_PIN            5
+
+/**
+ * analog inputs for the antenna analyzer bridge detectors
+ */
+#define ANALYZER_FORWARD_PIN              A0
+#define ANALYZER_REFLECTED_PIN            A1
+
+/**
+ * EEPROM map
+ * The state log keeps the operating state across power cycles,
+ * see StatePersistence.h. A bigger area spreads the wear further.
+ * The calibration log keeps the crystal correction, written seldom,
+ * and the channel log the memory channels.
+ */
+#define EEPROM_STATE_LOG_ADDRESS          0
+#define EEPROM_STATE_LOG_BYTES          512
+#define EEPROM_CALIBRATION_LOG_ADDRESS  512
+#define EEPROM_CALIBRATION_LOG_BYTES     64
+#define EEPROM_CHANNEL_LOG_ADDRESS      576
+#define EEPROM_CHANNEL_LOG_BYTES        256
+
+#endif // HARDWARECONFIG_H
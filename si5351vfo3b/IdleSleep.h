@@ -0,0 +1,251 @@
+#ifndef IDLESLEEP_H
+#define IDLESLEEP_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions used to wait out the time between
+ * passes of the operating loop.
+ *
+ * With USE_IDLE_SLEEP defined, the processor is put in SLEEP_MODE_IDLE
+ * instead of spinning in delay(). The timer 0 tick (every 1.024 ms)
+ * and the encoder interrupts wake it up again, so the loop timing is
+ * unchanged, but the core draws much less current in between. An event
+ * posted by an interrupt, such as a full encoder step, ends the wait
+ * early, so the new frequency goes out to the clock chip as soon as
+ * the step is seen.
+ *
+ * With USE_POWER_DOWN_SLEEP also defined, the processor drops into
+ * SLEEP_MODE_PWR_DOWN after the VFO has been left alone for
+ * IDLE_POWER_DOWN_DELAY_MILS. The encoder and button pins are then
+ * armed as pin change interrupts, which are the only pin interrupts
+ * that can wake the part from power down. With the pin change encoder
+ * driver the encoder pins are armed all the time, and only the button
+ * pins are added for power down. The interrupt vectors are in
+ * PinChangeInterrupts.h. Oscillator start up from power down takes
+ * about 1 ms with the standard Uno fuses. If any of the pins has no
+ * pin change interrupt on your board, the sketch stays in idle sleep.
+ * The stall watchdog is stopped for the duration of power down.
+ *
+ * With USE_CAT_CONTROL defined, a byte arriving on the serial port
+ * also ends the wait, and power down is never entered: it stops the
+ * serial port, and the first command would be lost.
+ *
+ * With USE_FREQUENCY_SWEEP defined, a running sweep wakes the loop
+ * whenever its ring of register blocks is half empty, and with
+ * USE_ANTENNA_ANALYZER whenever a detector sample is ready to send.
+ * A beacon being sent needs nothing from the loop until it ends.
+ */
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+/**
+ * quiet time before dropping into power down sleep
+ */
+#define IDLE_POWER_DOWN_DELAY_MILS     5000
+
+/**
+ * variables tracking loop timing
+ */
+unsigned long loop_tick_time      = 0;
+unsigned long loop_elapsed_mils   = LOOP_DELAY_MILS;
+unsigned long idle_activity_time  = 0;
+
+/**
+ * checks for work that needs the loop to keep running
+ * must be called with interrupts disabled
+ * @return true if encoder, button, display, state saving or CAT
+ *         work is still pending
+ */
+boolean vfoHasPendingWork() {
+   return !vfoEvents.isEmpty()
+       || (encoder_movement != 0)
+       || (freq_delta_display_time > 0)
+       || !VFOSelectPin.isQuiescent()
+       || !FrequencyDeltaSelectPin.isQuiescent()
+       || statePersistencePending()
+#ifdef USE_CAT_CONTROL
+       || catHasPendingWork()
+#endif
+#ifdef USE_FREQUENCY_SWEEP
+       || sweep_active
+#endif
+#ifdef USE_ANTENNA_ANALYZER
+       || analyzer_active
+#endif
+#ifdef USE_FSK_BEACON
+       || beacon_active
+#endif
+       ;
+}
+
+#ifdef USE_POWER_DOWN_SLEEP
+/**
+ * pins that wake the processor from power down
+ */
+const uint8_t wakePins[] = {
+#ifndef USE_PIN_CHANGE_ENCODER
+                             ENCODER_PIN_A
+                           , ENCODER_PIN_B
+                           ,
+#endif
+                             VFO_SELECTOR_PIN
+                           , FRQ_DELTA_SELECTOR_PIN };
+
+#define NUMBER_OF_WAKE_PINS   (sizeof(wakePins)/sizeof(wakePins[0]))
+
+/**
+ * checks that every wake pin has a pin change interrupt
+ * @return true if power down sleep can be used on this board
+ */
+boolean wakePinsSupported() {
+   for (uint8_t ii=0; ii<NUMBER_OF_WAKE_PINS; ++ii) {
+      if (digitalPinToPCICR(wakePins[ii]) == 0) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * arms or disarms the pin change interrupts on the wake pins
+ * @param  flag  true to arm the wake pins
+ */
+void enableWakePins(boolean flag) {
+   for (uint8_t ii=0; ii<NUMBER_OF_WAKE_PINS; ++ii) {
+      uint8_t pin = wakePins[ii];
+
+      if (flag) {
+         *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+         PCIFR                   |= bit(digitalPinToPCICRbit(pin));
+         *digitalPinToPCICR(pin) |= bit(digitalPinToPCICRbit(pin));
+      }
+      else {
+         *digitalPinToPCMSK(pin) &= ~bit(digitalPinToPCMSKbit(pin));
+      }
+   }
+}
+
+/**
+ * puts the processor in power down until a wake pin changes
+ */
+void powerDown() {
+   // let any pending serial output drain, the uart stops in power down
+   Serial.flush();
+
+   // the watchdog would reset us out of a long sleep
+   stallBreadcrumb(STALL_TASK_SLEEP);
+   wdt_disable();
+
+   set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+   noInterrupts();
+   enableWakePins(true);
+   if (!vfoHasPendingWork()) {
+      sleep_enable();
+      interrupts();
+      sleep_cpu();
+      sleep_disable();
+   }
+   interrupts();
+   enableWakePins(false);
+   armStallWatchdog();
+
+   idle_activity_time = millis();
+}
+#endif // USE_POWER_DOWN_SLEEP
+
+/**
+ * puts the processor in idle sleep until the next interrupt
+ * does not sleep if an event is already waiting
+ * @return true if an event is waiting
+ */
+boolean idleSleep() {
+   boolean eventPending;
+
+   set_sleep_mode(SLEEP_MODE_IDLE);
+   noInterrupts();
+   eventPending = !vfoEvents.isEmpty();
+#ifdef USE_CAT_CONTROL
+   eventPending = eventPending || catInputWaiting();
+#endif
+#ifdef USE_FREQUENCY_SWEEP
+   eventPending = eventPending || frequencySweep.needsRefill();
+#endif
+#ifdef USE_ANTENNA_ANALYZER
+   eventPending = eventPending || detectorSampler.ready();
+#endif
+   if (!eventPending) {
+      // the instruction after sei always runs, so no
+      // interrupt can sneak in before the sleep
+      sleep_enable();
+      interrupts();
+      sleep_cpu();
+      sleep_disable();
+   }
+   interrupts();
+
+   return eventPending;
+}
+
+/**
+ * waits out the time between loop passes
+ * Returns early when an interrupt has posted an event.
+ * The time since the start of the previous pass is left in
+ * loop_elapsed_mils, for use by anything counting down time
+ * in the loop.
+ */
+void waitForNextLoopTick() {
+#ifdef USE_IDLE_SLEEP
+   unsigned long waitStart = millis();
+
+   noInterrupts();
+   boolean busy = vfoHasPendingWork();
+   interrupts();
+
+   if (busy) {
+      idle_activity_time = waitStart;
+   }
+
+#if defined(USE_POWER_DOWN_SLEEP) && !defined(USE_CAT_CONTROL)
+   if (!busy && ((waitStart - idle_activity_time) > IDLE_POWER_DOWN_DELAY_MILS)
+             && wakePinsSupported()) {
+      powerDown();
+   }
+#endif
+
+   while ((millis() - waitStart) < LOOP_DELAY_MILS) {
+      if (idleSleep()) {
+         // handle the event right away
+         idle_activity_time = millis();
+         break;
+      }
+   }
+#else
+   delay(LOOP_DELAY_MILS);
+#endif
+
+   unsigned long tm = millis();
+   loop_elapsed_mils = tm - loop_tick_time;
+   loop_tick_time = tm;
+}
+
+#endif // IDLESLEEP_H
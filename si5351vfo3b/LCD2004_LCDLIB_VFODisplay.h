@@ -40,9 +40,10 @@
 class LCD2004_LCDLib_VFODisplay : public VFODisplay {
 protected:   
    /**
-    * pointer to externally defined LCD display object
+    * LCD display object, held in place so nothing is
+    * allocated on the heap
     */
-   LiquidCrystal_I2C *mp_display;
+   LiquidCrystal_I2C m_display;
    
    /**
     * show vfos display method 
@@ -51,23 +52,26 @@ protected:
       short int screenLine = 0;
       
       if (mb_show_heading_line) {
-      mp_display->setCursor(0, screenLine++); // Start at character 0, line 0
-      mp_display->print(HEADING_PREFIX);
-      mp_display->print(ml_freq_delta, DEC);
+      m_display.setCursor(0, screenLine++); // Start at character 0, line 0
+      if (formatOffset()) {
+         m_display.print(ms_buffer);
+      }
+      else {
+         m_display.print(F(HEADING_PREFIX));
+      }
+      m_display.print(ml_freq_delta, DEC);
       }
       
-      for (int ii = 0; ii<mi_number_of_vfos; ++ii) {
-         mi_displayLine = ii;
-         mb_enabled = mpp_vfos[mi_displayLine]->isEnabled();
-         ml_freq = mpp_vfos[mi_displayLine]->getFrequency();
+      for (int ii = 0; ii<mi_number_of_lines; ++ii) {
+         loadDisplayLine(mi_firstBand + ii);
          
-         mp_display->setCursor(11, screenLine++); // Start at character 0, line ii+1
+         m_display.setCursor(11, screenLine++); // Start at character 0, line ii+1
 
          formatIndicator();
-         mp_display->write(ms_buffer[0]);
+         m_display.write(ms_buffer[0]);
          
          formatFrequencyMHz();  
-         mp_display->print(ms_buffer);
+         m_display.print(ms_buffer);
       }      
    }
    
@@ -75,59 +79,54 @@ protected:
     * show vfos display method 
     */
    void displayFrequencyDeltaScreen() {
-      mp_display->setCursor(0, 0); // Start at character 0, line 1
-      mp_display->write(mc_freqDelta);
-      mp_display->print(" freq =");
+      m_display.setCursor(0, 0); // Start at character 0, line 1
+      m_display.write(mc_freqDelta);
+      m_display.print(F(" freq ="));
       
-      mp_display->setCursor(0, 1); // Start at character 0, line 2
-      mp_display->print(ml_freq_delta, DEC);
+      m_display.setCursor(0, 1); // Start at character 0, line 2
+      m_display.print(ml_freq_delta, DEC);
    }
    
 public:
    /**
     * Constructor 
     * 
-    * @param  vfo list
-    * @param  num_vfos number of vfos to show in display
+    * @param  bank   band list to show
+    * @param  lines  number of band lines in display
     */
-   LCD2004_LCDLib_VFODisplay(VFODefinition **vfos
-                           , int num_vfos
+   LCD2004_LCDLib_VFODisplay(VFOBank *bank
+                           , int lines
                            , boolean show_header)
-   : VFODisplay(vfos, num_vfos, show_header)
+   : VFODisplay(bank, lines, show_header)
+   , m_display(0x20, 4, 5, 6, 0, 1, 2, 3, 7, NEGATIVE)  // Set the LCD I2C address     
    { 
       // override some of the default display characters
       mc_indicator = '~'; // this renders as a right arrow
       mc_disabled  = 219; // alt 165
       mc_freqDelta = 94;
-       
-      mp_display = new LiquidCrystal_I2C(0x20, 4, 5, 6, 0, 1, 2, 3, 7, NEGATIVE);  // Set the LCD I2C address     
-       
-      mp_display->begin(20,4);         // initialize the lcd for 20 chars 4 lines
-      mp_display->clear();
-      mp_display->backlight();
    }
    
    /**
-    * Destructor 
+    * sets up the lcd
     */
-   virtual ~LCD2004_LCDLib_VFODisplay() 
-   {
-      if (mp_display != 0) {
-         delete mp_display;
-         mp_display = 0;
-      }
+   virtual void begin() {
+      m_display.begin(20,4);         // initialize the lcd for 20 chars 4 lines
+      m_display.clear();
+      m_display.backlight();
    }
 
    /**
-    * display heading line and all vfos 
+    * display heading line and the window of bands around the
+    * selected one
     * @param  f_delta current frequency change increment
-    * @param  currentVFO subscript of selected vfo in list (from 0)
+    * @param  currentVFO subscript of selected band in list (from 0)
     */
    void showVFOs(unsigned long f_delta, short currentVFO) {
       ml_freq_delta = f_delta;
       mi_currentVFO = currentVFO;
+      scrollToCurrent();
       
-      mp_display->clear();
+      m_display.clear();
       displayVFOScreen();
    }
      
@@ -138,7 +137,7 @@ public:
    virtual void showFreqDeltaDisplay(unsigned long f_delta) {
       ml_freq_delta = f_delta;
       
-      mp_display->clear();      
+      m_display.clear();      
       displayFrequencyDeltaScreen();
    }
 };   
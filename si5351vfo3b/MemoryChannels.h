@@ -0,0 +1,348 @@
+#ifndef MEMORYCHANNELS_H
+#define MEMORYCHANNELS_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class MemoryChannels, which holds the memory
+ * channels of the VFO - a frequency, the band it is on and its flags
+ * each - and steps a scan through them, one channel per tick of a
+ * timer interrupt.
+ *
+ * The channel plan is worked out when a channel is stored: the chip
+ * and clock of its band, and its multisynth register block, from
+ * Si5351Group::multisynth(), as a frequency load writes it. A hop is
+ * then no arithmetic at all. step(), called from the timer interrupt,
+ * sends the block of the next channel in one write, and on a hop
+ * between channels of the same output only the registers from the
+ * first one that differs: channels within a band share the output
+ * divider and the high bits of the divider. A hop to a channel of
+ * another output writes its block while that output is still off,
+ * then turns the two outputs over in one write of the output enables.
+ *
+ * The SRAM kept for each channel is 16 bytes, in an array the sketch
+ * sizes. The crystal correction is in PLL A (see Si5351Group.h), so
+ * the blocks stay good when it changes.
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+
+#include "BandDefinition.h"
+#include "Si5351Group.h"
+
+/**
+ * no channel, for an empty plan or a scan not yet on one
+ */
+#define MEMORY_NO_CHANNEL             0xff
+
+/**
+ * channel flags
+ */
+#define MEMORY_CHANNEL_USED           0x01    // channel holds a frequency
+#define MEMORY_CHANNEL_SKIP           0x02    // passed over by a scan
+
+/**
+ * one memory channel, with its registers worked out
+ */
+struct MemoryChannel {
+   unsigned long  frequency;
+   uint8_t        band;
+   uint8_t        flags;
+   uint8_t        device;
+   uint8_t        clock;
+   uint8_t        params[SI5351_PARAMETERS_LENGTH];
+};
+
+/**
+ * This class holds the memory channels and scans through them
+ */
+class MemoryChannels {
+protected:
+   /**
+    * chips running the outputs
+    */
+   Si5351Group           &m_devices;
+
+   /**
+    * band table in flash
+    */
+   const BandDefinition  *mp_bands;
+   uint8_t                mc_bandCount;
+
+   /**
+    * the channels, supplied by the sketch
+    */
+   MemoryChannel         *mp_channels;
+   uint8_t                mc_count;
+
+   /**
+    * interrupt side: channel the scan is on, the one whose block is
+    * on the scan's output, that output, and the hops made
+    */
+   volatile uint8_t       mc_current;
+   volatile uint8_t       mc_sent;
+   uint8_t                mc_device;
+   uint8_t                mc_clock;
+   volatile uint16_t      mi_hops;
+   volatile boolean       mb_running;
+
+   /**
+    * sends the registers of a channel and turns its output on, the
+    * output the scan was on off
+    */
+   void hop(uint8_t channel) {
+      const MemoryChannel &to = mp_channels[channel];
+      uint8_t first = 0;
+
+      if (  (mc_sent != MEMORY_NO_CHANNEL)
+         && (to.device == mc_device) && (to.clock == mc_clock)) {
+         const uint8_t *from = mp_channels[mc_sent].params;
+         while ((first < SI5351_PARAMETERS_LENGTH) && (to.params[first] == from[first])) {
+            ++first;
+         }
+      }
+      if (first < SI5351_PARAMETERS_LENGTH) {
+         m_devices.writeMultisynth(to.device, (si5351_clock)to.clock, to.params, first);
+      }
+
+      if ((to.device != mc_device) || (to.clock != mc_clock)) {
+         m_devices.outputEnable(mc_device, (si5351_clock)mc_clock, false);
+         mc_device = to.device;
+         mc_clock  = to.clock;
+      }
+      m_devices.outputEnable(mc_device, (si5351_clock)mc_clock, true);
+      m_devices.flush();
+
+      mc_sent    = channel;
+      mc_current = channel;
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  devices    SI5351 chips running the outputs
+    * @param  bands      band table in PROGMEM
+    * @param  bandCount  number of bands in the table
+    * @param  channels   array of count channels
+    * @param  count      number of channels
+    */
+   MemoryChannels(Si5351Group &devices
+                , const BandDefinition *bands
+                , uint8_t bandCount
+                , MemoryChannel *channels
+                , uint8_t count)
+   : m_devices(devices)
+   , mp_bands(bands)
+   , mc_bandCount(bandCount)
+   , mp_channels(channels)
+   , mc_count(count)
+   , mc_current(MEMORY_NO_CHANNEL)
+   , mc_sent(MEMORY_NO_CHANNEL)
+   , mc_device(0)
+   , mc_clock(0)
+   , mi_hops(0)
+   , mb_running(false)
+   {
+      for (uint8_t ii=0; ii<mc_count; ++ii) {
+         mp_channels[ii].flags = 0;
+      }
+   }
+
+   /**
+    * gets number of channels
+    */
+   uint8_t count() const {
+      return mc_count;
+   }
+
+   /**
+    * checks whether a channel holds a frequency
+    * @param  channel  channel number, below count()
+    */
+   boolean isUsed(uint8_t channel) const {
+      return (mp_channels[channel].flags & MEMORY_CHANNEL_USED) != 0;
+   }
+
+   /**
+    * gets the frequency of a channel
+    * @return Hz, 0 if the channel is empty
+    */
+   unsigned long frequency(uint8_t channel) const {
+      return isUsed(channel) ? mp_channels[channel].frequency : 0;
+   }
+
+   /**
+    * gets the band of a channel
+    */
+   uint8_t band(uint8_t channel) const {
+      return mp_channels[channel].band;
+   }
+
+   /**
+    * gets the flags of a channel
+    * @return MEMORY_CHANNEL_* flags
+    */
+   uint8_t flags(uint8_t channel) const {
+      return mp_channels[channel].flags;
+   }
+
+   /**
+    * stores a channel and works out its registers, or empties it
+    * Call while the scan is stopped.
+    * @param  channel  channel number
+    * @param  f        frequency in Hz, 0 to empty the channel
+    * @param  band     band the frequency is on
+    * @param  flags    MEMORY_CHANNEL_SKIP or 0
+    * @return false if the channel or band is out of range, or the
+    *         band does not cover the frequency, or the divider cannot
+    *         reach it
+    */
+   boolean store(uint8_t channel, unsigned long f, uint8_t band, uint8_t flags) {
+      if (channel >= mc_count) {
+         return false;
+      }
+      MemoryChannel &to = mp_channels[channel];
+      if (f == 0) {
+         to.flags = 0;
+         return true;
+      }
+      if (band >= mc_bandCount) {
+         return false;
+      }
+
+      BandReader reader(&mp_bands[band]);
+      if ((f < reader.minFrequency()) || (f > reader.maxFrequency())) {
+         return false;
+      }
+      if (!Si5351Group::multisynth(reader.pllFrequency(), f, to.params)) {
+         return false;
+      }
+      to.frequency = f;
+      to.band      = band;
+      to.flags     = MEMORY_CHANNEL_USED | (flags & MEMORY_CHANNEL_SKIP);
+      to.device    = reader.device();
+      to.clock     = reader.clock();
+      return true;
+   }
+
+   /**
+    * finds the next channel a scan stops on
+    * @param  from  channel to start after, MEMORY_NO_CHANNEL for the
+    *               first
+    * @return channel, MEMORY_NO_CHANNEL if none is used and not skipped
+    */
+   uint8_t next(uint8_t from) const {
+      for (uint8_t ii=1; ii<=mc_count; ++ii) {
+         uint8_t channel = (from == MEMORY_NO_CHANNEL) ? (ii - 1) : ((from + ii) % mc_count);
+         if ((mp_channels[channel].flags & (MEMORY_CHANNEL_USED | MEMORY_CHANNEL_SKIP)) == MEMORY_CHANNEL_USED) {
+            return channel;
+         }
+      }
+      return MEMORY_NO_CHANNEL;
+   }
+
+   /**
+    * sets up a scan from the channel after the one it was last on;
+    * the first step() sends the whole block of that channel. Call
+    * with the timer stopped.
+    * @param  device  chip of the output on now
+    * @param  clk     that output, turned off on the first hop to
+    *                 another
+    * @return false if there is no channel to scan
+    */
+   boolean begin(uint8_t device, si5351_clock clk) {
+      mc_device  = device;
+      mc_clock   = clk;
+      mc_sent    = MEMORY_NO_CHANNEL;
+      mi_hops    = 0;
+      mb_running = (next(mc_current) != MEMORY_NO_CHANNEL);
+      return mb_running;
+   }
+
+   /**
+    * ends the scan; the output is left on the channel it was on
+    */
+   void stop() {
+      mb_running = false;
+   }
+
+   /**
+    * hops to the next channel, call from the timer interrupt
+    * @return false once the scan has been stopped
+    */
+   boolean step() {
+      if (!mb_running) {
+         return false;
+      }
+      uint8_t channel = next(mc_current);
+      if (channel == MEMORY_NO_CHANNEL) {
+         mb_running = false;
+         return false;
+      }
+
+      hop(channel);
+      ++mi_hops;
+      return true;
+   }
+
+   /**
+    * checks whether the scan is running
+    */
+   boolean running() const {
+      return mb_running;
+   }
+
+   /**
+    * gets the channel the scan is on, or was last on
+    * @return channel, MEMORY_NO_CHANNEL before the first scan
+    */
+   uint8_t current() const {
+      return mc_current;
+   }
+
+   /**
+    * gets the number of hops made since begin()
+    */
+   uint16_t hops() const {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      uint16_t n = mi_hops;
+      SREG = oldSREG;
+      return n;
+   }
+
+   /**
+    * gets the chip of the output the scan is on
+    */
+   uint8_t device() const {
+      return mc_device;
+   }
+
+   /**
+    * gets the output the scan is on
+    */
+   si5351_clock clock() const {
+      return (si5351_clock)mc_clock;
+   }
+};
+
+#endif // MEMORYCHANNELS_H
@@ -0,0 +1,95 @@
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the class implementation for PinChangeEncoder.
+ */
+#include <Arduino.h>
+#include "PinChangeEncoder.h"
+
+/**
+ * transition table states
+ * The encoder rests with both pins high (column 3). An up step is
+ * the sequence 3 -> 1 -> 0 -> 2 -> 3, a down step 3 -> 2 -> 0 -> 1 -> 3.
+ */
+#define PCE_START         0x0
+#define PCE_UP_FINAL      0x1
+#define PCE_UP_BEGIN      0x2
+#define PCE_UP_NEXT       0x3
+#define PCE_DOWN_BEGIN    0x4
+#define PCE_DOWN_FINAL    0x5
+#define PCE_DOWN_NEXT     0x6
+
+const uint8_t PinChangeEncoder::transitionTable[7][4] PROGMEM = {
+   // pins:  00               01               10               11
+   { PCE_START,      PCE_UP_BEGIN,    PCE_DOWN_BEGIN,  PCE_START                       }, // START
+   { PCE_UP_NEXT,    PCE_START,       PCE_UP_FINAL,    PCE_START | PCENCODER_DIR_UP    }, // UP_FINAL
+   { PCE_UP_NEXT,    PCE_UP_BEGIN,    PCE_START,       PCE_START                       }, // UP_BEGIN
+   { PCE_UP_NEXT,    PCE_UP_BEGIN,    PCE_UP_FINAL,    PCE_START                       }, // UP_NEXT
+   { PCE_DOWN_NEXT,  PCE_START,       PCE_DOWN_BEGIN,  PCE_START                       }, // DOWN_BEGIN
+   { PCE_DOWN_NEXT,  PCE_DOWN_FINAL,  PCE_START,       PCE_START | PCENCODER_DIR_DOWN  }, // DOWN_FINAL
+   { PCE_DOWN_NEXT,  PCE_DOWN_FINAL,  PCE_DOWN_BEGIN,  PCE_START                       }  // DOWN_NEXT
+};
+
+PinChangeEncoder *PinChangeEncoder::groupList[PCENCODER_NUMBER_OF_GROUPS] = { 0, 0, 0 };
+
+/**
+ * sets up encoder pins with pullups, adds the encoder to its
+ * pin change group and enables the pin change interrupts
+ *
+ * @return  false if the pins do not support pin change interrupts
+ */
+bool PinChangeEncoder::initialize() {
+   volatile uint8_t *pcicr = digitalPinToPCICR(mc_pinA);
+   uint8_t group = digitalPinToPCICRbit(mc_pinA);
+
+   // both pins must be in the same port and pin change group
+   if (  (pcicr == 0)
+      || (digitalPinToPCICR(mc_pinB) == 0)
+      || (digitalPinToPCICRbit(mc_pinB) != group)
+      || (digitalPinToPort(mc_pinA) != digitalPinToPort(mc_pinB))
+      || (group >= PCENCODER_NUMBER_OF_GROUPS)) {
+      return false;
+   }
+
+   pinMode(mc_pinA, INPUT_PULLUP);
+   pinMode(mc_pinB, INPUT_PULLUP);
+
+   mp_inputRegister = portInputRegister(digitalPinToPort(mc_pinA));
+   mc_maskA = digitalPinToBitMask(mc_pinA);
+   mc_maskB = digitalPinToBitMask(mc_pinB);
+
+   // link into group list and enable the pin interrupts as one step
+   uint8_t oldSREG = SREG;
+   noInterrupts();
+
+   mc_state    = PCE_START;
+   mc_lastPins = readPins();
+   mp_next     = groupList[group];
+   groupList[group] = this;
+
+   *digitalPinToPCMSK(mc_pinA) |= bit(digitalPinToPCMSKbit(mc_pinA));
+   *digitalPinToPCMSK(mc_pinB) |= bit(digitalPinToPCMSKbit(mc_pinB));
+   PCIFR  |= bit(group);
+   *pcicr |= bit(group);
+
+   SREG = oldSREG;
+   return true;
+}
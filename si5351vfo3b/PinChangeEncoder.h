@@ -0,0 +1,203 @@
+#ifndef _PINCHANGEENCODER_H_
+#define _PINCHANGEENCODER_H_
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the class definition for PinChangeEncoder. This
+ * class decodes a quadrature rotary encoder from pin change interrupts,
+ * so it does not need the two external interrupt pins, and any number
+ * of encoders can share the pin change interrupt of a port.
+ *
+ * All encoders share one state transition table. The table only reports
+ * a step when the encoder has gone through the whole quadrature cycle
+ * and come back to rest, so contact bounce just moves the state back
+ * and forth and never produces a false step. No debounce delay is
+ * needed in the interrupt handler.
+ *
+ * Each encoder counts its steps into a counter supplied by the sketch,
+ * which the sketch reads and clears the same way it handles the counter
+ * of the external interrupt encoder handlers. An optional step hook is
+ * called from the interrupt handler after each step, to let the sketch
+ * post an event.
+ *
+ * The pin change interrupt vectors themselves are defined by the
+ * sketch (see PinChangeInterrupts.h), and call serviceGroup().
+ */
+
+#include <Arduino.h>
+
+/**
+ * number of pin change interrupt groups on the processor
+ * (PCINT0_vect .. PCINT2_vect on the AT328 and AT2560)
+ */
+#define PCENCODER_NUMBER_OF_GROUPS   3
+
+/**
+ * step direction flags returned by the transition table
+ */
+#define PCENCODER_DIR_NONE           0x00
+#define PCENCODER_DIR_UP             0x10
+#define PCENCODER_DIR_DOWN           0x20
+#define PCENCODER_STATE_MASK         0x0f
+
+/**
+ * function called from the interrupt handler after each step
+ */
+typedef void (*PinChangeEncoderHook)();
+
+/**
+ * This class decodes one rotary encoder from pin change interrupts.
+ * Both encoder pins must be on the same port.
+ */
+class PinChangeEncoder {
+protected:
+
+  /**
+   * shared quadrature transition table, indexed by [state][pins]
+   */
+   static const uint8_t transitionTable[7][4];
+
+  /**
+   * head of the list of encoders on each pin change group
+   */
+   static PinChangeEncoder *groupList[PCENCODER_NUMBER_OF_GROUPS];
+
+  /**
+   * next encoder on the same pin change group
+   */
+   PinChangeEncoder *mp_next;
+
+  /**
+   * input register of the port the encoder is on
+   */
+   volatile uint8_t *mp_inputRegister;
+
+  /**
+   * counter receiving the encoder steps
+   */
+   volatile long    &ml_movement;
+
+  /**
+   * called after each step, may be null
+   */
+   PinChangeEncoderHook mp_stepHook;
+
+   uint8_t           mc_pinA;
+   uint8_t           mc_pinB;
+   uint8_t           mc_maskA;
+   uint8_t           mc_maskB;
+
+  /**
+   * current state in the transition table
+   */
+   uint8_t           mc_state;
+
+  /**
+   * pin reading at the last interrupt, as a table column
+   */
+   uint8_t           mc_lastPins;
+
+  /**
+   * reads encoder pins as a transition table column
+   *
+   * @return  (B << 1) | A
+   */
+   uint8_t readPins() const {
+      uint8_t port = *mp_inputRegister;
+      return ((port & mc_maskB) ? 2 : 0) | ((port & mc_maskA) ? 1 : 0);
+   }
+
+  /**
+   * advances the decoder on a pin change
+   * called from the pin change interrupt handler
+   */
+   void service() {
+      uint8_t pins = readPins();
+
+      if (pins != mc_lastPins) {
+         mc_lastPins = pins;
+         mc_state = pgm_read_byte(&transitionTable[mc_state & PCENCODER_STATE_MASK][pins]);
+
+         if (mc_state & PCENCODER_DIR_UP) {
+            ++ml_movement;
+         }
+         else if (mc_state & PCENCODER_DIR_DOWN) {
+            --ml_movement;
+         }
+         else {
+            return;
+         }
+
+         if (mp_stepHook != 0) {
+            mp_stepHook();
+         }
+      }
+   }
+
+public:
+
+  /**
+   * services all encoders on a pin change group
+   * call from the pin change interrupt vector of the group
+   *
+   * @param  group   pin change group number, 0 for PCINT0_vect
+   */
+   static void serviceGroup(uint8_t group) {
+      for (PinChangeEncoder *p = groupList[group]; p != 0; p = p->mp_next) {
+         p->service();
+      }
+   }
+
+  /**
+   * sets up encoder pins with pullups, adds the encoder to its
+   * pin change group and enables the pin change interrupts
+   *
+   * @return  false if the pins do not support pin change interrupts
+   */
+   bool initialize();
+
+  /**
+   * PinChangeEncoder Constructor
+   *
+   * @param  pa        encoder pin A
+   * @param  pb        encoder pin B
+   * @param  counter   counter receiving the encoder steps; incremented
+   *                   when B leads A, decremented when A leads B
+   * @param  hook      function called after each step. Default none.
+   */
+   PinChangeEncoder(uint8_t pa
+                  , uint8_t pb
+                  , volatile long &counter
+                  , PinChangeEncoderHook hook = 0)
+   : mp_next(0)
+   , mp_inputRegister(0)
+   , ml_movement(counter)
+   , mp_stepHook(hook)
+   , mc_pinA(pa)
+   , mc_pinB(pb)
+   , mc_maskA(0)
+   , mc_maskB(0)
+   , mc_state(0)
+   , mc_lastPins(3)
+   {}
+};
+
+#endif // _PINCHANGEENCODER_H_
@@ -0,0 +1,85 @@
+#ifndef PINCHANGEINTERRUPTS_H
+#define PINCHANGEINTERRUPTS_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the pin change interrupt vectors. They are used by
+ * the pin change encoder driver, and to wake the processor from power
+ * down sleep. Only one definition of each vector may exist, so both
+ * uses are served from here.
+ *
+ * A vector only serves the encoders of its own group, so the time
+ * spent per edge depends on the number of encoders sharing the port,
+ * not on the total number of encoders. An encoder whose pins did not
+ * change is skipped after one port read and compare.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#if defined(USE_PIN_CHANGE_ENCODER)
+
+/**
+ * service pin change interrupts for encoders on each group
+ * A button pin armed for wake up also lands here, and simply
+ * finds no encoder pins changed.
+ */
+ISR(PCINT0_vect) {
+   PinChangeEncoder::serviceGroup(0);
+}
+
+#ifdef PCINT1_vect
+ISR(PCINT1_vect) {
+   PinChangeEncoder::serviceGroup(1);
+}
+#endif
+
+#ifdef PCINT2_vect
+ISR(PCINT2_vect) {
+   PinChangeEncoder::serviceGroup(2);
+}
+#endif
+
+#elif defined(USE_POWER_DOWN_SLEEP)
+
+/**
+ * service wake up interrupt on any wake pin changing state
+ * The encoder edge interrupts are not running in power down,
+ * so the encoder handlers are run here to pick up the edge
+ * that woke us. They compare the pin to the last recorded
+ * state, so calling them for an unchanged pin does nothing.
+ */
+ISR(PCINT0_vect) {
+   encoderPinA_ISR();
+   encoderPinB_ISR();
+}
+
+#ifdef PCINT1_vect
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+
+#ifdef PCINT2_vect
+ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+#endif
+
+#endif
+
+#endif // PINCHANGEINTERRUPTS_H
@@ -27,9 +27,16 @@
  * be found here:
  * 
  * https://code.google.com/p/u8glib/
+ *
+ * The U8glib constructor sets up the SSD1306 controller over I2C at
+ * once, so the driver object is not a plain member: a member would be
+ * built with the globals, before setup() has the clock chip running.
+ * It is built in place by begin(), in storage held in the display
+ * object, so it is still statically allocated.
  */
  
 #include <Arduino.h> 
+#include <new.h>
 #include "VFODisplay.h"
 
 /**
@@ -38,6 +45,16 @@
 #define DISPLAY_FUNCTION_VFOS    0
 #define DISPLAY_FUNCTION_FDELTA  1
 
+/**
+ * U8glib driver, page buffer size selected by
+ * USE_SMALLER_SSD1306_128X64_BUFFER
+ */
+#ifdef USE_SMALLER_SSD1306_128X64_BUFFER
+typedef U8GLIB_SSD1306_128X64    SSD1306_Driver;
+#else
+typedef U8GLIB_SSD1306_128X64_2X SSD1306_Driver;
+#endif
+
 /**
  * This class implements the methods defined in base class
  * VFODisplay, using the Google U8glib library.
@@ -45,13 +62,11 @@
 class SSD1306_U8glib_VFODisplay : public VFODisplay {
 protected:   
    /**
-    * pointer to externally defined SSD1306 display object
+    * SSD1306 display object, built in mc_driver by begin() so
+    * nothing is allocated on the heap, 0 until then
     */
-#ifdef USE_SMALLER_SSD1306_128X64_BUFFER
-   U8GLIB_SSD1306_128X64 *mp_display;
-#else
-   U8GLIB_SSD1306_128X64_2X *mp_display;   
-#endif
+   SSD1306_Driver *mp_display;
+   alignas(SSD1306_Driver) uint8_t mc_driver[sizeof(SSD1306_Driver)];
 
    int             mi_displayFunc;     
 
@@ -68,17 +83,20 @@ protected:
          // small yellow header line
          mp_display->setFont(u8g_font_6x12);
          mp_display->setPrintPos(ix,iy);
-         mp_display->print(HEADING_PREFIX);
+         if (formatOffset()) {
+            mp_display->print(ms_buffer);
+         }
+         else {
+            mp_display->print(F(HEADING_PREFIX));
+         }
          mp_display->print(ml_freq_delta, DEC);
          
          // move to next line
          iy += 18;
       }
       
-      for (int ii = 0; ii<mi_number_of_vfos; ++ii) {
-         mi_displayLine = ii;
-         mb_enabled = mpp_vfos[mi_displayLine]->isEnabled();
-         ml_freq = mpp_vfos[mi_displayLine]->getFrequency();
+      for (int ii = 0; ii<mi_number_of_lines; ++ii) {
+         loadDisplayLine(mi_firstBand + ii);
          
          mp_display->setPrintPos(ix,iy);
          
@@ -112,7 +130,7 @@ protected:
       mp_display->setFont(u8g_font_10x20_67_75);
       mp_display->write(mc_freqDelta);
       mp_display->setFont(u8g_font_10x20);
-      mp_display->print(" freq=\n");
+      mp_display->print(F(" freq=\n"));
       
       iy += 17;
       mp_display->setPrintPos(ix,iy);
@@ -124,6 +142,10 @@ protected:
     * refreshes and paints the display
     */
    virtual void paint() {
+      if (mp_display == 0) {
+         return;
+      }
+
       // picture loop
       mp_display->firstPage();  
       do {
@@ -143,20 +165,23 @@ public:
    /**
     * Constructor 
     * 
-    * @param  vfo list
-    * @param  num_vfos number of vfos to show in display
+    * @param  bank   band list to show
+    * @param  lines  number of band lines in display
     */
-   SSD1306_U8glib_VFODisplay(VFODefinition **vfos
-                           , int num_vfos
+   SSD1306_U8glib_VFODisplay(VFOBank *bank
+                           , int lines
                            , boolean show_header)
-   : VFODisplay(vfos, num_vfos, show_header)
+   : VFODisplay(bank, lines, show_header)
+   , mp_display(0)
    , mi_displayFunc(0)
-   {  
-#ifdef USE_SMALLER_SSD1306_128X64_BUFFER
-      mp_display = new U8GLIB_SSD1306_128X64(U8G_I2C_OPT_NONE|U8G_I2C_OPT_DEV_0);	// I2C / TWI;
-#else
-      mp_display = new U8GLIB_SSD1306_128X64_2X(U8G_I2C_OPT_NONE|U8G_I2C_OPT_DEV_0);	// I2C / TWI;
-#endif      
+   {}
+
+   /**
+    * builds the driver, which sets up the controller
+    */
+   virtual void begin() {
+      mp_display = new (mc_driver) SSD1306_Driver(U8G_I2C_OPT_NONE|U8G_I2C_OPT_DEV_0);	// I2C / TWI
+
       // assign default color value
       if ( mp_display->getMode() == U8G_MODE_R3G3B2 ) {
          mp_display->setColorIndex(255);     // white
@@ -172,20 +197,15 @@ public:
       }
    }
    /**
-    * Destructor 
-    */
-   virtual ~SSD1306_U8glib_VFODisplay() 
-   {
-   }
-
-   /**
-    * display heading line and all vfos 
+    * display heading line and the window of bands around the
+    * selected one
     * @param  f_delta current frequency change increment
-    * @param  currentVFO subscript of selected vfo in list (from 0)
+    * @param  currentVFO subscript of selected band in list (from 0)
     */
    void showVFOs(unsigned long f_delta, short currentVFO) {
       ml_freq_delta = f_delta;
       mi_currentVFO = currentVFO;
+      scrollToCurrent();
       mi_displayFunc = DISPLAY_FUNCTION_VFOS;
       
       // repaint screen with current display
@@ -0,0 +1,381 @@
+#ifndef SCANCONTROL_H
+#define SCANCONTROL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions scanning the memory channels, built in
+ * when USE_MEMORY_SCAN is defined. Channels are stored, read,
+ * recalled and scanned with CAT commands of this VFO's own, run here
+ * for CATControl.h; nn is a channel number, 2 digits:
+ *
+ *    MWnn;        store the dial frequency of the selected band
+ *    MWnnfffffffffffs;                   store a frequency in Hz (11
+ *                                        digits) on the band covering
+ *                                        it, s 1 to skip it when
+ *                                        scanning; 0 Hz empties it
+ *    MRnn;        MRnnfffffffffffbbbs;   frequency, band (3 digits)
+ *                                        and skip flag, 0 Hz if empty
+ *    MCnn;                               recall it to the dial
+ *    SCddddddd;                          scan, dwell us (7 digits) on
+ *                                        each channel
+ *    SC0; SC1;                           stop, resume after a pause
+ *    SC;          SCrnnhhhhh;            r 0 stopped, 1 scanning, 2
+ *                                        paused; channel on, hops
+ *                                        made (5 digits)
+ *
+ * Channels cannot be stored while a scan runs. The channels are kept
+ * in EEPROM (see StatePersistence.h).
+ *
+ * A scan goes round the channels that are not marked skip, in channel
+ * order, a dwell on each, until it is paused or stopped. The hops are
+ * timed by the sweep's Timer1 compare interrupt (see SweepControl.h),
+ * which sends the registers worked out when the channel was stored
+ * (see MemoryChannels.h) in one write: 3 to 8 of them to a channel on
+ * the same output, all 8 to another, with a write of the output
+ * enables after. A hop within an output is about 0.65 ms of bus time
+ * and one to another output 1.2 ms, both inside the shortest dwell
+ * the timer takes, SWEEP_MIN_DWELL_MICROS: 500 channels a second.
+ *
+ * As with a sweep, a running scan owns the clock chip bus; the loop
+ * waits it out. A button press or a turn of the encoder pauses it on
+ * the channel it is on: that channel's band is selected and tuned to
+ * it, as from the dial, and the press or turn is taken by the pause.
+ * A paused scan can be resumed from the next channel. It stops on SC0
+ * or a CAT frequency set, which load the dial frequency back.
+ */
+
+#include <Arduino.h>
+#include "CATParser.h"
+
+/**
+ * events that pause a scan: the operator's. The display's own are
+ * dropped while it runs, and made up by a repaint when it ends
+ */
+#define SCAN_PAUSE_EVENTS  (bit(EVENT_ENCODER_STEP) | bit(EVENT_BUTTON_SHORT) | bit(EVENT_BUTTON_LONG))
+
+/**
+ * MW, MR, MC and SC command fields
+ */
+#define CAT_CHANNEL_DIGITS                2
+#define CAT_CHANNEL_FREQUENCY             2
+#define CAT_CHANNEL_SKIP                 13
+#define CAT_CHANNEL_LENGTH               14
+#define CAT_CHANNEL_BAND_DIGITS           3
+#define CAT_SCAN_DWELL_DIGITS             7
+#define CAT_SCAN_HOPS_DIGITS              5
+
+/**
+ * tunes a band from CAT, in CATControl.h
+ */
+void setBandFrequency(uint8_t band, unsigned long f);
+
+/**
+ * true from the start of a scan until it is paused or stopped, and
+ * true while it is paused, with its dwell kept for resuming
+ */
+boolean       scan_active = false;
+boolean       scan_paused = false;
+unsigned long scan_dwell;
+
+/**
+ * hops to the next channel, called from the Timer1 interrupt
+ * @return true while the scan runs
+ */
+boolean scanTick() {
+   return memoryChannels.step();
+}
+
+/**
+ * stops the timer and the scan, leaving the output as it is
+ */
+void haltScan() {
+   stopSweepTimer();
+   memoryChannels.stop();
+   scan_active = false;
+}
+
+/**
+ * ends a scan, running or paused, and loads the dial frequency of
+ * the selected band back into its clock, the output the scan was on
+ * turned off, and repaints the display
+ */
+void stopScan() {
+   scan_paused = false;
+   if (!scan_active) {
+      return;
+   }
+   haltScan();
+
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   si5351Devices.outputEnable(memoryChannels.device(), memoryChannels.clock(), false);
+   vfoBank.unload();
+   vfoBank.select(vfoBank.selected());
+   vfoEvents.postOnce(EVENT_FREQUENCY_CHANGED);
+}
+
+/**
+ * pauses the scan on the channel it is on, tuning the channel's band
+ * to it and dropping the waiting events, its repaint covering any
+ * of the display's
+ */
+void pauseScan() {
+   haltScan();
+   scan_paused = true;
+   vfoEvents.clear();
+
+   uint8_t channel = memoryChannels.current();
+   uint8_t band    = memoryChannels.band(channel);
+
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   vfoBank.unload();
+   vfoBank.restore(band, memoryChannels.frequency(channel), true);
+   vfoBank.select(band);
+   noteStateChange();
+   vfoEvents.postOnce(EVENT_FREQUENCY_CHANGED);
+}
+
+/**
+ * starts scanning from the channel after the one last scanned
+ * @param  dwell  us on each channel
+ * @return false if the dwell is out of range, or there is no channel
+ *         to scan
+ */
+boolean startScan(unsigned long dwell) {
+   if (  (dwell < SWEEP_MIN_DWELL_MICROS) || (dwell > SWEEP_MAX_DWELL_MICROS)
+      || (memoryChannels.next(MEMORY_NO_CHANNEL) == MEMORY_NO_CHANNEL)) {
+      return false;
+   }
+
+   // the output on now is turned off by the first hop to another
+   si5351_VFODefinition *vfo = vfoBank.active();
+   uint8_t      device = vfo->getDevice();
+   si5351_clock clk    = vfo->getClock();
+   if (scan_active) {
+      haltScan();
+      device = memoryChannels.device();
+      clk    = memoryChannels.clock();
+   }
+   else {
+      if (sweep_active) {
+         stopSweep();
+      }
+#ifdef USE_FSK_BEACON
+      stopBeacon();
+#endif
+   }
+
+   memoryChannels.begin(device, clk);
+   scan_dwell  = dwell;
+   scan_paused = false;
+
+   // first channel now, the rest one per dwell
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   memoryChannels.step();
+   startSweepTimer(dwell);
+   scan_active = true;
+   return true;
+}
+
+/**
+ * resumes a paused scan at its dwell
+ * @return false if no scan is paused
+ */
+boolean resumeScan() {
+   return scan_paused && startScan(scan_dwell);
+}
+
+/**
+ * pauses the scan when the encoder or a button has posted an event
+ * call once per loop pass
+ * @return true while the scan runs and owns the bus
+ */
+boolean checkScan() {
+   if (!scan_active) {
+      return false;
+   }
+   if (sweep_timer_running && !vfoEvents.clearUnless(SCAN_PAUSE_EVENTS)) {
+      return true;
+   }
+
+   if (sweep_timer_running) {
+      pauseScan();
+   }
+   else {
+      stopScan();
+   }
+   return false;
+}
+
+/**
+ * reads the channel number of an MW, MR or MC command
+ * @param  parser   holding the command
+ * @param  channel  set to the channel
+ * @return false if it is missing or out of range
+ */
+boolean catChannel(const CATParser &parser, unsigned long &channel) {
+   return (parser.parameterLength() >= CAT_CHANNEL_DIGITS)
+       && parser.number(0, CAT_CHANNEL_DIGITS, channel)
+       && (channel < memoryChannels.count());
+}
+
+/**
+ * runs an MW command, storing a memory channel
+ * @param  parser  holding the command
+ * @return false if the parameters are bad, no band covers the
+ *         frequency, or a scan is running
+ */
+boolean runChannelStoreCommand(const CATParser &parser) {
+   unsigned long channel, f, skip;
+   uint8_t       band = vfoBank.selected();
+
+   if (scan_active || !catChannel(parser, channel)) {
+      return false;
+   }
+   if (parser.parameterLength() == CAT_CHANNEL_DIGITS) {
+      f    = vfoBank.frequency(band);
+      skip = 0;
+   }
+   else if (  (parser.parameterLength() != CAT_CHANNEL_LENGTH)
+           || !parser.number(CAT_CHANNEL_FREQUENCY, CAT_FREQUENCY_DIGITS, f)
+           || !parser.number(CAT_CHANNEL_SKIP,      1,                    skip)
+           || (skip > 1)) {
+      return false;
+   }
+   else if (f != 0) {
+      band = vfoBank.bandFor(f);
+   }
+
+   if (!memoryChannels.store(channel, f, band, skip ? MEMORY_CHANNEL_SKIP : 0)) {
+      return false;
+   }
+   noteChannelChange();
+   return true;
+}
+
+/**
+ * runs an MC command, recalling a memory channel to the dial
+ * @param  parser  holding the command
+ * @return false if the parameters are bad or the channel is empty
+ */
+boolean runChannelRecallCommand(const CATParser &parser) {
+   unsigned long channel;
+
+   if (  (parser.parameterLength() != CAT_CHANNEL_DIGITS) || !catChannel(parser, channel)
+      || !memoryChannels.isUsed(channel)) {
+      return false;
+   }
+   setBandFrequency(memoryChannels.band(channel), memoryChannels.frequency(channel));
+   return true;
+}
+
+/**
+ * sends the MR answer, a memory channel
+ * @param  parser  holding the command
+ * @return false if the parameters are bad
+ */
+boolean sendChannel(const CATParser &parser) {
+   unsigned long channel;
+
+   if ((parser.parameterLength() != CAT_CHANNEL_DIGITS) || !catChannel(parser, channel)) {
+      return false;
+   }
+   Serial.print(F("MR"));
+   sendCATDigits(channel, CAT_CHANNEL_DIGITS);
+   sendCATDigits(memoryChannels.frequency(channel), CAT_FREQUENCY_DIGITS);
+   sendCATDigits(memoryChannels.isUsed(channel) ? memoryChannels.band(channel) : 0, CAT_CHANNEL_BAND_DIGITS);
+   Serial.write((memoryChannels.flags(channel) & MEMORY_CHANNEL_SKIP) ? '1' : '0');
+   Serial.write(';');
+   return true;
+}
+
+/**
+ * runs an SC command with parameters: starts, stops or resumes a scan
+ * @param  parser  holding the command
+ * @return false if the parameters are bad or the scan is refused
+ */
+boolean runScanCommand(const CATParser &parser) {
+   unsigned long value;
+
+   if (parser.parameterLength() == 1) {
+      if (!parser.number(value) || (value > 1)) {
+         return false;
+      }
+      if (value == 0) {
+         stopScan();
+         return true;
+      }
+      return resumeScan();
+   }
+
+   return (parser.parameterLength() == CAT_SCAN_DWELL_DIGITS)
+       && parser.number(value)
+       && startScan(value);
+}
+
+/**
+ * sends the scan status answer
+ */
+void sendScanStatus() {
+   uint8_t channel = memoryChannels.current();
+
+   Serial.print(F("SC"));
+   Serial.write(scan_active ? '1' : (scan_paused ? '2' : '0'));
+   sendCATDigits((channel == MEMORY_NO_CHANNEL) ? 0 : channel, CAT_CHANNEL_DIGITS);
+   sendCATDigits(memoryChannels.hops(), CAT_SCAN_HOPS_DIGITS);
+   Serial.write(';');
+}
+
+/**
+ * runs the command in a parser if it is the scan's, MW, MR, MC or
+ * SC, and answers it
+ * @param  parser  holding a whole command
+ * @return false if it is not a channel or scan command
+ */
+boolean runScanCATCommand(const CATParser &parser) {
+   boolean ok;
+
+   if (parser.is("MW")) {
+      ok = runChannelStoreCommand(parser);
+   }
+   else if (parser.is("MR")) {
+      ok = sendChannel(parser);
+   }
+   else if (parser.is("MC")) {
+      ok = runChannelRecallCommand(parser);
+   }
+   else if (parser.is("SC")) {
+      if (parser.parameterLength() == 0) {
+         sendScanStatus();
+         return true;
+      }
+      ok = runScanCommand(parser);
+   }
+   else {
+      return false;
+   }
+
+   if (!ok) {
+      Serial.print(F("?;"));
+   }
+   return true;
+}
+
+#endif // SCANCONTROL_H
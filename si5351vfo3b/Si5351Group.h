@@ -0,0 +1,479 @@
+#ifndef SI5351GROUP_H
+#define SI5351GROUP_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class Si5351Group, the SI5351 chips on the I2C
+ * bus. An output is a (device, clock) pair: the device is its index
+ * in the group, as named in the band table.
+ *
+ * All chips share the one bus, so transfers to different chips cannot
+ * overlap; what costs is the number of transfers. The library sets
+ * single bits (output enable, drive strength) by reading the register
+ * back and writing it again, three transfers per clock per call. The
+ * group does the same work in fewer, larger writes:
+ *
+ * - begin() sets up each chip with one write of the output enables
+ *   and one bulk write of all eight clock control registers, instead
+ *   of a read-modify-write per clock for each setting.
+ * - output enables are kept in a copy of each chip's register 3.
+ *   Changes are staged with outputEnable() and written by flush(),
+ *   one write per chip that changed, however many clocks on it did -
+ *   a band switch turning one clock off and another on is one write.
+ *
+ * Anything else that turns outputs on and off must go through the
+ * group too, or the copy goes stale.
+ *
+ * For a fast start the registers behind one output - crystal load,
+ * clock control, PLL A and the multisynth - can be read back into an
+ * image with readImage() and saved. restore() writes the image back
+ * in one burst and turns the output on, before begin(); begin() then
+ * sets up the rest of that chip without turning the output off or
+ * resetting its PLL again.
+ *
+ * Every clock runs from PLL A, as begin() sets the clock control
+ * registers, and outputs are loaded with multisynth(), which works
+ * out the eight register block, output divider included, and
+ * writeMultisynth(), which sends it in one write of under 1 ms. The
+ * clock must be in fractional mode, as begin() leaves it. A frequency
+ * the divider cannot reach from the PLL - above SI5351_PLL_FIXED / 8,
+ * 112.5 MHz - is refused by divider() and multisynth(), which return
+ * false, and the caller writes nothing. The library's set_freq is not used: in 1.x it puts every clock but
+ * CLK0 on PLL B, and programs PLL B again on each call from the
+ * crystal without this group's correction, then follows with three
+ * read-modify-writes, about 3.5 ms of bus time. PLL B stays as
+ * init() left it, running nothing.
+ *
+ * The crystal correction is not handed to the library either, which
+ * keeps it in parts per 10 million. setCorrection() folds it once
+ * into the reference PLL A is worked out from, in 1/SI5351_FREQ_MULT
+ * Hz, and writePll() sets PLL A from that. PLL A then runs at
+ * SI5351_PLL_FIXED itself, so every multisynth divider stays as it
+ * is and the correction costs nothing more, on every clock.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <si5351.h>
+
+/**
+ * chips in a group - the SI5351 answers at 0x60 or 0x61
+ */
+#define SI5351_GROUP_MAX_DEVICES         2
+#define SI5351_GROUP_CLOCKS              8
+
+/**
+ * largest crystal correction either way, parts per billion
+ */
+#define SI5351_GROUP_MAX_CORRECTION  200000L
+
+/**
+ * multisynth divider range, 8 to 2048
+ */
+#define SI5351_GROUP_MIN_DIVIDER         8
+#define SI5351_GROUP_MAX_DIVIDER      2048
+
+/**
+ * register image of one output, byte offsets
+ */
+#define SI5351_IMAGE_CLOCK               0
+#define SI5351_IMAGE_CRYSTAL_LOAD        1
+#define SI5351_IMAGE_CONTROL             2
+#define SI5351_IMAGE_PLL                 3
+#define SI5351_IMAGE_MULTISYNTH          (SI5351_IMAGE_PLL + SI5351_PARAMETERS_LENGTH)
+#define SI5351_IMAGE_LENGTH              (SI5351_IMAGE_MULTISYNTH + SI5351_PARAMETERS_LENGTH)
+
+/**
+ * This class holds the SI5351 chips and their output enables
+ */
+class Si5351Group {
+protected:
+   /**
+    * externally defined driver objects, one per chip
+    */
+   Si5351 * const *mpp_devices;
+   uint8_t         mc_count;
+
+   /**
+    * copy of register 3 of each chip, a set bit turns a clock off
+    */
+   uint8_t         mc_outputOff[SI5351_GROUP_MAX_DEVICES];
+
+   /**
+    * bit per chip with staged output changes
+    */
+   uint8_t         mc_changed;
+
+   /**
+    * bit per chip brought up by restore(), for begin()
+    */
+   uint8_t         mc_restored;
+
+   /**
+    * crystal correction in parts per billion, and the crystal
+    * frequency with it folded in, Hz * SI5351_FREQ_MULT
+    */
+   long               ml_correction;
+   unsigned long long ml_reference;
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  devices  array of driver objects, device 0 first
+    * @param  count    number of chips, up to SI5351_GROUP_MAX_DEVICES
+    */
+   Si5351Group(Si5351 * const *devices, uint8_t count)
+   : mpp_devices(devices)
+   , mc_count(count)
+   , mc_changed(0)
+   , mc_restored(0)
+   , ml_correction(0)
+   , ml_reference((unsigned long long)SI5351_XTAL_FREQ * SI5351_FREQ_MULT)
+   {
+      for (uint8_t ii=0; ii<SI5351_GROUP_MAX_DEVICES; ++ii) {
+         mc_outputOff[ii] = 0xff;
+      }
+   }
+
+   /**
+    * sets up every chip: crystal load, all outputs off, every clock
+    * on its own fractional multisynth from PLL A at one drive
+    * strength, PLL A at the fixed frequency
+    * A chip brought up by restore() keeps its output and PLL running.
+    * @param  xtal_load  crystal load capacitance, SI5351_CRYSTAL_LOAD_xPF
+    * @param  drive      output drive strength
+    */
+   void begin(uint8_t xtal_load, si5351_drive drive) {
+      uint8_t control[SI5351_GROUP_CLOCKS];
+      for (uint8_t ii=0; ii<SI5351_GROUP_CLOCKS; ++ii) {
+         control[ii] = SI5351_CLK_INPUT_MULTISYNTH_N | drive;
+      }
+
+      for (uint8_t ii=0; ii<mc_count; ++ii) {
+         Si5351 &chip = *mpp_devices[ii];
+         boolean restored = (mc_restored & bit(ii)) != 0;
+
+         if (!restored) {
+            chip.init(xtal_load, 0);
+
+            mc_outputOff[ii] = 0xff;
+            chip.si5351_write(SI5351_OUTPUT_ENABLE_CTRL, mc_outputOff[ii]);
+         }
+
+         // the restored clock gets the value it already has
+         chip.si5351_write_bulk(SI5351_CLK0_CTRL, SI5351_GROUP_CLOCKS, control);
+
+         if (!restored) {
+            writePll(ii);
+         }
+      }
+      mc_changed  = 0;
+      mc_restored = 0;
+   }
+
+   /**
+    * sets the crystal correction, for the next writePll() or begin()
+    * @param  ppb  crystal error in parts per billion, + when it runs
+    *              fast, within SI5351_GROUP_MAX_CORRECTION
+    * @return false if the correction is out of range
+    */
+   boolean setCorrection(long ppb) {
+      if ((ppb < -SI5351_GROUP_MAX_CORRECTION) || (ppb > SI5351_GROUP_MAX_CORRECTION)) {
+         return false;
+      }
+      long long xtal = (long long)SI5351_XTAL_FREQ * SI5351_FREQ_MULT;
+      long long err  = xtal * ppb;
+      ml_correction = ppb;
+      ml_reference  = xtal + (err + ((err < 0) ? -500000000LL : 500000000LL)) / 1000000000LL;
+      return true;
+   }
+
+   /**
+    * gets the crystal correction
+    * @return parts per billion
+    */
+   long getCorrection() const {
+      return ml_correction;
+   }
+
+   /**
+    * sets PLL A of a chip to SI5351_PLL_FIXED from the corrected
+    * crystal frequency, and resets it
+    * @param  device  index of chip in group
+    */
+   void writePll(uint8_t device) {
+      Si5351 &chip = *mpp_devices[device];
+      uint8_t params[SI5351_PARAMETERS_LENGTH];
+
+      unsigned long a = (unsigned long)(SI5351_PLL_FIXED / ml_reference);
+      unsigned long b = (unsigned long)(((SI5351_PLL_FIXED % ml_reference) * SI5351_FRAC_DENOM
+                                         + ml_reference / 2) / ml_reference);
+      if (b >= SI5351_FRAC_DENOM) {
+         ++a;
+         b = 0;
+      }
+      multisynthRegisters(a, b, 0, params);
+      chip.si5351_write_bulk(SI5351_PLLA_PARAMETERS, SI5351_PARAMETERS_LENGTH, params);
+      chip.si5351_write(SI5351_PLL_RESET, SI5351_PLL_RESET_A);
+   }
+
+   /**
+    * reads back the registers running an output
+    * One register per read, as the library offers: use when the bus
+    * is not busy, not on the tuning path.
+    * @param  device  index of chip in group
+    * @param  clk     clock output on the chip
+    * @param  image   SI5351_IMAGE_LENGTH bytes
+    */
+   void readImage(uint8_t device, si5351_clock clk, uint8_t *image) {
+      Si5351 &chip = *mpp_devices[device];
+
+      image[SI5351_IMAGE_CLOCK]        = clk;
+      image[SI5351_IMAGE_CRYSTAL_LOAD] = chip.si5351_read(SI5351_CRYSTAL_LOAD);
+      image[SI5351_IMAGE_CONTROL]      = chip.si5351_read(SI5351_CLK0_CTRL + clk);
+      for (uint8_t ii=0; ii<SI5351_PARAMETERS_LENGTH; ++ii) {
+         image[SI5351_IMAGE_PLL + ii]        = chip.si5351_read(SI5351_PLLA_PARAMETERS + ii);
+         image[SI5351_IMAGE_MULTISYNTH + ii] = chip.si5351_read(SI5351_CLK0_PARAMETERS
+                                                              + SI5351_PARAMETERS_LENGTH * clk + ii);
+      }
+   }
+
+   /**
+    * brings one output of a chip straight up from a register image,
+    * at power up before begin()
+    * Writes the image back to back and resets PLL A, then turns the
+    * output on: seven writes, 21 register bytes.
+    * @param  device  index of chip in group
+    * @param  image   SI5351_IMAGE_LENGTH bytes, from readImage()
+    * @param  enable  true to turn the output on
+    */
+   void restore(uint8_t device, const uint8_t *image, boolean enable) {
+      Si5351 &chip = *mpp_devices[device];
+      uint8_t clk  = image[SI5351_IMAGE_CLOCK];
+
+      Wire.begin();
+      mc_outputOff[device] = 0xff;
+      chip.si5351_write(SI5351_OUTPUT_ENABLE_CTRL, mc_outputOff[device]);
+      chip.si5351_write(SI5351_CRYSTAL_LOAD, image[SI5351_IMAGE_CRYSTAL_LOAD]);
+      chip.si5351_write(SI5351_CLK0_CTRL + clk, image[SI5351_IMAGE_CONTROL]);
+      chip.si5351_write_bulk(SI5351_PLLA_PARAMETERS, SI5351_PARAMETERS_LENGTH
+                           , (uint8_t *)image + SI5351_IMAGE_PLL);
+      chip.si5351_write_bulk(SI5351_CLK0_PARAMETERS + SI5351_PARAMETERS_LENGTH * clk, SI5351_PARAMETERS_LENGTH
+                           , (uint8_t *)image + SI5351_IMAGE_MULTISYNTH);
+      chip.si5351_write(SI5351_PLL_RESET, SI5351_PLL_RESET_A);
+
+      if (enable) {
+         mc_outputOff[device] &= ~bit(clk);
+         chip.si5351_write(SI5351_OUTPUT_ENABLE_CTRL, mc_outputOff[device]);
+      }
+      mc_restored |= bit(device);
+   }
+
+   /**
+    * gets number of chips
+    */
+   uint8_t count() const {
+      return mc_count;
+   }
+
+   /**
+    * works out the multisynth registers for an output frequency,
+    * without writing them
+    * @param  pll_freq  PLL frequency, Hz * SI5351_FREQ_MULT, 0 for
+    *                   SI5351_PLL_FIXED
+    * @param  f         output frequency in Hz
+    * @param  params    SI5351_PARAMETERS_LENGTH bytes, left alone if
+    *                   the divider is out of range
+    * @return false if the divider is out of range
+    */
+   static boolean multisynth(unsigned long long pll_freq, unsigned long f, uint8_t *params) {
+      return multisynthFine(pll_freq, (unsigned long long)f * SI5351_FREQ_MULT, params);
+   }
+
+   /**
+    * works out the multisynth registers for an output frequency to a
+    * fraction of a Hz
+    * @param  pll_freq  PLL frequency, Hz * SI5351_FREQ_MULT, 0 for
+    *                   SI5351_PLL_FIXED
+    * @param  freq      output frequency, Hz * SI5351_FREQ_MULT
+    * @param  params    SI5351_PARAMETERS_LENGTH bytes, left alone if
+    *                   the divider is out of range
+    * @return false if the divider is out of range
+    */
+   static boolean multisynthFine(unsigned long long pll_freq, unsigned long long freq, uint8_t *params) {
+      unsigned long a, b;
+      uint8_t       r_div;
+      if (!divider(pll_freq, freq, a, b, r_div)) {
+         return false;
+      }
+      multisynthRegisters(a, b, r_div, params);
+      return true;
+   }
+
+   /**
+    * checks an output frequency can be reached from a PLL, for callers
+    * that work out a run of register blocks from its ends
+    * @param  pll_freq  PLL frequency, Hz * SI5351_FREQ_MULT, 0 for
+    *                   SI5351_PLL_FIXED
+    * @param  f         output frequency in Hz
+    */
+   static boolean reaches(unsigned long long pll_freq, unsigned long f) {
+      unsigned long a, b;
+      uint8_t       r_div;
+      return divider(pll_freq, (unsigned long long)f * SI5351_FREQ_MULT, a, b, r_div);
+   }
+
+   /**
+    * checks a multisynth divider is in the chip's range
+    * @param  a  whole part of the divider
+    * @param  b  fraction, in 1/SI5351_FRAC_DENOM
+    */
+   static boolean dividerInRange(unsigned long a, unsigned long b) {
+      return    (a >= SI5351_GROUP_MIN_DIVIDER)
+             && ((a < SI5351_GROUP_MAX_DIVIDER) || ((a == SI5351_GROUP_MAX_DIVIDER) && (b == 0)));
+   }
+
+   /**
+    * works out the multisynth divider for an output frequency, rounded
+    * as the library's set_freq does
+    * @param  pll_freq  PLL frequency, Hz * SI5351_FREQ_MULT, 0 for
+    *                   SI5351_PLL_FIXED
+    * @param  freq      output frequency, Hz * SI5351_FREQ_MULT
+    * @param  a         set to the whole part of the divider
+    * @param  b         set to the fraction, in 1/SI5351_FRAC_DENOM
+    * @param  r_div     set to the output divider, as a power of 2
+    * @return false if the divider is out of the chip's range: the
+    *         frequency is too high for the PLL
+    */
+   static boolean divider(unsigned long long pll_freq
+                     , unsigned long long freq
+                     , unsigned long &a
+                     , unsigned long &b
+                     , uint8_t &r_div) {
+      if (pll_freq == 0) {
+         pll_freq = SI5351_PLL_FIXED;
+      }
+
+      // output divider keeps low frequencies in multisynth range
+      r_div = 0;
+      while ((r_div < 7) && (freq < (((unsigned long long)SI5351_CLKOUT_MIN_FREQ * 128 * SI5351_FREQ_MULT) >> r_div))) {
+         ++r_div;
+      }
+      freq <<= r_div;
+
+      a = (unsigned long)(pll_freq / freq);
+      b = (unsigned long)(((pll_freq % freq) * SI5351_FRAC_DENOM + freq / 2) / freq);
+      if (b >= SI5351_FRAC_DENOM) {
+         ++a;
+         b = 0;
+      }
+      return dividerInRange(a, b);
+   }
+
+   /**
+    * packs a multisynth divider into its register block
+    * @param  a       whole part of the divider
+    * @param  b       fraction, in 1/SI5351_FRAC_DENOM
+    * @param  r_div   output divider, as a power of 2
+    * @param  params  SI5351_PARAMETERS_LENGTH bytes
+    */
+   static void multisynthRegisters(unsigned long a, unsigned long b, uint8_t r_div, uint8_t *params) {
+      // c fixed unless b is 0
+      unsigned long c = (b == 0) ? 1 : SI5351_FRAC_DENOM;
+
+      unsigned long fl = (128 * b) / c;
+      unsigned long p1 = 128 * a + fl - 512;
+      unsigned long p2 = 128 * b - c * fl;
+      unsigned long p3 = c;
+
+      params[0] = (uint8_t)(p3 >> 8);
+      params[1] = (uint8_t)p3;
+      params[2] = (uint8_t)(((p1 >> 16) & 0x03) | (r_div << SI5351_OUTPUT_CLK_DIV_SHIFT));
+      params[3] = (uint8_t)(p1 >> 8);
+      params[4] = (uint8_t)p1;
+      params[5] = (uint8_t)(((p3 >> 12) & 0xf0) | ((p2 >> 16) & 0x0f));
+      params[6] = (uint8_t)(p2 >> 8);
+      params[7] = (uint8_t)p2;
+   }
+
+   /**
+    * sends a multisynth register block from multisynth() to an output,
+    * one write
+    * @param  device  index of chip in group
+    * @param  clk     clock output on the chip
+    * @param  params  SI5351_PARAMETERS_LENGTH bytes
+    * @param  first   first register of the block to send, for blocks
+    *                 known to match the output's up to there
+    */
+   void writeMultisynth(uint8_t device, si5351_clock clk, const uint8_t *params, uint8_t first = 0) {
+      mpp_devices[device]->si5351_write_bulk(SI5351_CLK0_PARAMETERS + SI5351_PARAMETERS_LENGTH * clk + first
+                                           , SI5351_PARAMETERS_LENGTH - first, (uint8_t *)params + first);
+   }
+
+   /**
+    * gets the driver of a chip
+    * @param  device  index of chip in group
+    */
+   Si5351 &device(uint8_t device) {
+      return *mpp_devices[device];
+   }
+
+   /**
+    * stages an output on or off, written by flush()
+    * @param  device  index of chip in group
+    * @param  clk     clock output on the chip
+    * @param  enable  true to turn the output on
+    */
+   void outputEnable(uint8_t device, si5351_clock clk, boolean enable) {
+      uint8_t off = enable ? (mc_outputOff[device] & ~bit(clk)) : (mc_outputOff[device] | bit(clk));
+      if (off != mc_outputOff[device]) {
+         mc_outputOff[device] = off;
+         mc_changed |= bit(device);
+      }
+   }
+
+   /**
+    * turns every output of every chip off now, one write per chip,
+    * dropping anything staged - for stall recovery, before begin()
+    */
+   void allOutputsOff() {
+      for (uint8_t ii=0; ii<mc_count; ++ii) {
+         mc_outputOff[ii] = 0xff;
+         mpp_devices[ii]->si5351_write(SI5351_OUTPUT_ENABLE_CTRL, mc_outputOff[ii]);
+      }
+      mc_changed = 0;
+   }
+
+   /**
+    * writes staged output changes, one write per chip changed
+    */
+   void flush() {
+      for (uint8_t ii=0; mc_changed != 0; ++ii) {
+         if (mc_changed & bit(ii)) {
+            mpp_devices[ii]->si5351_write(SI5351_OUTPUT_ENABLE_CTRL, mc_outputOff[ii]);
+            mc_changed &= ~bit(ii);
+         }
+      }
+   }
+};
+
+#endif // SI5351GROUP_H
@@ -77,15 +77,19 @@ void SimpleDigitalInputPin::processPinState(long tm, int priorState) {
  * reads physical pin state and applies debounce logic
  */
 void SimpleDigitalInputPin::determinePinState() {
+   applyReading(digitalRead(pinNumber));
+}
+
+/**
+ * applies debounce logic to a physical pin state just read
+ */
+void SimpleDigitalInputPin::applyReading(int reading) {
    // save current pin state
    int priorState = state;
    
    // get curren system time
    long tm = millis();
 
-   // read the input pin:
-   int reading = digitalRead(pinNumber);
-
    if (reading != lastReading) {
       // pin input has changed
       // - start debounce timing
@@ -125,10 +129,19 @@ void SimpleDigitalInputPin::determinePinState() {
  * @return  true if state of pin has changed
  */
 bool SimpleDigitalInputPin::readInputPulseMode() {
-   bool rtn = false;
-   
    // check state of input pin
    determinePinState();
+   return updatePulseMode();
+}
+
+/**
+ * moves the pulse mode on from the pin state
+ *
+ * @return  true if state of pin has changed
+ */
+bool SimpleDigitalInputPin::updatePulseMode() {
+   bool rtn = false;
+   
    if (hasChanged()) {
       rtn = true; // signal state change to caller
       
@@ -107,7 +107,7 @@ public:
   /**
    * performs hardware pin initializations
    */
-   virtual void initialize();
+   void initialize();
    
   /**
    * returns physical state of pin
@@ -207,6 +207,20 @@ protected:
    * updates stored pulse on a state change
    */
    void processPinState(long tm, int priorState);
+
+  /**
+   * applies debounce logic to a physical pin state just read
+   *
+   * @param  reading  physical pin state from {LOW,HIGH}
+   */
+   void applyReading(int reading);
+
+  /**
+   * moves the pulse mode on from the pin state
+   *
+   * @return  true if state of pin has changed
+   */
+   bool updatePulseMode();
    
 public:   
   /**
@@ -264,7 +278,18 @@ public:
    */
    bool hasChanged()
    { return stateChanged;}
-   
+
+  /**
+   * checks if pin is at rest - released, settled and idle
+   *
+   * @return  true if no press or pulse is in progress on the pin
+   */
+   bool isQuiescent() const {
+      return (PIN_MODE_IDLE == currentPinMode)
+          && (LOW == logicalState)
+          && (lastReading == state);
+   }
+
   /**
    * SimpleDigitalPin Constructor
    *
@@ -290,4 +315,53 @@ public:
    }
 };
 
+/**
+* This class is a SimpleDigitalInputPin that reads the hardware pin
+* through a pin read policy, such as FastPin<N>, instead of
+* digitalRead(). The policy must provide a static read() method
+* returning LOW or HIGH. The policy is fixed at compile time: the
+* reads below hide the base class ones, with no virtual call, so
+* the read is inlined. Callers must use the pin through its own
+* type, not a SimpleDigitalInputPin reference.
+*/
+template <class PIN_READ_POLICY>
+class PolicyDigitalInputPin : public SimpleDigitalInputPin {
+public:
+  /**
+   * reads physical pin state through the policy and applies
+   * debounce logic
+   */
+   inline void determinePinState() {
+      applyReading(PIN_READ_POLICY::read());
+   }
+
+  /**
+   * reads the pin through the policy and updates the pulse mode,
+   * see SimpleDigitalInputPin::readInputPulseMode()
+   *
+   * @return  true if mode of pin has changed
+   */
+   inline bool readInputPulseMode() {
+      determinePinState();
+      return updatePulseMode();
+   }
+
+  /**
+   * PolicyDigitalInputPin Constructor
+   *
+   * @param  pn           pin number, must match the policy pin
+   * @param  md           pin mode
+   * @param  dbt          debounce threshold, milliseconds
+   * @param  ini_st       initial pin state
+   * @param  invert       is pin sense inverted?
+   */
+   PolicyDigitalInputPin (int pn
+                  , int md
+                  , int dbt
+                  , int ini_st
+                  , bool invert = DIGITAL_PIN_NON_INVERTING)
+   : SimpleDigitalInputPin (pn, md, dbt, ini_st, invert)
+   {}
+};
+
 #endif // _DIGITALPININPUT_H_
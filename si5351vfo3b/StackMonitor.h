@@ -0,0 +1,137 @@
+#ifndef STACKMONITOR_H
+#define STACKMONITOR_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the stack high water monitor, built in when
+ * USE_STACK_MONITOR is defined in the sketch.
+ *
+ * Straight after reset, before the C runtime starts, all SRAM between
+ * the end of the static variables and the stack pointer is painted
+ * with a marker byte. The heap grows up into this from below and the
+ * stack down into it from above; any byte the stack has ever used is
+ * no longer the marker. Counting the marker bytes left above the top
+ * of the heap gives the smallest free gap there has been between heap
+ * and stack since reset - deepest call chain plus interrupts included.
+ *
+ * setup() prints the memory split once, and the loop checks the gap
+ * once a second, printing it on Serial each time it reaches a new
+ * low, with a warning below STACK_MONITOR_WARNING_BYTES. The check
+ * counts up from the heap, about 5 cycles a byte.
+ *
+ * The build time side of the budget is tools/memory_budget.py.
+ */
+
+#include <Arduino.h>
+
+#ifndef __AVR__
+#error "StackMonitor.h reads the AVR memory layout and only builds for the board"
+#endif
+
+#define STACK_PAINT_BYTE                 0xc5
+#define STACK_MONITOR_INTERVAL_MILS      1000
+#define STACK_MONITOR_WARNING_BYTES      128
+
+/**
+ * memory layout symbols from the linker and malloc
+ */
+extern uint8_t  __data_start;
+extern uint8_t  __heap_start;
+extern uint8_t *__brkval;
+
+/**
+ * smallest free gap reported so far
+ */
+unsigned int  stack_free_reported = 0xffff;
+unsigned long stack_monitor_last_check;
+
+/**
+ * paints free SRAM first thing after reset
+ * The stack is still empty here, so everything from the end of the
+ * static variables up to the stack pointer is free.
+ */
+void stackMonitorPaint() __attribute__ ((naked, used, section (".init3")));
+void stackMonitorPaint() {
+   for (uint8_t *p = &__heap_start; p < (uint8_t *)SP; ++p) {
+      *p = STACK_PAINT_BYTE;
+   }
+}
+
+/**
+ * gets the current top of the heap
+ */
+inline uint8_t *stackMonitorHeapEnd() {
+   return (__brkval != 0) ? __brkval : &__heap_start;
+}
+
+/**
+ * counts the painted bytes left above the heap
+ * @return smallest free gap between heap and stack since reset
+ */
+unsigned int stackFreeLow() {
+   uint8_t *p = stackMonitorHeapEnd();
+   while ((p < (uint8_t *)RAMEND) && (*p == STACK_PAINT_BYTE)) {
+      ++p;
+   }
+   return p - stackMonitorHeapEnd();
+}
+
+/**
+ * reports how SRAM is split, once setup has allocated its objects
+ */
+void reportMemoryUse() {
+   Serial.print(F("memory: static "));
+   Serial.print(&__heap_start - &__data_start);
+   Serial.print(F(", heap "));
+   Serial.print(stackMonitorHeapEnd() - &__heap_start);
+   Serial.print(F(", free "));
+   Serial.print((uint8_t *)SP - stackMonitorHeapEnd());
+   Serial.print(F(" of "));
+   Serial.print(RAMEND + 1 - (unsigned int)&__data_start);
+   Serial.println(F(" bytes"));
+
+   stack_monitor_last_check = millis();
+}
+
+/**
+ * checks the free gap once per interval, reporting new lows
+ * called from the operating loop
+ */
+void checkStackMonitor() {
+   if ((millis() - stack_monitor_last_check) < STACK_MONITOR_INTERVAL_MILS) {
+      return;
+   }
+   stack_monitor_last_check = millis();
+
+   unsigned int freeLow = stackFreeLow();
+   if (freeLow < stack_free_reported) {
+      stack_free_reported = freeLow;
+
+      if (freeLow < STACK_MONITOR_WARNING_BYTES) {
+         Serial.print(F("WARNING "));
+      }
+      Serial.print(F("stack: free low "));
+      Serial.print(freeLow);
+      Serial.println(F(" bytes"));
+   }
+}
+
+#endif // STACKMONITOR_H
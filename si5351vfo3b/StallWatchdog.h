@@ -0,0 +1,222 @@
+#ifndef STALLWATCHDOG_H
+#define STALLWATCHDOG_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions implementing a watchdog based stall
+ * detector.
+ *
+ * The watchdog is armed with a timeout well above the longest loop
+ * pass and is reset once per pass. A pass paints the display at most
+ * once however many events it dispatches, so the longest pass is the
+ * loop delay plus one full paint and the encoder interrupts that
+ * land during it, each with its debounce delay. The host build
+ * measures 95 to 145 ms between resets with the encoder turning, the
+ * most with contact bounce (vfo_host, vfo_sim traces), where
+ * painting once per event had reached about 400 ms.
+ * vfo_host and vfo_sim report the longest gap against this timeout
+ * so the margin stays under test. Before each
+ * stage that can block on the I2C bus, the sketch writes a task id
+ * to a breadcrumb variable kept in the .noinit section, which the
+ * startup code does not clear.
+ *
+ * If a stage hangs, the watchdog interrupt marks the breadcrumb as
+ * a stall and forces a reset. The sketch then comes back up with
+ * the I2C bus released, all Si5351 outputs off and all vfos marked
+ * disabled, and reports the stalled task over Serial. The outage is
+ * bounded by STALL_WATCHDOG_TIMEOUT plus the restart time.
+ */
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+
+/**
+ * watchdog timeout - over three times the longest loop pass, which
+ * is one display paint plus the loop delay and encoder interrupts
+ */
+#define STALL_WATCHDOG_TIMEOUT           WDTO_500MS
+
+/**
+ * marker showing the breadcrumb was left by a stall
+ */
+#define STALL_MARKER                     0x5A17
+
+/**
+ * task ids written to the breadcrumb
+ */
+#define STALL_TASK_NONE                  0
+#define STALL_TASK_SETUP_INPUTS          1
+#define STALL_TASK_SETUP_ENCODER         2
+#define STALL_TASK_SETUP_VFOS            3
+#define STALL_TASK_SETUP_DISPLAY         4
+#define STALL_TASK_SETUP_SI5351          5
+#define STALL_TASK_TICK                  6
+#define STALL_TASK_SI5351_WRITE          7
+#define STALL_TASK_DISPLAY_PAINT         8
+#define STALL_TASK_SLEEP                 9
+
+/**
+ * breadcrumb variables, kept across a watchdog reset
+ */
+volatile uint8_t  stall_breadcrumb   __attribute__ ((section (".noinit")));
+volatile uint16_t stall_marker       __attribute__ ((section (".noinit")));
+uint8_t           stall_count        __attribute__ ((section (".noinit")));
+
+/**
+ * set if this start up is a recovery from a stall
+ */
+boolean stall_recovered = false;
+
+/**
+ * turns off the watchdog first thing after reset
+ * A watchdog reset leaves the watchdog running with its
+ * shortest timeout, which would reset us again during start up.
+ */
+void stallWatchdogEarlyInit() __attribute__ ((naked, used, section (".init3")));
+void stallWatchdogEarlyInit() {
+   MCUSR = 0;
+   wdt_disable();
+}
+
+/**
+ * records the task about to run
+ * @param  task  task id
+ */
+inline void stallBreadcrumb(uint8_t task) {
+   stall_breadcrumb = task;
+}
+
+/**
+ * arms the watchdog, interrupt first then reset
+ */
+void armStallWatchdog() {
+   wdt_reset();
+   wdt_enable(STALL_WATCHDOG_TIMEOUT);
+   WDTCSR |= bit(WDIE);
+}
+
+/**
+ * resets the watchdog at the start of a loop pass
+ */
+inline void feedStallWatchdog() {
+   wdt_reset();
+}
+
+/**
+ * service watchdog timeout - the loop has stalled
+ * marks the breadcrumb and resets right away
+ */
+ISR(WDT_vect) {
+   stall_marker = STALL_MARKER;
+   wdt_enable(WDTO_15MS);
+   for (;;) {
+      // wait for reset
+   }
+}
+
+/**
+ * gets name of a task id for the stall report
+ * @param  task  task id
+ * @return task name
+ */
+const __FlashStringHelper *stallTaskName(uint8_t task) {
+   switch (task) {
+      case STALL_TASK_SETUP_INPUTS:    return F("setup inputs");
+      case STALL_TASK_SETUP_ENCODER:   return F("setup encoder");
+      case STALL_TASK_SETUP_VFOS:      return F("setup vfos");
+      case STALL_TASK_SETUP_DISPLAY:   return F("setup display");
+      case STALL_TASK_SETUP_SI5351:    return F("setup si5351");
+      case STALL_TASK_TICK:            return F("loop tick");
+      case STALL_TASK_SI5351_WRITE:    return F("si5351 write");
+      case STALL_TASK_DISPLAY_PAINT:   return F("display paint");
+      case STALL_TASK_SLEEP:           return F("sleep");
+   }
+   return F("unknown");
+}
+
+/**
+ * releases an I2C bus held by a device stuck mid-byte
+ * clocks SCL until the device lets go of SDA, then sends a stop
+ */
+void recoverI2CBus() {
+   pinMode(SDA, INPUT_PULLUP);
+   pinMode(SCL, INPUT_PULLUP);
+
+   for (int ii=0; (ii<9) && (digitalRead(SDA) == LOW); ++ii) {
+      pinMode(SCL, OUTPUT);
+      digitalWrite(SCL, LOW);
+      delayMicroseconds(5);
+      pinMode(SCL, INPUT_PULLUP);
+      delayMicroseconds(5);
+   }
+
+   // stop condition - SDA low to high while SCL high
+   pinMode(SDA, OUTPUT);
+   digitalWrite(SDA, LOW);
+   delayMicroseconds(5);
+   pinMode(SDA, INPUT_PULLUP);
+   delayMicroseconds(5);
+}
+
+/**
+ * checks for a stall reset, and if found reports it and
+ * forces the clock outputs off
+ * call early in setup, after Serial is started
+ */
+void checkStallRecovery() {
+   if (stall_marker == STALL_MARKER) {
+      stall_recovered = true;
+      ++stall_count;
+
+      // get the bus back and turn all clock outputs off, on every chip
+      recoverI2CBus();
+      Wire.begin();
+      si5351Devices.allOutputsOff();
+
+      Serial.print(F("stall reset #"));
+      Serial.print(stall_count);
+      Serial.print(F(" in task "));
+      Serial.print(stall_breadcrumb);
+      Serial.print(' ');
+      Serial.println(stallTaskName(stall_breadcrumb));
+   }
+   else {
+      stall_count = 0;
+   }
+
+   stall_marker = 0;
+   stallBreadcrumb(STALL_TASK_NONE);
+}
+
+/**
+ * after a stall, keep all vfos disabled until the operator
+ * turns them back on
+ * call after the band bank is set up
+ */
+void applyStallSafeState() {
+   if (stall_recovered) {
+      for (int ii=0; ii<vfoBank.count(); ++ii) {
+         vfoBank.setEnabled(ii, false);
+      }
+   }
+}
+
+#endif // STALLWATCHDOG_H
@@ -0,0 +1,365 @@
+#ifndef STATEPERSISTENCE_H
+#define STATEPERSISTENCE_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions that keep the operating state in
+ * EEPROM, so the VFO comes back up where it was left: the selected
+ * band, the frequency increment, and the tuned frequency and enabled
+ * flag of every band.
+ *
+ * Writing on every encoder step would wear out the EEPROM in weeks
+ * of tuning. Instead the handlers call noteStateChange(), and the
+ * state is saved once the controls have been left alone for
+ * STATE_QUIET_MILS. The record goes into the EEPROMLog area, which
+ * spreads the writes over its slots; an unchanged state, such as a
+ * band switched away from and back again, is not written at all.
+ *
+ * The write is done by the EEPROM ready interrupt, a byte at a time,
+ * so the loop never waits for it.
+ *
+ * The record also holds the SI5351 registers running the selected
+ * band, read back from the chip when the state is saved. At power up
+ * setupSI5351() writes them straight back with restoreOutputImage(),
+ * so RF is on without the library working out the dividers, and
+ * before the display is set up.
+ *
+ * The payload is, all values low byte first:
+ *
+ *    selected band (1 byte), frequency increment (4 bytes),
+ *    enabled bits (VFOBANK_ENABLED_BYTES), band frequencies (4 bytes each),
+ *    chip of selected band (1 byte), its register image (SI5351_IMAGE_LENGTH)
+ *
+ * The chip byte is 0xff, and the image not used, when it was read
+ * with a RIT/XIT offset on the output.
+ *
+ * The crystal correction of the unit, in parts per billion (see
+ * Si5351Group.h), is kept in a log of its own, so a bad state record
+ * cannot take the calibration with it. It is restored with the state
+ * and folded into the clock setup before the clocks start, and saved
+ * at once when setCalibration() changes it. A change of correction
+ * also saves the state again, as the image holds PLL A.
+ *
+ * With USE_MEMORY_SCAN defined, the memory channels (see
+ * MemoryChannels.h) are kept in a third log, saved at once when one
+ * is stored: for each channel its frequency (4 bytes), band and
+ * flags. The registers of a channel are worked out again when it is
+ * restored, so a band table changed since is checked against.
+ */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+
+/**
+ * time the controls must be left alone before the state is saved
+ */
+#define STATE_QUIET_MILS               3000
+
+/**
+ * payload length for the band table in use
+ */
+#define STATE_BANDS_LENGTH     (1 + 4 + VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS) + 4 * NUMBER_OF_BANDS)
+#define STATE_PAYLOAD_LENGTH   (STATE_BANDS_LENGTH + 1 + SI5351_IMAGE_LENGTH)
+
+/**
+ * the record log, and the SRAM copy of its current record
+ */
+uint8_t   stateRecord[EEPROMLOG_RECORD_LENGTH(STATE_PAYLOAD_LENGTH)];
+EEPROMLog stateLog(EEPROM_STATE_LOG_ADDRESS, EEPROM_STATE_LOG_BYTES, stateRecord, sizeof(stateRecord));
+
+/**
+ * the calibration log: the crystal correction, low byte first
+ */
+#define CALIBRATION_PAYLOAD_LENGTH        4
+
+uint8_t   calibrationRecord[EEPROMLOG_RECORD_LENGTH(CALIBRATION_PAYLOAD_LENGTH)];
+EEPROMLog calibrationLog(EEPROM_CALIBRATION_LOG_ADDRESS, EEPROM_CALIBRATION_LOG_BYTES, calibrationRecord, sizeof(calibrationRecord));
+
+#ifdef USE_MEMORY_SCAN
+/**
+ * the channel log: frequency, band and flags of each memory channel
+ */
+#define CHANNEL_SAVED_LENGTH              6
+#define CHANNEL_PAYLOAD_LENGTH   (CHANNEL_SAVED_LENGTH * MEMORY_CHANNELS)
+
+uint8_t   channelRecord[EEPROMLOG_RECORD_LENGTH(CHANNEL_PAYLOAD_LENGTH)];
+EEPROMLog channelLog(EEPROM_CHANNEL_LOG_ADDRESS, EEPROM_CHANNEL_LOG_BYTES, channelRecord, sizeof(channelRecord));
+#endif
+
+/**
+ * variables tracking unsaved changes
+ */
+boolean       state_changed = false;
+unsigned long state_change_time;
+boolean       calibration_changed = false;
+boolean       channels_changed = false;
+
+/**
+ * register image of the selected band found by restoreState(),
+ * 0 if there is none that fits
+ */
+const uint8_t *state_image = 0;
+
+/**
+ * service EEPROM ready - write the next byte of the record
+ * The logs are never written at the same time.
+ */
+ISR(EE_READY_vect) {
+   if (calibrationLog.busy()) {
+      calibrationLog.service();
+   }
+#ifdef USE_MEMORY_SCAN
+   else if (channelLog.busy()) {
+      channelLog.service();
+   }
+#endif
+   else {
+      stateLog.service();
+   }
+}
+
+/**
+ * checks for a record of any log still being written
+ */
+boolean stateLogsBusy() {
+   return stateLog.busy()
+       || calibrationLog.busy()
+#ifdef USE_MEMORY_SCAN
+       || channelLog.busy()
+#endif
+       ;
+}
+
+/**
+ * copies a value into a payload, low byte first
+ * @return next free byte of the payload
+ */
+uint8_t *packState(uint8_t *p, uint32_t value) {
+   for (uint8_t ii=0; ii<4; ++ii) {
+      *p++ = (uint8_t)value;
+      value >>= 8;
+   }
+   return p;
+}
+
+/**
+ * reads a value from a payload, low byte first
+ */
+uint32_t unpackState(const uint8_t *p) {
+   return (uint32_t)p[0]
+        | ((uint32_t)p[1] << 8)
+        | ((uint32_t)p[2] << 16)
+        | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * builds the payload for the current state
+ * @param  payload  STATE_PAYLOAD_LENGTH bytes
+ */
+void buildStatePayload(uint8_t *payload) {
+   uint8_t *p = payload;
+
+   *p++ = vfoBank.selected();
+   p = packState(p, frequency_delta);
+
+   uint8_t *enabled = p;
+   memset(enabled, 0, VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS));
+   p += VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS);
+
+   for (uint8_t ii=0; ii<NUMBER_OF_BANDS; ++ii) {
+      if (vfoBank.isEnabled(ii)) {
+         enabled[ii >> 3] |= bit(ii & 7);
+      }
+      p = packState(p, vfoBank.frequency(ii));
+   }
+
+   // registers running the selected band; none while a RIT/XIT
+   // offset is on them, as the offset is not saved
+   si5351_VFODefinition *vfo = vfoBank.active();
+   *p++ = (vfo->getOutputOffset() == 0) ? vfo->getDevice() : 0xff;
+   si5351Devices.readImage(vfo->getDevice(), vfo->getClock(), p);
+}
+
+/**
+ * restores the state saved by a previous run, if any
+ * Values that do not fit the current band table or limits are
+ * left at their defaults.
+ * call after the band bank is set up, before the clocks are loaded
+ */
+void restoreState() {
+   // a correction out of range is refused, leaving none
+   if (calibrationLog.begin()) {
+      si5351Devices.setCorrection((long)unpackState(calibrationLog.payload()));
+   }
+
+#ifdef USE_MEMORY_SCAN
+   // a channel the band table no longer takes is left empty
+   if (channelLog.begin()) {
+      const uint8_t *channel = channelLog.payload();
+      for (uint8_t ii=0; ii<MEMORY_CHANNELS; ++ii, channel+=CHANNEL_SAVED_LENGTH) {
+         if (channel[5] & MEMORY_CHANNEL_USED) {
+            memoryChannels.store(ii, unpackState(channel), channel[4], channel[5]);
+         }
+      }
+   }
+#endif
+
+   if (!stateLog.begin()) {
+      return;
+   }
+
+   const uint8_t *p = stateLog.payload();
+   const uint8_t *enabled = p + 5;
+   const uint8_t *frequencies = enabled + VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS);
+
+   if (p[0] < NUMBER_OF_BANDS) {
+      vfoBank.setSelected(p[0]);
+   }
+
+   unsigned long delta = unpackState(p + 1);
+   for (unsigned long ii=FREQ_DELTA_MIN; ii<=FREQ_DELTA_MAX; ii*=FREQ_DELTA_MULT) {
+      if (delta == ii) {
+         frequency_delta = delta;
+      }
+   }
+
+   for (uint8_t ii=0; ii<NUMBER_OF_BANDS; ++ii) {
+      vfoBank.restore(ii
+                    , unpackState(frequencies + 4 * ii)
+                    , (enabled[ii >> 3] & bit(ii & 7)) != 0);
+   }
+
+   // the image is only good for the band and output it was read from
+   uint8_t        selected = vfoBank.selected();
+   const uint8_t *device   = p + STATE_BANDS_LENGTH;
+   const uint8_t *image    = device + 1;
+   si5351_VFODefinition *vfo = vfoBank.active();
+   if (  (p[0] == selected)
+      && (vfoBank.frequency(selected) == unpackState(frequencies + 4 * selected))
+      && (*device == vfo->getDevice())
+      && (*device < si5351Devices.count())
+      && (image[SI5351_IMAGE_CLOCK] == vfo->getClock())) {
+      state_image = image;
+   }
+}
+
+/**
+ * brings the selected band up from the register image saved with the
+ * state, if restoreState() found one
+ * call at power up, before Si5351Group::begin()
+ * @return true if the output was restored
+ */
+boolean restoreOutputImage() {
+   if (state_image == 0) {
+      return false;
+   }
+
+   si5351Devices.restore(vfoBank.active()->getDevice()
+                       , state_image
+                       , vfoBank.isEnabled(vfoBank.selected()));
+   vfoBank.markLoaded();
+   state_image = 0;
+   return true;
+}
+
+/**
+ * notes a change to the saved state, restarting the quiet period
+ */
+inline void noteStateChange() {
+   state_changed = true;
+   state_change_time = millis();
+}
+
+/**
+ * checks for a change not yet saved, or a save still being written
+ */
+boolean statePersistencePending() {
+   return state_changed || calibration_changed || channels_changed || stateLogsBusy();
+}
+
+/**
+ * sets the crystal correction, puts it into PLL A of every chip and
+ * saves it
+ * The outputs keep their multisynth dividers and move with PLL A.
+ * @param  ppb  crystal error in parts per billion, + when it runs fast
+ * @return false if the correction is out of range
+ */
+boolean setCalibration(long ppb) {
+   if (!si5351Devices.setCorrection(ppb)) {
+      return false;
+   }
+
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   for (uint8_t ii=0; ii<si5351Devices.count(); ++ii) {
+      si5351Devices.writePll(ii);
+   }
+   calibration_changed = true;
+   noteStateChange();
+   return true;
+}
+
+#ifdef USE_MEMORY_SCAN
+/**
+ * notes a change to the memory channels, saved at once
+ */
+inline void noteChannelChange() {
+   channels_changed = true;
+}
+#endif
+
+/**
+ * saves the state once the quiet period has passed
+ * call once per loop pass
+ */
+void checkStatePersistence() {
+   if (calibration_changed && !stateLogsBusy()) {
+      uint8_t payload[CALIBRATION_PAYLOAD_LENGTH];
+      packState(payload, (uint32_t)si5351Devices.getCorrection());
+      calibrationLog.write(payload);
+      calibration_changed = false;
+   }
+
+#ifdef USE_MEMORY_SCAN
+   if (channels_changed && !stateLogsBusy()) {
+      uint8_t  payload[CHANNEL_PAYLOAD_LENGTH];
+      uint8_t *channel = payload;
+      for (uint8_t ii=0; ii<MEMORY_CHANNELS; ++ii) {
+         channel    = packState(channel, memoryChannels.frequency(ii));
+         *channel++ = memoryChannels.band(ii);
+         *channel++ = memoryChannels.flags(ii);
+      }
+      channelLog.write(payload);
+      channels_changed = false;
+   }
+#endif
+
+   if (  state_changed
+      && ((millis() - state_change_time) >= STATE_QUIET_MILS)
+      && !stateLogsBusy()) {
+      uint8_t payload[STATE_PAYLOAD_LENGTH];
+      stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+      buildStatePayload(payload);
+      stateLog.write(payload);
+      state_changed = false;
+   }
+}
+
+#endif // STATEPERSISTENCE_H
@@ -0,0 +1,415 @@
+#ifndef SWEEPCONTROL_H
+#define SWEEPCONTROL_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains functions running frequency sweeps on the
+ * selected band, built in when USE_FREQUENCY_SWEEP is defined. A sweep
+ * is started, stopped and watched with the SW CAT command, which is
+ * run here for CATControl.h:
+ *
+ *    SWsssssssssssppppppppppphhhhhhhdddddddr;
+ *                 start and stop in Hz (11 digits), step in Hz (7),
+ *                 dwell in us (7), r 1 to repeat until stopped
+ *    SW0;         stop
+ *    SW;          SWrnnnnnuuuuulllllll;  r 1 while running, points
+ *                 sent (5 digits), underruns (5), latest the timer
+ *                 interrupt ran in us (7)
+ *
+ * The dwell on each point is timed by Timer1 in CTC mode, at the
+ * smallest prescaler that fits it in 16 bits: at 16 MHz that is
+ * 62.5 ns resolution up to 4 ms, and 64 us at the longest dwells. A
+ * dwell that is not a whole number of ticks has the fraction carried
+ * from tick to tick, each period one tick longer as it adds up, so
+ * the points do not drift off the dwell however many there are. The
+ * compare interrupt sends the next point with FrequencySweep::step().
+ * The I2C write needs the TWI interrupt, so the handler masks its own
+ * vector and turns interrupts back on; a dwell shorter than the write
+ * delays the next point instead of nesting.
+ * One point is a 10 byte transfer, 0.92 ms at 100 kHz, all of it in
+ * the handler. SWEEP_MIN_DWELL_MICROS is twice that, so the handler
+ * takes at most half of each dwell and the loop - keeping the ring
+ * filled and the serial port read - always gets the rest; at 1 ms it
+ * took 92%. Timer1 counts up from the compare match, so TCNT1 on
+ * entry is how late the interrupt ran; the worst is kept for the SW
+ * status answer.
+ *
+ * A running sweep owns the I2C bus, which the clock chips share with
+ * the OLED. Wire is not reentrant, so the handler must be its only
+ * user while the timer runs, and that is enforced in two places:
+ * loop() returns after checkSweep(), so no events are dispatched and
+ * nothing is painted (nor the state saved) until the sweep ends, and
+ * every CAT command that writes a clock ends the sweep first, through
+ * stopCATTimed(). The loop only keeps the ring filled. The sweep ends
+ * after its last point, on SW0; on a CAT frequency set, or on any
+ * posted event - a turn of the encoder or a button press - which is
+ * then handled as usual. The dial frequency is loaded back into the
+ * clock when it ends.
+ *
+ * With USE_ANTENNA_ANALYZER defined, the compare interrupt also
+ * starts the detector sampling of the point it is leaving, before it
+ * writes the next (see AnalyzerControl.h), and the timer runs one
+ * tick past the last point to sample it.
+ *
+ * With USE_FSK_BEACON defined, the same timer and interrupt send the
+ * symbols of a beacon message (see BeaconControl.h), and with
+ * USE_MEMORY_SCAN the hops of a memory channel scan (see
+ * ScanControl.h). Only one of a sweep, a beacon and a scan runs at a
+ * time: starting one stops the others.
+ *
+ * Timer1 is also used by the cycle benchmarks, which run and finish
+ * during setup.
+ */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+#include "FrequencySweep.h"
+#include "CATParser.h"
+
+/**
+ * dwell limits - twice one point write at 100 kHz I2C, and 65536
+ * ticks of the largest prescaler
+ */
+#define SWEEP_MIN_DWELL_MICROS         2000
+#define SWEEP_MAX_DWELL_MICROS      4000000UL
+
+/**
+ * SW command fields, offsets in the parameters and widths
+ */
+#define CAT_SWEEP_START                   0
+#define CAT_SWEEP_STOP                   11
+#define CAT_SWEEP_STEP                   22
+#define CAT_SWEEP_DWELL                  29
+#define CAT_SWEEP_REPEAT                 36
+#define CAT_SWEEP_LENGTH                 37
+#define CAT_SWEEP_STEP_DIGITS             7
+#define CAT_SWEEP_DWELL_DIGITS            7
+#define CAT_SWEEP_COUNT_DIGITS            5
+
+/**
+ * the sweep, stepped by the Timer1 compare interrupt
+ */
+FrequencySweep frequencySweep(si5351Devices);
+
+/**
+ * true from the start of a sweep until the dial frequency is back
+ */
+boolean sweep_active = false;
+
+/**
+ * latest the compare interrupt has run, in Timer1 ticks, and the
+ * prescaler as a shift for turning ticks into cycles
+ */
+volatile uint16_t sweep_late_ticks = 0;
+uint8_t           sweep_prescale_shift = 0;
+
+/**
+ * dwell in whole Timer1 ticks, the fraction of a tick left over in
+ * cycles, and the fraction carried so far
+ */
+uint16_t          sweep_period_ticks;
+uint16_t          sweep_period_fraction;
+uint16_t          sweep_fraction_carry;
+
+/**
+ * set while Timer1 is ticking; the compare interrupt clears it when
+ * there is nothing left to do
+ */
+volatile boolean  sweep_timer_running = false;
+
+#ifdef USE_ANTENNA_ANALYZER
+/**
+ * set by the analyzer on a sweep it is sampling
+ */
+boolean sweep_analyzed = false;
+
+boolean analyzerTick();
+#endif
+
+#ifdef USE_FSK_BEACON
+boolean beaconTick();
+void    stopBeacon();
+#endif
+
+#ifdef USE_MEMORY_SCAN
+boolean scanTick();
+void    stopScan();
+#endif
+
+/**
+ * Timer1 compare - sends the next point
+ */
+ISR(TIMER1_COMPA_vect) {
+   // counter restarted at the match
+   uint16_t late = TCNT1;
+
+   // the period starting now, a tick longer when the fraction adds up
+   if (sweep_period_fraction != 0) {
+      sweep_fraction_carry += sweep_period_fraction;
+      if (sweep_fraction_carry >= bit(sweep_prescale_shift)) {
+         sweep_fraction_carry -= bit(sweep_prescale_shift);
+         OCR1A = sweep_period_ticks;
+      }
+      else {
+         OCR1A = sweep_period_ticks - 1;
+      }
+   }
+
+   TIMSK1 &= ~bit(OCIE1A);
+   sei();
+   if (late > sweep_late_ticks) {
+      sweep_late_ticks = late;
+   }
+
+#ifdef USE_ANTENNA_ANALYZER
+   boolean more = analyzerTick();
+#else
+   boolean more = false;
+#endif
+#ifdef USE_FSK_BEACON
+   more = beaconTick() || more;
+#endif
+#ifdef USE_MEMORY_SCAN
+   more = scanTick() || more;
+#endif
+   more = frequencySweep.step() || more;
+
+   cli();
+   if (more) {
+      TIMSK1 |= bit(OCIE1A);
+   }
+   else {
+      TCCR1B = 0;
+      sweep_timer_running = false;
+   }
+}
+
+/**
+ * starts Timer1 interrupting every dwell
+ * @param  dwell  time between interrupts in us, within the limits
+ */
+void startSweepTimer(unsigned long dwell) {
+   // prescaler 1, 8, 64, 256, 1024 as shifts
+   static const uint8_t shift[] = { 0, 3, 6, 8, 10 };
+   unsigned long cycles = dwell * (F_CPU / 1000000UL);
+   uint8_t       cs     = 0;
+
+   while ((cycles >> shift[cs]) >= 65536UL) {
+      ++cs;
+   }
+   sweep_prescale_shift  = shift[cs];
+   sweep_period_ticks    = cycles >> shift[cs];
+   sweep_period_fraction = cycles & (bit(shift[cs]) - 1);
+   sweep_fraction_carry  = 0;
+   sweep_late_ticks      = 0;
+   sweep_timer_running   = true;
+
+   TCCR1B = 0;
+   TCCR1A = 0;
+   TCNT1  = 0;
+   OCR1A  = sweep_period_ticks - 1;
+   TIFR1  = bit(OCF1A);
+   TIMSK1 |= bit(OCIE1A);
+   TCCR1B = bit(WGM12) | (cs + 1);
+}
+
+/**
+ * stops Timer1
+ */
+void stopSweepTimer() {
+   TIMSK1 &= ~bit(OCIE1A);
+   TCCR1B = 0;
+   sweep_timer_running = false;
+}
+
+/**
+ * ends a sweep and loads the dial frequency back into the clock
+ */
+void stopSweep() {
+   stopSweepTimer();
+   frequencySweep.stop();
+   sweep_active = false;
+
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   vfoBank.active()->loadFrequency();
+}
+
+/**
+ * starts a sweep of the selected band: start, start + step, ... up
+ * to stop, dwell us on each point
+ * @param  start   first frequency in Hz
+ * @param  stop    last frequency in Hz, reached if a whole number
+ *                 of steps from start
+ * @param  step    Hz between points
+ * @param  dwell   us on each point
+ * @param  repeat  true to sweep again from the start until stopped
+ * @return false if the band does not cover the sweep, the divider
+ *         cannot reach it, or the step or dwell is out of range
+ */
+boolean startSweep(unsigned long start
+                 , unsigned long stop
+                 , unsigned long step
+                 , unsigned long dwell
+                 , boolean repeat) {
+   uint8_t band = vfoBank.selected();
+   si5351_VFODefinition *vfo = vfoBank.active();
+
+   // the divider moves one way with frequency, so the ends do for
+   // every point between
+   if (  (step == 0) || (stop < start)
+      || !vfoBank.covers(band, start) || !vfoBank.covers(band, stop)
+      || !Si5351Group::reaches(vfo->getPllFrequency(), start)
+      || !Si5351Group::reaches(vfo->getPllFrequency(), stop)
+      || (((stop - start) / step) >= 0xffffUL)
+      || (dwell < SWEEP_MIN_DWELL_MICROS) || (dwell > SWEEP_MAX_DWELL_MICROS)) {
+      return false;
+   }
+
+   if (sweep_active) {
+      stopSweepTimer();
+      frequencySweep.stop();
+   }
+#ifdef USE_FSK_BEACON
+   stopBeacon();
+#endif
+#ifdef USE_MEMORY_SCAN
+   stopScan();
+#endif
+#ifdef USE_ANTENNA_ANALYZER
+   sweep_analyzed = false;
+#endif
+
+   frequencySweep.begin(vfo->getDevice()
+                      , vfo->getClock()
+                      , vfo->getPllFrequency()
+                      , start
+                      , step
+                      , (uint16_t)((stop - start) / step + 1)
+                      , repeat);
+
+   // start point now, the rest one per dwell
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   frequencySweep.step();
+   startSweepTimer(dwell);
+   sweep_active = true;
+   return true;
+}
+
+/**
+ * gets the latest the compare interrupt has run since the sweep
+ * started
+ * @return us
+ */
+unsigned long sweepLateMicros() {
+   uint8_t oldSREG = SREG;
+   noInterrupts();
+   unsigned long ticks = sweep_late_ticks;
+   SREG = oldSREG;
+   return (ticks << sweep_prescale_shift) / (F_CPU / 1000000UL);
+}
+
+/**
+ * checks whether the timer is still stepping a sweep
+ */
+inline boolean sweepRunning() {
+   return sweep_active && sweep_timer_running;
+}
+
+/**
+ * keeps a running sweep fed, and ends it when it is done or an event
+ * has been posted
+ * call once per loop pass
+ * @return true while the sweep runs and owns the bus
+ */
+boolean checkSweep() {
+   if (!sweep_active) {
+      return false;
+   }
+   if (sweep_timer_running && vfoEvents.isEmpty()) {
+      frequencySweep.refill();
+      return true;
+   }
+
+   stopSweep();
+   return false;
+}
+
+/**
+ * runs an SW command with parameters: stops, or starts a sweep
+ * @param  parser  holding the command
+ * @return false if the parameters are bad or the sweep is refused
+ */
+boolean runSweepCommand(const CATParser &parser) {
+   unsigned long start, stop, step, dwell, repeat;
+
+   if (parser.parameterLength() == 1) {
+      if (!parser.number(repeat) || (repeat != 0)) {
+         return false;
+      }
+      if (sweep_active) {
+         stopSweep();
+      }
+      return true;
+   }
+
+   return (parser.parameterLength() == CAT_SWEEP_LENGTH)
+       && parser.number(CAT_SWEEP_START,  CAT_FREQUENCY_DIGITS,   start)
+       && parser.number(CAT_SWEEP_STOP,   CAT_FREQUENCY_DIGITS,   stop)
+       && parser.number(CAT_SWEEP_STEP,   CAT_SWEEP_STEP_DIGITS,  step)
+       && parser.number(CAT_SWEEP_DWELL,  CAT_SWEEP_DWELL_DIGITS, dwell)
+       && parser.number(CAT_SWEEP_REPEAT, 1,                      repeat)
+       && (repeat <= 1)
+       && startSweep(start, stop, step, dwell, repeat != 0);
+}
+
+/**
+ * sends the sweep status answer
+ */
+void sendSweepStatus() {
+   Serial.print(F("SW"));
+   Serial.write(sweepRunning() ? '1' : '0');
+   sendCATDigits(frequencySweep.written(),   CAT_SWEEP_COUNT_DIGITS);
+   sendCATDigits(frequencySweep.underruns(), CAT_SWEEP_COUNT_DIGITS);
+   sendCATDigits(sweepLateMicros(),          CAT_SWEEP_DWELL_DIGITS);
+   Serial.write(';');
+}
+
+/**
+ * runs the command in a parser if it is the sweep's, SW, and answers
+ * it
+ * @param  parser  holding a whole command
+ * @return false if it is not a sweep command
+ */
+boolean runSweepCATCommand(const CATParser &parser) {
+   if (!parser.is("SW")) {
+      return false;
+   }
+   if (parser.parameterLength() == 0) {
+      sendSweepStatus();
+   }
+   else if (!runSweepCommand(parser)) {
+      Serial.print(F("?;"));
+   }
+   return true;
+}
+
+#endif // SWEEPCONTROL_H
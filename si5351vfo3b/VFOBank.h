@@ -0,0 +1,346 @@
+#ifndef VFOBANK_H
+#define VFOBANK_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains class VFOBank, which separates the logical bands
+ * the operator tunes from the clock outputs of the SI5351 chips.
+ *
+ * Bands are listed in a PROGMEM table (see BandDefinition.h), each
+ * naming the chip and clock it is sent out on; several bands may share
+ * one output. Only the selected band is live, in a single vfo object that
+ * is moved from band to band. For the others the bank keeps just what
+ * the operator has changed: the tuned frequency (4 bytes) and the
+ * enabled flag (1 bit), in arrays the sketch sizes from the table.
+ * Everything else stays in flash, so a band costs no SRAM beyond that.
+ *
+ * Switching saves the live frequency, points the vfo at the new band
+ * and turns its clock on. The bank remembers which band each output
+ * was last loaded with: if the new band is still loaded on its output
+ * the switch is just the output enables, one write when both bands are
+ * on the same chip. Otherwise one frequency load is added. The cost does not
+ * depend on the number of bands.
+ */
+
+#include <Arduino.h>
+#include <si5351.h>
+
+#include "BandDefinition.h"
+#include "Si5351Group.h"
+#include "si5351_VFODefinition.h"
+
+/**
+ * outputs tracked for loaded bands, CLK0 - CLK7 on each chip
+ */
+#define VFOBANK_OUTPUTS                  (SI5351_GROUP_MAX_DEVICES * SI5351_GROUP_CLOCKS)
+#define VFOBANK_NO_BAND                  0xff
+
+/**
+ * bytes needed for the enabled bits of a number of bands
+ */
+#define VFOBANK_ENABLED_BYTES(bands)     (((bands) + 7) / 8)
+
+/**
+ * This class holds the band list and the live vfo
+ */
+class VFOBank {
+protected:
+   /**
+    * band table in flash
+    */
+   const BandDefinition *mp_bands;
+   uint8_t               mc_count;
+
+   /**
+    * tuned frequency of each band, supplied by the sketch
+    * the entry of the selected band is stale while it is live
+    */
+   unsigned long        *mp_frequency;
+
+   /**
+    * enabled bit of each band, supplied by the sketch
+    */
+   uint8_t              *mp_enabled;
+
+   uint8_t               mc_selected;
+
+   /**
+    * band last loaded into each output
+    */
+   uint8_t               mc_loaded[VFOBANK_OUTPUTS];
+
+   /**
+    * the selected band, running on its clock
+    */
+   si5351_VFODefinition  m_vfo;
+
+   /**
+    * chips running the outputs
+    */
+   Si5351Group          &m_devices;
+
+   /**
+    * gets the output of the live vfo
+    * @return subscript in mc_loaded
+    */
+   uint8_t output() const {
+      return m_vfo.getDevice() * SI5351_GROUP_CLOCKS + m_vfo.getClock();
+   }
+
+   /**
+    * writes the enabled bit of a band
+    */
+   void storeEnabled(uint8_t band, boolean flag) {
+      if (flag) {
+         mp_enabled[band >> 3] |= bit(band & 7);
+      }
+      else {
+         mp_enabled[band >> 3] &= ~bit(band & 7);
+      }
+   }
+
+   /**
+    * copies the live vfo back into the band arrays
+    */
+   void save() {
+      mp_frequency[mc_selected] = m_vfo.getFrequency();
+      storeEnabled(mc_selected, m_vfo.isEnabled());
+   }
+
+public:
+   /**
+    * Constructor
+    *
+    * @param  devices      SI5351 chips running the clocks
+    * @param  bands        band table in PROGMEM
+    * @param  count        number of bands in the table
+    * @param  frequencies  array of count tuned frequencies
+    * @param  enabled      array of VFOBANK_ENABLED_BYTES(count) bytes
+    */
+   VFOBank(Si5351Group &devices
+         , const BandDefinition *bands
+         , uint8_t count
+         , unsigned long *frequencies
+         , uint8_t *enabled)
+   : mp_bands(bands)
+   , mc_count(count)
+   , mp_frequency(frequencies)
+   , mp_enabled(enabled)
+   , mc_selected(0)
+   , m_vfo(devices, bands)
+   , m_devices(devices)
+   {
+      for (uint8_t ii=0; ii<VFOBANK_OUTPUTS; ++ii) {
+         mc_loaded[ii] = VFOBANK_NO_BAND;
+      }
+   }
+
+   /**
+    * sets all bands to their default frequency, enabled, and selects
+    * one without touching the clocks
+    * @param  band  band to select
+    */
+   void begin(uint8_t band) {
+      for (uint8_t ii=0; ii<mc_count; ++ii) {
+         mp_frequency[ii] = BandReader(&mp_bands[ii]).defaultFrequency();
+         storeEnabled(ii, true);
+      }
+      mc_selected = band;
+      m_vfo.setBand(&mp_bands[band], mp_frequency[band], true);
+   }
+
+   /**
+    * gets number of bands
+    */
+   uint8_t count() const {
+      return mc_count;
+   }
+
+   /**
+    * gets selected band
+    */
+   uint8_t selected() const {
+      return mc_selected;
+   }
+
+   /**
+    * gets the live vfo, running the selected band
+    */
+   si5351_VFODefinition *active() {
+      return &m_vfo;
+   }
+
+   /**
+    * gets the tuned frequency of a band
+    * @return frequency in Hz
+    */
+   unsigned long frequency(uint8_t band) {
+      return (band == mc_selected) ? m_vfo.getFrequency() : mp_frequency[band];
+   }
+
+   /**
+    * checks whether a frequency is within the limits of a band
+    * @param  band  band to check
+    * @param  f     frequency in Hz
+    */
+   boolean covers(uint8_t band, unsigned long f) {
+      BandReader reader(&mp_bands[band]);
+      return (f >= reader.minFrequency()) && (f <= reader.maxFrequency());
+   }
+
+   /**
+    * finds the band covering a frequency, the selected band first
+    * @param  f  frequency in Hz
+    * @return band, or VFOBANK_NO_BAND if no band covers it
+    */
+   uint8_t bandFor(unsigned long f) {
+      for (uint8_t ii=0; ii<mc_count; ++ii) {
+         uint8_t band = (mc_selected + ii) % mc_count;
+         if (covers(band, f)) {
+            return band;
+         }
+      }
+      return VFOBANK_NO_BAND;
+   }
+
+   /**
+    * checks the enabled flag of a band
+    */
+   boolean isEnabled(uint8_t band) {
+      return (band == mc_selected) ? m_vfo.isEnabled() : ((mp_enabled[band >> 3] & bit(band & 7)) != 0);
+   }
+
+   /**
+    * sets the enabled flag of a band, without touching the clocks
+    */
+   void setEnabled(uint8_t band, boolean flag) {
+      if (band == mc_selected) {
+         m_vfo.setEnabled(flag);
+      }
+      storeEnabled(band, flag);
+   }
+
+   /**
+    * sets the saved state of a band, without touching the clocks
+    * A frequency outside the band limits is left as it was.
+    * @param  band  band to set
+    * @param  f     tuned frequency in Hz
+    * @param  flag  enabled/disabled state of band
+    */
+   void restore(uint8_t band, unsigned long f, boolean flag) {
+      BandReader reader(&mp_bands[band]);
+      if ((f < reader.minFrequency()) || (f > reader.maxFrequency())) {
+         f = frequency(band);
+      }
+
+      if (band == mc_selected) {
+         m_vfo.setBand(&mp_bands[band], f, flag);
+      }
+      mp_frequency[band] = f;
+      storeEnabled(band, flag);
+   }
+
+   /**
+    * selects a band without touching the clocks, for setup
+    * @param  band  band to select
+    */
+   void setSelected(uint8_t band) {
+      save();
+      mc_selected = band;
+      m_vfo.setBand(&mp_bands[band], mp_frequency[band], isEnabled(band));
+   }
+
+   /**
+    * loads the selected band into its clock
+    */
+   void load() {
+      m_vfo.loadFrequency();
+      markLoaded();
+   }
+
+   /**
+    * loads a change of RIT/XIT offset into the selected band's clock
+    * The offset is shared by all bands, so the other outputs no longer
+    * hold what their band needs, and are loaded in full when selected.
+    */
+   void loadOffset() {
+      m_vfo.loadOffset();
+      for (uint8_t ii=0; ii<VFOBANK_OUTPUTS; ++ii) {
+         if (ii != output()) {
+            mc_loaded[ii] = VFOBANK_NO_BAND;
+         }
+      }
+   }
+
+   /**
+    * forgets the band loaded into every output, for a caller that has
+    * written their registers itself; each band is loaded in full when
+    * next selected
+    */
+   void unload() {
+      for (uint8_t ii=0; ii<VFOBANK_OUTPUTS; ++ii) {
+         mc_loaded[ii] = VFOBANK_NO_BAND;
+      }
+   }
+
+   /**
+    * records the selected band as already in its clock, for an output
+    * brought up by Si5351Group::restore()
+    */
+   void markLoaded() {
+      mc_loaded[output()] = mc_selected;
+   }
+
+   /**
+    * switches to another band
+    * Turns off the clock of the old band, and turns on the clock of
+    * the new one if it is enabled, loading its frequency first unless
+    * the output still holds it. When no load is needed both output
+    * changes go out together.
+    * @param  band  band to select
+    */
+   void select(uint8_t band) {
+      select(band, frequency(band));
+   }
+
+   /**
+    * switches to another band and tunes it, with one load of its clock
+    * @param  band  band to select
+    * @param  f     frequency in Hz, within the band limits
+    */
+   void select(uint8_t band, unsigned long f) {
+      m_vfo.stageStop();
+      setSelected(band);
+      if (f != m_vfo.getFrequency()) {
+         m_vfo.setFrequency(f);
+         mc_loaded[output()] = VFOBANK_NO_BAND;
+      }
+      if (mc_loaded[output()] != band) {
+         // old clock off while the dividers change
+         m_devices.flush();
+         load();
+      }
+      m_vfo.stageStart();
+      m_devices.flush();
+   }
+};
+
+#endif // VFOBANK_H
@@ -23,10 +23,30 @@
  *
  * This file contains the definition of base class VFODefinition, 
  * which defines the methods needed by the three band VFO.
+ *
+ * Besides the dial frequency a vfo holds a RIT/XIT offset, shared by
+ * the two as on Kenwood rigs, and flags saying which of them is on
+ * and whether the rig is transmitting. The output runs at the dial
+ * frequency plus the offset while RIT is on and receiving, or XIT is
+ * on and transmitting. The dial frequency itself never moves, and a
+ * change of offset or flags is loaded with loadOffset(), which the
+ * hardware may do more cheaply than a whole loadFrequency().
  */
   
 #include <Arduino.h> 
 
+/**
+ * offset flags, see VFODefinition::setOffsetFlags()
+ */
+#define VFO_OFFSET_RIT                 0x01   // offset on while receiving
+#define VFO_OFFSET_XIT                 0x02   // offset on while transmitting
+#define VFO_OFFSET_TRANSMIT            0x04   // rig is transmitting
+
+/**
+ * largest offset either way, in Hz
+ */
+#define VFO_OFFSET_MAX                 9999
+
 /**
  * This class defines the methods needed by the three band VFO to operate
  * the SI5351 clock chip.
@@ -37,6 +57,8 @@ protected:
    unsigned long minFrequency;
    unsigned long maxFrequency;
    boolean       enabled;
+   long          offset;
+   uint8_t       offsetFlags;
    
 public:
    /**
@@ -55,6 +77,8 @@ public:
    , minFrequency(minf)
    , maxFrequency(maxf)
    , enabled(flag)
+   , offset(0)
+   , offsetFlags(0)
    {}
    
    /**
@@ -65,6 +89,19 @@ public:
       return frequency;
    }
    
+   /**
+    * sets vfo frequency, if it is within the vfo limits
+    * @param  f  new vfo frequency in Hz
+    * @return false if the frequency is out of range
+    */   
+   virtual boolean setFrequency(unsigned long f) {
+      if ((f < minFrequency) || (f > maxFrequency)) {
+         return false;
+      }
+      frequency = f;
+      return true;
+   }
+   
    /**
     * flips vfo enabled/disabled state 
     */   
@@ -114,6 +151,60 @@ public:
       }
    }
 
+   /**
+    * gets the RIT/XIT offset
+    * @return offset in Hz, whether or not it is on
+    */
+   virtual long getOffset() {
+      return offset;
+   }
+
+   /**
+    * sets the RIT/XIT offset, if it is within VFO_OFFSET_MAX
+    * @param  hz  new offset in Hz
+    * @return false if the offset is out of range
+    */
+   virtual boolean setOffset(long hz) {
+      if ((hz < -VFO_OFFSET_MAX) || (hz > VFO_OFFSET_MAX)) {
+         return false;
+      }
+      offset = hz;
+      return true;
+   }
+
+   /**
+    * gets the offset flags
+    * @return VFO_OFFSET_* flags
+    */
+   virtual uint8_t getOffsetFlags() {
+      return offsetFlags;
+   }
+
+   /**
+    * sets the offset flags
+    * @param  flags  VFO_OFFSET_* flags
+    */
+   virtual void setOffsetFlags(uint8_t flags) {
+      offsetFlags = flags;
+   }
+
+   /**
+    * gets the offset the output is running at now
+    * @return offset in Hz, 0 unless RIT or XIT applies
+    */
+   virtual long getOutputOffset() {
+      boolean transmit = (offsetFlags & VFO_OFFSET_TRANSMIT) != 0;
+      return (offsetFlags & (transmit ? VFO_OFFSET_XIT : VFO_OFFSET_RIT)) ? offset : 0;
+   }
+
+   /**
+    * gets the frequency the output is running at
+    * @return dial frequency plus the offset in effect, in Hz
+    */
+   virtual unsigned long getOutputFrequency() {
+      return frequency + getOutputOffset();
+   }
+
    // abstract methods
    
    /**
@@ -131,6 +222,12 @@ public:
     * loads vfo current frequency into the hardware
     */
    virtual void loadFrequency()        = 0;
+
+   /**
+    * loads a change of offset or offset flags into the hardware,
+    * the dial frequency unchanged
+    */
+   virtual void loadOffset()           = 0;
    
 };   
    
@@ -24,9 +24,14 @@
  * This file contains the definition of base class VFODisplay, 
  * which defines the methods needed by the three band VFO to 
  * display VFO frequency and status.
+ *
+ * The display shows a fixed number of band lines. When the bank holds
+ * more bands than that, the lines are a window over the band list that
+ * scrolls to keep the selected band in view.
  */
  
 #include <Arduino.h> 
+#include "VFOBank.h"
 
 /**
  * display character constants
@@ -36,10 +41,17 @@
 #define DISABLED_CHARACTER               0xa1  // empty square
 #define NOT_SELECTED                     ' '   // space
 #define FREQ_DELTA_CHARACTER             0xb3  // up pointing triangle
-#define HEADING_PREFIX                   "SI5351 N2HTT "
+#define HEADING_PREFIX                   "SI5351 N2HTT "  // printed with F(), stays in flash
 #define SHOW_HEADING                     true
 #define NO_HEADING                       false
 
+/**
+ * RIT/XIT labels in flash, indexed by the offset flags less one,
+ * four bytes each
+ */
+#define OFFSET_LABEL_LENGTH              4
+const char vfo_display_offset_labels[] PROGMEM = "RIT\0XIT\0R+X";
+
 
 /**
  * This class defines the methods needed by the three band VFO to 
@@ -51,8 +63,9 @@ protected:
    unsigned long   ml_freq;
    unsigned long   ml_freq_delta;
    
-   VFODefinition **mpp_vfos;
-   int             mi_number_of_vfos;
+   VFOBank        *mp_bank;
+   int             mi_number_of_lines;
+   int             mi_firstBand;
    int             mi_currentVFO;
    int             mi_displayLine;
    boolean         mb_enabled;
@@ -67,15 +80,17 @@ protected:
    /**
     * Constructor     
     * 
-    * @param  num_vfos number of vfos to show in display
+    * @param  bank   band list to show
+    * @param  lines  number of band lines in display
     */
-   VFODisplay(VFODefinition **vfos
-            , int num_vfos
+   VFODisplay(VFOBank *bank
+            , int lines
             , boolean show_header = SHOW_HEADING)
-   : mpp_vfos(vfos)
-   , mi_number_of_vfos(num_vfos)
-   , ml_freq(0)
+   : ml_freq(0)
    , ml_freq_delta(0)
+   , mp_bank(bank)
+   , mi_number_of_lines((lines < bank->count()) ? lines : bank->count())
+   , mi_firstBand(0)
    , mi_currentVFO(0)
    , mi_displayLine(0)
    , mb_enabled(false)
@@ -86,6 +101,28 @@ protected:
    , mc_freqDelta(FREQ_DELTA_CHARACTER)  
    {ms_buffer[0]=0;}
    
+   /**
+    * scrolls the window of band lines so the selected band is on it
+    */
+   void scrollToCurrent() {
+      if (mi_currentVFO < mi_firstBand) {
+         mi_firstBand = mi_currentVFO;
+      }
+      else if (mi_currentVFO >= mi_firstBand + mi_number_of_lines) {
+         mi_firstBand = mi_currentVFO - mi_number_of_lines + 1;
+      }
+   }
+
+   /**
+    * loads frequency and status of a band for display
+    * @param  band  subscript of band in list (from 0)
+    */
+   void loadDisplayLine(int band) {
+      mi_displayLine = band;
+      mb_enabled = mp_bank->isEnabled(band);
+      ml_freq = mp_bank->frequency(band);
+   }
+
    /**
     * select indicator character for selected vfo
     */
@@ -97,23 +134,46 @@ protected:
                   :mc_notSelected);
    }
     
+   /**
+    * RIT/XIT offset of the selected band formatted as RIT +nnnn Hz,
+    * the width of HEADING_PREFIX so it can stand in for it
+    * @return false, buffer untouched, when neither is on
+    */
+   boolean formatOffset() {
+      VFODefinition *vfo = mp_bank->active();
+      uint8_t flags = vfo->getOffsetFlags() & (VFO_OFFSET_RIT | VFO_OFFSET_XIT);
+      if (flags == 0) {
+         return false;
+      }
+      strcpy_P(ms_buffer, vfo_display_offset_labels + (flags - 1) * OFFSET_LABEL_LENGTH);
+      sprintf_P(ms_buffer + OFFSET_LABEL_LENGTH - 1, PSTR(" %+05ld Hz "), vfo->getOffset());
+      return true;
+   }
+
    /**
     * frequency formatted as nn.nnnnn 
     */
    void formatFrequencyMHz() {
       long mant = ml_freq / 1000000L;
       long dec =  (ml_freq % 1000000L) / 10L;
-      sprintf(ms_buffer, "%2lu.%05lu", mant,dec);
+      sprintf_P(ms_buffer, PSTR("%2lu.%05lu"), mant,dec);
    }
    
 public:
     
+   /**
+    * sets up the display hardware
+    * called from setup(), so that display objects can be statically
+    * allocated and constructed before the bus is running
+    */
+   virtual void begin() {}
+
    /**
     * abstract method 
-    * display heading line and all vfos 
+    * display heading line and the window of bands around the
+    * selected one
     * @param  f_delta current frequency change increment
-    * @param  currentVFO subscript of selected vfo in list (from 0)
-    * @param  vfoList pointer to array holding vfo list
+    * @param  currentVFO subscript of selected band in list (from 0)
     */
    virtual void showVFOs(unsigned long f_delta, short currentVFO) = 0;
     
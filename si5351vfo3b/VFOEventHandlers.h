@@ -0,0 +1,275 @@
+#ifndef VFOEVENTHANDLERS_H
+#define VFOEVENTHANDLERS_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the event handlers run by the operating loop,
+ * the dispatch table mapping event types to them, and the timer tick
+ * that posts the button and overlay timeout events.
+ *
+ * The encoder interrupts post encoder step events themselves (see
+ * FrequencySelection.h). The buttons need time based debouncing, so
+ * they are read once per loop tick, which posts an event only when
+ * a press has been recognized.
+ *
+ * The handlers do not paint the display themselves: they ask for a
+ * paint, and dispatchEvents() does the one asked for last once all
+ * the waiting events have been run. A full frame is around 90 ms on
+ * the OLED, so a pass that takes a burst of encoder steps and button
+ * presses still paints once, not once per event.
+ *
+ * To add a control, give it an event type in VFOEventQueue.h and a
+ * handler in the dispatch table below, and post the event from
+ * wherever the control is read.
+ */
+
+#include <Arduino.h>
+
+/**
+ * button ids - the argument of button events
+ */
+#define BUTTON_VFO_SELECT                0
+#define BUTTON_FREQ_DELTA                1
+#define NUMBER_OF_BUTTONS                2
+
+/**
+ * display paints the handlers ask for
+ */
+#define DISPLAY_PAINT_NONE               0
+#define DISPLAY_PAINT_VFOS               1
+#define DISPLAY_PAINT_FREQ_DELTA         2
+
+uint8_t display_paint = DISPLAY_PAINT_NONE;
+
+/**
+ * asks for a repaint of the vfo display, done by dispatchEvents()
+ */
+void repaintVFOs() {
+   display_paint = DISPLAY_PAINT_VFOS;
+}
+
+/**
+ * short press on vfo select button - switch to next band
+ */
+void selectNextVFO() {
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+
+   // turn off current clock, turn on clock of next band
+   // if not disabled
+   vfoBank.select((vfoBank.selected() + 1) % vfoBank.count());
+   noteStateChange();
+
+   // repaint the vfo display
+   repaintVFOs();
+}
+
+/**
+ * long press on vfo select button - toggle vfo enable flag
+ */
+void toggleCurrentVFO() {
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+
+   vfoBank.active()->toggleEnabled();
+
+   // turn on new clock if not disabled
+   vfoBank.active()->start();
+   noteStateChange();
+
+   // repaint the vfo display
+   repaintVFOs();
+}
+
+/**
+ * short press on frequency delta button - change frequency delta
+ */
+void selectNextFrequencyDelta() {
+   if (frequency_delta < FREQ_DELTA_MAX) {
+      frequency_delta *= FREQ_DELTA_MULT;
+   }
+   else {
+      frequency_delta = FREQ_DELTA_MIN;
+   }
+   noteStateChange();
+
+   // take over display to show new frequency delta
+   display_paint = DISPLAY_PAINT_FREQ_DELTA;
+   freq_delta_display_time = FREQ_DELTA_LATENCY_MILS;
+}
+
+/**
+ * long press on frequency delta button - disable all VFOs
+ */
+void disableAllVFOs() {
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+
+   // set band enable flags off
+   for (int ii=0; ii<vfoBank.count(); ++ii) {
+      vfoBank.setEnabled(ii, false);
+   }
+
+   // turn off current clock, the only one running
+   vfoBank.active()->stop();
+   noteStateChange();
+
+   // repaint the vfo display
+   repaintVFOs();
+}
+
+/**
+ * button actions, indexed by button id
+ */
+void (* const shortPressActions[NUMBER_OF_BUTTONS])() = {
+   selectNextVFO,
+   selectNextFrequencyDelta
+};
+
+void (* const longPressActions[NUMBER_OF_BUTTONS])() = {
+   toggleCurrentVFO,
+   disableAllVFOs
+};
+
+/**
+ * handles encoder step event - updates current vfo frequency
+ */
+void onEncoderStep(const VFOEvent &) {
+   stallBreadcrumb(STALL_TASK_SI5351_WRITE);
+   if (updateSelectedFrequencyValue()) {
+      noteStateChange();
+      vfoEvents.postOnce(EVENT_FREQUENCY_CHANGED);
+   }
+}
+
+/**
+ * handles short button press event
+ */
+void onButtonShort(const VFOEvent &event) {
+   shortPressActions[event.arg]();
+}
+
+/**
+ * handles long button press event
+ */
+void onButtonLong(const VFOEvent &event) {
+   longPressActions[event.arg]();
+}
+
+/**
+ * handles overlay expired event - back to the vfo display
+ */
+void onOverlayExpired(const VFOEvent &) {
+   repaintVFOs();
+}
+
+/**
+ * handles frequency changed event - re-display frequencies
+ */
+void onFrequencyChanged(const VFOEvent &) {
+   repaintVFOs();
+}
+
+/**
+ * handles display start event - set up the display and paint it,
+ * posted by setup() so RF does not wait for the display
+ */
+void onDisplayStart(const VFOEvent &) {
+   stallBreadcrumb(STALL_TASK_SETUP_DISPLAY);
+   setupDisplay();
+   repaintVFOs();
+}
+
+/**
+ * dispatch table, indexed by event type
+ */
+const VFOEventHandler vfoEventHandlers[NUMBER_OF_EVENT_TYPES] = {
+   onEncoderStep,          // EVENT_ENCODER_STEP
+   onButtonShort,          // EVENT_BUTTON_SHORT
+   onButtonLong,           // EVENT_BUTTON_LONG
+   onOverlayExpired,       // EVENT_OVERLAY_EXPIRED
+   onFrequencyChanged,     // EVENT_FREQUENCY_CHANGED
+   onDisplayStart          // EVENT_DISPLAY_START
+};
+
+/**
+ * runs the handlers for the waiting events, then paints the display
+ * once if any of them asked for it
+ */
+void dispatchEvents() {
+   vfoEvents.dispatch(vfoEventHandlers);
+
+   switch (display_paint) {
+      case DISPLAY_PAINT_VFOS:
+         stallBreadcrumb(STALL_TASK_DISPLAY_PAINT);
+         pDisplay->showVFOs(frequency_delta, vfoBank.selected());
+         break;
+
+      case DISPLAY_PAINT_FREQ_DELTA:
+         stallBreadcrumb(STALL_TASK_DISPLAY_PAINT);
+         pDisplay->showFreqDeltaDisplay(frequency_delta);
+         break;
+   }
+   display_paint = DISPLAY_PAINT_NONE;
+}
+
+/**
+ * reads a button and posts an event for a recognized press
+ * Takes the pin by its own type, so a PolicyDigitalInputPin is read
+ * through its policy, inline.
+ * @param  pin     button input pin
+ * @param  button  button id
+ */
+template <class INPUT_PIN>
+void postButtonEvent(INPUT_PIN &pin, int8_t button) {
+   if (pin.readInputPulseMode()) {
+      switch (pin.getCurrentPinMode()) {
+         case PIN_MODE_SHORT_PULSE:
+            vfoEvents.post(EVENT_BUTTON_SHORT, button);
+            pin.setCurrentPinMode(PIN_MODE_IDLE);
+            break;
+
+         case PIN_MODE_LONG_PULSE:
+            vfoEvents.post(EVENT_BUTTON_LONG, button);
+            pin.setCurrentPinMode(PIN_MODE_IDLE);
+            break;
+      }
+   }
+}
+
+/**
+ * loop timer tick - posts button and timeout events
+ */
+void postTickEvents() {
+   // selecting output vfo is first priority
+   postButtonEvent(VFOSelectPin, BUTTON_VFO_SELECT);
+   postButtonEvent(FrequencyDeltaSelectPin, BUTTON_FREQ_DELTA);
+
+   // check to see if freq delta display needs to be overwritten
+   if (freq_delta_display_time > 0) {
+      freq_delta_display_time = ((unsigned long)freq_delta_display_time > loop_elapsed_mils)
+                              ? (short)(freq_delta_display_time - loop_elapsed_mils)
+                              : 0;
+
+      if (freq_delta_display_time <= 0) {
+         vfoEvents.postOnce(EVENT_OVERLAY_EXPIRED);
+      }
+   }
+}
+
+#endif // VFOEVENTHANDLERS_H
@@ -0,0 +1,237 @@
+#ifndef VFOEVENTQUEUE_H
+#define VFOEVENTQUEUE_H
+
+/**
+ * @file
+ * @author  Mike Aiello N2HTT <n2htt@arrl.net>
+ * @version 1.0
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details at
+ * http://www.gnu.org/copyleft/gpl.html
+ *
+ * @section DESCRIPTION
+ *
+ * This file contains the definition of VFOEventQueue, a small ring
+ * buffer of events feeding the operating loop. Events are posted by
+ * the interrupt handlers and by the loop timer tick, and taken off
+ * by the loop, which runs the handler for each event type from a
+ * dispatch table. The loop only does work for events that happened.
+ *
+ * Posting is safe from interrupt handlers and from the loop. Only
+ * the loop takes events off the queue.
+ */
+
+#include <Arduino.h>
+
+/**
+ * event types
+ */
+#define EVENT_ENCODER_STEP          0    // encoder moved a full step
+#define EVENT_BUTTON_SHORT          1    // short press, arg is button id
+#define EVENT_BUTTON_LONG           2    // long press, arg is button id
+#define EVENT_OVERLAY_EXPIRED       3    // overlay display time is up
+#define EVENT_FREQUENCY_CHANGED     4    // a vfo frequency has changed
+#define EVENT_DISPLAY_START         5    // display is to be set up and painted
+#define NUMBER_OF_EVENT_TYPES       6
+
+/**
+ * queue size, must be a power of 2
+ */
+#define EVENT_QUEUE_SIZE            8
+
+/**
+ * An event - type and a small argument
+ */
+struct VFOEvent {
+   uint8_t type;
+   int8_t  arg;
+};
+
+/**
+ * event handler function, as stored in a dispatch table
+ */
+typedef void (*VFOEventHandler)(const VFOEvent &event);
+
+/**
+ * This class holds events waiting for the loop
+ */
+class VFOEventQueue {
+protected:
+   VFOEvent          m_events[EVENT_QUEUE_SIZE];
+   volatile uint8_t  mc_head;
+   volatile uint8_t  mc_tail;
+
+  /**
+   * bit per event type posted with postOnce() and not yet taken
+   */
+   volatile uint8_t  mc_pending;
+
+  /**
+   * number of events dropped because the queue was full
+   */
+   volatile uint8_t  mc_overflows;
+
+  /**
+   * adds event to queue - interrupts must be off
+   */
+   boolean put(uint8_t type, int8_t arg) {
+      uint8_t next = (mc_head + 1) & (EVENT_QUEUE_SIZE - 1);
+
+      if (next == mc_tail) {
+         ++mc_overflows;
+         return false;
+      }
+
+      m_events[mc_head].type = type;
+      m_events[mc_head].arg  = arg;
+      mc_head = next;
+      return true;
+   }
+
+public:
+  /**
+   * Constructor
+   */
+   VFOEventQueue()
+   : mc_head(0)
+   , mc_tail(0)
+   , mc_pending(0)
+   , mc_overflows(0)
+   {}
+
+  /**
+   * posts an event
+   * @param  type  event type
+   * @param  arg   event argument
+   * @return false if the queue was full and the event was dropped
+   */
+   boolean post(uint8_t type, int8_t arg = 0) {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      boolean rtn = put(type, arg);
+      SREG = oldSREG;
+      return rtn;
+   }
+
+  /**
+   * posts an event unless one of the same type, also posted with
+   * postOnce(), is still waiting. Use for events that just mean
+   * "go and look", so a burst of them costs one handler call.
+   * @param  type  event type
+   * @return false if the queue was full and the event was dropped
+   */
+   boolean postOnce(uint8_t type) {
+      boolean rtn = true;
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      if (!(mc_pending & bit(type))) {
+         rtn = put(type, 0);
+         if (rtn) {
+            mc_pending |= bit(type);
+         }
+      }
+      SREG = oldSREG;
+      return rtn;
+   }
+
+  /**
+   * takes the oldest event off the queue
+   * @param  event  receives the event
+   * @return false if the queue was empty
+   */
+   boolean get(VFOEvent &event) {
+      boolean rtn = false;
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      if (mc_tail != mc_head) {
+         event = m_events[mc_tail];
+         mc_tail = (mc_tail + 1) & (EVENT_QUEUE_SIZE - 1);
+         mc_pending &= ~bit(event.type);
+         rtn = true;
+      }
+      SREG = oldSREG;
+      return rtn;
+   }
+
+  /**
+   * checks for waiting events
+   * @return true if no events are waiting
+   */
+   boolean isEmpty() const {
+      return mc_tail == mc_head;
+   }
+
+  /**
+   * drops every waiting event unless one of some types is among them,
+   * for a control that owns the loop and leaves only those to it
+   * @param  types  bit per event type
+   * @return true if one of them is waiting, and nothing was dropped
+   */
+   boolean clearUnless(uint8_t types) {
+      boolean rtn = false;
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      for (uint8_t ii=mc_tail; ii!=mc_head; ii=(ii + 1) & (EVENT_QUEUE_SIZE - 1)) {
+         if (types & bit(m_events[ii].type)) {
+            rtn = true;
+            break;
+         }
+      }
+      if (!rtn) {
+         mc_tail    = mc_head;
+         mc_pending = 0;
+      }
+      SREG = oldSREG;
+      return rtn;
+   }
+
+  /**
+   * drops every waiting event, for a control that takes whatever
+   * was posted as its own
+   */
+   void clear() {
+      uint8_t oldSREG = SREG;
+      noInterrupts();
+      mc_tail    = mc_head;
+      mc_pending = 0;
+      SREG = oldSREG;
+   }
+
+  /**
+   * gets number of events dropped on a full queue
+   * @return overflow count
+   */
+   uint8_t getOverflows() const {
+      return mc_overflows;
+   }
+
+  /**
+   * runs the handler for every waiting event
+   * Events posted by the handlers are run in the same call, up to a
+   * queue's worth, so steady input from the interrupt handlers can
+   * not keep the loop from getting back to its tick. Anything left
+   * over is run on the next pass, which does not sleep first.
+   * @param  handlers  dispatch table, indexed by event type
+   */
+   void dispatch(const VFOEventHandler *handlers) {
+      VFOEvent event;
+      uint8_t  count = EVENT_QUEUE_SIZE;
+      while (count-- && get(event)) {
+         if (event.type < NUMBER_OF_EVENT_TYPES) {
+            handlers[event.type](event);
+         }
+      }
+   }
+};
+
+#endif // VFOEVENTQUEUE_H
@@ -27,12 +27,31 @@
  * found here:
  * 
  * https://github.com/etherkit/Si5351Arduino
+ *
+ * loadFrequency() runs the output at the dial frequency plus the
+ * offset in effect, writing the multisynth block worked out by
+ * Si5351Group::multisynth() in one transfer. It does not use the
+ * library's set_freq, which moves every clock but CLK0 to PLL B and
+ * programs PLL B itself from the uncorrected crystal (see
+ * Si5351Group.h). A change of RIT/XIT offset does not
+ * go through a whole load again: on the first one after a load the
+ * divider of the dial frequency is worked out once, a + b/c, with the
+ * rate the fraction b moves per Hz of offset and the inverse of the
+ * frequency. Each offset is then a few multiplies on b, the series of
+ * 1/(f + d) to its square term, which puts b within a count of what
+ * a load would over VFO_OFFSET_MAX. Only the registers from the
+ * first one that changed are sent, 3 or 4 bytes against a load's 8.
+ * The first offset after a load sends the whole block. Like
+ * Si5351Group::writeMultisynth() this needs the clock in fractional
+ * mode, as Si5351Group::begin() leaves it.
  */
  
 #include <Arduino.h> 
 #include <si5351.h>
 
 #include "VFODefinition.h"
+#include "BandDefinition.h"
+#include "Si5351Group.h"
 
 /**
  * This class mplements the methods defined in base class
@@ -42,69 +61,226 @@ class si5351_VFODefinition : public VFODefinition {
 protected:   
    
    /**
-    * Stores PLL selection for this vfo
+    * band record in flash, holding the PLL, chip and clock
+    * selection for this vfo
     */
-   unsigned long long si5351PLL;
+   BandReader         m_band;
    
    /**
-    * Stores clock selection for this vfo
+    * reference to extenally defined SI5351 chips,
+    * one of which runs this vfo
     */
-   si5351_clock       si5351Clock;
-   
+   Si5351Group        &m_devices;
+
    /**
-    * reference to extenally defined SI5351 object
-    * which runs this vfo
+    * divider of the dial frequency, worked out on the first change of
+    * offset after a load: whole part, fraction in 1/SI5351_FRAC_DENOM
+    * with 16 more bits of it, and output divider, then the fraction's
+    * change per Hz of offset, 16 bit fixed point, and 1/f, 40 bit
+    * fixed point
     */
-   Si5351             &si5351;
-   
+   boolean            mb_solved;
+   unsigned long      ml_a;
+   unsigned long      ml_b;
+   uint16_t           mi_bLow;
+   uint8_t            mc_rdiv;
+   unsigned long      ml_slope;
+   unsigned long      ml_inverse;
+
+   /**
+    * multisynth registers last sent by loadOffset(), good until the
+    * next load
+    */
+   uint8_t            mc_params[SI5351_PARAMETERS_LENGTH];
+   boolean            mb_paramsSent;
+
+   /**
+    * works out the divider of the dial frequency, and how it moves
+    * with the offset
+    */
+   void solveDial() {
+      unsigned long long pll = m_band.pllFrequency();
+      if (pll == 0) {
+         pll = SI5351_PLL_FIXED;
+      }
+      unsigned long long f = (unsigned long long)frequency * SI5351_FREQ_MULT;
+      Si5351Group::divider(pll, f, ml_a, ml_b, mc_rdiv);
+
+      // the divider again, the fraction unrounded
+      f <<= mc_rdiv;
+      unsigned long long n = (pll % f) * SI5351_FRAC_DENOM;
+      ml_a       = (unsigned long)(pll / f);
+      ml_b       = (unsigned long)(n / f);
+      mi_bLow    = (uint16_t)(((n % f) << 16) / f);
+
+      // the whole divider in counts of b, c * (a + b/c), goes as 1/f
+      unsigned long long cd = (SI5351_FRAC_DENOM * pll) / f;
+      ml_slope   = (unsigned long)(((cd << 16) + frequency / 2) / frequency);
+      ml_inverse = (unsigned long)(((1ULL << 40) + frequency / 2) / frequency);
+      mb_solved  = true;
+   }
    
 public:
    
    /**
     * Constructor 
     * 
-    * @param  f     starting frequency of VFO in Hz
-    * @param  minf  minimum frequency of VFO in Hz
-    * @param  maxf  maximum frequency of VFO in Hz
-    * @param  pll   SI5351 PLL selection. See SI5351 library documentation.
-    * @param  clock SI5351 clock selection. See SI5351 library documentation.
+    * @param  devices SI5351 chips, one of which runs the clock
+    * @param  band  band record in PROGMEM: starting, minimum and maximum
+    *               frequency, SI5351 PLL, chip and clock selection. See
+    *               SI5351 library documentation.
     * @param  flag  enabled/disabled state of clock. Default enabled.
     */
-   si5351_VFODefinition(Si5351  &device
-                      , unsigned long f
-                      , unsigned long minf
-                      , unsigned long maxf
-                      , unsigned long long pll
-                      , si5351_clock clock
+   si5351_VFODefinition(Si5351Group &devices
+                      , const BandDefinition *band
                       , boolean flag= true)
-   : si5351(device)
-   , VFODefinition(f,minf,maxf,flag)
-   , si5351PLL(pll)
-   , si5351Clock(clock)
+   : VFODefinition(BandReader(band).defaultFrequency()
+                 , BandReader(band).minFrequency()
+                 , BandReader(band).maxFrequency()
+                 , flag)
+   , m_band(band)
+   , m_devices(devices)
+   , mb_solved(false)
+   , mb_paramsSent(false)
   {}
    
+   /**
+    * moves the vfo to another band, without touching the clock
+    * @param  band  band record in PROGMEM
+    * @param  f     frequency to tune to in Hz
+    * @param  flag  enabled/disabled state of clock
+    */
+   void setBand(const BandDefinition *band, unsigned long f, boolean flag) {
+      m_band        = BandReader(band);
+      minFrequency  = m_band.minFrequency();
+      maxFrequency  = m_band.maxFrequency();
+      frequency     = f;
+      enabled       = flag;
+      mb_solved     = false;
+      mb_paramsSent = false;
+   }
+
+   /**
+    * gets the clock output of the vfo
+    * @return clock
+    */
+   si5351_clock getClock() const {
+      return m_band.clock();
+   }
+
+   /**
+    * gets the chip running the vfo
+    * @return index of chip in group
+    */
+   uint8_t getDevice() const {
+      return m_band.device();
+   }
+
+   /**
+    * gets the PLL frequency the vfo runs from
+    * @return Hz * SI5351_FREQ_MULT
+    */
+   unsigned long long getPllFrequency() const {
+      return m_band.pllFrequency();
+   }
+
+   /**
+    * stages the clock on, written by Si5351Group::flush()
+    * Respects the vfo enabled flag.
+    */
+   void stageStart() {
+      m_devices.outputEnable(m_band.device(), m_band.clock(), enabled);
+   }
+
+   /**
+    * stages the clock off, written by Si5351Group::flush()
+    */
+   void stageStop() {
+      m_devices.outputEnable(m_band.device(), m_band.clock(), false);
+   }
+
    /**
     * Start clock running
     * Respects the vfo enabled flag, will not start clock
     * if vfo is marked disabled.
     */
    virtual void start() {
-      si5351.output_enable(si5351Clock, (enabled)?1:0);   
+      stageStart();
+      m_devices.flush();
    }
    
    /**
     * Stop clock
     */
    virtual void stop()  {
-      si5351.output_enable(si5351Clock, 0);   
+      stageStop();
+      m_devices.flush();
    }
    
    /**
-    * loads vfo current frequency into the clock
-    * takes effect immediately
+    * loads vfo current frequency, and the offset in effect, into the
+    * clock
+    * takes effect immediately; a frequency the divider cannot reach
+    * is not written, and the clock keeps the last one loaded
     */
    virtual void loadFrequency()  {
-      si5351.set_freq(((unsigned long long)frequency)*SI5351_FREQ_MULT, si5351PLL, si5351Clock);
+      uint8_t params[SI5351_PARAMETERS_LENGTH];
+      if (Si5351Group::multisynth(m_band.pllFrequency(), getOutputFrequency(), params)) {
+         m_devices.writeMultisynth(m_band.device(), m_band.clock(), params);
+      }
+      mb_solved     = false;
+      mb_paramsSent = false;
+   }
+
+   /**
+    * loads a change of offset or offset flags into the clock, from
+    * the divider of the dial frequency
+    * takes effect immediately
+    */
+   virtual void loadOffset()  {
+      // the clock still holds the dial frequency the load put there
+      if (!mb_paramsSent && (getOutputOffset() == 0)) {
+         return;
+      }
+      if (!mb_solved) {
+         solveDial();
+      }
+
+      // c * divider at f + d is cd / (1 + y), y = d / f: b moves by
+      // -slope * d * (1 - y + y * y)
+      long long d   = getOutputOffset();
+      long long sd  = (long long)ml_slope * d;
+      long long y   = d * (long long)ml_inverse;
+      long long yy  = ((y >> 8) * (y >> 8)) >> 24;
+      long long q16 = ((long long)ml_b << 16) + mi_bLow - sd + (((sd >> 16) * (y - yy)) >> 24);
+      long          b = (long)((q16 + 0x8000) >> 16);
+      unsigned long a = ml_a;
+      while (b < 0) {
+         b += SI5351_FRAC_DENOM;
+         --a;
+      }
+      while (b >= (long)SI5351_FRAC_DENOM) {
+         b -= SI5351_FRAC_DENOM;
+         ++a;
+      }
+      if (!Si5351Group::dividerInRange(a, (unsigned long)b)) {
+         return;
+      }
+
+      uint8_t params[SI5351_PARAMETERS_LENGTH];
+      Si5351Group::multisynthRegisters(a, (unsigned long)b, mc_rdiv, params);
+
+      uint8_t first = 0;
+      if (mb_paramsSent) {
+         while ((first < SI5351_PARAMETERS_LENGTH) && (params[first] == mc_params[first])) {
+            ++first;
+         }
+      }
+      if (first < SI5351_PARAMETERS_LENGTH) {
+         m_devices.writeMultisynth(m_band.device(), m_band.clock(), params, first);
+         memcpy(mc_params, params, SI5351_PARAMETERS_LENGTH);
+         mb_paramsSent = true;
+      }
    }
 };
 
@@ -15,6 +15,8 @@
  *    current frequency increment.
  *  - Choose your favorite band and frequencies as default start up
  *    values.
+ *  - Processor can sleep between loop passes to save battery power in
+ *    portable operation (USE_IDLE_SLEEP).
  */
  
 /**
@@ -41,8 +43,11 @@
  * breakout board from Etherkit. It should run on any AT328 
  * Arduino. Required resources are:
  *  - 32k program memory
- *  - 1k variable space
- *  - 2 pins supporting external hardware interrupts
+ *  - 2k SRAM, of which the stack needs about 512 bytes; each
+ *    optional feature below takes more of both memories, so check a
+ *    build with tools/memory_budget.py
+ *  - 2 pins supporting external hardware interrupts, or 2 pins on
+ *    one port supporting pin change interrupts
  *  - 2 digital input pins
  *  - I2C bus support for SI5351 and an OLED 128x64 pixel display (0.96")
  *
@@ -131,6 +136,104 @@
  */
 //#define USE_SMALLER_SSD1306_128X64_BUFFER
 
+/**
+ * Uncomment the first line below to let the processor sleep between
+ * loop passes instead of spinning in delay(). Uncomment the second
+ * line as well to drop into power down sleep when the VFO has been
+ * left alone for a while - this needs pin change interrupts on the
+ * encoder and button pins, which the AT328 boards have.
+ * See IdleSleep.h for details.
+ */
+//#define USE_IDLE_SLEEP
+//#define USE_POWER_DOWN_SLEEP
+
+/**
+ * Uncomment the line below to decode the encoder from pin change
+ * interrupts instead of the two external interrupts. This frees
+ * INT0/INT1, lets the encoder go on any two pins of one port, and
+ * allows more encoders to be added. See PinChangeEncoder.h
+ */
+//#define USE_PIN_CHANGE_ENCODER
+
+/**
+ * Uncomment the line below to build the cycle benchmarks into the
+ * sketch. At the end of setup the hot path code is timed on the board
+ * with Timer1 and a table printed on the serial port, then the VFO
+ * runs as usual. See CycleBenchmark.h
+ */
+//#define USE_CYCLE_BENCHMARK
+
+/**
+ * Uncomment the line below to watch SRAM on the serial port: the
+ * memory split after setup, and the smallest free gap between heap
+ * and stack each time it reaches a new low. See StackMonitor.h, and
+ * tools/memory_budget.py for the build time report.
+ */
+//#define USE_STACK_MONITOR
+
+/**
+ * Uncomment the line below to let a computer read and set the
+ * frequency over the serial port, with Kenwood TS-480 CAT commands
+ * at CAT_BAUD_RATE. Power down sleep stops the serial port, so it is
+ * not used while CAT control is built in. See CATControl.h
+ */
+//#define USE_CAT_CONTROL
+
+/**
+ * Uncomment the line below to also take binary frequency frames on
+ * the serial port, for sweeps and hopping tests driven from a
+ * computer faster than CAT commands allow. Needs USE_CAT_CONTROL.
+ * See FrameParser.h and CATControl.h
+ */
+//#define USE_FREQUENCY_STREAM
+
+/**
+ * Uncomment the line below to run timed frequency sweeps of the
+ * selected band, started with the SW CAT command: each point is sent
+ * from a Timer1 interrupt, so the dwell does not depend on the loop.
+ * Needs USE_CAT_CONTROL. See SweepControl.h and FrequencySweep.h
+ */
+//#define USE_FREQUENCY_SWEEP
+
+/**
+ * Uncomment the line below to use the VFO as an antenna analyzer: an
+ * SWR bridge on the selected band's output, its detectors on
+ * ANALYZER_FORWARD_PIN and ANALYZER_REFLECTED_PIN, swept with the SA
+ * CAT command, SWR points sent back as binary frames. Needs
+ * USE_FREQUENCY_SWEEP. See AnalyzerControl.h and DetectorSampler.h
+ */
+//#define USE_ANTENNA_ANALYZER
+
+/**
+ * Uncomment the line below to send WSPR or FT8 style FSK beacon
+ * messages on the selected band, loaded and started with the BM and
+ * BE CAT commands: the tones are switched from the sweep's Timer1
+ * interrupt with precomputed registers, so the symbol edges keep to
+ * the timer. Needs USE_FREQUENCY_SWEEP. See BeaconControl.h and
+ * FSKBeacon.h
+ */
+//#define USE_FSK_BEACON
+
+/**
+ * Uncomment the line below to keep MEMORY_CHANNELS memory channels,
+ * stored and recalled with the MW and MC CAT commands, and scan
+ * through them with SC: each hop is sent from the sweep's Timer1
+ * interrupt as one write of registers worked out when the channel
+ * was stored. A button press pauses the scan on its channel. Needs
+ * USE_FREQUENCY_SWEEP. See ScanControl.h and MemoryChannels.h
+ */
+//#define USE_MEMORY_SCAN
+
+/**
+ * Uncomment the line below to drive a second SI5351 at I2C address
+ * 0x61, running the fixed carriers in the carrier table below (BFO,
+ * transverter LO) alongside the VFO. Bands may also be put on it. The
+ * Etherkit 1.x library always talks to 0x60: this needs a driver that
+ * takes the chip address in its constructor, as the 2.x library does.
+ * See Si5351Group.h
+ */
+//#define USE_SECOND_SI5351
+
 #include <Wire.h>
 #include <SPI.h>
 
@@ -146,19 +249,31 @@
 
 /**
  * Pared-down implementation of DigitalPin/DigitalPulse
- * Uncomment the definition of the macro USE_SIMPLE_DIGITAL_PIN
- * below to use a non-library, local implementation of the 
- * DigitalPin and DigitalPulse classes.
- * 
  * The local versions of these classes have all unused 
  * functionality removed, yielding the minimum flash memory
  * size.
+ *
+ * Button pins are read through FastPin, which reads the port
+ * register directly instead of calling digitalRead(). To go
+ * back to digitalRead(), define INPUT_PIN_TYPE(pn) as
+ * SimpleDigitalInputPin instead.
  */
 #include "SimpleDigitalInputPin.h"
 #include "SimpleDigitalPulse.h"
-#define INPUT_PIN_TYPE SimpleDigitalInputPin
+#include "FastPin.h"
+#define INPUT_PIN_TYPE(pn) PolicyDigitalInputPin< FastPin<pn> >
+
+#include "PinChangeEncoder.h"
+#include "VFOEventQueue.h"
 
+#include "Si5351Group.h"
 #include "si5351_VFODefinition.h"
+#include "VFOBank.h"
+#include "EEPROMLog.h"
+
+#ifdef USE_MEMORY_SCAN
+#include "MemoryChannels.h"
+#endif
 
 #ifdef USE_U8GLIB_LIBRARY
    #ifdef USE_SSD1306_128X64_DISPLAY
@@ -182,12 +297,9 @@
 #define DISPLAY_HEADER_LINE    SHOW_HEADING
 
 /**
- * hardware pin definitions
+ * hardware pin definitions and EEPROM map
  */
-#define ENCODER_PIN_A                     2
-#define ENCODER_PIN_B                     3
-#define VFO_SELECTOR_PIN                  4
-#define FRQ_DELTA_SELECTOR_PIN            5
+#include "HardwareConfig.h"
 
 /**
  * frequency change constants
@@ -198,13 +310,16 @@
 #define FREQ_DELTA_MULT                  10
 
 /**
- * The following two lines control how many 
- * VFOs the sketch will control - maximum 3. 
- * You can reduce the number of VFOs if you are
+ * The following two lines control how many bands
+ * are shown at once, and which band is selected at
+ * power up. The bands themselves are listed in the
+ * band table below - when there are more bands than
+ * display lines, the display scrolls through them.
+ * You can reduce the number of lines if you are
  * using a display with fewer than 3 lines
  */
-#define NUMBER_OF_VFOS                    3
-#define STARTING_VFO                      1
+#define DISPLAY_BAND_LINES                3
+#define STARTING_BAND                     1
 
 /**
  * vfo frequency limits
@@ -230,39 +345,127 @@
 #define FREQ_DELTA_LATENCY_MILS         900
 
 /**
- * Si5351 clock board object
+ * Si5351 clock board objects, device 0 first
  */
 Si5351 si5351;
+#ifdef USE_SECOND_SI5351
+Si5351 si5351b(SI5351_BUS_BASE_ADDR + 1);
+#endif
+
+Si5351 * const si5351List[] = {
+   &si5351,
+#ifdef USE_SECOND_SI5351
+   &si5351b,
+#endif
+};
+
+Si5351Group si5351Devices(si5351List, sizeof(si5351List) / sizeof(si5351List[0]));
+
+/**
+ * band table, held in flash - see BandDefinition.h
+ * Add a line here for each band wanted, up to 255. Bands
+ * may share a clock output; only the selected band runs.
+ * Device is the chip, the subscript in si5351List.
+ */
+const BandDefinition bandTable[] PROGMEM = {
+   // default              minimum              maximum              PLL               clock        device
+   { FREQ_VFO_A_DEFAULT,   FREQ_VFO_A_MIN,      FREQ_VFO_A_MAX,      SI5351_PLL_FIXED, SI5351_CLK0, 0 },
+   { FREQ_VFO_B_DEFAULT,   FREQ_VFO_B_MIN,      FREQ_VFO_B_MAX,      SI5351_PLL_FIXED, SI5351_CLK1, 0 },
+   { FREQ_VFO_C_DEFAULT,   FREQ_VFO_C_MIN,      FREQ_VFO_C_MAX,      SI5351_PLL_FIXED, SI5351_CLK2, 0 },
+};
+
+#ifdef USE_SECOND_SI5351
+/**
+ * fixed carriers, started with the VFO and left running
+ * Each is a band whose limits are its frequency. Every clock runs
+ * from PLL A at SI5351_PLL_FIXED, 900 MHz, so nothing above 112.5 MHz
+ * can be set: the LO here is for a 6 m transverter on a 10 m IF.
+ */
+#define FREQ_BFO                    8998500
+#define FREQ_TRANSVERTER_LO        22000000
+
+const BandDefinition carrierTable[] PROGMEM = {
+   // frequency            minimum              maximum              PLL               clock        device
+   { FREQ_BFO,             FREQ_BFO,            FREQ_BFO,            SI5351_PLL_FIXED, SI5351_CLK0, 1 },
+   { FREQ_TRANSVERTER_LO,  FREQ_TRANSVERTER_LO, FREQ_TRANSVERTER_LO, SI5351_PLL_FIXED, SI5351_CLK1, 1 },
+};
+
+#define NUMBER_OF_CARRIERS   (sizeof(carrierTable) / sizeof(carrierTable[0]))
+#endif
+
+#define NUMBER_OF_BANDS   (sizeof(bandTable) / sizeof(bandTable[0]))
 
 /**
- * vfo list and variables controlling frequency
+ * band bank - see VFOBank.h
+ * The SRAM kept for each band is its tuned frequency and
+ * an enabled bit. All objects are statically allocated, so
+ * the heap is never used and malloc is left out of the link.
  */
-VFODefinition *vfoList[NUMBER_OF_VFOS];
+unsigned long bandFrequency[NUMBER_OF_BANDS];
+uint8_t       bandEnabled[VFOBANK_ENABLED_BYTES(NUMBER_OF_BANDS)];
 
-short currVFO;
-VFODefinition *pCurrentVFO;
+VFOBank vfoBank(si5351Devices, bandTable, NUMBER_OF_BANDS, bandFrequency, bandEnabled);
+
+#ifdef USE_MEMORY_SCAN
+/**
+ * memory channels - see MemoryChannels.h
+ * Each costs 16 bytes of SRAM, and 6 in the channel log
+ * record; up to 40 fit the record.
+ */
+#define MEMORY_CHANNELS                   8
+
+MemoryChannel  memoryChannel[MEMORY_CHANNELS];
+
+MemoryChannels memoryChannels(si5351Devices, bandTable, NUMBER_OF_BANDS, memoryChannel, MEMORY_CHANNELS);
+#endif
+
+/**
+ * variables controlling frequency
+ */
 short freq_delta_display_time;
 unsigned long frequency_delta;
 
+/**
+ * events waiting for the operating loop
+ */
+VFOEventQueue vfoEvents;
+
 /**
  * display object
+ * The display hardware is set up by begin() in setupDisplay().
  */
-VFODisplay *pDisplay;
+#ifdef USE_U8GLIB_LIBRARY
+   #ifdef USE_SSD1306_128X64_DISPLAY
+      SSD1306_U8glib_VFODisplay vfoDisplay(&vfoBank
+                                         , DISPLAY_BAND_LINES
+                                         , DISPLAY_HEADER_LINE);
+   #endif
+#endif
+
+#ifdef USE_LIQUIDCRYSTAL_LIBRARY
+   #ifdef USE_LCD_20X4_DISPLAY
+      LCD2004_LCDLib_VFODisplay vfoDisplay(&vfoBank
+                                         , DISPLAY_BAND_LINES
+                                         , DISPLAY_HEADER_LINE);
+   #endif
+#endif
+
+VFODisplay *pDisplay = &vfoDisplay;
 
 /**
  * digital pins (reading button presses)
  */ 
-INPUT_PIN_TYPE VFOSelectPin( VFO_SELECTOR_PIN
-                                , INPUT_PULLUP
-                                , BUTTON_DEBOUNCE_WAIT_MILS
-                                , DIGITAL_PIN_INIT_STATE_HIGH
-                                , DIGITAL_PIN_INVERTING);
+INPUT_PIN_TYPE(VFO_SELECTOR_PIN) VFOSelectPin( VFO_SELECTOR_PIN
+                                             , INPUT_PULLUP
+                                             , BUTTON_DEBOUNCE_WAIT_MILS
+                                             , DIGITAL_PIN_INIT_STATE_HIGH
+                                             , DIGITAL_PIN_INVERTING);
 
-INPUT_PIN_TYPE FrequencyDeltaSelectPin( FRQ_DELTA_SELECTOR_PIN
-                                       , INPUT_PULLUP
-                                       , BUTTON_DEBOUNCE_WAIT_MILS
-                                       , DIGITAL_PIN_INIT_STATE_HIGH
-                                       , DIGITAL_PIN_INVERTING);
+INPUT_PIN_TYPE(FRQ_DELTA_SELECTOR_PIN) FrequencyDeltaSelectPin( FRQ_DELTA_SELECTOR_PIN
+                                                              , INPUT_PULLUP
+                                                              , BUTTON_DEBOUNCE_WAIT_MILS
+                                                              , DIGITAL_PIN_INIT_STATE_HIGH
+                                                              , DIGITAL_PIN_INVERTING);
 
 
 /**
@@ -270,138 +473,213 @@ INPUT_PIN_TYPE FrequencyDeltaSelectPin( FRQ_DELTA_SELECTOR_PIN
  */
 #include "FrequencySelection.h"
 
+/**
+ * watchdog stall detector
+ */
+#include "StallWatchdog.h"
+
+/**
+ * operating state kept in EEPROM
+ */
+#include "StatePersistence.h"
+
+/**
+ * pin change interrupt vectors for encoders and wake up
+ */
+#include "PinChangeInterrupts.h"
+
 /**
  * initialization code for hardware devices
  */
 #include "DeviceInitializations.h"
 
+#if defined(USE_FREQUENCY_STREAM) && !defined(USE_CAT_CONTROL)
+#error "USE_FREQUENCY_STREAM needs USE_CAT_CONTROL"
+#endif
+
+#if defined(USE_FREQUENCY_SWEEP) && !defined(USE_CAT_CONTROL)
+#error "USE_FREQUENCY_SWEEP needs USE_CAT_CONTROL"
+#endif
+
+#ifdef USE_FREQUENCY_SWEEP
+/**
+ * timed frequency sweeps
+ */
+#include "SweepControl.h"
+#endif
+
+#if defined(USE_ANTENNA_ANALYZER) && !defined(USE_FREQUENCY_SWEEP)
+#error "USE_ANTENNA_ANALYZER needs USE_FREQUENCY_SWEEP"
+#endif
+
+#ifdef USE_ANTENNA_ANALYZER
+/**
+ * antenna analyzer on the sweep
+ */
+#include "AnalyzerControl.h"
+#endif
+
+#if defined(USE_FSK_BEACON) && !defined(USE_FREQUENCY_SWEEP)
+#error "USE_FSK_BEACON needs USE_FREQUENCY_SWEEP"
+#endif
+
+#ifdef USE_FSK_BEACON
+/**
+ * FSK beacon on the sweep timer
+ */
+#include "BeaconControl.h"
+#endif
+
+#if defined(USE_MEMORY_SCAN) && !defined(USE_FREQUENCY_SWEEP)
+#error "USE_MEMORY_SCAN needs USE_FREQUENCY_SWEEP"
+#endif
+
+#ifdef USE_MEMORY_SCAN
+/**
+ * memory channel scan on the sweep timer
+ */
+#include "ScanControl.h"
+#endif
+
+#ifdef USE_CAT_CONTROL
+/**
+ * CAT commands and frequency frames over the serial port
+ */
+#include "CATControl.h"
+#endif
+
+/**
+ * code waiting out the time between loop passes
+ */
+#include "IdleSleep.h"
+
+/**
+ * event handlers and dispatch table for the operating loop
+ */
+#include "VFOEventHandlers.h"
+
+#ifdef USE_STACK_MONITOR
+/**
+ * stack high water monitor
+ */
+#include "StackMonitor.h"
+#endif
+
+#ifdef USE_CYCLE_BENCHMARK
+/**
+ * on-target cycle benchmarks
+ */
+#include "CycleBenchmark.h"
+#endif
+
 /**
  * sketch setup
  */
 void setup()   { 
+#ifdef USE_CAT_CONTROL
+   // initialize serial port at the CAT rate
+   Serial.begin(CAT_BAUD_RATE);
+#else
    // initialize serial port at a relatively languid rate               
    Serial.begin(9600);
+#endif
+
+   // report a stall reset, and force clock outputs off if there was one
+   checkStallRecovery();
+   armStallWatchdog();
+   
+   // initialize band bank, and restore the state left by the last run
+   stallBreadcrumb(STALL_TASK_SETUP_VFOS);
+   setupVFOs();
+   restoreState();
+   applyStallSafeState();
+   
+   // turn on vfos first, so RF does not wait for the display
+   stallBreadcrumb(STALL_TASK_SETUP_SI5351);
+   feedStallWatchdog();
+   setupSI5351();   
+
+   // light up display from the first loop pass
+   vfoEvents.post(EVENT_DISPLAY_START);
    
    // initialize digital input pins for button presses               
+   stallBreadcrumb(STALL_TASK_SETUP_INPUTS);
    setupInputPins();
    
    // setup encoder for frequency adjustments               
+   stallBreadcrumb(STALL_TASK_SETUP_ENCODER);
    setupEncoder();
-   
-   // initialize vfo list                
-   setupVFOs();
-   
-   // light up display               
-   setupDisplay();   
-   
-   // turn on vfos               
-   setupSI5351();   
 
    delay(SETUP_DELAY_MILS);
+
+#ifdef USE_STACK_MONITOR
+   reportMemoryUse();
+#endif
+
+#ifdef USE_CYCLE_BENCHMARK
+   // the display frame is timed too: bring the display up now, which
+   // spends the start event so the first loop pass leaves it alone
+   dispatchEvents();
+   runCycleBenchmarks();
+#endif
 }
 
 /**
  * operating loop
  */
 void loop() {
-   // selecting output vfo is first priority
-   if (VFOSelectPin.readInputPulseMode()) {
-      int mode = VFOSelectPin.getCurrentPinMode();
-      switch (mode) {
-         case PIN_MODE_SHORT_PULSE:
-            // short pulse - switch to next vfoList
-            // - turn off current clock
-            pCurrentVFO->stop();
-            
-            // increment the selected vfoList
-            currVFO = (++currVFO) % NUMBER_OF_VFOS; 
-            pCurrentVFO = vfoList[currVFO]; 
-            
-            // turn on new clock if not disabled
-            pCurrentVFO->start();
- 
-            // repaint the vfoList display
-            pDisplay->showVFOs(frequency_delta, currVFO);
-
-            // reset pin
-            VFOSelectPin.setCurrentPinMode(PIN_MODE_IDLE);
-            break;
-
-         case PIN_MODE_LONG_PULSE:
-            // long pulse - toggle vfoList enable flag
-            pCurrentVFO->toggleEnabled(); 
-            
-            // turn on new clock if not disabled
-            pCurrentVFO->start();
-
-            // repaint the vfoList display
-            pDisplay->showVFOs(frequency_delta, currVFO);
-
-            // reset pin
-            VFOSelectPin.setCurrentPinMode(PIN_MODE_IDLE);
-            break;
-      }
-   }
+   // loop is still running
+   feedStallWatchdog();
+
+   // read buttons and timers, posting events for anything that happened
+   stallBreadcrumb(STALL_TASK_TICK);
+   postTickEvents();
+
+#ifdef USE_CAT_CONTROL
+   // read and run commands from the serial port
+   checkCATCommands();
+#endif
+
+#ifdef USE_ANTENNA_ANALYZER
+   // send analyzer points as they are sampled
+   checkAnalyzer();
+#endif
 
-   // then we can check to see if frequency delta needs to change
-   if (FrequencyDeltaSelectPin.readInputPulseMode()) {
-      int mode = FrequencyDeltaSelectPin.getCurrentPinMode();
-      switch (mode) {
-         case PIN_MODE_SHORT_PULSE:
-            // short pulse - change frequency delta
-            if (frequency_delta < FREQ_DELTA_MAX) {
-               frequency_delta *= FREQ_DELTA_MULT;
-            }
-            else {
-               frequency_delta = FREQ_DELTA_MIN;
-            }
-
-            // take over display to show new frequency delta
-            pDisplay->showFreqDeltaDisplay(frequency_delta);
-            freq_delta_display_time = FREQ_DELTA_LATENCY_MILS;
-
-            // reset pin
-            FrequencyDeltaSelectPin.setCurrentPinMode(PIN_MODE_IDLE);
-            break;
-
-         case PIN_MODE_LONG_PULSE:
-            // long pulse - disable all VFOs
-            
-            for (int ii=0; ii<NUMBER_OF_VFOS; ++ii) {
-               // set band enable flag off
-               vfoList[ii]->setEnabled(false); 
-            
-               // - turn off current clock
-               vfoList[ii]->stop();
-            }
-
-            // repaint the vfoList display
-            pDisplay->showVFOs(frequency_delta, currVFO);
-            
-            // reset pin
-            FrequencyDeltaSelectPin.setCurrentPinMode(PIN_MODE_IDLE);
-            break;
-      }
+#ifdef USE_FREQUENCY_SWEEP
+   // a running sweep owns the I2C bus: its timer interrupt writes the
+   // clock, so nothing here may paint or save until it ends
+   if (checkSweep()) {
+      waitForNextLoopTick();
+      return;
    }
-  
-   // check to see if freq delta display needs to be overwritten
-   if (freq_delta_display_time > 0) {
-      // update the display time for the vfoList select pin
-      freq_delta_display_time = (freq_delta_display_time > LOOP_DELAY_MILS)
-                              ? (freq_delta_display_time -= LOOP_DELAY_MILS)
-                              : 0;
-
-      // repaint the vfoList display if freq display time exhausted
-      if (freq_delta_display_time <= 0) {
-         pDisplay->showVFOs(frequency_delta, currVFO);
-      }
+#endif
+
+#ifdef USE_FSK_BEACON
+   // so does a beacon being sent
+   if (checkBeacon()) {
+      waitForNextLoopTick();
+      return;
    }
-  
-   // re-display frequencies if encoder has made changes
-   if (updateSelectedFrequencyValue()) {
-      pDisplay->showVFOs(frequency_delta, currVFO);
+#endif
+
+#ifdef USE_MEMORY_SCAN
+   // and a memory scan, until a press pauses it
+   if (checkScan()) {
+      waitForNextLoopTick();
+      return;
    }
-   
-   delay(LOOP_DELAY_MILS);
-}
+#endif
 
+   // run handlers for posted events, then repaint once
+   dispatchEvents();
+
+   // save operating state once the controls are left alone
+   checkStatePersistence();
+
+#ifdef USE_STACK_MONITOR
+   checkStackMonitor();
+#endif
+
+   // sleep until next pass
+   waitForNextLoopTick();
+}
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+#
+# SRAM and flash budget report for the si5351vfo3b sketch
+#
+# Reads the linked .elf with avr-size and avr-nm, lists the largest
+# symbols in each memory, and fails (exit 1) when static SRAM or flash
+# use goes over budget. Static SRAM is .data + .bss + .noinit; what is
+# left of the 2 KB must hold the stack, so that is reserved out of the
+# budget. Every object in the sketch is statically allocated, so malloc
+# being linked in at all fails the check unless heap is reserved.
+# The runtime side, the real stack high water mark on the board, is
+# USE_STACK_MONITOR in the sketch (StackMonitor.h).
+#
+#    arduino-cli compile -b arduino:avr:uno --output-dir build si5351vfo3b
+#    tools/memory_budget.py build/si5351vfo3b.ino.elf
+#
+# Run it after every change that adds a feature: a build that no
+# longer leaves room for the stack fails here instead of on the bench.
+# To put numbers on the change, keep the .elf from before it and give
+# it as the baseline; the symbols that grew or shrank most are listed
+# after the report:
+#
+#    tools/memory_budget.py --baseline before.elf build/si5351vfo3b.ino.elf
+#
+import argparse
+import subprocess
+import sys
+
+SRAM_SIZE      = 2048     # ATmega328
+FLASH_SIZE     = 32256    # 32 KB less the Uno optiboot loader
+STACK_RESERVE  = 512      # deepest call chain plus interrupts, see StackMonitor.h
+HEAP_RESERVE   = 0        # everything is statically allocated
+HEAP_SYMBOLS   = ('malloc', 'free', 'realloc', 'calloc')
+
+SRAM_SECTIONS  = ('.data', '.bss', '.noinit')
+FLASH_SECTIONS = ('.text', '.data')
+
+# nm types: d/b initialized and zeroed data, t/r/w code and constants
+SRAM_TYPES     = 'dDbBvV'
+FLASH_TYPES    = 'tTrRwW'
+
+
+def run(tool, *args):
+    try:
+        return subprocess.run((tool,) + args, check=True, stdout=subprocess.PIPE,
+                              universal_newlines=True).stdout
+    except (OSError, subprocess.CalledProcessError) as err:
+        sys.exit('memory_budget: %s: %s' % (tool, err))
+
+
+def section_sizes(prefix, elf):
+    """section name -> size in bytes, from size -A"""
+    sizes = {}
+    for line in run(prefix + 'size', '-A', elf).splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith('.') and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def symbols(prefix, elf):
+    """(size, type, name) of every sized symbol, from nm"""
+    result = []
+    for line in run(prefix + 'nm', '-S', '-C', '--size-sort', elf).splitlines():
+        fields = line.split(None, 3)
+        if len(fields) == 4:
+            result.append((int(fields[1], 16), fields[2], fields[3]))
+    return result
+
+
+def report(title, used, budget, rows, top):
+    status = 'ok' if used <= budget else 'OVER BUDGET'
+    print('%s: %d of %d bytes, %d free - %s' % (title, used, budget, budget - used, status))
+    for size, kind, name in sorted(rows, reverse=True)[:top]:
+        print('   %6d  %s  %s' % (size, kind, name))
+    print()
+    return used <= budget
+
+
+def compare(title, used, base_used, rows, base_rows, top):
+    """prints the change from the baseline, and the symbols changed most"""
+    print('%s: %d bytes, was %d, %+d' % (title, used, base_used, used - base_used))
+    sizes = {}
+    for size, kind, name in base_rows:
+        sizes[name] = sizes.get(name, 0) - size
+    for size, kind, name in rows:
+        sizes[name] = sizes.get(name, 0) + size
+    changed = [(abs(d), d, name) for name, d in sizes.items() if d]
+    for _, delta, name in sorted(changed, reverse=True)[:top]:
+        print('   %+6d  %s' % (delta, name))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='SRAM and flash budget report')
+    parser.add_argument('elf', help='linked sketch .elf')
+    parser.add_argument('--sram', type=int, default=SRAM_SIZE, help='SRAM bytes')
+    parser.add_argument('--flash', type=int, default=FLASH_SIZE, help='flash bytes available to the sketch')
+    parser.add_argument('--stack', type=int, default=STACK_RESERVE, help='SRAM bytes kept for the stack')
+    parser.add_argument('--heap', type=int, default=HEAP_RESERVE, help='SRAM bytes kept for the heap')
+    parser.add_argument('--top', type=int, default=15, help='symbols listed per memory')
+    parser.add_argument('--prefix', default='avr-', help='binutils prefix')
+    parser.add_argument('--baseline', metavar='ELF', help='.elf from before a change, to report the difference')
+    args = parser.parse_args()
+
+    sizes = section_sizes(args.prefix, args.elf)
+    syms  = symbols(args.prefix, args.elf)
+
+    sram_used  = sum(sizes.get(s, 0) for s in SRAM_SECTIONS)
+    flash_used = sum(sizes.get(s, 0) for s in FLASH_SECTIONS)
+
+    sram_rows  = [s for s in syms if s[1] in SRAM_TYPES]
+    flash_rows = [s for s in syms if s[1] in FLASH_TYPES]
+
+    print('sections: ' + ', '.join('%s %d' % (s, sizes[s]) for s in sorted(sizes)
+                                   if s in SRAM_SECTIONS + FLASH_SECTIONS))
+    print()
+    ok  = report('static SRAM (%d less %d stack, %d heap)' % (args.sram, args.stack, args.heap),
+                 sram_used, args.sram - args.stack - args.heap, sram_rows, args.top)
+    ok &= report('flash', flash_used, args.flash, flash_rows, args.top)
+
+    heap = sorted(set(s[2] for s in syms if s[1] in 'tTwW' and s[2] in HEAP_SYMBOLS))
+    if heap:
+        print('heap: %s linked in%s' % (', '.join(heap),
+              '' if args.heap else ' with no heap reserved - FAIL'))
+        ok &= args.heap > 0
+    else:
+        print('heap: not linked')
+
+    if args.baseline:
+        base_sizes = section_sizes(args.prefix, args.baseline)
+        base_syms  = symbols(args.prefix, args.baseline)
+        print()
+        compare('static SRAM', sram_used, sum(base_sizes.get(s, 0) for s in SRAM_SECTIONS),
+                sram_rows, [s for s in base_syms if s[1] in SRAM_TYPES], args.top)
+        compare('flash', flash_used, sum(base_sizes.get(s, 0) for s in FLASH_SECTIONS),
+                flash_rows, [s for s in base_syms if s[1] in FLASH_TYPES], args.top)
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())